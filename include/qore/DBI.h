@@ -54,6 +54,7 @@
 #define DBI_CAP_HAS_DESCRIBE             (1 << 15) //!< supports the describe API
 #define DBI_CAP_HAS_ARRAY_BIND           (1 << 16) //!< supports binding arrays by value for bulk DML operations
 #define DBI_CAP_HAS_RESULTSET_OUTPUT     (1 << 17) //!< supports the "resultset" placeholder buffer specification
+#define DBI_CAP_HAS_STMT_BIND_ARRAY      (1 << 18) //!< supports binding column arrays to a prepared statement for bulk DML in a single driver call (set automatically by the Qore library)
 
 #define BN_PLACEHOLDER  0
 #define BN_VALUE        1
@@ -94,8 +95,9 @@
 #define QDBI_METHOD_DESCRIBE                 31
 #define QDBI_METHOD_STMT_FREE                32
 #define QDBI_METHOD_STMT_EXEC_DESCRIBE       33
+#define QDBI_METHOD_STMT_BIND_ARRAY          34
 
-#define QDBI_VALID_CODES 33
+#define QDBI_VALID_CODES 34
 
 /* DBI EVENT Types
    all DBI events must have the following keys:
@@ -238,6 +240,19 @@ typedef int (*q_dbi_stmt_prepare_raw_t)(SQLStatement* stmt, const QoreString& st
  */
 typedef int (*q_dbi_stmt_bind_t)(SQLStatement* stmt, const QoreListNode& l, ExceptionSink* xsink);
 
+//! bind column arrays for a bulk DML operation; the statement is then executed once for all rows
+/** @param stmt the statement
+    @param l the bind arguments in placeholder order; list arguments give one value for each row, all other
+    arguments are used for every row
+    @param rows the number of rows to bind; all list arguments have exactly this number of elements
+    @param xsink if any errors occur, error information should be added to this object
+
+    @returns -1 = an exception occurred, 0 = OK
+
+    @since %Qore 0.9.5
+ */
+typedef int (*q_dbi_stmt_bind_array_t)(SQLStatement* stmt, const QoreListNode& l, int64 rows, ExceptionSink* xsink);
+
 //! execute statement
 /** @returns -1 = an exception occurred, 0 = OK
  */
@@ -282,6 +297,12 @@ typedef QoreHashNode* (*q_dbi_describe_t)(Datasource* ds, const QoreString* str,
 #define DBI_OPT_NUMBER_STRING "string-numbers"    //!< numeric/decimal/number values converted to Qore strings (original solution)
 #define DBI_OPT_NUMBER_NUMERIC "numeric-numbers"  //!< numeric/decimal/number values converted to arbitrary-precision number values
 #define DBI_OPT_TIMEZONE "timezone"               //!< set server=side timezone rules for automatic conversions/date-time value tagging
+//! maximum number of prepared statements cached per connection; handled by the Datasource and not passed to drivers
+/** @since %Qore 0.9.5 */
+#define DBI_OPT_STMT_CACHE "statement-cache"
+//! read-only option returning statement cache statistics
+/** @since %Qore 0.9.5 */
+#define DBI_OPT_STMT_CACHE_STATS "statement-cache-stats"
 
 //! this is the data structure Qore DBI drivers will use to pass the supported DBI methods
 /** the minimum methods that must be supported are: open, close, select, selectRows, execSQL, execRawSQL, commit, and rollback
@@ -321,6 +342,8 @@ public:
    DLLEXPORT void add(int code, q_dbi_stmt_prepare_raw_t method);
    // covers bind, bind_placeholders, bind_values
    DLLEXPORT void add(int code, q_dbi_stmt_bind_t method);
+   // covers bind_array
+   DLLEXPORT void add(int code, q_dbi_stmt_bind_array_t method);
    // covers exec, close, affected_rows, define, and exec_describe
    DLLEXPORT void add(int code, q_dbi_stmt_exec_t method);
    // covers fetch_row, get_output, and get_output_rows
@@ -346,6 +346,8 @@ public:
 class qore_var_rwlock_priv;
 
 class QoreVarRWLock {
+    friend class qore_var_rwlock_priv;
+
 private:
     //! this function is not implemented; it is here as a private function in order to prohibit it from being used
     DLLLOCAL QoreVarRWLock(const QoreVarRWLock&);
@@ -1789,6 +1789,21 @@ public:
     */
     DLLEXPORT int64 getConnectionId() const;
 
+    //! sets the size of the buffer used for buffered socket reads
+    /** @param size the new size of the read buffer in bytes
+        @param xsink if an error occurs, the Qore-language exception information will be added here
+
+        @return 0 for OK, -1 for error (an exception is raised)
+
+        @since %Qore 0.9.5
+    */
+    DLLEXPORT int setReadBufferSize(int64 size, ExceptionSink* xsink);
+
+    //! returns the size of the buffer used for buffered socket reads
+    /** @since %Qore 0.9.5
+    */
+    DLLEXPORT int64 getReadBufferSize() const;
+
     DLLLOCAL static void doException(int rc, const char* meth, int timeout_ms, ExceptionSink* xsink);
 
     //! sets the event queue (not part of the library's pubilc API), must be already referenced before call
@@ -230,6 +230,8 @@ public:
     DLLEXPORT bool captureRemoteCertificates(bool set);
     DLLEXPORT QoreObject* getRemoteCertificate() const;
     DLLEXPORT int64 getConnectionId() const;
+    DLLEXPORT int setReadBufferSize(int64 size, ExceptionSink* xsink);
+    DLLEXPORT int64 getReadBufferSize() const;
 };
 
 #endif // _QORE_QORE_SOCKET_OBJECT_H
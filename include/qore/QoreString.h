@@ -477,8 +477,11 @@ public:
     DLLEXPORT QoreString* convertEncoding(const QoreEncoding* nccs, ExceptionSink* xsink) const;
 
     //! returns the character buffer and leaves the QoreString empty, the caller owns the memory returned (must be manually freed)
-    /** note that after this call the string buffer memory is 0 (i.e. QoreString::getBuffer() will return NULL)
-         @return the character buffer for the string, the caller owns the memory returned (must be manually freed)
+    /** @return the character buffer for the string, the caller owns the memory returned (must be manually freed)
+
+        @since %Qore 0.9.5 the string is reset to an empty string after this call (QoreString::getBuffer() no longer
+        returns nullptr), and a new buffer is allocated for the return value if the string is stored in the inline
+        buffer for short strings
     */
     DLLEXPORT char* giveBuffer();
 
@@ -228,4 +228,9 @@ DLLEXPORT extern const TypedHashDecl* hashdeclUrlInfo;
 */
 DLLEXPORT extern const TypedHashDecl* hashdeclFtpResponseInfo;
 
+//! SocketPollerEvent hashdecl
+/** @since %Qore 0.9.5
+*/
+DLLEXPORT extern const TypedHashDecl* hashdeclSocketPollerEvent;
+
 #endif
@@ -78,6 +78,10 @@ private:
       assert(dest);
       assert(limit);
 
+      // streams with data in memory are not buffered
+      if (direct)
+         return readDataDirect(xsink, dest, limit, require_all);
+
       char* destPtr = static_cast<char*>(dest);
       size_t read = 0;
 
@@ -146,6 +150,8 @@ private:
     * @return the next byte available to be read, -1 indicates end of the stream, -2 indicates an error
     */
    virtual int64 peek(ExceptionSink* xsink) override {
+      if (direct)
+         return direct->peek(xsink);
       if (!bufCount) {
          int rc = fillBuffer(bufCapacity, xsink);
          if (!rc)
@@ -42,12 +42,94 @@
 #include "qore/intern/DatasourceStatementHelper.h"
 #include "qore/intern/QoreSQLStatement.h"
 
-#include <map>
+#include <atomic>
 #include <deque>
 #include <string>
 
-typedef std::map<int, int> thread_use_t;   // for marking a datasource in use
-typedef std::deque<int> free_list_t;       // for the free list
+// number of buckets in the connection wait time histogram
+#define DSP_WAIT_BUCKETS 6
+
+// number of thread entries allocated together in DatasourcePoolThreadMap
+#define DSP_TID_BLOCK 64
+
+// pool indexes per thread; entries are allocated in blocks of TIDs when a thread in the block first uses the pool
+class DatasourcePoolThreadMap {
+public:
+    DLLLOCAL DatasourcePoolThreadMap(unsigned max_threads) : size((max_threads + DSP_TID_BLOCK - 1) / DSP_TID_BLOCK),
+            blocks(new std::atomic<Block*>[size]) {
+        for (unsigned i = 0; i < size; ++i) {
+            blocks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    DLLLOCAL ~DatasourcePoolThreadMap() {
+        for (unsigned i = 0; i < size; ++i) {
+            delete blocks[i].load(std::memory_order_relaxed);
+        }
+        delete [] blocks;
+    }
+
+    // returns the pool index allocated to the given thread or -1
+    DLLLOCAL int getSlot(int tid) const {
+        const Block* b = getBlock(tid);
+        return b ? b->e[tid % DSP_TID_BLOCK].slot.load(std::memory_order_relaxed) : -1;
+    }
+
+    // returns the pool index last used by the given thread or -1
+    DLLLOCAL int getHint(int tid) const {
+        const Block* b = getBlock(tid);
+        return b ? b->e[tid % DSP_TID_BLOCK].hint : -1;
+    }
+
+    // allocates the given pool index to the given thread; only called by the thread itself
+    DLLLOCAL void setSlot(int tid, int i) {
+        Entry& e = getCreateEntry(tid);
+        e.hint = i;
+        e.slot.store(i, std::memory_order_relaxed);
+    }
+
+    // releases the pool index allocated to the given thread; only called by the thread itself
+    DLLLOCAL void clearSlot(int tid) {
+        Block* b = getBlock(tid);
+        assert(b);
+        b->e[tid % DSP_TID_BLOCK].slot.store(-1, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        // pool index allocated to the thread or -1; only written by the thread itself
+        std::atomic<int> slot{-1};
+        // pool index last used by the thread or -1; only accessed by the thread itself
+        int hint = -1;
+    };
+
+    struct Block {
+        Entry e[DSP_TID_BLOCK];
+    };
+
+    const unsigned size;
+    std::atomic<Block*>* blocks;
+
+    DLLLOCAL Block* getBlock(int tid) const {
+        assert((unsigned)tid / DSP_TID_BLOCK < size);
+        return blocks[tid / DSP_TID_BLOCK].load(std::memory_order_acquire);
+    }
+
+    DLLLOCAL Entry& getCreateEntry(int tid) {
+        std::atomic<Block*>& bp = blocks[tid / DSP_TID_BLOCK];
+        Block* b = bp.load(std::memory_order_acquire);
+        if (!b) {
+            // another thread in the same block may install it first
+            Block* nb = new Block;
+            if (bp.compare_exchange_strong(b, nb, std::memory_order_acq_rel)) {
+                b = nb;
+            } else {
+                delete nb;
+            }
+        }
+        return b->e[tid % DSP_TID_BLOCK];
+    }
+};
 
 // class holding datasource configuration params
 class DatasourceConfig {
@@ -122,25 +204,44 @@ public:
     }
 };
 
-class DatasourcePool : public AbstractThreadResource, public QoreCondition, public QoreThreadLock, public DatasourceStatementHelper {
+class DatasourcePool : public AbstractThreadResource, public QoreThreadLock, public DatasourceStatementHelper {
     friend class DatasourcePoolActionHelper;
 protected:
+    // a thread waiting for a free connection; waiters are served in FIFO order
+    struct PoolWaiter {
+        QoreCondition cond;
+        // pool index handed off to the waiter by the thread releasing the connection
+        int slot = -1;
+    };
+    typedef std::deque<PoolWaiter*> waiter_list_t;
+
     Datasource** pool;
     int* tid_list;            // list of thread IDs per pool index
-    thread_use_t tmap;        // map from tids to pool index
-    free_list_t free_list;
+    // connection allocation flags per pool index; free connections are acquired with a CAS without the lock
+    std::atomic<bool>* in_use;
+    // pool index allocated to and last used by each thread
+    DatasourcePoolThreadMap thread_map;
+    // threads waiting for a connection; only accessed in the lock
+    waiter_list_t waiters;
 
     unsigned min,
         max,
-        cmax,                      // current max
-        wait_count,
-        wait_max,
         tl_warning_ms;
 
-    int64 tl_timeout_ms,
-        stats_reqs,
-        stats_hits
-        ;
+    // current max; only increased in the lock
+    std::atomic<unsigned> cmax;
+    // number of threads waiting on a connection
+    std::atomic<unsigned> wait_count;
+
+    int64 tl_timeout_ms;
+
+    std::atomic<int64> stats_reqs,
+        stats_hits,
+        stats_affinity;
+
+    // wait statistics; only accessed in the lock
+    int64 wait_max,
+        wait_hist[DSP_WAIT_BUCKETS];
 
     ResolvedCallReferenceNode* warning_callback;
     QoreValue callback_arg;
@@ -157,6 +258,9 @@ protected:
 
     DLLLOCAL Datasource* getAllocatedDS();
     DLLLOCAL Datasource* getDSIntern(bool& new_ds, int64& wait_total, ExceptionSink* xsink);
+    DLLLOCAL int acquireFreeSlot(int hint);
+    DLLLOCAL int acquireSlotWait(int tid, int64& wait_total, ExceptionSink* xsink);
+    DLLLOCAL void releaseSlot(int i);
     DLLLOCAL Datasource* getDS(bool& new_ds, ExceptionSink* xsink);
     DLLLOCAL void freeDS(ExceptionSink* xsink);
     // share the code for exec() and execRaw()
@@ -227,9 +331,7 @@ public:
         return pool[0]->getOptionHash();
     }
 
-    DLLLOCAL QoreValue getOption(const char* opt, ExceptionSink* xsink) {
-        return pool[0]->getOption(opt, xsink);
-    }
+    DLLLOCAL QoreValue getOption(const char* opt, ExceptionSink* xsink);
 
     // functions supporting DatasourceStatementHelper
     DLLLOCAL DatasourceStatementHelper* helperRefSelfImpl() {
@@ -257,8 +359,7 @@ public:
     }
 
     DLLLOCAL bool currentThreadInTransaction() const {
-        SafeLocker sl((QoreThreadLock*)this);
-        return tmap.find(gettid()) != tmap.end();
+        return thread_map.getSlot(gettid()) >= 0;
     }
 
     DLLLOCAL QoreHashNode* getConfigHash(ExceptionSink* xsink);
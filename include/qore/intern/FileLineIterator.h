@@ -36,6 +36,7 @@
 #include <cstring>
 
 #include "qore/intern/FileInputStream.h"
+#include "qore/intern/MmapInputStream.h"
 #include "qore/intern/InputStreamLineIterator.h"
 
 /**
@@ -44,12 +45,13 @@
 class FileLineIterator : public QoreIteratorBase {
 public:
     DLLLOCAL FileLineIterator(ExceptionSink* xsink, const QoreStringNode* name, const QoreEncoding* enc = QCS_DEFAULT,
-        const QoreStringNode* n_eol = 0, bool n_trim = true, int flags = 0) :
+        const QoreStringNode* n_eol = 0, bool n_trim = true, int flags = 0, bool use_mmap = false) :
         eol(n_eol ? n_eol->stringRefSelf() : nullptr),
         encoding(enc),
         filename(name->stringRefSelf()),
         trim(n_trim),
-        flags(flags) {
+        flags(flags),
+        use_mmap(use_mmap) {
         doReset(xsink);
     }
 
@@ -58,7 +60,8 @@ public:
         encoding(old.encoding),
         filename(old.filename->stringRefSelf()),
         trim(old.trim),
-        flags(old.flags) {
+        flags(old.flags),
+        use_mmap(old.use_mmap) {
         doReset(xsink);
     }
 
@@ -104,15 +107,15 @@ public:
     }
 
     DLLLOCAL QoreListNode* stat(ExceptionSink* xsink) {
-        return fis->getFile().stat(xsink);
+        return getFile().stat(xsink);
     }
 
     DLLLOCAL QoreHashNode* hstat(ExceptionSink* xsink) {
-        return fis->getFile().hstat(xsink);
+        return getFile().hstat(xsink);
     }
 
     DLLLOCAL bool isTty() {
-        return fis->getFile().isTty();
+        return getFile().isTty();
     }
 
     DLLLOCAL virtual void deref() {
@@ -128,23 +131,39 @@ public:
 
 private:
     DLLLOCAL void doReset(ExceptionSink* xsink) {
-        fis = new FileInputStream(*filename, -1, flags, xsink);
-        if (*xsink)
-            return;
-        fis->ref();
+        InputStream* is;
+        if (use_mmap) {
+            mis = new MmapInputStream(*filename, xsink);
+            if (*xsink)
+                return;
+            is = *mis;
+        } else {
+            fis = new FileInputStream(*filename, -1, flags, xsink);
+            if (*xsink)
+                return;
+            is = *fis;
+        }
+        is->ref();
         if (!encoding->isAsciiCompat())
-            src = new InputStreamLineIterator(xsink, new EncodingConversionInputStream(*fis, encoding, QCS_UTF8, xsink), QCS_UTF8, *eol, trim);
+            src = new InputStreamLineIterator(xsink, new EncodingConversionInputStream(is, encoding, QCS_UTF8, xsink), QCS_UTF8, *eol, trim);
         else
-            src = new InputStreamLineIterator(xsink, *fis, encoding, *eol, trim);
+            src = new InputStreamLineIterator(xsink, is, encoding, *eol, trim);
+    }
+
+    DLLLOCAL QoreFile& getFile() {
+        return use_mmap ? mis->getFile() : fis->getFile();
     }
 
     SimpleRefHolder<InputStreamLineIterator> src = nullptr;
     SimpleRefHolder<FileInputStream> fis = nullptr;
+    SimpleRefHolder<MmapInputStream> mis = nullptr;
     SimpleRefHolder<QoreStringNode> eol;
     const QoreEncoding* encoding;
     SimpleRefHolder<QoreStringNode> filename;
     bool trim;
     int flags;
+    //! if true, the file is read through a memory mapping
+    bool use_mmap;
 };
 
 #endif // _QORE_FILELINEITERATOR_H
@@ -53,6 +53,7 @@ class BarewordNode;
 class QoreFunction;
 class qore_class_private;
 class qore_ns_private;
+class QoreCallSiteCache;
 
 typedef std::vector<QoreParseTypeInfo*> ptype_vec_t;
 typedef std::vector<LocalVar*> lvar_vec_t;
@@ -194,6 +195,10 @@ public:
     LocalVar* argvid;
     LocalVar* selfid;
     bool resolved;
+    // true if the code references argv or implicit arguments, in which case argv must be set up for calls
+    bool argv_ref = false;
+    // the parse-time implicit argument reference count when the local variables were pushed
+    unsigned parse_implicit_arg_refs = 0;
 
     DLLLOCAL UserSignature(int n_first_line, int n_last_line, QoreValue params, RetTypeInfo* retTypeInfo, int64 po);
 
@@ -256,7 +261,7 @@ public:
 
     DLLLOCAL void parseInitPushLocalVars(const QoreTypeInfo* classTypeInfo);
 
-    // returns the $argv reference count
+    // pops the local variables and records whether argv is used by the code
     DLLLOCAL void parseInitPopLocalVars();
 };
 
@@ -274,13 +279,14 @@ public:
         @param self the object of the call target; not (necessarily) the current contextual object where the call is
         made.  "self" is needed to handle executing default argument expressions for normal (non-static) methods in
         case they reference class members or methods
+        @param cache the cache of the call site used to resolve the variant at runtime, if any
 
         saves current program location in case there's an exception
     */
     DLLLOCAL CodeEvaluationHelper(ExceptionSink* n_xsink, const QoreFunction* func,
         const AbstractQoreFunctionVariant*& variant, const char* n_name, const QoreListNode* args = nullptr,
         QoreObject* self = nullptr, const qore_class_private* n_qc = nullptr, qore_call_t n_ct = CT_UNUSED,
-        bool is_copy = false, const qore_class_private* cctx = nullptr);
+        bool is_copy = false, const qore_class_private* cctx = nullptr, QoreCallSiteCache* cache = nullptr);
 
     //! Creates the object for evaluating the given code (function, method, closure) with the given arguments
     /**
@@ -395,7 +401,7 @@ protected:
     bool restore_stack = false;
 
     DLLLOCAL void init(const QoreFunction* func, const AbstractQoreFunctionVariant*& variant, bool is_copy,
-        const qore_class_private* cctx, QoreObject* self);
+        const qore_class_private* cctx, QoreObject* self, QoreCallSiteCache* cache = nullptr);
 
     DLLLOCAL void setCallName(const QoreFunction* func);
 };
@@ -918,7 +924,8 @@ public:
     }
 
     // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
-    DLLLOCAL virtual QoreValue evalFunction(const AbstractQoreFunctionVariant* variant, const QoreListNode* args, QoreProgram* pgm, ExceptionSink* xsink) const;
+    // using the call site cache if given
+    DLLLOCAL virtual QoreValue evalFunction(const AbstractQoreFunctionVariant* variant, const QoreListNode* args, QoreProgram* pgm, ExceptionSink* xsink, QoreCallSiteCache* cache = nullptr) const;
 
     // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
     // this function will use destructive evaluation of "args"
@@ -36,6 +36,7 @@
 #include <qore/Qore.h>
 #include "qore/intern/QoreParseListNode.h"
 #include "qore/intern/FunctionList.h"
+#include "qore/intern/QoreCallSiteCache.h"
 
 class FunctionCallBase {
 protected:
@@ -81,6 +82,9 @@ protected:
     // such as when the node was created during background operation execution
     bool tmp_args = false;
 
+    // cache for methods and variants resolved at runtime; created on first use
+    mutable std::atomic<QoreCallSiteCache*> call_cache = {nullptr};
+
     DLLLOCAL virtual QoreValue evalImpl(bool& needs_deref, ExceptionSink* xsink) const = 0;
 
     DLLLOCAL void doFlags(int64 flags) {
@@ -113,6 +117,7 @@ public:
             args->deref(&xsink);
             args = nullptr;
         }
+        delete call_cache.load(std::memory_order_relaxed);
     }
 
     // ns can be nullptr if the function is a method
@@ -126,6 +131,11 @@ public:
         return lvids;
     }
 
+    DLLLOCAL QoreCallSiteCache* getCallSiteCache() const {
+        QoreCallSiteCache* rv = call_cache.load(std::memory_order_acquire);
+        return rv ? rv : QoreCallSiteCache::get(call_cache, loc, getName());
+    }
+
    DLLLOCAL virtual const char* getName() const = 0;
 };
 
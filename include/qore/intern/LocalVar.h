@@ -301,6 +301,9 @@ public:
     }
 };
 
+// value for a local variable stack slot that has not been resolved yet
+#define QORE_LVAR_NO_SLOT -1
+
 // now shared between parent and child Program objects for top-level local variables with global scope
 class LocalVar {
 private:
@@ -309,16 +312,18 @@ private:
         parse_assigned = false;
     const QoreTypeInfo* typeInfo;
     const QoreTypeInfo* refTypeInfo;
+    // position of the variable in the thread-local variable stack; resolved on the first access
+    mutable std::atomic<int> slot;
 
     DLLLOCAL LocalVarValue* get_var() const {
-        return thread_find_lvar(name.c_str());
+        return thread_find_lvar(name.c_str(), slot);
     }
 
 public:
-    DLLLOCAL LocalVar(const char* n_name, const QoreTypeInfo* ti) : name(n_name), typeInfo(ti), refTypeInfo(QoreTypeInfo::getReferenceTarget(ti)) {
+    DLLLOCAL LocalVar(const char* n_name, const QoreTypeInfo* ti) : name(n_name), typeInfo(ti), refTypeInfo(QoreTypeInfo::getReferenceTarget(ti)), slot(QORE_LVAR_NO_SLOT) {
     }
 
-    DLLLOCAL LocalVar(const LocalVar& old) : name(old.name), closure_use(old.closure_use), parse_assigned(old.parse_assigned), typeInfo(old.typeInfo), refTypeInfo(old.refTypeInfo) {
+    DLLLOCAL LocalVar(const LocalVar& old) : name(old.name), closure_use(old.closure_use), parse_assigned(old.parse_assigned), typeInfo(old.typeInfo), refTypeInfo(old.refTypeInfo), slot(QORE_LVAR_NO_SLOT) {
     }
 
     DLLLOCAL ~LocalVar() {
@@ -0,0 +1,109 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  MmapInputStream.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_MMAPINPUTSTREAM_H
+#define _QORE_MMAPINPUTSTREAM_H
+
+#include "qore/InputStream.h"
+
+#include <cstring>
+
+/**
+ * @brief Private data for the Qore::MmapInputStream class.
+ *
+ * The file is mapped read-only into memory; the unread data can also be accessed directly with getData() and
+ * skip(), which allows stream readers to scan the mapping without copying it first.
+ */
+class MmapInputStream : public InputStream {
+public:
+    DLLLOCAL MmapInputStream(const QoreStringNode* fileName, ExceptionSink* xsink);
+
+    DLLLOCAL ~MmapInputStream();
+
+    DLLLOCAL const char* getName() override {
+        return "MmapInputStream";
+    }
+
+    DLLLOCAL int64 read(void* ptr, int64 limit, ExceptionSink* xsink) override {
+        assert(limit > 0);
+        size_t count = len - offset;
+        if (count > static_cast<size_t>(limit)) {
+            count = limit;
+        }
+        if (count) {
+            memcpy(ptr, data + offset, count);
+            offset += count;
+        }
+        return count;
+    }
+
+    DLLLOCAL int64 peek(ExceptionSink* xsink) override {
+        if (offset == len) // No more data.
+            return -1;
+        return static_cast<unsigned char>(data[offset]);
+    }
+
+    //! returns a pointer to the next unread byte
+    DLLLOCAL const char* getData() const {
+        return data + offset;
+    }
+
+    //! returns the number of unread bytes
+    DLLLOCAL size_t available() const {
+        return len - offset;
+    }
+
+    //! marks the given number of bytes as read
+    DLLLOCAL void skip(size_t bytes) {
+        assert(bytes <= len - offset);
+        offset += bytes;
+    }
+
+    //! returns the size of the mapped file
+    DLLLOCAL size_t size() const {
+        return len;
+    }
+
+    DLLLOCAL QoreFile& getFile() {
+        return f;
+    }
+
+private:
+    QoreFile f;
+    //! the mapped file data
+    char* data = nullptr;
+    //! the size of the mapping
+    size_t len = 0;
+    //! the offset of the next unread byte
+    size_t offset = 0;
+};
+
+#endif // _QORE_MMAPINPUTSTREAM_H
@@ -76,6 +76,9 @@ public:
    DLLLOCAL static void setAccept(QoreSocketObject& sock, QoreObject* o) {
       sock.priv->setAccept(o);
    }
+
+   //! returns the socket descriptor (-1 if not open) and sets buffered to true if data is already buffered for reading
+   DLLLOCAL static int getPollInfo(QoreSocketObject& sock, bool& buffered);
 };
 
 #endif // _QORE_CLASS_QORESOCKET_H
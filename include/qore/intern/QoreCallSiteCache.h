@@ -0,0 +1,130 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreCallSiteCache.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_QORECALLSITECACHE_H
+
+#define _QORE_QORECALLSITECACHE_H
+
+#include <atomic>
+#include <string>
+
+// the number of variant and method entries in each call site cache
+#define QORE_CALL_SITE_CACHE_SIZE 4
+// the maximum number of arguments for calls whose variant resolution can be cached
+#define QORE_CALL_SITE_CACHE_MAX_ARGS 6
+
+class QoreFunction;
+class AbstractQoreFunctionVariant;
+class qore_class_private;
+class QoreMethod;
+
+//! invalidates all call site cache entries; called when functions, classes or hashdecls are modified or destroyed
+DLLLOCAL void qore_call_site_cache_invalidate();
+
+//! polymorphic inline cache for runtime variant and method resolution at a call site
+/** variants are cached by the runtime types of the arguments, methods by the class of the object called; entries are
+    read without locking, updates are serialized with a sequence counter and lookups made during an update fall back
+    to the normal resolution
+*/
+class QoreCallSiteCache {
+public:
+    DLLLOCAL QoreCallSiteCache(const QoreProgramLocation* loc, const char* name);
+
+    DLLLOCAL ~QoreCallSiteCache();
+
+    //! returns the variant for a call with the given arguments, raises an exception if no variant matches
+    DLLLOCAL const AbstractQoreFunctionVariant* findVariant(const QoreFunction* func, const QoreListNode* args,
+        const qore_class_private* class_ctx, ExceptionSink* xsink);
+
+    //! returns the method cached for the given class and class context or nullptr if not cached
+    DLLLOCAL const QoreMethod* findMethod(const QoreClass* cls, const qore_class_private* class_ctx);
+
+    //! caches the method resolved for the given class and class context
+    DLLLOCAL void addMethod(const QoreClass* cls, const qore_class_private* class_ctx, const QoreMethod* m);
+
+    //! returns the cache for a call site, creating it if necessary
+    DLLLOCAL static QoreCallSiteCache* get(std::atomic<QoreCallSiteCache*>& cache, const QoreProgramLocation* loc,
+        const char* name);
+
+    //! returns cache statistics for all call sites of the given Program that have been resolved at runtime
+    DLLLOCAL static QoreListNode* getInfo(const QoreProgram* pgm);
+
+private:
+    struct VariantEntry {
+        // the cache generation of the entry; 0 = empty
+        std::atomic<unsigned> gen = {0};
+        std::atomic<const QoreFunction*> func = {nullptr};
+        std::atomic<const qore_class_private*> class_ctx = {nullptr};
+        std::atomic<int64> po = {0};
+        std::atomic<unsigned> nargs = {0};
+        // argument type keys
+        std::atomic<const void*> args[QORE_CALL_SITE_CACHE_MAX_ARGS];
+        std::atomic<const AbstractQoreFunctionVariant*> variant = {nullptr};
+    };
+
+    struct MethodEntry {
+        // the cache generation of the entry; 0 = empty
+        std::atomic<unsigned> gen = {0};
+        std::atomic<const QoreClass*> cls = {nullptr};
+        std::atomic<const qore_class_private*> class_ctx = {nullptr};
+        std::atomic<const QoreMethod*> method = {nullptr};
+    };
+
+    VariantEntry ventry[QORE_CALL_SITE_CACHE_SIZE];
+    MethodEntry mentry[QORE_CALL_SITE_CACHE_SIZE];
+    // odd while an entry is being updated
+    std::atomic<unsigned> seq = {0};
+    // the next entries to replace; only accessed while holding the update sequence
+    unsigned vnext = 0,
+        mnext = 0;
+
+    std::atomic<int64> variant_hits = {0},
+        variant_misses = {0},
+        method_hits = {0},
+        method_misses = {0};
+
+    // the Program and location of the call site
+    const QoreProgram* pgm;
+    const QoreProgramLocation* loc;
+    std::string name;
+
+    DLLLOCAL void addVariant(unsigned gen, const QoreFunction* func, const qore_class_private* class_ctx, int64 po,
+        unsigned nargs, const void** keys, const AbstractQoreFunctionVariant* variant);
+
+    // starts an update; returns false if another thread is updating the cache
+    DLLLOCAL bool beginUpdate(unsigned& s);
+
+    DLLLOCAL void endUpdate(unsigned s) {
+        seq.store(s + 2, std::memory_order_release);
+    }
+};
+
+#endif
@@ -42,6 +42,7 @@
 #include "qore/vector_set"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <deque>
 #include <list>
@@ -66,6 +67,7 @@ typedef std::map<std::string, QoreMethod*> hm_method_t;
 
 // forward reference to private class implementation
 class qore_class_private;
+class HashShape;
 
 // map from abstract signature to variant for fast tracking of abstract variants
 //typedef vector_map_t<const char*, MethodVariantBase*> vmap_t;
@@ -648,7 +650,7 @@ public:
     }
 
     // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
-    DLLLOCAL QoreValue evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx = nullptr) const;
+    DLLLOCAL QoreValue evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx = nullptr, QoreCallSiteCache* cache = nullptr) const;
 
     // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
     DLLLOCAL QoreValue evalMethodTmpArgs(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, QoreObject* self, QoreListNode* args, const qore_class_private* cctx = nullptr) const;
@@ -671,7 +673,7 @@ public:
     }
 
     // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
-    DLLLOCAL QoreValue evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, const QoreListNode* args, const qore_class_private* cctx = nullptr) const;
+    DLLLOCAL QoreValue evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, const QoreListNode* args, const qore_class_private* cctx = nullptr, QoreCallSiteCache* cache = nullptr) const;
 
     // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
     DLLLOCAL QoreValue evalMethodTmpArgs(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, QoreListNode* args, const qore_class_private* cctx = nullptr) const;
@@ -1738,6 +1740,8 @@ public:
     QoreMemberMap members;
     // member initialization list in hierarchy nitialization order
     member_init_list_t member_init_list;
+    // shared key layout for members stored in the object's data hash; created on demand
+    mutable std::atomic<HashShape*> shape{nullptr};
 
     // static var list (map)
     QoreVarMap vars;
@@ -2130,6 +2134,18 @@ public:
         return info ? info->getClassContext(class_ctx) : nullptr;
     }
 
+    //! returns the slot of a declared member in the object data shape of this class
+    /** this = the object's class
+
+        @param mem the member name
+        @param class_ctx the current class context
+        @param typeInfo output variable for the member's type
+
+        @return the slot number or QORE_HASH_NO_SLOT if the member must be accessed by name; members stored in
+        private:internal data and members that cannot be accessed from \a class_ctx are always accessed by name
+    */
+    DLLLOCAL unsigned runtimeGetMemberSlot(const char* mem, const qore_class_private* class_ctx, const QoreTypeInfo*& typeInfo) const;
+
     DLLLOCAL bool runtimeIsMemberInternal(const char* mem) const {
         QoreMemberInfo* info = members.find(mem);
         return info && info->isLocalInternal() ? true : false;
@@ -2536,6 +2552,9 @@ public:
 
     DLLLOCAL int initMembers(QoreObject& o, bool& need_scan, ExceptionSink* xsink) const;
 
+    //! returns the shape for the object data hash or nullptr if the class has no members stored there
+    DLLLOCAL const HashShape* getShape() const;
+
     DLLLOCAL int initMember(QoreObject& o, bool& need_scan, const char* member_name, const QoreMemberInfo& info, const qore_class_private* member_class_ctx, ExceptionSink* xsink) const;
 
     DLLLOCAL void clearConstants(QoreListNode& l) {
@@ -2674,7 +2693,8 @@ public:
     DLLLOCAL void generateBuiltinSignature(const char* nspath);
     DLLLOCAL void initializeBuiltin();
 
-    DLLLOCAL QoreValue evalMethod(QoreObject* self, const char* nme, const QoreListNode* args, const qore_class_private* class_ctx, ExceptionSink* xsink) const;
+    // if cache is not null, it is used to look up and record the method resolved for the object's class
+    DLLLOCAL QoreValue evalMethod(QoreObject* self, const char* nme, const QoreListNode* args, const qore_class_private* class_ctx, ExceptionSink* xsink, QoreCallSiteCache* cache = nullptr) const;
 
     DLLLOCAL QoreValue evalMethodGate(QoreObject* self, const char* nme, const QoreListNode* args, ExceptionSink* xsink) const;
 
@@ -3350,12 +3370,12 @@ public:
         BSYSCONB(func)->eval(*parent_class, self, code, args);
     }
 
-    DLLLOCAL QoreValue eval(ExceptionSink* xsink, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx = nullptr) const {
+    DLLLOCAL QoreValue eval(ExceptionSink* xsink, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx = nullptr, QoreCallSiteCache* cache = nullptr) const {
         if (!static_flag) {
             assert(self);
-            return NMETHF(func)->evalMethod(xsink, 0, self, args, cctx);
+            return NMETHF(func)->evalMethod(xsink, 0, self, args, cctx, cache);
         }
-        return SMETHF(func)->evalMethod(xsink, 0, args, cctx);
+        return SMETHF(func)->evalMethod(xsink, 0, args, cctx, cache);
     }
 
     DLLLOCAL QoreValue evalTmpArgs(ExceptionSink* xsink, QoreObject* self, QoreListNode* args, const qore_class_private* cctx = nullptr) const {
@@ -3394,8 +3414,8 @@ public:
         return m.priv->evalPseudoMethod(variant, n, args, xsink);
     }
 
-    DLLLOCAL static QoreValue eval(const QoreMethod& m, ExceptionSink* xsink, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx = nullptr) {
-        return m.priv->eval(xsink, self, args, cctx);
+    DLLLOCAL static QoreValue eval(const QoreMethod& m, ExceptionSink* xsink, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx = nullptr, QoreCallSiteCache* cache = nullptr) {
+        return m.priv->eval(xsink, self, args, cctx, cache);
     }
 
     DLLLOCAL static QoreValue evalTmpArgs(const QoreMethod& m, ExceptionSink* xsink, QoreObject* self, QoreListNode* args, const qore_class_private* cctx = nullptr) {
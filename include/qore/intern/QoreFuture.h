@@ -0,0 +1,140 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreFuture.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_QOREFUTURE_H
+
+#define _QORE_QOREFUTURE_H
+
+#include <qore/AbstractPrivateData.h>
+#include <qore/QoreThreadLock.h>
+#include <qore/QoreCondition.h>
+
+#include <vector>
+
+class QoreFuture;
+
+//! interface for actions executed when a future is resolved
+class AbstractFutureListener {
+public:
+    DLLLOCAL virtual ~AbstractFutureListener() = default;
+
+    //! called once when the future is resolved; called without the future's lock held
+    DLLLOCAL virtual void done(QoreFuture& f, ExceptionSink* xsink) = 0;
+
+    //! releases any resources held by the listener and deletes it
+    DLLLOCAL virtual void del(ExceptionSink* xsink) = 0;
+};
+
+//! the result of an asynchronous task that is either a value or an exception
+class QoreFuture : public AbstractPrivateData {
+public:
+    DLLLOCAL QoreFuture() {
+    }
+
+    //! resolves the future with the given value or with the exception in xs if any; takes ownership of both
+    DLLLOCAL void set(QoreValue v, ExceptionSink& xs, ExceptionSink* xsink);
+
+    //! resolves the future with the given value; takes ownership of the value
+    DLLLOCAL void setValue(QoreValue v, ExceptionSink* xsink) {
+        ExceptionSink xs;
+        set(v, xs, xsink);
+    }
+
+    //! resolves the future with a copy of the exception in the given resolved future
+    DLLLOCAL void setException(const QoreFuture& src, ExceptionSink* xsink);
+
+    //! resolves the future with the given exception
+    DLLLOCAL void setException(const char* err, const char* desc, ExceptionSink* xsink);
+
+    //! waits for the future to be resolved and returns the referenced value or raises the exception
+    /** @param timeout_ms the timeout in milliseconds; 0 = wait forever, negative = do not wait
+        @param to set to true if a timeout occurred
+    */
+    DLLLOCAL QoreValue get(int timeout_ms, bool& to, ExceptionSink* xsink);
+
+    //! returns true if the future has been resolved
+    DLLLOCAL bool isDone() const {
+        AutoLocker al(m);
+        return done;
+    }
+
+    //! returns true if the future has been resolved with an exception
+    /** must only be called after the future has been resolved
+    */
+    DLLLOCAL bool hasException() const {
+        assert(done);
+        return (bool)err;
+    }
+
+    //! returns the value of a resolved future without an exception
+    DLLLOCAL const QoreValue getValue() const {
+        assert(done);
+        return value;
+    }
+
+    //! adds a listener that is called when the future is resolved; takes ownership of the listener
+    /** if the future has already been resolved, the listener is called immediately in the calling thread
+    */
+    DLLLOCAL void addListener(AbstractFutureListener* l, ExceptionSink* xsink);
+
+    DLLLOCAL virtual void deref(ExceptionSink* xsink);
+
+    //! returns a future that is resolved with the result of calling the code with the value of this future
+    DLLLOCAL QoreFuture* then(const ResolvedCallReferenceNode* code, ExceptionSink* xsink);
+
+    //! returns a future that is resolved with a list of the values of all given futures
+    DLLLOCAL static QoreFuture* all(const std::vector<QoreFuture*>& futures, ExceptionSink* xsink);
+
+protected:
+    DLLLOCAL virtual ~QoreFuture() {
+        assert(listeners.empty());
+        assert(!value);
+    }
+
+private:
+    mutable QoreThreadLock m;
+    QoreCondition cond;
+    //! the value of the future if resolved without an exception
+    QoreValue value;
+    //! the exception if the future was resolved with an exception
+    ExceptionSink err;
+    //! listeners to call when the future is resolved
+    std::vector<AbstractFutureListener*> listeners;
+    //! number of threads waiting on the result
+    int waiting = 0;
+    //! resolved flag
+    bool done = false;
+
+    //! marks the future as resolved and calls listeners; must be called with the lock held
+    DLLLOCAL void resolveIntern(SafeLocker& sl, ExceptionSink* xsink);
+};
+
+#endif // _QORE_QOREFUTURE_H
@@ -33,32 +33,400 @@
 
 #define _QORE_QOREHASHNODEINTERN_H
 
-#include <list>
+#include "qore/intern/xxhash.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+//! the number of member slots in the first block of a hash, which is allocated when the first member is added
+/** empty hashes allocate no member storage; further blocks double in size
+*/
+#ifndef QORE_HASH_FIRST_BLOCK
+#define QORE_HASH_FIRST_BLOCK 4
+#endif
+
+//! hashes with up to this many members (not counting shape slots) are searched linearly without an index
+#ifndef QORE_HASH_LINEAR_MEMBERS
+#define QORE_HASH_LINEAR_MEMBERS 8
+#endif
+
+// marks an invalid slot index
+#define QORE_HASH_NO_SLOT 0xffffffffu
+// marks a deleted entry in the open-addressed index
+#define QORE_HASH_DELETED_SLOT 0xfffffffeu
+
+//! the key of a hash member
+/** short keys are stored inline, longer keys are allocated; keys of members stored in a HashShape slot are shared
+    with the shape and are not copied
+*/
+class HashMemberKey {
+public:
+    DLLLOCAL HashMemberKey() {
+    }
+
+    DLLLOCAL ~HashMemberKey() {
+        release();
+    }
+
+    DLLLOCAL const char* c_str() const {
+        return type == HMK_INLINE ? buf : ptr;
+    }
+
+    DLLLOCAL size_t size() const {
+        return len;
+    }
+
+    //! returns true if the key has been set
+    DLLLOCAL bool isSet() const {
+        return type != HMK_NONE;
+    }
+
+    //! sets the key to a copy of the given string
+    DLLLOCAL void assign(const char* key) {
+        release();
+        len = strlen(key);
+        if (len < sizeof(buf)) {
+            memcpy(buf, key, len + 1);
+            type = HMK_INLINE;
+        } else {
+            ptr = (char*)malloc(len + 1);
+            memcpy(ptr, key, len + 1);
+            type = HMK_HEAP;
+        }
+    }
+
+    //! sets the key to the given string, which must remain valid as long as the key is set
+    DLLLOCAL void share(const char* key, size_t key_len) {
+        release();
+        ptr = const_cast<char*>(key);
+        len = key_len;
+        type = HMK_SHARED;
+    }
+
+    DLLLOCAL void clear() {
+        release();
+        len = 0;
+        type = HMK_NONE;
+    }
+
+private:
+    enum hmk_type_e : unsigned char {
+        HMK_NONE = 0,
+        HMK_INLINE = 1,
+        HMK_HEAP = 2,
+        HMK_SHARED = 3,
+    };
+
+    union {
+        char buf[16];
+        char* ptr;
+    };
+    unsigned len = 0;
+    hmk_type_e type = HMK_NONE;
+
+    DLLLOCAL HashMemberKey(const HashMemberKey&) = delete;
+    DLLLOCAL HashMemberKey& operator=(const HashMemberKey&) = delete;
+
+    DLLLOCAL void release() {
+        if (type == HMK_HEAP) {
+            free(ptr);
+        }
+    }
+};
+
+//! a shared key layout for hashes whose keys are known in advance
+/** used for hashdecl hashes and object member data; each key has a fixed slot number, and hashes using the shape
+    reserve the first size() slots for the keys in the shape, so members can be accessed by slot number and the
+    keys themselves are shared with the shape
 
-// to maintain the order of inserts
+    a shape can extend a parent shape, in which case the parent's keys have the same slot numbers in the child
+*/
+class HashShape {
+public:
+    DLLLOCAL HashShape(const HashShape* parent = nullptr);
+
+    //! adds a key to the shape; returns the slot number of the key; only legal before the shape is finalized
+    DLLLOCAL unsigned addKey(const char* key);
+
+    //! builds the index; must be called before the shape is used
+    DLLLOCAL void finalize();
+
+    DLLLOCAL unsigned size() const {
+        return (unsigned)keys.size();
+    }
+
+    DLLLOCAL const std::string& getKey(unsigned slot) const {
+        return keys[slot];
+    }
+
+    DLLLOCAL unsigned getHashCode(unsigned slot) const {
+        return hash_codes[slot];
+    }
+
+    //! returns the slot number of the given key or QORE_HASH_NO_SLOT if not present
+    DLLLOCAL unsigned find(const char* key) const {
+        return find(key, (unsigned)qore_hash_str()(key));
+    }
+
+    //! returns the slot number of the given key with the given hash code or QORE_HASH_NO_SLOT if not present
+    DLLLOCAL unsigned find(const char* key, unsigned hash_code) const;
+
+    //! returns true if this shape is the given shape or is derived from it
+    DLLLOCAL bool extends(const HashShape* other) const {
+        for (const HashShape* s = this; s; s = s->parent) {
+            if (s == other) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    DLLLOCAL void ref() const {
+        ++refs;
+    }
+
+    DLLLOCAL void deref() const;
+
+private:
+    // shapes can be referenced by a very large number of hashes, so QoreReferenceCounter is not used here
+    mutable std::atomic<unsigned> refs;
+    const HashShape* parent;
+    std::vector<std::string> keys;
+    std::vector<unsigned> hash_codes;
+    // open-addressed index of slot numbers
+    std::vector<unsigned> index;
+    unsigned index_mask = 0;
+#ifdef DEBUG
+    bool finalized = false;
+#endif
+
+    DLLLOCAL ~HashShape();
+};
+
+// a member of a hash; members are stored in blocks owned by the HashMemberList and are never moved once created
 class HashMember {
 public:
     QoreValue val;
-    std::string key;
+    HashMemberKey key;
+    // hash code of the key; only valid when the list has an index or for shape slots
+    unsigned hash_code = 0;
+    // the previous and next slots in insertion order
+    unsigned prev = QORE_HASH_NO_SLOT;
+    unsigned next = QORE_HASH_NO_SLOT;
+};
+
+//! ordered hash member storage
+/** members are stored in a dense slot array; the first QORE_HASH_FIRST_BLOCK slots are stored in a block that is
+    allocated with the first member, further slots are stored in blocks that double in size, so member addresses
+    are stable for the lifetime of the member.
+
+    Insertion order is maintained with slot links so that iterators and member pointers behave like std::list
+    iterators; deleted slots are reused for new members.
+
+    When the hash grows beyond QORE_HASH_LINEAR_MEMBERS members, an open-addressed index (linear probing) of slot numbers is
+    created for lookups; smaller hashes are searched linearly.
+
+    If a HashShape is set, the first slots are reserved for the keys in the shape and are looked up with the
+    shape's index; keys not in the shape are stored in the following slots as above.
+*/
+class HashMemberList {
+public:
+    // bidirectional iterator with std::list semantics; the end iterator can be decremented to the last element
+    class iterator {
+    friend class HashMemberList;
+    public:
+        DLLLOCAL iterator() {
+        }
+
+        DLLLOCAL HashMember* operator*() const {
+            return l->getSlot(i);
+        }
 
-    DLLLOCAL HashMember(const char* n_key) : key(n_key) {
+        DLLLOCAL iterator& operator++() {
+            i = l->getSlot(i)->next;
+            return *this;
+        }
+
+        DLLLOCAL iterator& operator--() {
+            i = (i == QORE_HASH_NO_SLOT) ? l->tail : l->getSlot(i)->prev;
+            return *this;
+        }
+
+        DLLLOCAL bool operator==(const iterator& other) const {
+            return i == other.i;
+        }
+
+        DLLLOCAL bool operator!=(const iterator& other) const {
+            return i != other.i;
+        }
+
+    private:
+        const HashMemberList* l = nullptr;
+        unsigned i = QORE_HASH_NO_SLOT;
+
+        DLLLOCAL iterator(const HashMemberList* l, unsigned i) : l(l), i(i) {
+        }
+    };
+
+    typedef iterator const_iterator;
+
+    DLLLOCAL HashMemberList() {
     }
 
-    DLLLOCAL ~HashMember() {
+    DLLLOCAL ~HashMemberList() {
+        freeStorage();
     }
-};
 
-typedef std::list<HashMember*> qhlist_t;
+    DLLLOCAL iterator begin() const {
+        return iterator(this, head);
+    }
 
-#ifdef HAVE_QORE_HASH_MAP
-//#warning compiling with hash_map
-#include <qore/hash_map_include.h>
-#include "qore/intern/xxhash.h"
+    DLLLOCAL iterator end() const {
+        return iterator(this, QORE_HASH_NO_SLOT);
+    }
+
+    DLLLOCAL size_t size() const {
+        return count;
+    }
+
+    DLLLOCAL bool empty() const {
+        return !count;
+    }
+
+    DLLLOCAL HashMember* front() const {
+        assert(count);
+        return getSlot(head);
+    }
+
+    DLLLOCAL HashMember* back() const {
+        assert(count);
+        return getSlot(tail);
+    }
+
+    //! returns true if the list has an index for lookups
+    DLLLOCAL bool hasIndex() const {
+        return (bool)index;
+    }
+
+    //! returns the number of member blocks allocated
+    DLLLOCAL unsigned getBlockCount() const {
+        return first_block ? (unsigned)blocks.size() + 1 : 0;
+    }
+
+    //! sets the shape for the list, which must be empty and have no shape
+    DLLLOCAL void setShape(const HashShape* s);
+
+    DLLLOCAL const HashShape* getShape() const {
+        return shape;
+    }
+
+    //! returns the member in the given shape slot or nullptr if the member is not present
+    DLLLOCAL HashMember* getShapeMember(unsigned s) const {
+        assert(s < shape_size);
+        HashMember* m = getSlot(s);
+        return m->key.isSet() ? m : nullptr;
+    }
+
+    //! returns the member with the given key or nullptr if not present
+    DLLLOCAL HashMember* find(const char* key) const {
+        unsigned s = findSlot(key);
+        return s == QORE_HASH_NO_SLOT ? nullptr : getSlot(s);
+    }
 
-typedef HASH_MAP<const char*, qhlist_t::iterator, qore_hash_str, eqstr> hm_hm_t;
+    //! returns the member with the given key, creating it at the end of the list if not present
+    DLLLOCAL HashMember* findCreate(const char* key);
+
+    //! returns the member in the given shape slot, creating it at the end of the list if not present
+    DLLLOCAL HashMember* findCreateShapeMember(unsigned s);
+
+    //! removes the member from the list; the value must be cleared by the caller before this call
+    DLLLOCAL void erase(iterator i);
+
+    //! removes the member with the given key from the list and returns its value; the caller owns the value
+    DLLLOCAL QoreValue take(const char* key, bool& exists);
+
+    //! removes all members; values must be cleared by the caller before this call
+    DLLLOCAL void clear();
+
+    //! returns an iterator pointing to the member with the given key or end() if not present
+    DLLLOCAL iterator getIterator(const char* key) const {
+        return iterator(this, findSlot(key));
+    }
+
+private:
+    // the first member block; nullptr if no member has been added
+    HashMember* first_block = nullptr;
+    // further member blocks; block n holds (QORE_HASH_FIRST_BLOCK << n) members
+    std::vector<HashMember*> blocks;
+    // open-addressed index of slot numbers; nullptr if not yet needed
+    unsigned* index = nullptr;
+    // index size - 1; the index size is always a power of 2
+    unsigned index_mask = 0;
+    // number of used (live + deleted) index entries
+    unsigned index_used = 0;
+    // number of live members
+    unsigned count = 0;
+    // number of slots ever used
+    unsigned slots = 0;
+    // first and last slots in insertion order
+    unsigned head = QORE_HASH_NO_SLOT;
+    unsigned tail = QORE_HASH_NO_SLOT;
+    // list of free slots, linked through HashMember::next
+    unsigned free_head = QORE_HASH_NO_SLOT;
+    // the shape for the first slots, if any
+    const HashShape* shape = nullptr;
+    // number of slots reserved for the shape
+    unsigned shape_size = 0;
+    // number of live members in shape slots
+    unsigned shape_count = 0;
+
+    DLLLOCAL HashMemberList(const HashMemberList&) = delete;
+    DLLLOCAL HashMemberList& operator=(const HashMemberList&) = delete;
+
+    DLLLOCAL static unsigned hashKey(const char* key) {
+        return (unsigned)qore_hash_str()(key);
+    }
+
+    DLLLOCAL HashMember* getSlot(unsigned s) const {
+        assert(s < slots);
+        if (s < QORE_HASH_FIRST_BLOCK) {
+            return &first_block[s];
+        }
+        // find the block: block n starts at slot (QORE_HASH_FIRST_BLOCK << n)
+        unsigned q = s / QORE_HASH_FIRST_BLOCK;
+#ifdef __GNUC__
+        unsigned b = 31 - __builtin_clz(q);
 #else
-typedef std::map<const char*, qhlist_t::iterator, ltstr> hm_hm_t;
+        unsigned b = 0;
+        while (q >>= 1) {
+            ++b;
+        }
 #endif
+        return &blocks[b][s - (QORE_HASH_FIRST_BLOCK << b)];
+    }
+
+    DLLLOCAL unsigned findSlot(const char* key) const;
+
+    // appends the slot to the ordered list
+    DLLLOCAL void link(unsigned s);
+
+    // returns a free slot, allocating a new block if necessary
+    DLLLOCAL unsigned getFreeSlot();
+
+    // adds the slot to the index
+    DLLLOCAL void indexAdd(unsigned s, unsigned hash_code);
+
+    // removes the slot from the index
+    DLLLOCAL void indexRemove(unsigned s);
+
+    // rebuilds the index with the given size, which must be a power of 2
+    DLLLOCAL void rebuildIndex(unsigned size);
+
+    DLLLOCAL void freeStorage();
+};
+
+typedef HashMemberList qhlist_t;
 
 // QoreHashIterator private class
 class qhi_priv {
@@ -121,7 +489,6 @@ public:
 class qore_hash_private {
 public:
     qhlist_t member_list;
-    hm_hm_t hm;
     // either hashdecl or complexTypeInfo can be set, but not both
     const TypedHashDecl* hashdecl = nullptr;
     const QoreTypeInfo* complexTypeInfo = nullptr;
@@ -155,10 +522,10 @@ public:
     DLLLOCAL QoreValue getReferencedKeyValueIntern(const char* key, bool& exists) const {
         assert(key);
 
-        hm_hm_t::const_iterator i = hm.find(key);
-        if (i != hm.end()) {
+        HashMember* m = member_list.find(key);
+        if (m) {
             exists = true;
-            return (*(i->second))->val.refSelf();
+            return m->val.refSelf();
         }
 
         exists = false;
@@ -167,11 +534,11 @@ public:
 
     DLLLOCAL int64 getKeyAsBigInt(const char* key, bool &found) const {
         assert(key);
-        hm_hm_t::const_iterator i = hm.find(key);
+        HashMember* m = member_list.find(key);
 
-        if (i != hm.end()) {
+        if (m) {
             found = true;
-            return (*(i->second))->val.getAsBigInt();
+            return m->val.getAsBigInt();
         }
 
         found = false;
@@ -180,11 +547,11 @@ public:
 
     DLLLOCAL bool getKeyAsBool(const char* key, bool& found) const {
         assert(key);
-        hm_hm_t::const_iterator i = hm.find(key);
+        HashMember* m = member_list.find(key);
 
-        if (i != hm.end()) {
+        if (m) {
             found = true;
-            return (*(i->second))->val.getAsBool();
+            return m->val.getAsBool();
         }
 
         found = false;
@@ -193,40 +560,23 @@ public:
 
     DLLLOCAL bool existsKey(const char* key) const {
         assert(key);
-        return hm.find(key) != hm.end();
+        return member_list.find(key) != nullptr;
     }
 
     DLLLOCAL bool existsKeyValue(const char* key) const {
         assert(key);
-        hm_hm_t::const_iterator i = hm.find(key);
-        if (i == hm.end())
-            return false;
-        return !(*(i->second))->val.isNothing();
+        HashMember* m = member_list.find(key);
+        return m && !m->val.isNothing();
     }
 
-    DLLLOCAL HashMember* findMember(const char* key) {
+    DLLLOCAL HashMember* findMember(const char* key) const {
         assert(key);
-        hm_hm_t::iterator i = hm.find(key);
-        return i != hm.end() ? (*(i->second)) : nullptr;
+        return member_list.find(key);
     }
 
-   DLLLOCAL HashMember* findCreateMember(const char* key) {
-        // otherwise create the new hash entry
-        HashMember* om = findMember(key);
-        if (om)
-            return om;
-
-        om = new HashMember(key);
-        assert(om->val.isNothing());
-        member_list.push_back(om);
-
-        // add to the map
-        qhlist_t::iterator i = member_list.end();
-        --i;
-        hm[om->key.c_str()] = i;
-
-        // return the new member
-        return om;
+    DLLLOCAL HashMember* findCreateMember(const char* key) {
+        assert(key);
+        return member_list.findCreate(key);
     }
 
     DLLLOCAL QoreValue& getValueRef(const char* key) {
@@ -234,27 +584,18 @@ public:
     }
 
     // NOTE: does not delete the value, this must be done by the caller before this call
-    // also does not delete map entry; must be done outside this call
     DLLLOCAL void internDeleteKey(qhlist_t::iterator i) {
-        HashMember* om = *i;
-
         member_list.erase(i);
-
-        // free om memory
-        delete om;
     }
 
     DLLLOCAL void deleteKey(const char* key, ExceptionSink *xsink) {
         assert(key);
 
-        hm_hm_t::iterator i = hm.find(key);
+        qhlist_t::iterator li = member_list.getIterator(key);
 
-        if (i == hm.end())
+        if (li == member_list.end())
             return;
 
-        qhlist_t::iterator li = i->second;
-        hm.erase(i);
-
         // dereference node if present
         AbstractQoreNode* n = (*li)->val.assignNothing();
         if (n) {
@@ -277,17 +618,11 @@ public:
     DLLLOCAL QoreValue takeKeyValueIntern(const char* key) {
         assert(key);
 
-        hm_hm_t::iterator i = hm.find(key);
-
-        if (i == hm.end())
+        bool exists;
+        QoreValue rv = member_list.take(key, exists);
+        if (!exists)
             return QoreValue();
 
-        qhlist_t::iterator li = i->second;
-        hm.erase(i);
-
-        QoreValue rv = (*li)->val;
-        internDeleteKey(li);
-
         if (needs_scan(rv))
             incScanCount(-1);
 
@@ -308,6 +643,9 @@ public:
 
     DLLLOCAL int getLValue(const char* key, LValueHelper& lvh, bool for_remove, ExceptionSink* xsink);
 
+    //! sets the hashdecl for a new hash and uses the hashdecl's shape for member storage
+    DLLLOCAL void setHashDecl(const TypedHashDecl* hd);
+
     DLLLOCAL void getTypeName(QoreString& str) const {
         if (hashdecl)
             str.sprintf("hash<%s>", hashdecl->getName());
@@ -323,7 +661,7 @@ public:
     DLLLOCAL QoreHashNode* getCopy() const {
         QoreHashNode* h = new QoreHashNode;
         if (hashdecl)
-            h->priv->hashdecl = hashdecl;
+            h->priv->setHashDecl(hashdecl);
         if (complexTypeInfo)
             h->priv->complexTypeInfo = complexTypeInfo;
         return h;
@@ -332,7 +670,7 @@ public:
     DLLLOCAL QoreHashNode* getEmptyCopy(bool is_value) const {
         QoreHashNode* h = new QoreHashNode(!is_value);
         if (hashdecl)
-            h->priv->hashdecl = hashdecl;
+            h->priv->setHashDecl(hashdecl);
         if (complexTypeInfo)
             h->priv->complexTypeInfo = complexTypeInfo;
         return h;
@@ -377,7 +715,7 @@ public:
         }
         QoreHashNode* h = new QoreHashNode;
         // copy all members to new object
-        for (auto& i : member_list) {
+        for (HashMember* i : member_list) {
             hash_assignment_priv ha(*h, i->key.c_str());
             QoreValue v = copy_strip_complex_types(i->val);
 #ifdef DEBUG
@@ -392,7 +730,7 @@ public:
 
     DLLLOCAL void copyIntern(qore_hash_private& h) const {
         // copy all members to new object
-        for (auto& i : member_list) {
+        for (HashMember* i : member_list) {
             hash_assignment_priv ha(h, i->key.c_str());
 #ifdef DEBUG
             assert(ha.swap(i->val.refSelf()).isNothing());
@@ -414,7 +752,7 @@ public:
         QoreHashNodeHolder h(getCopy(), xsink);
 
         for (qhlist_t::const_iterator i = member_list.begin(), e = member_list.end(); i != e; ++i) {
-            h->priv->setKeyValue((*i)->key, (*i)->val.refSelf(), xsink);
+            h->priv->setKeyValue((*i)->key.c_str(), (*i)->val.refSelf(), xsink);
             if (*xsink)
                 return nullptr;
         }
@@ -446,19 +784,17 @@ public:
 
     DLLLOCAL bool derefImpl(ExceptionSink* xsink, bool reverse = false) {
         if (reverse) {
-            for (qhlist_t::reverse_iterator i = member_list.rbegin(), e = member_list.rend(); i != e; ++i) {
+            for (qhlist_t::iterator i = member_list.end(), e = member_list.begin(); i != e;) {
+                --i;
                 (*i)->val.discard(xsink);
-                delete *i;
             }
         } else {
             for (qhlist_t::iterator i = member_list.begin(), e = member_list.end(); i != e; ++i) {
                 (*i)->val.discard(xsink);
-                delete *i;
             }
         }
 
         member_list.clear();
-        hm.clear();
         obj_count = 0;
         return true;
     }
@@ -516,7 +852,7 @@ public:
 
     DLLLOCAL static QoreHashNode* newHashDecl(const TypedHashDecl* hd) {
         QoreHashNode* rv = new QoreHashNode;
-        rv->priv->hashdecl = hd;
+        rv->priv->setHashDecl(hd);
         return rv;
     }
 
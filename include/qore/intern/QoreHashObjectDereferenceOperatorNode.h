@@ -33,10 +33,21 @@
 
 #define _QORE_QOREHASHOBJECTDEREFERENCEOPERATORNODE_H
 
+#include <atomic>
+
 class QoreHashObjectDereferenceOperatorNode : public QoreBinaryOperatorNode<> {
 OP_COMMON
 protected:
     const QoreTypeInfo* typeInfo;
+    // the hashdecl of the left-hand side if known at parse time and the right-hand side is a constant member name
+    const TypedHashDecl* member_hd = nullptr;
+    // the slot of the member in the hashdecl's shape; (unsigned)-1 if not yet resolved
+    mutable std::atomic<unsigned> member_slot{(unsigned)-1};
+
+    //! returns the member value directly from the hashdecl's shape slot if possible
+    /** @return true if the hash uses the hashdecl's shape and \a rv was set, false if a normal lookup is required
+    */
+    DLLLOCAL bool getShapeMemberValue(const QoreHashNode& h, QoreValue& rv) const;
 
     DLLLOCAL QoreValue evalImpl(bool& needs_deref, ExceptionSink* xsink) const;
 
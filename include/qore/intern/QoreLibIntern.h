@@ -537,6 +537,46 @@ DLLLOCAL extern QoreThreadLock lck_gmtime;
 
 DLLLOCAL extern char table64[64];
 
+//! returns true if the base64 and hex codec functions use SIMD kernels on this CPU
+DLLLOCAL bool q_codec_simd();
+
+//! returns the length of the base64 encoding of \a len bytes including padding and without line breaks
+static inline qore_size_t q_base64_encoded_len(qore_size_t len) {
+    return ((len + 2) / 3) * 4;
+}
+
+//! base64-encodes \a len bytes from \a src to \a dst including padding; returns the number of characters written
+/** \a dst must have room for at least q_base64_encoded_len(len) characters; no terminating null is written
+*/
+DLLLOCAL qore_size_t q_base64_encode(char* dst, const unsigned char* src, qore_size_t len);
+
+//! decodes complete groups of four base64 characters from \a src to \a dst
+/** stops before the first group that is incomplete or that contains any character outside the base64 alphabet
+    (line breaks, padding, invalid characters), so the caller can handle it with the full parser
+
+    @param dst the output buffer; must have room for at least (len / 4) * 3 bytes
+    @param src the base64 input
+    @param len the length of the input in bytes
+    @param read the number of input bytes consumed
+
+    @return the number of bytes written to \a dst
+*/
+DLLLOCAL qore_size_t q_base64_decode_groups(char* dst, const char* src, qore_size_t len, qore_size_t& read);
+
+//! returns the 6-bit value of the given base64 character or -1 if the character is not in the base64 alphabet
+DLLLOCAL int q_base64_value(char c);
+
+//! hex-encodes \a len bytes from \a src to \a dst with lower-case digits; writes exactly 2 * len characters
+DLLLOCAL void q_hex_encode(char* dst, const unsigned char* src, qore_size_t len);
+
+//! decodes pairs of hex digits from \a src to \a dst; returns the number of bytes written
+/** stops before the first pair containing a character that is not a hex digit; \a len must be even
+*/
+DLLLOCAL qore_size_t q_hex_decode(char* dst, const char* src, qore_size_t len);
+
+//! returns the value of the given hex digit or -1 if the character is not a hex digit
+DLLLOCAL int q_hex_value(char c);
+
 DLLLOCAL int get_nibble(char c, ExceptionSink* xsink);
 DLLLOCAL BinaryNode* parseHex(const QoreProgramLocation* loc, const char* buf, int len);
 DLLLOCAL void print_node(FILE* fp, const QoreValue qv);
@@ -722,9 +762,11 @@ private:
 public:
    T var[S1];
    int pos;
+   // index of the block in the stack
+   int idx;
    ThreadBlock<T, S1>* prev, * next;
 
-   DLLLOCAL ThreadBlock(ThreadBlock* n_prev = 0) : pos(0), prev(n_prev), next(0) { }
+   DLLLOCAL ThreadBlock(ThreadBlock* n_prev = 0) : pos(0), idx(n_prev ? n_prev->idx + 1 : 0), prev(n_prev), next(0) { }
    DLLLOCAL ~ThreadBlock() { }
    DLLLOCAL T& get(int p) {
       return var[p];
@@ -947,6 +989,9 @@ DLLLOCAL int q_get_mode(const QoreString& path);
  */
 DLLLOCAL qore_offset_t q_UTF8_get_char_len(const char* p, qore_size_t valid_len);
 
+//! returns the number of bytes at the start of the given buffer that are ASCII characters
+DLLLOCAL qore_size_t q_ascii_prefix_len(const char* p, qore_size_t len);
+
 //! returns the byte length of the next UTF-16 (big-endian encoded) character or 0 for an encoding error or a negative number if the string is too short to represent the character
 /** FIXME: change return type to qore_offset_t
  */
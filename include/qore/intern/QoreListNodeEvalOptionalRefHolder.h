@@ -39,13 +39,21 @@ private:
     QoreListNode* val;
     ExceptionSink* xsink;
     bool needs_deref;
+    // true if "val" is an argument list to be released for reuse
+    bool recycle = false;
 
     DLLLOCAL void discardIntern() {
         if (needs_deref && val) {
-            val->deref(xsink);
+            if (recycle)
+                releaseArgs();
+            else
+                val->deref(xsink);
         }
+        recycle = false;
     }
 
+    DLLLOCAL void releaseArgs();
+
     DLLLOCAL void evalIntern(const QoreListNode* exp) {
         if (exp) {
             val = exp->evalList(needs_deref, xsink);
@@ -110,6 +118,11 @@ public:
         evalIntern(exp);
     }
 
+    //! assigns the arguments for a call by executing the given list, dereferences the old object if necessary
+    /** the arguments are evaluated into a list reused from previous calls in the same thread where possible
+    */
+    DLLLOCAL void assignEvalArgs(const QoreListNode* exp);
+
     //! assigns a new value and dereference flag to this object, dereferences the old object if necessary
     DLLLOCAL void assign(bool n_needs_deref, QoreListNode* n_val) {
         discardIntern();
@@ -130,6 +143,7 @@ public:
     DLLLOCAL QoreListNode* getReferencedValue() {
         if (needs_deref) {
             needs_deref = false;
+            recycle = false;
         }
         else if (val) {
             val->ref();
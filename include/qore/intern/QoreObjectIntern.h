@@ -220,6 +220,9 @@ public:
 
     DLLLOCAL int getLValue(const char* key, LValueHelper& lvh, const qore_class_private* class_ctx, bool for_remove, ExceptionSink* xsink);
 
+    // gets an lvalue for a declared member resolved to the given slot with qore_class_private::runtimeGetMemberSlot()
+    DLLLOCAL int getLValueSlot(const HashShape* shape, unsigned slot, const char* key, const QoreTypeInfo* mti, LValueHelper& lvh, bool for_remove, ExceptionSink* xsink);
+
     DLLLOCAL QoreStringNode* firstKey(ExceptionSink* xsink) {
         // get the current class context
         const qore_class_private* class_ctx = runtime_get_class();
@@ -399,6 +402,9 @@ public:
 
     DLLLOCAL QoreValue getReferencedMemberNoMethod(const char* mem, ExceptionSink* xsink) const;
 
+    // returns a declared member resolved to the given slot with qore_class_private::runtimeGetMemberSlot()
+    DLLLOCAL QoreValue getReferencedMemberSlot(const HashShape* shape, unsigned slot, const char* mem, ExceptionSink* xsink) const;
+
     // lock not held on entry
     DLLLOCAL void doDeleteIntern(ExceptionSink* xsink) {
         printd(5, "qore_object_private::doDeleteIntern() execing destructor() obj: %p\n", obj);
@@ -703,6 +709,10 @@ public:
         return obj.priv->getLValue(key, lvh, class_ctx, for_remove, xsink);
     }
 
+    DLLLOCAL static int getLValueSlot(const QoreObject& obj, const HashShape* shape, unsigned slot, const char* key, const QoreTypeInfo* mti, LValueHelper& lvh, bool for_remove, ExceptionSink* xsink) {
+        return obj.priv->getLValueSlot(shape, slot, key, mti, lvh, for_remove, xsink);
+    }
+
     DLLLOCAL static void plusEquals(QoreObject* obj, const AbstractQoreNode* v, AutoVLock& vl, ExceptionSink* xsink) {
         obj->priv->plusEquals(v, vl, xsink);
     }
@@ -0,0 +1,106 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreParallelPool.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_INTERN_QOREPARALLELPOOL_H
+#define _QORE_INTERN_QOREPARALLELPOOL_H
+
+#include <qore/QoreThreadLock.h>
+#include <qore/QoreCondition.h>
+#include <qore/QoreCounter.h>
+
+#include <atomic>
+#include <deque>
+
+//! a job that can be executed in chunks in parallel by the QoreParallelPool
+class AbstractParallelJob {
+public:
+    DLLLOCAL virtual ~AbstractParallelJob() {
+    }
+
+    //! executes the given chunk; can be called in any thread
+    DLLLOCAL virtual void runChunk(size_t chunk, ExceptionSink* xsink) = 0;
+};
+
+//! process-wide pool of library threads executing chunks of parallel jobs
+/** threads are started on demand up to the number of CPUs - 1; the thread submitting a job also executes chunks
+    of the job, so nested parallel jobs cannot deadlock the pool
+*/
+class QoreParallelPool {
+public:
+    DLLLOCAL QoreParallelPool() {
+    }
+
+    //! executes all chunks of the job and returns when all chunks have been executed
+    /** chunks are executed in the calling thread and in pool threads; after an exception is raised, no further
+        chunks are started and the first exception is raised in \a xsink
+
+        @return 0 for OK, -1 if an exception was raised
+    */
+    DLLLOCAL int run(AbstractParallelJob& job, size_t chunks, ExceptionSink* xsink);
+
+    //! returns the maximum number of threads that can execute chunks of a job including the calling thread
+    DLLLOCAL unsigned getConcurrency();
+
+    //! stops all pool threads; called when the library is shut down
+    DLLLOCAL void del();
+
+private:
+    struct ParallelJobState;
+
+    QoreThreadLock m;
+    //! pool threads wait on this condition for jobs
+    QoreCondition cond;
+    //! callers wait on this condition for pool threads to finish with their jobs
+    QoreCondition done_cond;
+    //! jobs with chunks that have not been started yet
+    std::deque<ParallelJobState*> jobs;
+    //! counts running pool threads
+    QoreCounter tcount;
+    //! the maximum number of pool threads; -1 = not yet initialized
+    int max_threads = -1;
+    //! the number of pool threads started
+    int threads = 0;
+    //! the number of pool threads waiting for a job
+    int idle = 0;
+    bool stopflag = false;
+
+    DLLLOCAL void worker(ExceptionSink* xsink);
+
+    DLLLOCAL void runChunks(ParallelJobState& js);
+
+    DLLLOCAL void initUnlocked();
+
+    DLLLOCAL static void startWorker(ExceptionSink* xsink, void* arg);
+};
+
+DLLLOCAL extern QoreParallelPool qore_parallel_pool;
+
+#endif
@@ -36,6 +36,7 @@
 #include <qore/QoreThreadLock.h>
 #include <qore/QoreCondition.h>
 
+#include <atomic>
 #include <string>
 
 class qore_object_private;
@@ -78,6 +79,116 @@ public:
 #define QW_TIMEOUT -2
 #define QW_ERROR   -3
 
+// Queue constructor flags
+#define QUEUE_LOCKFREE (1 << 0)
+
+// the assumed size of a CPU cache line, used to keep independently updated atomic variables apart
+#define QORE_CACHE_LINE_SIZE 64
+
+//! a bounded lock-free multi-producer multi-consumer ring buffer
+/** each slot carries a sequence number that tells producers and consumers whether the slot is free or filled for
+    the current lap of the buffer, so neither side needs a lock or allocates memory per element
+ */
+class QoreQueueRing {
+public:
+    DLLLOCAL QoreQueueRing(size_t cap) : slots(new QoreQueueRingSlot[cap]), cap(cap) {
+        assert(cap);
+        for (size_t i = 0; i < cap; ++i) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    DLLLOCAL ~QoreQueueRing() {
+        delete [] slots;
+    }
+
+    //! appends a value to the ring and takes the reference; returns false if the ring is full
+    DLLLOCAL bool push(QoreValue v) {
+        QoreQueueRingSlot* slot;
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            slot = &slots[pos % cap];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (!dif) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->val = v;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! removes the first value from the ring; returns false if the ring is empty
+    DLLLOCAL bool shift(QoreValue& v) {
+        QoreQueueRingSlot* slot;
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            slot = &slots[pos % cap];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+            if (!dif) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        v = slot->val;
+        slot->val = QoreValue();
+        slot->seq.store(pos + cap, std::memory_order_release);
+        return true;
+    }
+
+    //! returns the number of values in the ring; only exact if there are no concurrent operations
+    DLLLOCAL size_t size() const {
+        size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_acquire);
+        return t > h ? (t - h > cap ? cap : t - h) : 0;
+    }
+
+    DLLLOCAL size_t capacity() const {
+        return cap;
+    }
+
+    //! calls the given function with each value in the ring in order; there must be no concurrent operations
+    template <typename F>
+    DLLLOCAL void forEach(F f) const {
+        for (size_t pos = head.load(std::memory_order_acquire), end = tail.load(std::memory_order_acquire);
+                pos < end; ++pos) {
+            const QoreQueueRingSlot& slot = slots[pos % cap];
+            if (slot.seq.load(std::memory_order_acquire) == pos + 1 && f(slot.val)) {
+                break;
+            }
+        }
+    }
+
+private:
+    struct QoreQueueRingSlot {
+        std::atomic<size_t> seq;
+        QoreValue val;
+    };
+
+    QoreQueueRingSlot* slots;
+    const size_t cap;
+
+    // producer and consumer positions are kept on separate cache lines
+    char pad0[QORE_CACHE_LINE_SIZE];
+    std::atomic<size_t> tail{0};
+    char pad1[QORE_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> head{0};
+    char pad2[QORE_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
 class qore_queue_private {
     friend class qore_object_private;
 
@@ -93,9 +204,18 @@ private:
     QoreStringNode* desc;
     int len,   // the number of elements currently in the queue (or -1 for deleted)
         max;   // the maximum size of the queue (or -1 for unlimited)
-    unsigned read_waiting,   // number of threads waiting on reads
+    std::atomic<unsigned> read_waiting,   // number of threads waiting on reads
                 write_waiting;  // number of threads waiting on writes
 
+    // the ring buffer for lock-free queues; if set, the linked list and len are not used
+    QoreQueueRing* ring = nullptr;
+    // set when lock-free queue operations have to take the lock to check the error or deleted status
+    std::atomic<bool> ring_closed{false};
+    // the number of lock-free ring operations in progress outside the lock
+    mutable std::atomic<unsigned> ring_ops{0};
+    // set in the lock while the ring is scanned or copied; lock-free ring operations wait on the lock while set
+    mutable std::atomic<bool> ring_scan{false};
+
     // issue #3101: maintain a count of all scanable objects in the queue
     int scan_count = 0;
 
@@ -111,6 +231,86 @@ private:
     // called in the lock; returns -1 if not possible (cannot write to the queue) or 0 of OK
     DLLLOCAL int checkWriteIntern(ExceptionSink* xsink, bool always_error = false);
 
+    // lock-free queue operations; the lock is only acquired if the calling thread has to block
+    DLLLOCAL void pushLockFree(ExceptionSink* xsink, QoreValue n, int timeout_ms, bool& to);
+    DLLLOCAL QoreValue shiftLockFree(ExceptionSink* xsink, int timeout_ms, bool& to);
+    DLLLOCAL void pushAllLockFree(ExceptionSink* xsink, const QoreListNode* vl, int timeout_ms, bool& to);
+    DLLLOCAL QoreListNode* getBatchLockFree(ExceptionSink* xsink, int max_elements, int timeout_ms, bool& to);
+    // takes up to max_elements values from the ring without blocking; returns the number of values taken
+    DLLLOCAL size_t takeRingBatch(QoreListNode& rv, int max_elements);
+
+    // removes up to max_elements values from the head of the queue and releases the lock; there must be at least
+    // one value in the queue
+    DLLLOCAL QoreListNode* takeBatchIntern(SafeLocker& sl, QoreObject* self, int max_elements);
+
+    // returns -1 if the lock-free queue has been closed with an error or deleted (exception raised)
+    DLLLOCAL int checkLockFree(ExceptionSink* xsink) {
+        if (!ring_closed.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        AutoLocker al(&l);
+        return checkWriteIntern(xsink, true);
+    }
+
+    // wakes up a blocked thread after a lock-free write or read
+    DLLLOCAL void signalLockFree(std::atomic<unsigned>& waiting, QoreCondition& cond, bool all = false) {
+        // pairs with the fence in the blocking path: either the waiting thread sees the change to the ring or we
+        // see the waiting thread
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed)) {
+            AutoLocker al(&l);
+            if (all) {
+                cond.broadcast();
+            } else {
+                cond.signal();
+            }
+        }
+    }
+
+    // starts a lock-free ring operation; must not be called in the lock
+    DLLLOCAL void enterRing() const {
+        while (true) {
+            ring_ops.fetch_add(1, std::memory_order_seq_cst);
+            if (!ring_scan.load(std::memory_order_seq_cst)) {
+                return;
+            }
+            ring_ops.fetch_sub(1, std::memory_order_release);
+            // wait for the scan to complete
+            AutoLocker al(&l);
+        }
+    }
+
+    DLLLOCAL void exitRing() const {
+        ring_ops.fetch_sub(1, std::memory_order_release);
+    }
+
+    // appends a value to the ring outside the lock
+    DLLLOCAL bool ringPush(QoreValue v) {
+        enterRing();
+        bool rc = ring->push(v);
+        exitRing();
+        return rc;
+    }
+
+    // removes the first value from the ring outside the lock
+    DLLLOCAL bool ringShift(QoreValue& v) {
+        enterRing();
+        bool rc = ring->shift(v);
+        exitRing();
+        return rc;
+    }
+
+    // stops lock-free ring operations so that ring values can be accessed; must be called in the lock
+    DLLLOCAL void quiesceRingIntern() const;
+
+    // allows lock-free ring operations again; must be called in the lock
+    DLLLOCAL void resumeRingIntern() const {
+        ring_scan.store(false, std::memory_order_release);
+    }
+
+    // removes all values from the ring; must be called in the lock
+    DLLLOCAL void clearRingIntern(ExceptionSink* xsink);
+
 public:
     DLLLOCAL qore_queue_private(int n_max = -1) : head(0), tail(0), desc(0), len(0), max(n_max), read_waiting(0), write_waiting(0) {
         assert(max);
@@ -119,6 +319,23 @@ public:
 
     DLLLOCAL qore_queue_private(const qore_queue_private &orig) : head(0), tail(0), err(orig.err), desc(orig.desc ? orig.desc->stringRefSelf() : 0), len(0), max(orig.max), read_waiting(0), write_waiting(0) {
         AutoLocker al(orig.l);
+        if (orig.ring) {
+            ring = new QoreQueueRing(orig.ring->capacity());
+            ring_closed.store(!err.empty(), std::memory_order_relaxed);
+            if (orig.len == Queue_Deleted) {
+                return;
+            }
+
+            // values can only be referenced while no other thread can remove them
+            orig.quiesceRingIntern();
+            orig.ring->forEach([this] (const QoreValue& v) -> bool {
+                ring->push(v.refSelf());
+                return false;
+            });
+            orig.resumeRingIntern();
+            return;
+        }
+
         if (orig.len == Queue_Deleted)
             return;
 
@@ -140,8 +357,27 @@ public:
         assert(!tail);
         assert(len == Queue_Deleted);
         assert(!desc);
+        assert(!ring || !ring->size());
+        delete ring;
+    }
+
+    //! makes the queue a bounded lock-free queue; must be called before the queue is used
+    DLLLOCAL void setLockFree() {
+        assert(max > 0);
+        assert(!ring);
+        ring = new QoreQueueRing(max);
     }
 
+    DLLLOCAL bool isLockFree() const {
+        return ring;
+    }
+
+    //! flags the given object for scanning if the queue is lock-free; call after the object's queue is set
+    /** values are added to and removed from lock-free queues without the lock, so scanable values cannot be counted
+        as with other queues
+    */
+    DLLLOCAL void initScan(QoreObject* self);
+
     // push at the end of the queue and take the reference - can only be used when len == -1
     DLLLOCAL void pushAndTakeRef(QoreValue n);
 
@@ -154,12 +390,22 @@ public:
     DLLLOCAL QoreValue shift(ExceptionSink* xsink, QoreObject* self, int timeout_ms, bool& to);
     DLLLOCAL QoreValue pop(ExceptionSink* xsink, QoreObject* self, int timeout_ms, bool& to);
 
+    // push all values in the list at the end of the queue with a single lock acquisition unless the queue is full
+    DLLLOCAL void pushAll(ExceptionSink* xsink, QoreObject* self, const QoreListNode* vl, int timeout_ms, bool& to);
+
+    // waits for at least one value and returns up to max_elements values from the head of the queue
+    DLLLOCAL QoreListNode* getBatch(ExceptionSink* xsink, QoreObject* self, int max_elements, int timeout_ms,
+            bool& to);
+
+    // returns all values in the queue without blocking
+    DLLLOCAL QoreListNode* drain(ExceptionSink* xsink, QoreObject* self);
+
     DLLLOCAL bool empty() const {
-        return !len;
+        return ring ? !ring->size() : !len;
     }
 
     DLLLOCAL int size() const {
-        return len;
+        return ring ? (int)ring->size() : len;
     }
 
     DLLLOCAL int getMax() const {
@@ -45,6 +45,8 @@
 
 class QoreRegexBase {
 public:
+    DLLLOCAL ~QoreRegexBase();
+
     DLLLOCAL void setCaseInsensitive();
     DLLLOCAL void setDotAll();
     DLLLOCAL void setExtended();
@@ -53,8 +55,16 @@ public:
 
 protected:
     pcre* p = nullptr;
+    //! extra data from pcre_study(), including JIT-compiled code if available
+    pcre_extra* extra = nullptr;
     int options = 0;
     QoreString* str = nullptr;
+
+    //! compiles and studies the given UTF-8 pattern; returns 0 for OK, -1 for error (exception raised)
+    DLLLOCAL int compile(const char* pattern, ExceptionSink* xsink);
+
+    //! executes the compiled pattern; falls back to the interpreter if the JIT stack is exhausted
+    DLLLOCAL int execIntern(const char* subject, int len, int offset, int* ovector, int ovecsize) const;
 };
 
 #endif
@@ -0,0 +1,120 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreRegexCache.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_INTERN_QOREREGEXCACHE_H
+#define _QORE_INTERN_QOREREGEXCACHE_H
+
+#include "qore/intern/QoreRegex.h"
+#include "qore/intern/QoreRegexSubst.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// the maximum number of compiled patterns held in each of the regex and substitution caches
+#define QORE_REGEX_CACHE_SIZE 256
+
+//! process-wide LRU cache of compiled regular expressions for patterns given at runtime
+/** patterns are keyed by their UTF-8 text and options; cached objects are shared between threads and are only used
+    for matching, so they must not be modified after they are returned
+*/
+class QoreRegexCache {
+public:
+    DLLLOCAL QoreRegexCache(size_t max = QORE_REGEX_CACHE_SIZE) : max(max) {
+    }
+
+    DLLLOCAL ~QoreRegexCache() {
+        clear();
+    }
+
+    //! returns a referenced regular expression for the given pattern and options or nullptr if an exception was raised
+    DLLLOCAL QoreRegex* getRegex(const QoreString& pattern, int64 options, ExceptionSink* xsink);
+
+    //! returns a referenced substitution pattern for the given pattern and options or nullptr if an exception was raised
+    /** the substitution is global if \a options contains QRE_GLOBAL
+    */
+    DLLLOCAL QoreRegexSubst* getRegexSubst(const QoreString& pattern, int64 options, ExceptionSink* xsink);
+
+    //! returns a hash of cache statistics
+    DLLLOCAL QoreHashNode* getStats() const;
+
+    //! removes all entries from the cache; called when the library is shut down
+    DLLLOCAL void clear();
+
+private:
+    struct Key {
+        std::string pattern;
+        int64 options;
+
+        DLLLOCAL bool operator==(const Key& k) const {
+            return options == k.options && pattern == k.pattern;
+        }
+    };
+
+    struct KeyHash {
+        DLLLOCAL size_t operator()(const Key& k) const {
+            return std::hash<std::string>()(k.pattern) ^ std::hash<int64>()(k.options);
+        }
+    };
+
+    // a single LRU list; the most recently used entry is at the front of the list
+    template <class T>
+    struct LruCache {
+        typedef std::list<std::pair<Key, T*>> list_t;
+        typedef std::unordered_map<Key, typename list_t::iterator, KeyHash> map_t;
+
+        list_t lru;
+        map_t map;
+
+        DLLLOCAL void clear() {
+            for (auto& i : lru) {
+                i.second->deref();
+            }
+            lru.clear();
+            map.clear();
+        }
+    };
+
+    mutable QoreThreadLock m;
+    LruCache<QoreRegex> regex_cache;
+    LruCache<QoreRegexSubst> subst_cache;
+    size_t max;
+    int64 hits = 0,
+        misses = 0,
+        evictions = 0;
+
+    template <class T, class F>
+    DLLLOCAL T* get(LruCache<T>& cache, const QoreString& pattern, int64 options, ExceptionSink* xsink, F create);
+};
+
+DLLLOCAL extern QoreRegexCache qore_regex_cache;
+
+#endif
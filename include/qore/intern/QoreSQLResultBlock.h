@@ -0,0 +1,146 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreSQLResultBlock.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_QORESQLRESULTBLOCK_H
+
+#define _QORE_QORESQLRESULTBLOCK_H
+
+#include <qore/AbstractPrivateData.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//! the column names of a result block
+/** shared by all blocks fetched from the same statement as long as the columns do not change
+*/
+class SQLResultColumns : public QoreReferenceCounter {
+public:
+    typedef std::vector<std::string> name_vec_t;
+
+    //! column names in result set order
+    name_vec_t names;
+
+    DLLLOCAL SQLResultColumns(const QoreHashNode& h);
+
+    DLLLOCAL void ref() const {
+        ROreference();
+    }
+
+    DLLLOCAL void deref() {
+        if (ROdereference())
+            delete this;
+    }
+
+    //! returns true if the hash has exactly the same keys in the same order
+    DLLLOCAL bool matches(const QoreHashNode& h) const;
+
+    //! returns the column index or -1 if the column is not present
+    DLLLOCAL int find(const char* name) const {
+        name_map_t::const_iterator i = index.find(name);
+        return i == index.end() ? -1 : (int)i->second;
+    }
+
+private:
+    typedef std::unordered_map<std::string, size_t> name_map_t;
+    name_map_t index;
+};
+
+//! a block of rows from a result set stored as one list per column
+class QoreSQLResultBlock : public AbstractPrivateData {
+public:
+    //! creates the block from the hash of lists returned by the DBI driver
+    /** @param h the hash of lists returned by the driver's fetch_columns method; the reference is always consumed
+        @param cols the column names of the last block fetched from the statement; reused if the columns match,
+        otherwise replaced
+        @param xsink for Qore-language exceptions
+
+        @return the new block or nullptr if there are no more rows or if an exception was raised
+    */
+    DLLLOCAL static QoreSQLResultBlock* create(QoreHashNode* h, SQLResultColumns*& cols, ExceptionSink* xsink);
+
+    DLLLOCAL QoreSQLResultBlock(const QoreSQLResultBlock& old);
+
+    using AbstractPrivateData::deref;
+    DLLLOCAL virtual void deref(ExceptionSink* xsink);
+
+    //! returns the number of rows in the block
+    DLLLOCAL size_t size() const {
+        return rows;
+    }
+
+    //! returns the number of columns in the block
+    DLLLOCAL size_t columnCount() const {
+        return data.size();
+    }
+
+    //! returns the column names as a list of strings
+    DLLLOCAL QoreListNode* getColumnNames() const;
+
+    //! returns the column types as a hash of type names; "auto" is returned for columns with mixed types or NULLs
+    DLLLOCAL QoreHashNode* getColumnTypes() const;
+
+    //! returns the values of the given column; the list is typed if all values have the same type
+    DLLLOCAL QoreListNode* getColumn(const char* name, ExceptionSink* xsink) const;
+
+    //! returns all columns as a hash of lists
+    DLLLOCAL QoreHashNode* getColumns(ExceptionSink* xsink) const;
+
+    //! returns the given row as a hash
+    DLLLOCAL QoreHashNode* getRow(int64 row, ExceptionSink* xsink) const;
+
+    //! returns a single value
+    DLLLOCAL QoreValue getValue(int64 row, const char* name, ExceptionSink* xsink) const;
+
+private:
+    //! column names shared with other blocks
+    SQLResultColumns* cols;
+    //! one list of values per column
+    std::vector<QoreListNode*> data;
+    //! the common type of all values in each column or NT_ALL if the types are mixed or NULL is present
+    std::vector<qore_type_t> types;
+    //! the number of rows
+    size_t rows;
+
+    DLLLOCAL QoreSQLResultBlock(SQLResultColumns* cols, size_t rows) : cols(cols), rows(rows) {
+    }
+
+    DLLLOCAL virtual ~QoreSQLResultBlock() {
+        assert(data.empty());
+        cols->deref();
+    }
+
+    DLLLOCAL int findColumn(const char* name, ExceptionSink* xsink) const;
+
+    DLLLOCAL int checkRow(int64 row, ExceptionSink* xsink) const;
+};
+
+#endif
@@ -35,6 +35,7 @@
 #include "qore/intern/sql_statement_private.h"
 
 #include "qore/intern/DatasourceStatementHelper.h"
+#include "qore/intern/QoreSQLResultBlock.h"
 
 #define STMT_IDLE      0
 #define STMT_PREPARED  1
@@ -57,6 +58,8 @@ protected:
    QoreString str;
    // copy of prepare args
    QoreListNode* prepare_args = nullptr;
+   // column names shared by result blocks returned by fetchBlock()
+   SQLResultColumns* block_cols = nullptr;
    // status
    unsigned char status = STMT_IDLE;
    // raw prepare flag
@@ -94,6 +97,9 @@ public:
 
    DLLLOCAL int exec(const QoreListNode* args, ExceptionSink* xsink);
 
+   // executes the statement once for all rows in the given column arrays; returns the number of affected rows
+   DLLLOCAL int64 execArray(const QoreHashNode& data, ExceptionSink* xsink);
+
    DLLLOCAL int affectedRows(ExceptionSink* xsink);
 
    DLLLOCAL QoreHashNode* getOutput(ExceptionSink* xsink);
@@ -109,6 +115,7 @@ public:
 
    DLLLOCAL QoreListNode* fetchRows(int rows, ExceptionSink* xsink);
    DLLLOCAL QoreHashNode* fetchColumns(int rows, ExceptionSink* xsink);
+   DLLLOCAL QoreSQLResultBlock* fetchBlock(int rows, ExceptionSink* xsink);
 
    DLLLOCAL QoreHashNode* describe(ExceptionSink* xsink);
 
@@ -0,0 +1,169 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreSocketPoller.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_QORESOCKETPOLLER_H
+
+#define _QORE_QORESOCKETPOLLER_H
+
+#include <qore/AbstractPrivateData.h>
+#include <qore/QoreThreadLock.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#if defined HAVE_SYS_EPOLL_H
+#define QORE_SOCKETPOLLER_EPOLL 1
+#elif defined HAVE_POLL && !defined _Q_WINDOWS
+#define QORE_SOCKETPOLLER_POLL 1
+#endif
+
+#ifdef QORE_SOCKETPOLLER_POLL
+#include <poll.h>
+#endif
+
+// readiness flags for SocketPoller events
+#define SOCK_POLLIN  (1 << 0)
+#define SOCK_POLLOUT (1 << 1)
+#define SOCK_POLLERR (1 << 2)
+
+class QoreSocketObject;
+
+//! a multiplexed readiness poller for Socket objects
+/** sockets are registered in one-shot mode: once a socket has been returned as ready by wait(), it is removed
+    from the poller and must be added again to be monitored again; this allows a socket to be handed to a worker
+    thread for I/O without any possibility of another thread also being notified for the same socket
+
+    the poller's lock is never held while waiting for events, so sockets can be added and removed by other
+    threads while a thread is blocked in wait()
+ */
+class QoreSocketPoller : public AbstractPrivateData {
+public:
+    DLLLOCAL QoreSocketPoller(ExceptionSink* xsink);
+
+    //! adds a socket to the poller; the object and the arg value are referenced
+    /** @return 0 for OK, -1 for error (exception raised)
+     */
+    DLLLOCAL int add(QoreObject* obj, QoreSocketObject* sock, int events, const QoreValue arg, ExceptionSink* xsink);
+
+    //! removes a socket from the poller; returns true if the socket was registered
+    DLLLOCAL bool remove(const QoreObject* obj, ExceptionSink* xsink);
+
+    //! waits for socket events and returns a list of SocketPollerEvent hashes for all ready sockets
+    /** the sockets returned are removed from the poller; an empty list is returned on a timeout or when
+        wakeup() is called
+     */
+    DLLLOCAL QoreListNode* wait(int timeout_ms, int max, ExceptionSink* xsink);
+
+    //! causes a thread blocked in wait() to return immediately
+    DLLLOCAL void wakeup();
+
+    //! removes all sockets from the poller and returns them as a list of Socket objects
+    DLLLOCAL QoreListNode* clear(ExceptionSink* xsink);
+
+    //! returns the number of sockets registered
+    DLLLOCAL size_t size() const {
+        AutoLocker al(m);
+        return emap.size();
+    }
+
+    //! returns the name of the event notification backend
+    DLLLOCAL static const char* getBackend();
+
+    DLLLOCAL virtual void deref(ExceptionSink* xsink) {
+        if (ROdereference()) {
+            ReferenceHolder<QoreListNode> l(clear(xsink), xsink);
+            delete this;
+        }
+    }
+
+    DLLLOCAL virtual void deref() {
+        ExceptionSink xsink;
+        deref(&xsink);
+    }
+
+protected:
+    DLLLOCAL virtual ~QoreSocketPoller();
+
+private:
+    struct SocketPollerEntry {
+        QoreObject* obj;
+        QoreSocketObject* sock;
+        int fd;
+        int events;
+        QoreValue arg;
+
+        DLLLOCAL void del(ExceptionSink* xsink);
+    };
+
+    // map of tokens to entries; tokens are never reused, so a stale event can never match a new entry
+    typedef std::map<uint64_t, SocketPollerEntry> entry_map_t;
+    // map of objects to tokens
+    typedef std::map<const QoreObject*, uint64_t> obj_map_t;
+    // token and events for sockets that are ready without waiting
+    typedef std::deque<std::pair<uint64_t, int>> ready_list_t;
+    // list of entries removed from the poller that are ready to be returned
+    typedef std::vector<std::pair<SocketPollerEntry, int>> result_list_t;
+
+    mutable QoreThreadLock m;
+    entry_map_t emap;
+    obj_map_t omap;
+    ready_list_t ready;
+
+    // the next token to assign; token 0 is reserved for the wakeup pipe
+    uint64_t next_token = 1;
+    // the wakeup pipe
+    int wfd[2] = {-1, -1};
+    // set when wakeup() was called by the user, cleared when a waiting thread returns because of it
+    bool woken = false;
+
+#ifdef QORE_SOCKETPOLLER_EPOLL
+    // the epoll file descriptor
+    int efd = -1;
+#endif
+
+    // wakes up any threads blocked in wait(); must be called with the lock held
+    DLLLOCAL void signalIntern();
+
+    // reads all data from the wakeup pipe; must be called with the lock held
+    DLLLOCAL void drainIntern();
+
+    // removes an entry from the maps and returns it; must be called with the lock held
+    DLLLOCAL SocketPollerEntry takeIntern(entry_map_t::iterator i);
+
+    // removes the kernel registration for the socket if it's still open with the same descriptor
+    DLLLOCAL void unregister(const SocketPollerEntry& e);
+
+    // returns a list of SocketPollerEvent hashes from the result list
+    DLLLOCAL QoreListNode* getEvents(result_list_t& rl, ExceptionSink* xsink);
+};
+
+#endif
@@ -0,0 +1,108 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreStatementCache.h
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#ifndef _QORE_QORESTATEMENTCACHE_H
+
+#define _QORE_QORESTATEMENTCACHE_H
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+//! per-connection LRU cache of prepared statements used by Datasource::exec()
+/** statements are keyed by their SQL text and are only cached for DML with bind-by-value arguments; the cache is
+    only accessed by the thread holding the connection, only the statistics may be read from other threads
+*/
+class QoreStatementCache {
+public:
+    DLLLOCAL QoreStatementCache(Datasource* ds) : ds(ds) {
+    }
+
+    DLLLOCAL ~QoreStatementCache() {
+        assert(lru.empty());
+    }
+
+    //! returns true if the given SQL can be executed with a cached statement
+    /** statements with output placeholders are never cached, as they return a hash of output values
+    */
+    DLLLOCAL static bool cacheable(const Datasource& ds, const QoreString& sql, const QoreListNode* args);
+
+    //! executes the given DML with a cached statement and returns the number of affected rows
+    DLLLOCAL QoreValue exec(const QoreString& sql, const QoreListNode& args, ExceptionSink* xsink);
+
+    //! sets the maximum number of cached statements; surplus statements are closed
+    DLLLOCAL void setMax(size_t n, ExceptionSink* xsink);
+
+    //! returns the maximum number of cached statements
+    DLLLOCAL size_t getMax() const {
+        return max;
+    }
+
+    //! closes all cached statements; must be called before the connection is closed or after it has been lost
+    DLLLOCAL void clear(ExceptionSink* xsink);
+
+    //! returns a hash of cache statistics
+    DLLLOCAL QoreHashNode* getStats() const;
+
+    //! returns a hash of statistics for a connection without a cache
+    DLLLOCAL static QoreHashNode* getEmptyStats();
+
+private:
+    struct CachedStatement {
+        std::string sql;
+        SQLStatement* stmt;
+
+        DLLLOCAL CachedStatement(const std::string& sql, SQLStatement* stmt) : sql(sql), stmt(stmt) {
+        }
+    };
+
+    // most recently used statements first
+    typedef std::list<CachedStatement> stmt_list_t;
+    typedef std::unordered_map<std::string, stmt_list_t::iterator> stmt_map_t;
+
+    Datasource* ds;
+    stmt_list_t lru;
+    stmt_map_t smap;
+    size_t max = 0;
+
+    // statistics
+    std::atomic<int64> count = {0},
+        hits = {0},
+        misses = {0},
+        evictions = {0},
+        invalidations = {0};
+
+    // closes the statement and removes it from the cache
+    DLLLOCAL void remove(stmt_list_t::iterator i, ExceptionSink* xsink);
+};
+
+#endif
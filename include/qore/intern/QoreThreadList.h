@@ -35,6 +35,8 @@
 
 #include <qore/QoreRWLock.h>
 
+#include <vector>
+
 // FIXME: move to config.h or something like that
 // not more than this number of threads can be running at the same time
 #ifndef MAX_QORE_THREADS
@@ -106,28 +108,25 @@ public:
     }
 
     DLLLOCAL int get(int status = QTS_NA) {
-        int tid = -1;
+        int tid;
         AutoLocker al(lck);
 
         if (current_tid == MAX_QORE_THREADS) {
-            int i;
-            // scan thread_list for free entry
-            for (i = 1; i < MAX_QORE_THREADS; i++) {
-                if (entry[i].available()) {
-                    tid = i;
-                    goto finish;
-                }
-            }
-            if (i == MAX_QORE_THREADS) {
+            // reuse the most recently released TID
+            if (free_tids.empty()) {
                 return -1;
             }
+            tid = free_tids.back();
+            free_tids.pop_back();
         } else {
             tid = current_tid++;
         }
 
-finish:
+        assert(entry[tid].available());
         entry[tid].allocate(new tid_node(tid), status);
-        ++num_threads;
+        if (++num_threads > peak_threads) {
+            peak_threads = num_threads;
+        }
         //printf("t%d cs=0\n", tid);
 
         return tid;
@@ -186,6 +185,17 @@ finish:
         return num_threads;
     }
 
+    //! returns the highest number of threads active at the same time
+    DLLLOCAL unsigned getPeakThreads() const {
+        return peak_threads;
+    }
+
+    //! marks the thread as already detached; for OS threads that run more than one Qore thread
+    DLLLOCAL void setDetached(int tid) {
+        AutoLocker al(lck);
+        entry[tid].joined = true;
+    }
+
     DLLLOCAL unsigned cancelAllActiveThreads();
 
     DLLLOCAL QoreHashNode* getAllCallStacks();
@@ -201,8 +211,12 @@ protected:
     // lock for reading the thread list
     mutable QoreThreadLock lck;
     unsigned num_threads = 0;
+    unsigned peak_threads = 0;
     ThreadEntry entry[MAX_QORE_THREADS];
 
+    // released TIDs below current_tid; reused once all TIDs have been issued
+    std::vector<int> free_tids;
+
     tid_node* tid_head = nullptr,
         * tid_tail = nullptr;
 
@@ -217,6 +231,7 @@ protected:
         entry[tid].cleanup();
         if (tid) {
             --num_threads;
+            free_tids.push_back(tid);
         }
     }
 };
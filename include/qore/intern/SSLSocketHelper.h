@@ -112,6 +112,11 @@ public:
     DLLLOCAL int read(const char* mname, char* buf, int size, int timeout_ms, ExceptionSink* xsink);
     // returns 0 for success
     DLLLOCAL int write(const char* mname, const void* buf, int size, int timeout_ms, ExceptionSink* xsink);
+    //! returns true if decrypted data is buffered in the SSL object
+    DLLLOCAL bool pending() const {
+        return ssl && SSL_pending(ssl) > 0;
+    }
+
     DLLLOCAL const char* getCipherName() const;
     DLLLOCAL const char* getCipherVersion() const;
     DLLLOCAL X509* getPeerCertificate() const;
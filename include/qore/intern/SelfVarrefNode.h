@@ -33,9 +33,30 @@
 
 #define _QORE_SELFVARREFNODE_H
 
+#include <atomic>
+
+class HashShape;
+
 class SelfVarrefNode : public ParseNode  {
+public:
+    // the slot of a declared member in the object data shape of a class
+    struct MemberSlot {
+        // the object's class
+        const qore_class_private* cls;
+        // the class context the slot was resolved in
+        const qore_class_private* class_ctx;
+        const HashShape* shape;
+        const QoreTypeInfo* typeInfo;
+        // QORE_HASH_NO_SLOT if the member must be accessed by name
+        unsigned slot;
+    };
+
 protected:
     const QoreTypeInfo *returnTypeInfo;
+    // the member slot for the first object class this expression was executed with
+    mutable std::atomic<MemberSlot*> member_slot{nullptr};
+    // true if the member was declared in the class hierarchy at parse time
+    bool declared = false;
 
     DLLLOCAL virtual QoreValue evalImpl(bool &needs_deref, ExceptionSink *xsink) const;
 
@@ -54,6 +75,7 @@ public:
     DLLLOCAL virtual ~SelfVarrefNode() {
         if (str)
             free(str);
+        delete member_slot.load(std::memory_order_relaxed);
     }
 
     // get string representation (for %n and %N), foff is for multi-line formatting offset, -1 = no line breaks
@@ -70,6 +92,13 @@ public:
 
     // returns the string, caller owns the memory
     DLLLOCAL char* takeString();
+
+    //! returns the slot of the member in the given object's data hash
+    /** the slot is resolved on the first execution and cached for the object's class
+
+        @return the slot or nullptr if the member must be accessed by name
+    */
+    DLLLOCAL const MemberSlot* getMemberSlot(const QoreObject& obj, const qore_class_private* class_ctx) const;
 };
 
 #endif
@@ -36,6 +36,7 @@
 
 #include "qore/qore_bitopts.h"
 #include "qore/InputStream.h"
+#include "qore/intern/MmapInputStream.h"
 #include "qore/intern/StringReaderHelper.h"
 
 DLLLOCAL extern qore_classid_t CID_STREAMREADER;
@@ -46,7 +47,8 @@ class StreamReader : public AbstractPrivateData {
 public:
     DLLLOCAL StreamReader(ExceptionSink* xsink, InputStream* is, const QoreEncoding* encoding = QCS_DEFAULT) :
         in(is, xsink),
-        enc(encoding) {
+        enc(encoding),
+        direct(dynamic_cast<MmapInputStream*>(is)) {
     }
 
     virtual DLLLOCAL ~StreamReader() {
@@ -74,6 +76,16 @@ public:
         if (limit == 0)
             return 0;
         SimpleRefHolder<BinaryNode> b(new BinaryNode());
+        if (direct) {
+            size_t len = direct->available();
+            if (limit > 0 && len > (size_t)limit)
+                len = limit;
+            if (!len)
+                return 0;
+            b->append(direct->getData(), len);
+            direct->skip(len);
+            return b.release();
+        }
         char buffer[STREAMREADER_BUFFER_SIZE];
         if (limit == -1) {
             while (true) {
@@ -131,6 +143,9 @@ public:
             return 0;
         eolstr.removeBom();
 
+        if (direct)
+            return readLineEolDirect(*eolstr, trim);
+
         SimpleRefHolder<QoreStringNode> str(new QoreStringNode(enc));
 
         qore_size_t eolpos = 0;
@@ -174,6 +189,9 @@ public:
     }
 
     DLLLOCAL QoreStringNode* readLine(bool trim, ExceptionSink* xsink) {
+        if (direct)
+            return readLineDirect(trim);
+
         SimpleRefHolder<QoreStringNode> str(new QoreStringNode(enc));
 
         while (true) {
@@ -347,6 +365,89 @@ protected:
     //! Encoding of the source input stream.
     const QoreEncoding* enc;
 
+    //! Source input stream if its data can be accessed directly in memory; data is then never buffered
+    MmapInputStream* direct;
+
+    //! Reads data directly from the memory of the source input stream.
+    DLLLOCAL qore_offset_t readDataDirect(ExceptionSink* xsink, void* dest, qore_size_t limit, bool require_all) {
+        size_t avail = direct->available();
+        if (avail < limit) {
+            if (require_all) {
+                xsink->raiseException("END-OF-STREAM-ERROR", "there is not enough data available in the stream; " QSD " bytes were requested, and " QSD " were read", limit, avail);
+                return -1;
+            }
+            limit = avail;
+        }
+        memcpy(dest, direct->getData(), limit);
+        direct->skip(limit);
+        return limit;
+    }
+
+    //! Reads a line with an automatically-detected EOL directly from the memory of the source input stream.
+    DLLLOCAL QoreStringNode* readLineDirect(bool trim) {
+        const char* p = direct->getData();
+        size_t avail = direct->available();
+        if (!avail)
+            return nullptr;
+
+        // find the first EOL byte; a '\r' can only be significant before the first '\n'
+        const char* e = static_cast<const char*>(memchr(p, '\n', avail));
+        const char* cr = static_cast<const char*>(memchr(p, '\r', e ? e - p : avail));
+        size_t len, eol_len;
+        if (cr) {
+            len = cr - p;
+            eol_len = (len + 1 < avail && cr[1] == '\n') ? 2 : 1;
+        } else if (e) {
+            len = e - p;
+            eol_len = 1;
+        } else {
+            len = avail;
+            eol_len = 0;
+        }
+
+        QoreStringNode* str = new QoreStringNode(p, trim ? len : len + eol_len, enc);
+        direct->skip(len + eol_len);
+        return str;
+    }
+
+    //! Reads a line with the given EOL directly from the memory of the source input stream.
+    DLLLOCAL QoreStringNode* readLineEolDirect(const QoreString* eol, bool trim) {
+        const char* p = direct->getData();
+        size_t avail = direct->available();
+        if (!avail)
+            return nullptr;
+
+        const char* es = eol->c_str();
+        size_t es_len = eol->size();
+        assert(es_len);
+        const char* end = p + avail;
+        const char* e = nullptr;
+        // we have to use memchr() and memcmp() here because we could be dealing with character
+        // encodings that include nulls in the string (ex: UTF-16*)
+        for (const char* s = p; (size_t)(end - s) >= es_len; ++s) {
+            s = static_cast<const char*>(memchr(s, es[0], end - s - es_len + 1));
+            if (!s)
+                break;
+            if (!memcmp(s, es, es_len)) {
+                e = s;
+                break;
+            }
+        }
+
+        size_t len, eol_len;
+        if (e) {
+            len = e - p;
+            eol_len = es_len;
+        } else {
+            len = avail;
+            eol_len = 0;
+        }
+
+        QoreStringNode* str = new QoreStringNode(p, trim ? len : len + eol_len, enc);
+        direct->skip(len + eol_len);
+        return q_remove_bom_utf16(str, enc);
+    }
+
 private:
     //! Read data until a limit.
     /** @param xsink exception sink
@@ -359,6 +460,8 @@ private:
     DLLLOCAL virtual qore_offset_t readData(ExceptionSink* xsink, void* dest, qore_size_t limit, bool require_all = true) {
         assert(dest);
         assert(limit > 0);
+        if (direct)
+            return readDataDirect(xsink, dest, limit, require_all);
         char* destPtr = static_cast<char*>(dest);
         qore_size_t read = 0;
         while (true) {
@@ -386,6 +489,8 @@ private:
         @return the next byte available to be read, -1 indicates end of the stream, -2 indicates an error
     */
     virtual int64 peek(ExceptionSink* xsink) {
+        if (direct)
+            return direct->peek(xsink);
         return in->peek(xsink);
     }
 };
@@ -34,6 +34,9 @@
 
 class ThreadLocalVariableData : public ThreadLocalData<LocalVarValue> {
 public:
+    DLLLOCAL ThreadLocalVariableData() : first(curr), frame_block(curr) {
+    }
+
     // clears and marks all variables as finalized on the stack
     DLLLOCAL void finalize(arg_vec_t*& cl) {
         ThreadLocalVariableData::iterator i(curr);
@@ -55,6 +58,10 @@ public:
         // then we uninstantiate
         while (curr->prev || curr->pos)
             uninstantiate(xsink);
+
+        frame_block = curr;
+        frame_pos = 0;
+        frame_stack.clear();
     }
 
     DLLLOCAL LocalVarValue* instantiate() {
@@ -94,10 +101,40 @@ public:
         --curr->pos;
     }
 
+    //! finds the variable using the slot cached in the variable and updates the slot if necessary
+    /** slots >= 0 are relative to the start of the current call frame; slots < QORE_LVAR_NO_SLOT give the absolute
+        position (-slot - 2) of variables instantiated below the current frame (i.e. top-level variables)
+    */
+    DLLLOCAL LocalVarValue* find(const char* id, std::atomic<int>& slot) {
+        int s = slot.load(std::memory_order_relaxed);
+        if (s != QORE_LVAR_NO_SLOT) {
+            LocalVarValue* var = s >= 0
+                ? getSlot(frame_block, frame_pos + s)
+                : getSlot(first, -s - 2);
+            if (var && var->id == id && !var->frame_boundary) {
+                return var;
+            }
+        }
+
+        Block* w;
+        int p;
+        LocalVarValue* var = findIntern(id, w, p);
+        int pos = w->idx * QORE_THREAD_STACK_BLOCK + p;
+        int base = frame_block->idx * QORE_THREAD_STACK_BLOCK + frame_pos;
+        slot.store(pos >= base ? pos - base : -pos - 2, std::memory_order_relaxed);
+        return var;
+    }
+
     DLLLOCAL LocalVarValue* find(const char* id) {
-        Block* w = curr;
+        Block* w;
+        int p;
+        return findIntern(id, w, p);
+    }
+
+    DLLLOCAL LocalVarValue* findIntern(const char* id, Block*& w, int& p) {
+        w = curr;
         while (true) {
-            int p = w->pos;
+            p = w->pos;
             while (p) {
                 --p;
                 LocalVarValue* var = &w->var[p];
@@ -126,6 +163,10 @@ public:
         //printd(5, "ThreadLocalVariableData::pushFrameBoundary(): fc:%d\n", frame_count);
         LocalVarValue* v = instantiate();
         v->setFrameBoundary();
+        // the new frame starts after the boundary marker
+        frame_stack.push_back(std::make_pair(frame_block, frame_pos));
+        frame_block = curr;
+        frame_pos = curr->pos;
     }
 
     DLLLOCAL void popFrameBoundary() {
@@ -135,6 +176,10 @@ public:
         uninstantiateIntern();
         assert(curr->var[curr->pos].frame_boundary);
         curr->var[curr->pos].frame_boundary = false;
+        assert(!frame_stack.empty());
+        frame_block = frame_stack.back().first;
+        frame_pos = frame_stack.back().second;
+        frame_stack.pop_back();
     }
 
     DLLLOCAL int getFrame(int frame, Block*& w, int& p);
@@ -143,6 +188,30 @@ public:
 
     // returns 0 = OK, 1 = no such variable, -1 exception setting variable
     DLLLOCAL int setVarValue(int frame, const char* name, const QoreValue& val, ExceptionSink* xsink);
+
+private:
+    // the first block in the stack
+    Block* first;
+    // the block and position of the first variable in the current call frame
+    Block* frame_block;
+    int frame_pos = 0;
+    // frame starting positions of the calling frames
+    std::vector<std::pair<Block*, int>> frame_stack;
+
+    //! returns the instantiated variable at the given position relative to the given block or nullptr if none
+    DLLLOCAL LocalVarValue* getSlot(Block* w, int p) const {
+        while (p >= QORE_THREAD_STACK_BLOCK) {
+            if (w == curr) {
+                return nullptr;
+            }
+            w = w->next;
+            p -= QORE_THREAD_STACK_BLOCK;
+        }
+        if (w == curr && p >= curr->pos) {
+            return nullptr;
+        }
+        return &w->var[p];
+    }
 };
 
 #endif
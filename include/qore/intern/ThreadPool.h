@@ -32,7 +32,14 @@
 
 #define QTP_DEFAULT_RELEASE_MS 5000
 
+// maximum number of task deques for work stealing
+#define QTP_MAX_DEQUES 64
+
+#include "qore/intern/QoreFuture.h"
+
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <qore/qlist>
 
 class ThreadTask;
@@ -43,37 +50,109 @@ typedef qlist<ThreadPoolThread*> tplist_t;
 
 class ThreadTask {
 public:
-    DLLLOCAL ThreadTask(ResolvedCallReferenceNode* c, ResolvedCallReferenceNode* cc) : code(c), cancelCode(cc) {
+    DLLLOCAL ThreadTask(ResolvedCallReferenceNode* c, ResolvedCallReferenceNode* cc, QoreFuture* f = nullptr)
+            : code(c), cancelCode(cc), future(f) {
     }
 
     DLLLOCAL ~ThreadTask() {
         assert(!code);
         assert(!cancelCode);
+        assert(!future);
     }
 
     DLLLOCAL void del(ExceptionSink* xsink) {
         code->deref(xsink);
         if (cancelCode)
             cancelCode->deref(xsink);
+        if (future)
+            future->deref(xsink);
 #ifdef DEBUG
         code = nullptr;
         cancelCode = nullptr;
+        future = nullptr;
 #endif
         delete this;
     }
 
-    DLLLOCAL QoreValue run(ExceptionSink* xsink) {
-        return code->execValue(0, xsink);
+    DLLLOCAL void run(ExceptionSink* xsink) {
+        if (!future) {
+            code->execValue(0, xsink).discard(xsink);
+            return;
+        }
+
+        // the result and any exception are returned to the caller through the future
+        ExceptionSink xs;
+        QoreValue rv = code->execValue(0, &xs);
+        future->set(rv, xs, xsink);
     }
 
     DLLLOCAL void cancel(ExceptionSink* xsink) {
         if (cancelCode)
             cancelCode->execValue(0, xsink).discard(xsink);
+        if (future)
+            future->setException("THREADPOOL-TASK-CANCELED", "the ThreadPool was stopped before the task could be " \
+                "executed", xsink);
     }
 
 protected:
     ResolvedCallReferenceNode* code;
     ResolvedCallReferenceNode* cancelCode;
+    QoreFuture* future;
+};
+
+// a task deque for work stealing; the worker threads assigned to the deque take tasks from the back, other worker
+// threads steal tasks from the front
+class ThreadTaskDeque {
+public:
+    // returns -1 if the deque has been closed because the ThreadPool is stopping
+    DLLLOCAL int push(ThreadTask* t) {
+        AutoLocker al(m);
+        if (closed)
+            return -1;
+        q.push_back(t);
+        count.store(q.size(), std::memory_order_release);
+        return 0;
+    }
+
+    DLLLOCAL ThreadTask* popBack() {
+        if (!count.load(std::memory_order_acquire))
+            return nullptr;
+        AutoLocker al(m);
+        if (q.empty())
+            return nullptr;
+        ThreadTask* t = q.back();
+        q.pop_back();
+        count.store(q.size(), std::memory_order_release);
+        return t;
+    }
+
+    DLLLOCAL ThreadTask* steal() {
+        if (!count.load(std::memory_order_acquire))
+            return nullptr;
+        AutoLocker al(m);
+        if (q.empty())
+            return nullptr;
+        ThreadTask* t = q.front();
+        q.pop_front();
+        count.store(q.size(), std::memory_order_release);
+        return t;
+    }
+
+    // closes the deque and appends any remaining tasks to the given queue
+    DLLLOCAL void close(taskq_t& tq) {
+        AutoLocker al(m);
+        closed = true;
+        tq.insert(tq.end(), q.begin(), q.end());
+        q.clear();
+        count.store(0, std::memory_order_release);
+    }
+
+private:
+    QoreThreadLock m;
+    taskq_t q;
+    // the number of tasks in the deque; allows empty deques to be skipped without acquiring the lock
+    std::atomic<size_t> count{0};
+    bool closed = false;
 };
 
 class ThreadTaskHolder {
@@ -109,8 +188,14 @@ protected:
         *stopCond = nullptr;
     QoreThreadLock m;
     tplist_t::iterator pos;
+    // the task deque assigned to this thread
+    unsigned slot;
+    // state for random victim selection when stealing tasks
+    unsigned rnd;
     bool stopflag = false,
-        stopped = false;
+        stopped = false,
+        // set when the thread should look for tasks in the task deques
+        steal = false;
 
     DLLLOCAL void finalize(ExceptionSink* xsink);
 
@@ -173,10 +258,39 @@ public:
         c.signal();
     }
 
+    // wakes up an idle thread to steal tasks from the task deques
+    DLLLOCAL void submitSteal() {
+        AutoLocker al(m);
+        assert(!stopflag);
+        assert(!task);
+        steal = true;
+        c.signal();
+    }
+
     DLLLOCAL int getId() const {
         return id;
     }
 
+    DLLLOCAL unsigned getSlot() const {
+        return slot;
+    }
+
+    DLLLOCAL ThreadPool& getPool() const {
+        return tp;
+    }
+
+    // returns a pseudo-random number for selecting steal victims
+    DLLLOCAL unsigned getRandom() {
+        // xorshift
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        return rnd;
+    }
+
+    // returns the ThreadPool worker thread object for the current thread, if any
+    DLLLOCAL static ThreadPoolThread* getCurrent();
+
     DLLLOCAL tplist_t::iterator getPos() const {
         return pos;
     }
@@ -204,9 +318,25 @@ protected:
     // quit flag
     bool quit = false;
 
-    // master task queue
+    // master task queue for tasks submitted from outside the pool
     taskq_t q;
 
+    // task deques for tasks submitted from worker threads; never resized while the pool exists
+    std::unique_ptr<ThreadTaskDeque[]> deques;
+    unsigned ndeques;
+
+    // next deque slot to assign to a new worker thread
+    std::atomic<unsigned> next_slot{0};
+
+    // number of tasks in the task deques
+    std::atomic<int> queued{0};
+
+    // set when idle threads should be woken up to steal tasks from the task deques
+    std::atomic<bool> steal_pending{false};
+
+    // set if tasks can no longer be submitted; can be read outside the lock
+    std::atomic<bool> closed{false};
+
     // task waiting flag
     bool waiting = false;
 
@@ -224,6 +354,15 @@ protected:
         return 0;
     }
 
+    // moves any tasks in the task deques to the master queue and closes the deques; must be called in the lock
+    DLLLOCAL void closeDequesUnlocked() {
+        size_t size = q.size();
+        for (unsigned i = 0; i < ndeques; ++i) {
+            deques[i].close(q);
+        }
+        queued.fetch_sub((int)(q.size() - size), std::memory_order_relaxed);
+    }
+
     DLLLOCAL int addIdleWorker(ExceptionSink* xsink) {
         assert(xsink);
         std::unique_ptr<ThreadPoolThread> tpth(new ThreadPoolThread(*this, xsink));
@@ -241,9 +380,12 @@ protected:
         return 0;
     }
 
-    DLLLOCAL ThreadPoolThread* getThreadUnlocked(ExceptionSink* xsink) {
+    // returns a thread for a task; if wait is false, returns nullptr if no thread is available immediately
+    DLLLOCAL ThreadPoolThread* getThreadUnlocked(ExceptionSink* xsink, bool wait = true) {
         assert(xsink);
         while (!stopflag && fh.empty() && max && (int)ah.size() == max) {
+            if (!wait)
+                return nullptr;
             waiting = true;
             cond.wait(m);
             waiting = false;
@@ -278,6 +420,7 @@ public:
 
     DLLLOCAL ~ThreadPool() {
         assert(q.empty());
+        assert(!queued);
         assert(ah.empty());
         assert(fh.empty());
         assert(stopped);
@@ -311,7 +454,10 @@ public:
         if (!stopflag) {
             detach = true;
             shutdown = true;
+            closed.store(true, std::memory_order_release);
             stopflag = true;
+            // tasks in the task deques are canceled with the tasks in the master queue
+            closeDequesUnlocked();
             cond.signal();
         }
 
@@ -330,6 +476,7 @@ public:
 
         if (!shutdown) {
             shutdown = true;
+            closed.store(true, std::memory_order_release);
             cond.signal();
         }
 
@@ -342,18 +489,25 @@ public:
 
     DLLLOCAL int submit(ResolvedCallReferenceNode* c, ResolvedCallReferenceNode* cc, ExceptionSink* xsink) {
         // optimistically create the task object outside the lock
-        ThreadTaskHolder task(new ThreadTask(c, cc), xsink);
+        return submitTask(new ThreadTask(c, cc), "submit", xsink);
+    }
 
-        AutoLocker al(m);
-        if (checkStopUnlocked("submit", xsink))
-            return -1;
+    // submits a task and returns a future for its result
+    DLLLOCAL QoreFuture* submitFuture(ResolvedCallReferenceNode* c, ResolvedCallReferenceNode* cc,
+            ExceptionSink* xsink) {
+        ReferenceHolder<QoreFuture> f(new QoreFuture, xsink);
+        f->ref();
+        if (submitTask(new ThreadTask(c, cc, *f), "submitFuture", xsink))
+            return nullptr;
+        return f.release();
+    }
 
-        if (q.empty())
-            cond.signal();
-        q.push_back(task.release());
+    // returns the next task for a worker thread that has finished a task or nullptr if there are no more tasks
+    DLLLOCAL ThreadTask* getNextTask(ThreadPoolThread* tpt);
 
-        return 0;
-    }
+    // executes queued tasks in a worker thread waiting on the given future until the future is resolved or there are
+    // no more queued tasks
+    DLLLOCAL void runTasksUntilDone(ThreadPoolThread* tpt, const QoreFuture& f);
 
     DLLLOCAL void threadCounts(int& idle, int& running) {
         AutoLocker al(m);
@@ -373,7 +527,8 @@ public:
             ah.erase(i);
 
             // requeue thread if possible
-            if ((!maxidle && release_ms) || ((int)fh.size() < maxidle) || q.size() > fh.size()) {
+            if ((!maxidle && release_ms) || ((int)fh.size() < maxidle) || q.size() > fh.size()
+                || queued.load(std::memory_order_relaxed) > (int)fh.size()) {
                 fh.push_back(tpt);
                 if (waiting || (release_ms && (int)fh.size() > minidle))
                     cond.signal();
@@ -385,6 +540,14 @@ public:
     }
 
     DLLLOCAL void worker(ExceptionSink* xsink);
+
+    // returns the task deque slot for a new worker thread
+    DLLLOCAL unsigned getSlot() {
+        return next_slot.fetch_add(1, std::memory_order_relaxed) % ndeques;
+    }
+
+protected:
+    DLLLOCAL int submitTask(ThreadTask* t, const char* meth, ExceptionSink* xsink);
 };
 
 #endif
@@ -172,6 +172,9 @@ public:
 
     DLLLOCAL bool isGlobalVar() const { return type == VT_GLOBAL; }
 
+    // returns the global variable or nullptr if this is not a global variable reference
+    DLLLOCAL Var* getGlobalVar() const { return type == VT_GLOBAL ? ref.var : nullptr; }
+
     //DLLLOCAL VarRefNode* isOptimized(const QoreTypeInfo*& typeInfo) const;
     DLLLOCAL int getLValue(LValueHelper& lvh, bool for_remove) const;
 
@@ -112,6 +112,9 @@ private:
 
     DLLLOCAL void del(ExceptionSink* xsink);
 
+    // reads a typed int, float, or bool value without the lock; returns false if a writer holds the lock
+    DLLLOCAL bool evalAtomic(QoreValue& rv) const;
+
     // not implemented
     Var(const Var&) = delete;
 
@@ -196,6 +199,16 @@ public:
 
     DLLLOCAL QoreValue eval() const;
 
+    //! adds a value to a typed int variable with a lock-free atomic operation
+    /** @return 0 if the value was updated, -1 if the update must be made with the lock held
+    */
+    DLLLOCAL int atomicAddBigInt(int64 i, int64& old_val);
+
+    //! adds a value to a typed float variable with a lock-free atomic operation
+    /** @return 0 if the value was updated, -1 if the update must be made with the lock held
+    */
+    DLLLOCAL int atomicAddFloat(double f, double& old_val);
+
     DLLLOCAL void doDoubleDeclarationError(const QoreProgramLocation* loc) {
         // make sure types are identical or throw an exception
         if (parseTypeInfo) {
@@ -428,6 +441,16 @@ public:
     DLLLOCAL void setAndLock(QoreVarRWLock& rwl);
     DLLLOCAL void set(QoreVarRWLock& rwl);
 
+    //! tries a lock-free atomic addition if the lvalue expression is a typed int global variable
+    /** @return 0 if the value was updated, -1 if the update must be made with an LValueHelper object
+    */
+    DLLLOCAL static int atomicAddBigInt(const QoreValue exp, int64 i, int64& old_val);
+
+    //! tries a lock-free atomic addition if the lvalue expression is a typed float global variable
+    /** @return 0 if the value was updated, -1 if the update must be made with an LValueHelper object
+    */
+    DLLLOCAL static int atomicAddFloat(const QoreValue exp, double f, double& old_val);
+
     DLLLOCAL AutoVLock& getAutoVLock() {
         return vl;
     }
@@ -54,6 +54,7 @@ struct dbi_driver_stmt {
     q_dbi_stmt_bind_t bind = nullptr,
         bind_placeholders = nullptr,
         bind_values = nullptr;
+    q_dbi_stmt_bind_array_t bind_array = nullptr;
     q_dbi_stmt_exec_t exec = nullptr,
         exec_describe = nullptr;
     q_dbi_stmt_fetch_row_t fetch_row = nullptr;
@@ -164,6 +165,9 @@ struct qore_dbi_private {
         if (!rc && f.opt.set) {
             ConstHashIterator hi(ds->getConnectOptions());
             while (hi.next()) {
+                // the statement cache option is handled by the Datasource
+                if (!strcmp(hi.getKey(), DBI_OPT_STMT_CACHE))
+                    continue;
                 f.opt.set(ds, hi.getKey(), hi.get(), xsink);
             }
         }
@@ -302,6 +306,15 @@ struct qore_dbi_private {
         return f.stmt.bind_values(stmt, l, xsink);
     }
 
+    DLLLOCAL bool hasStmtBindArray() const {
+        return (bool)f.stmt.bind_array;
+    }
+
+    DLLLOCAL int stmt_bind_array(SQLStatement* stmt, const QoreListNode& l, int64 rows, ExceptionSink* xsink) const {
+        assert(f.stmt.bind_array);
+        return f.stmt.bind_array(stmt, l, rows, xsink);
+    }
+
     DLLLOCAL int stmt_define(SQLStatement* stmt, ExceptionSink* xsink) const {
         return f.stmt.define(stmt, xsink);
     }
@@ -38,6 +38,7 @@
 #include "qore/intern/qore_dbi_private.h"
 #include "qore/intern/QoreSQLStatement.h"
 #include "qore/intern/DatasourceStatementHelper.h"
+#include "qore/intern/QoreStatementCache.h"
 
 #include <set>
 
@@ -86,6 +87,9 @@ struct qore_ds_private {
     // interface for the parent class
     DatasourceStatementHelper* dsh;
 
+    // prepared statement cache for exec(); only created if the statement-cache option is set
+    QoreStatementCache* stmt_cache = nullptr;
+
     DLLLOCAL qore_ds_private(Datasource* n_ds, DBIDriver* ndsl, DatasourceStatementHelper* dsh) : ds(n_ds), in_transaction(false), active_transaction(false), isopen(false), autocommit(false), connection_aborted(false), dsl(ndsl), qorecharset(QCS_DEFAULT), private_data(nullptr), p_port(0), port(0), opt(new QoreHashNode(autoTypeInfo)), event_queue(nullptr), dsh(dsh) {
     }
 
@@ -102,11 +106,15 @@ struct qore_ds_private {
         event_queue(old.event_queue ? old.event_queue->queueRefSelf() : nullptr),
         event_arg(old.event_arg.refSelf()),
         dsh(dsh) {
+        QoreValue v = opt->getKeyValue(DBI_OPT_STMT_CACHE);
+        if (v)
+            setStatementCacheSize(v.getAsBigInt(), nullptr);
     }
 
     DLLLOCAL ~qore_ds_private() {
         assert(!private_data);
         assert(stmt_set.empty());
+        delete stmt_cache;
         ExceptionSink xsink;
         if (opt)
             opt->deref(&xsink);
@@ -143,7 +151,61 @@ struct qore_ds_private {
     }
 
     DLLLOCAL QoreHashNode* getOptionHash() const {
-        return private_data ? qore_dbi_private::get(*dsl)->getOptionHash(ds) : opt->hashRefSelf();
+        if (!private_data)
+            return opt->hashRefSelf();
+
+        QoreHashNode* rv = qore_dbi_private::get(*dsl)->getOptionHash(ds);
+        // add the statement cache option handled by the Datasource itself
+        if (qore_dbi_private::get(*dsl)->hasStatementAPI()) {
+            QoreHashNode* h = new QoreHashNode(autoTypeInfo);
+            h->setKeyValue("desc", new QoreStringNode("the maximum number of prepared statements cached per "
+                "connection for DML executed with bind values; 0 = disabled"), nullptr);
+            h->setKeyValue("type", new QoreStringNode(QoreTypeInfo::getName(softBigIntTypeInfo)), nullptr);
+            int64 size = stmt_cache ? stmt_cache->getMax() : 0;
+            h->setKeyValue("value", size ? QoreValue(size) : QoreValue(), nullptr);
+            rv->setKeyValue(DBI_OPT_STMT_CACHE, h, nullptr);
+        }
+        return rv;
+    }
+
+    //! sets the maximum size of the prepared statement cache
+    DLLLOCAL int setStatementCacheOption(QoreValue v, ExceptionSink* xsink) {
+        if (!qore_dbi_private::get(*dsl)->hasStatementAPI()) {
+            xsink->raiseException("DBI-OPTION-ERROR", "driver '%s' does not support option '%s' as it does not " \
+                "implement the prepared statement API", dsl->getName(), DBI_OPT_STMT_CACHE);
+            return -1;
+        }
+        int64 size = v.getAsBigInt();
+        if (size < 0) {
+            xsink->raiseException("DBI-OPTION-ERROR", "option '%s' must be zero or positive; got " QLLD,
+                DBI_OPT_STMT_CACHE, size);
+            return -1;
+        }
+        setOption(DBI_OPT_STMT_CACHE, size, xsink);
+        setStatementCacheSize(size, xsink);
+        return 0;
+    }
+
+    DLLLOCAL void setStatementCacheSize(int64 size, ExceptionSink* xsink) {
+        if (!stmt_cache) {
+            if (!size)
+                return;
+            stmt_cache = new QoreStatementCache(ds);
+        }
+        stmt_cache->setMax(size, xsink);
+    }
+
+    //! returns the value of the statement cache options
+    DLLLOCAL QoreValue getStatementCacheOption(bool stats) const {
+        if (stats)
+            return stmt_cache ? stmt_cache->getStats() : QoreStatementCache::getEmptyStats();
+        return stmt_cache ? (int64)stmt_cache->getMax() : 0;
+    }
+
+    //! closes all cached statements after the connection has been lost or before it is closed
+    DLLLOCAL void clearStatementCache(ExceptionSink* xsink) {
+        if (stmt_cache)
+            stmt_cache->clear(xsink);
     }
 
     DLLLOCAL QoreHashNode* getCurrentOptionHash(bool ensure_hash = false) const;
@@ -202,12 +264,14 @@ struct qore_ds_private {
         assert(isopen);
         // close statements but do not clear datasource or statements in the datasource
         transactionDone(false, false, xsink);
+        clearStatementCache(xsink);
     }
 
     DLLLOCAL void connectionRecovered(ExceptionSink* xsink) {
         assert(isopen);
         // close all statements, clear private data, leave datasource allocation
         transactionDone(false, true, xsink);
+        clearStatementCache(xsink);
     }
 
     // @param clear if true then clears the statements' datasource ptrs and the stmt_set, if false, does not
@@ -252,6 +316,12 @@ struct qore_ds_private {
     DLLLOCAL int close() {
         if (isopen) {
             //printd(5, "qore_ds_private::close() this: %p in_transaction: %d active_transaction: %d\n", this, in_transaction, active_transaction);
+            if (stmt_cache) {
+                // cached statements must be closed before the connection
+                ExceptionSink xsink;
+                stmt_cache->clear(&xsink);
+                xsink.clear();
+            }
             qore_dbi_private::get(*dsl)->close(ds);
             isopen = false;
             in_transaction = false;
@@ -38,6 +38,9 @@ typedef ReferenceHolder<QoreListNode> safe_qorelist_t;
 
 #define LIST_PAD   15
 
+// the maximum number of entries kept allocated in an argument list cached for reuse
+#define QORE_ARG_LIST_MAX_ENTRIES 16
+
 struct qore_list_private {
     QoreValue* entry = nullptr;
     size_t length = 0;
@@ -500,7 +503,7 @@ struct qore_list_private {
         if (num < length)
             return;
         // make larger
-        if (num >= allocated) {
+        if (num > allocated) {
             size_t d = num >> 2;
             allocated = num + (d < LIST_PAD ? LIST_PAD : d);
             entry = (QoreValue*)realloc(entry, sizeof(QoreValue) * allocated);
@@ -515,7 +518,7 @@ struct qore_list_private {
         }
         // make larger
         if (num >= length) {
-            if (num >= allocated) {
+            if (num > allocated) {
                 size_t d = num >> 2;
                 allocated = num + (d < LIST_PAD ? LIST_PAD : d);
                 entry = (QoreValue*)realloc(entry, sizeof(QoreValue) * allocated);
@@ -525,6 +528,26 @@ struct qore_list_private {
         length = num;
     }
 
+    // discards all entries so that the list can be reused for the arguments of another call
+    DLLLOCAL void clearArgs(ExceptionSink* xsink) {
+        assert(complexTypeInfo == autoListTypeInfo);
+        // take the entries out of the list first, as destructors run when the values are discarded could make calls
+        size_t len = length;
+        length = 0;
+        obj_count = 0;
+        for (size_t i = 0; i < len; ++i) {
+            entry[i].discard(xsink);
+        }
+        finalized = false;
+        vlist = false;
+        // do not keep large buffers for argument lists
+        if (allocated > QORE_ARG_LIST_MAX_ENTRIES) {
+            free(entry);
+            entry = nullptr;
+            allocated = 0;
+        }
+    }
+
     DLLLOCAL void zeroEntries(size_t start, size_t end) {
         for (size_t i = start; i < end; ++i) {
             entry[i] = QoreValue();
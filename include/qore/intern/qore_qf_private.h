@@ -45,6 +45,7 @@
 #include <cstring>
 #include <string>
 #include <sys/file.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -74,12 +75,21 @@ struct qore_qf_private {
     QoreValue event_arg;
     //! if data should be included in file events
     bool event_data = false;
+    //! if reads are buffered; only set for regular files
+    bool read_ahead = false;
+    //! read-ahead buffer; allocated on the first buffered read
+    mutable char* rbuf = nullptr;
+    //! the number of bytes in the read-ahead buffer
+    mutable size_t rbuf_len = 0;
+    //! the offset of the next unread byte in the read-ahead buffer
+    mutable size_t rbuf_pos = 0;
 
     DLLLOCAL qore_qf_private(const QoreEncoding* cs) : charset(cs) {
     }
 
     DLLLOCAL ~qore_qf_private() {
         close_intern();
+        free(rbuf);
 
         // must be dereferenced and removed before deleting
         assert(!event_queue);
@@ -95,9 +105,12 @@ struct qore_qf_private {
             } else if (!detach) {
                 rc = ::close(fd);
                 is_open = false;
+                resetReadBuffer();
                 do_close_event_unlocked();
             } else {
-               rc = 0;
+                // leave the descriptor positioned at the next unread byte
+                discardReadBuffer();
+                rc = 0;
             }
         } else {
             rc = 0;
@@ -120,6 +133,7 @@ struct qore_qf_private {
             return -1;
         }
         filename = file.filename;
+        initReadAhead();
 
         return 0;
     }
@@ -148,9 +162,61 @@ struct qore_qf_private {
         if (cs)
             charset = cs;
         is_open = true;
+        initReadAhead();
         return 0;
     }
 
+    // reads are only buffered for regular files; other descriptors (ttys, pipes, sockets, etc) may be shared with
+    // other readers or may block when reading ahead
+    DLLLOCAL void initReadAhead() {
+        resetReadBuffer();
+        struct stat sbuf;
+        read_ahead = !special_file && !fstat(fd, &sbuf) && S_ISREG(sbuf.st_mode);
+    }
+
+    DLLLOCAL void resetReadBuffer() const {
+        rbuf_pos = rbuf_len = 0;
+    }
+
+    // discards the read-ahead buffer and sets the file position to the next unread byte
+    DLLLOCAL void discardReadBuffer() const {
+        if (rbuf_pos < rbuf_len)
+            lseek(fd, -(off_t)(rbuf_len - rbuf_pos), SEEK_CUR);
+        resetReadBuffer();
+    }
+
+    // refills the empty read-ahead buffer; returns the number of bytes read, 0 for EOF, or -1 for error
+    DLLLOCAL qore_offset_t fillReadBuffer() const {
+        assert(read_ahead);
+        assert(rbuf_pos == rbuf_len);
+        if (!rbuf)
+            rbuf = (char*)malloc(DEFAULT_FILE_BUFSIZE);
+        qore_offset_t rc = readIntern(rbuf, DEFAULT_FILE_BUFSIZE);
+        rbuf_pos = 0;
+        rbuf_len = rc > 0 ? rc : 0;
+        return rc;
+    }
+
+    // copies up to len bytes from the read-ahead buffer to dest and returns the number of bytes copied
+    DLLLOCAL size_t copyReadBuffer(void* dest, size_t len) const {
+        size_t avail = rbuf_len - rbuf_pos;
+        if (len > avail)
+            len = avail;
+        memcpy(dest, rbuf + rbuf_pos, len);
+        rbuf_pos += len;
+        return len;
+    }
+
+    // moves the read position back by the given number of bytes just read
+    DLLLOCAL void unread(size_t len) const {
+        if (rbuf_pos >= len) {
+            rbuf_pos -= len;
+            return;
+        }
+        discardReadBuffer();
+        lseek(fd, -(off_t)len, SEEK_CUR);
+    }
+
     DLLLOCAL int open(const char* fn, int flags, int mode, const QoreEncoding* cs) {
         if (!fn || special_file)
             return -1;
@@ -276,6 +342,8 @@ struct qore_qf_private {
 
     // assumes lock is held and file is open
     DLLLOCAL bool isDataAvailableIntern(int timeout_ms, const char* mname, ExceptionSink *xsink) const {
+        if (rbuf_pos < rbuf_len)
+            return true;
         return select(timeout_ms, true, mname, xsink);
     }
 
@@ -300,7 +368,34 @@ struct qore_qf_private {
 #endif
 
     // unlocked, assumes file is open
-    DLLLOCAL qore_size_t read(void *buf, qore_size_t bs) const {
+    DLLLOCAL qore_size_t read(void* buf, qore_size_t bs) const {
+        if (!read_ahead)
+            return readIntern(buf, bs);
+
+        qore_size_t br = 0;
+        while (br < bs) {
+            if (rbuf_pos == rbuf_len) {
+                qore_offset_t rc;
+                // large reads bypass the read-ahead buffer
+                if (bs - br >= DEFAULT_FILE_BUFSIZE) {
+                    rc = readIntern((char*)buf + br, bs - br);
+                    if (rc > 0)
+                        br += rc;
+                } else {
+                    rc = fillReadBuffer();
+                }
+                if (rc <= 0)
+                    return br ? br : rc;
+                if (rbuf_pos == rbuf_len)
+                    continue;
+            }
+            br += copyReadBuffer((char*)buf + br, bs - br);
+        }
+        return br;
+    }
+
+    // unlocked, assumes file is open; reads directly from the file descriptor
+    DLLLOCAL qore_size_t readIntern(void* buf, qore_size_t bs) const {
         qore_offset_t rc;
         while (true) {
             rc = ::read(fd, buf, bs);
@@ -317,6 +412,10 @@ struct qore_qf_private {
 
     // unlocked, assumes file is open
     DLLLOCAL qore_size_t write(const void* buf, qore_size_t len, ExceptionSink* xsink = 0) const {
+        // write at the position of the next unread byte
+        if (rbuf_pos < rbuf_len)
+            discardReadBuffer();
+
         qore_offset_t rc;
         while (true) {
             rc = ::write(fd, buf, len);
@@ -335,6 +434,9 @@ struct qore_qf_private {
 
     // private function, unlocked
     DLLLOCAL int readChar() const {
+        if (rbuf_pos < rbuf_len)
+            return (unsigned char)rbuf[rbuf_pos++];
+
         unsigned char ch = 0;
         if (read(&ch, 1) != 1)
             return -1;
@@ -352,6 +454,9 @@ struct qore_qf_private {
             return -1;
         }
 
+        if (rbuf_pos < rbuf_len)
+            return copyReadBuffer(dest, limit);
+
         qore_offset_t rc;
         while (true) {
             rc = ::read(fd, dest, limit);
@@ -372,12 +477,25 @@ struct qore_qf_private {
     }
 
     DLLLOCAL char* readBlock(qore_offset_t &size, int timeout_ms, const char* mname, ExceptionSink* xsink) {
-        qore_size_t bs = size > 0 && size < DEFAULT_FILE_BUFSIZE ? size : DEFAULT_FILE_BUFSIZE;
+        // the capacity of bbuf; the buffer is always allocated 1 byte bigger for the terminating null
+        qore_size_t cap = getReadSizeHint();
+        if (size > 0 && (qore_size_t)size < cap)
+            cap = size;
         qore_size_t br = 0;
-        char* buf = (char* )malloc(sizeof(char) * bs);
-        char* bbuf = 0;
+        char* bbuf = (char*)malloc(cap + 1);
+
+        // take any data in the read-ahead buffer first
+        if (rbuf_pos < rbuf_len)
+            br = copyReadBuffer(bbuf, cap);
+
+        while (size <= 0 || br < (qore_size_t)size) {
+            if (br == cap) {
+                cap <<= 1;
+                if (size > 0 && cap > (qore_size_t)size)
+                    cap = size;
+                bbuf = (char*)realloc(bbuf, cap + 1);
+            }
 
-        while (true) {
             // wait for data
             if (timeout_ms >= 0 && !isDataAvailableIntern(timeout_ms, mname, xsink)) {
                 if (!*xsink)
@@ -388,7 +506,8 @@ struct qore_qf_private {
 
             qore_offset_t rc;
             while (true) {
-                rc = ::read(fd, buf, bs);
+                // read directly into the result buffer
+                rc = ::read(fd, bbuf + br, cap - br);
                 // try again if we were interrupted by a signal
                 if (rc >= 0)
                     break;
@@ -397,35 +516,40 @@ struct qore_qf_private {
                     break;
                 }
             }
-            //printd(5, "readBlock(fd: %d, buf: %p, bs: %d) rc: %d\n", fd, buf, bs, rc);
+            //printd(5, "readBlock(fd: %d, bbuf: %p, cap: %d) rc: %d\n", fd, bbuf, cap, rc);
             if (rc <= 0)
                 break;
 
-            // enlarge bbuf (ensure buffer is 1 byte bigger than needed)
-            bbuf = (char* )realloc(bbuf, br + rc + 1);
-            // append buffer to bbuf
-            memcpy(bbuf + br, buf, rc);
             br += rc;
 
             do_read_event_unlocked(rc, br, size);
-
-            if (size > 0) {
-                if (size - br < bs)
-                    bs = size - br;
-                if (br >= (qore_size_t)size)
-                    break;
-            }
         }
-        free(buf);
-        if (*xsink) {
-            if (bbuf)
-                free(bbuf);
+        if (*xsink || !br) {
+            free(bbuf);
+            size = 0;
             return nullptr;
         }
+        // release excess memory
+        if (cap - br > DEFAULT_FILE_BUFSIZE)
+            bbuf = (char*)realloc(bbuf, br + 1);
         size = br;
         return bbuf;
     }
 
+    // returns the initial buffer size for reading the rest of the file: the remaining size of regular files + 1
+    // so that the end of the file can be detected without growing the buffer
+    DLLLOCAL qore_size_t getReadSizeHint() const {
+        if (read_ahead) {
+            struct stat sbuf;
+            if (!fstat(fd, &sbuf)) {
+                qore_offset_t pos = lseek(fd, 0, SEEK_CUR);
+                if (pos >= 0 && sbuf.st_size > pos)
+                    return sbuf.st_size - pos + (rbuf_len - rbuf_pos) + 1;
+            }
+        }
+        return DEFAULT_FILE_BUFSIZE;
+    }
+
     DLLLOCAL QoreStringNode* readLine(bool incl_eol, ExceptionSink* xsink) {
         QoreStringNodeHolder str(new QoreStringNode(charset));
 
@@ -447,6 +571,9 @@ struct qore_qf_private {
         if (!is_open)
             return -2;
 
+        if (read_ahead)
+            return readLineBuffered(str, incl_eol);
+
         bool tty = (bool)isatty(fd);
 
         int ch, rc = -1;
@@ -466,7 +593,7 @@ struct qore_qf_private {
                                 str.concat((char)ch);
                         } else {
                             // reset file to previous byte position
-                            lseek(fd, -1, SEEK_CUR);
+                            unread(1);
                         }
                     }
                 }
@@ -485,6 +612,47 @@ struct qore_qf_private {
         return rc;
     }
 
+    // reads a line using the read-ahead buffer; unlocked, assumes the file is open
+    DLLLOCAL int readLineBuffered(QoreString& str, bool incl_eol) {
+        int rc = -1;
+
+        while (rbuf_pos < rbuf_len || fillReadBuffer() > 0) {
+            rc = 0;
+
+            const char* start = rbuf + rbuf_pos;
+            size_t avail = rbuf_len - rbuf_pos;
+            // find the first EOL byte; a '\r' can only be significant before the first '\n'
+            const char* p = (const char*)memchr(start, '\n', avail);
+            const char* cr = (const char*)memchr(start, '\r', p ? p - start : avail);
+            if (cr)
+                p = cr;
+
+            if (!p) {
+                str.concat(start, avail);
+                rbuf_pos = rbuf_len;
+                continue;
+            }
+
+            size_t len = p - start + 1;
+            str.concat(start, incl_eol ? len : len - 1);
+            rbuf_pos += len;
+
+            if (*p == '\r') {
+                // see if next byte is '\n'
+                int ch = readChar();
+                if (ch == '\n') {
+                    if (incl_eol)
+                        str.concat('\n');
+                } else if (ch >= 0) {
+                    unread(1);
+                }
+            }
+            break;
+        }
+
+        return rc;
+    }
+
     DLLLOCAL int readUntil(char byte, QoreString& str, bool incl_byte = true) {
         str.clear();
 
@@ -495,6 +663,28 @@ struct qore_qf_private {
 
         int ch, rc = -1;
 
+        if (read_ahead) {
+            while (rbuf_pos < rbuf_len || fillReadBuffer() > 0) {
+                rc = 0;
+
+                const char* start = rbuf + rbuf_pos;
+                size_t avail = rbuf_len - rbuf_pos;
+                const char* p = (const char*)memchr(start, byte, avail);
+                if (!p) {
+                    str.concat(start, avail);
+                    rbuf_pos = rbuf_len;
+                    continue;
+                }
+
+                size_t len = p - start + 1;
+                str.concat(start, incl_byte ? len : len - 1);
+                rbuf_pos += len;
+                break;
+            }
+
+            return rc;
+        }
+
         while ((ch = readChar()) >= 0) {
             char c = ch;
             str.concat(c);
@@ -563,7 +753,7 @@ struct qore_qf_private {
                         }
                         else {
                             // reset file to previous byte position
-                            lseek(fd, -len, SEEK_CUR);
+                            unread(len);
                         }
                     }
                 }
@@ -758,7 +948,19 @@ struct qore_qf_private {
         if (!is_open)
             return -1;
 
-        return lseek(fd, 0, SEEK_CUR);
+        qore_offset_t rc = lseek(fd, 0, SEEK_CUR);
+        // take the data in the read-ahead buffer into account
+        return rc < 0 ? rc : rc - (rbuf_len - rbuf_pos);
+    }
+
+    DLLLOCAL qore_size_t setPos(qore_size_t pos) {
+        AutoLocker al(m);
+
+        if (!is_open)
+            return -1;
+
+        resetReadBuffer();
+        return lseek(fd, pos, SEEK_SET);
     }
 
     DLLLOCAL QoreHashNode* getEvent(int event, int source = QORE_SOURCE_FILE) const {
@@ -56,10 +56,17 @@
 #error no async socket I/O APIs available
 #endif
 
+#ifndef _Q_WINDOWS
+#include <sys/uio.h>
+#endif
+
 #ifndef DEFAULT_SOCKET_BUFSIZE
 #define DEFAULT_SOCKET_BUFSIZE 4096
 #endif
 
+// maximum size of the socket read buffer
+#define QORE_SOCKET_MAX_READ_BUFSIZE (16 * 1024 * 1024)
+
 #ifndef QORE_MAX_HEADER_SIZE
 #define QORE_MAX_HEADER_SIZE 16384
 #endif
@@ -232,8 +239,10 @@ struct qore_socket_private {
     // issue #3633: HTTP encoding to assume
     std::string assume_http_encoding = "ISO-8859-1";
 
-    // socket buffer for buffered reads
-    char rbuf[DEFAULT_SOCKET_BUFSIZE];
+    // socket buffer for buffered reads; allocated on the first buffered read
+    char* rbuf = nullptr;
+    // size of the read buffer
+    size_t rbuf_size = DEFAULT_SOCKET_BUFSIZE;
 
     // current buffer size
     size_t buflen = 0,
@@ -273,6 +282,10 @@ struct qore_socket_private {
     DLLLOCAL ~qore_socket_private() {
         close_internal();
 
+        if (rbuf) {
+            free(rbuf);
+        }
+
         // must be dereferenced and removed before deleting
         assert(!event_queue);
         assert(!warn_queue);
@@ -987,7 +1000,7 @@ struct qore_socket_private {
         }
         // select can return true if there is protocol negotiation data available,
         // so we try to peek 1 byte of application data with a timeout of 0 with the SSL connection
-        int rc = ssl->doSSLRW(xsink, mname, rbuf, 1, 0, PEEK, false);
+        int rc = ssl->doSSLRW(xsink, mname, getReadBuffer(), 1, 0, PEEK, false);
         if (*xsink || (rc == QSE_TIMEOUT)) {
             return false;
         }
@@ -1004,6 +1017,11 @@ struct qore_socket_private {
         return isSocketDataAvailable(timeout_ms, mname, xsink);
     }
 
+    //! returns true if data has already been read from the socket and is buffered for reading
+    DLLLOCAL bool hasBufferedData() const {
+        return buflen || (ssl && ssl->pending());
+    }
+
     DLLLOCAL bool isWriteFinished(int timeout_ms, const char* mname, ExceptionSink* xsink) {
         return asyncIoWait(timeout_ms, false, true, "Socket", mname, xsink);
     }
@@ -1531,31 +1549,64 @@ struct qore_socket_private {
 #endif
     }
 
-    // buffered reads for high performance
-    DLLLOCAL qore_offset_t brecv(ExceptionSink* xsink, const char* meth, char*& buf, qore_size_t bs, int flags, int timeout, bool do_event = true) {
-        assert(xsink);
-        // must be checked if open/connected before this function is called
-        assert(sock != QORE_INVALID_SOCKET);
-        assert(meth);
+    //! returns the read buffer, allocating it if necessary
+    DLLLOCAL char* getReadBuffer() {
+        if (!rbuf) {
+            rbuf = (char*)malloc(sizeof(char) * rbuf_size);
+        }
+        return rbuf;
+    }
 
-        // always returned buffered data first
+    //! sets the size of the buffer used for buffered reads
+    DLLLOCAL int setReadBufferSize(ExceptionSink* xsink, int64 size) {
+        if (size < 1 || size > QORE_SOCKET_MAX_READ_BUFSIZE) {
+            xsink->raiseException("SOCKET-READ-BUFFER-SIZE-ERROR", "invalid read buffer size " QLLD "; the size must "
+                "be between 1 and %d bytes", size, QORE_SOCKET_MAX_READ_BUFSIZE);
+            return -1;
+        }
+        if ((size_t)size == rbuf_size) {
+            return 0;
+        }
+        if (buflen > (size_t)size) {
+            xsink->raiseException("SOCKET-READ-BUFFER-SIZE-ERROR", "cannot set the read buffer size to " QLLD
+                " bytes while " QSD " bytes of data are buffered for reading", size, buflen);
+            return -1;
+        }
+        if (!rbuf) {
+            rbuf_size = size;
+            return 0;
+        }
+        char* nbuf = (char*)malloc(sizeof(char) * size);
+        // move any buffered data to the beginning of the new buffer
         if (buflen) {
-            buf = rbuf + bufoffset;
-            if (buflen <= bs) {
-                bs = buflen;
-                buflen = 0;
-                bufoffset = 0;
-            } else {
-                buflen -= bs;
-                bufoffset += bs;
-            }
-            return (qore_offset_t)bs;
+            memcpy(nbuf, rbuf + bufoffset, buflen);
+            bufoffset = 0;
         }
+        free(rbuf);
+        rbuf = nbuf;
+        rbuf_size = size;
+        return 0;
+    }
 
-        // real socket reads are only done when the buffer is empty
+    //! returns the size of the buffer used for buffered reads
+    DLLLOCAL size_t getReadBufferSize() const {
+        return rbuf_size;
+    }
 
-        //printd(5, "qore_socket_private::brecv(buf: %p, bs: %d, flags: %d, timeout: %d, do_event: %d) this: %p ssl: %d\n", buf, (int)bs, flags, timeout, (int)do_event, this, ssl);
+    //! returns the buffer capacity to use for the next read when receiving data directly into a value
+    /** the capacity is doubled for each read up to the total size requested (if any)
+    */
+    DLLLOCAL qore_size_t getRecvCapacity(qore_size_t cap, qore_offset_t bufsize) const {
+        cap = cap ? cap * 2 : rbuf_size;
+        if (bufsize > 0 && cap > (qore_size_t)bufsize) {
+            cap = bufsize;
+        }
+        return cap;
+    }
 
+    //! reads up to bs bytes from the socket into the given buffer without any buffering
+    DLLLOCAL qore_offset_t recvIntern(ExceptionSink* xsink, const char* meth, char* dest, qore_size_t bs, int flags,
+            int timeout) {
         qore_offset_t rc;
         if (!ssl) {
             if (timeout != -1 && !isDataAvailable(timeout, meth, xsink)) {
@@ -1570,7 +1621,7 @@ struct qore_socket_private {
 #ifdef DEBUG
                 errno = 0;
 #endif
-                rc = ::recv(sock, rbuf, DEFAULT_SOCKET_BUFSIZE, flags);
+                rc = ::recv(sock, dest, bs, flags);
                 if (rc == QORE_SOCKET_ERROR) {
                     sock_get_error();
                     if (errno == EINTR)
@@ -1584,13 +1635,43 @@ struct qore_socket_private {
                         qore_socket_error(xsink, "SOCKET-RECV-ERROR", "error in recv()", meth);
                     break;
                 }
-                //printd(5, "qore_socket_private::brecv(%d, %p, %ld, %d) rc: %ld errno: %d\n", sock, buf, bs, flags, rc, errno);
+                //printd(5, "qore_socket_private::recvIntern(%d, %p, %ld, %d) rc: %ld errno: %d\n", sock, dest, bs, flags, rc, errno);
                 // try again if we were interrupted by a signal
                 if (rc >= 0)
                     break;
             }
         } else
-            rc = ssl->read(meth, rbuf, DEFAULT_SOCKET_BUFSIZE, timeout, xsink);
+            rc = ssl->read(meth, dest, bs, timeout, xsink);
+
+        return rc;
+    }
+
+    // buffered reads for high performance
+    DLLLOCAL qore_offset_t brecv(ExceptionSink* xsink, const char* meth, char*& buf, qore_size_t bs, int flags, int timeout, bool do_event = true) {
+        assert(xsink);
+        // must be checked if open/connected before this function is called
+        assert(sock != QORE_INVALID_SOCKET);
+        assert(meth);
+
+        // always returned buffered data first
+        if (buflen) {
+            buf = rbuf + bufoffset;
+            if (buflen <= bs) {
+                bs = buflen;
+                buflen = 0;
+                bufoffset = 0;
+            } else {
+                buflen -= bs;
+                bufoffset += bs;
+            }
+            return (qore_offset_t)bs;
+        }
+
+        // real socket reads are only done when the buffer is empty
+
+        //printd(5, "qore_socket_private::brecv(buf: %p, bs: %d, flags: %d, timeout: %d, do_event: %d) this: %p ssl: %d\n", buf, (int)bs, flags, timeout, (int)do_event, this, ssl);
+
+        qore_offset_t rc = recvIntern(xsink, meth, getReadBuffer(), rbuf_size, flags, timeout);
 
         //printd(5, "qore_socket_private::brecv(%d, %p, %ld, %d) rc: %ld errno: %d\n", sock, buf, bs, flags, rc, errno);
         if (rc > 0) {
@@ -1617,6 +1698,37 @@ struct qore_socket_private {
         return rc;
     }
 
+    //! reads up to bs bytes into the given buffer
+    /** buffered data is returned first; if there is no buffered data and the request is at least as large as the
+        read buffer, the data is received directly into the destination buffer without an intermediate copy
+    */
+    DLLLOCAL qore_offset_t brecvInto(ExceptionSink* xsink, const char* meth, char* dest, qore_size_t bs, int flags,
+            int timeout, bool do_event = true) {
+        assert(xsink);
+        assert(sock != QORE_INVALID_SOCKET);
+        assert(meth);
+
+        if (buflen || bs < rbuf_size) {
+            char* buf;
+            qore_offset_t rc = brecv(xsink, meth, buf, bs, flags, timeout, do_event);
+            if (rc > 0) {
+                memcpy(dest, buf, rc);
+            }
+            return rc;
+        }
+
+        qore_offset_t rc = recvIntern(xsink, meth, dest, bs, flags, timeout);
+        if (rc > 0) {
+            // register event
+            if (do_event)
+                do_read_event(rc, rc);
+        } else if (!rc) {
+            close();
+        }
+
+        return rc;
+    }
+
     //! read until \\r\\n\\r\\n and return the string
     DLLLOCAL QoreStringNode* readHTTPData(ExceptionSink* xsink, const char* meth, int timeout, qore_offset_t& rc, bool exit_early = false) {
         assert(xsink);
@@ -1728,33 +1840,33 @@ struct qore_socket_private {
 
         PrivateQoreSocketThroughputHelper th(this, false);
 
-        qore_size_t bs = bufsize > 0 && bufsize < DEFAULT_SOCKET_BUFSIZE ? bufsize : DEFAULT_SOCKET_BUFSIZE;
-
         QoreStringNodeHolder str(new QoreStringNode(enc));
 
-        char* buf;
-
+        // the string buffer is grown as data is received, so the size given is not trusted for the allocation
+        qore_size_t cap = 0;
         while (true) {
-            rc = brecv(xsink, "recv", buf, bs, 0, timeout, false);
+            qore_size_t br = str->size();
+            // read directly into the string's buffer
+            if (br == cap) {
+                cap = getRecvCapacity(cap, bufsize);
+                str->reserve(cap);
+            }
+            rc = brecvInto(xsink, "recv", (char*)str->c_str() + br, cap - br, 0, timeout, false);
 
             if (rc <= 0) {
-                printd(5, "qore_socket_private::recv(" QSD ", %d) bs=" QSD ", br=" QSD ", rc=" QSD ", errno: %d (%s)\n", bufsize, timeout, bs, str->size(), rc, errno, strerror(errno));
+                printd(5, "qore_socket_private::recv(" QSD ", %d) br=" QSD ", rc=" QSD ", errno: %d (%s)\n", bufsize, timeout, str->size(), rc, errno, strerror(errno));
                 break;
             }
 
-            str->concat(buf, rc);
+            str->terminate(br + rc);
 
             // register event
             if (source > 0) {
                 do_read_event(rc, str->size(), bufsize, source);
             }
 
-            if (bufsize > 0) {
-                if (str->size() >= (qore_size_t)bufsize)
-                    break;
-                if ((bufsize - str->size()) < bs)
-                    bs = bufsize - str->size();
-            }
+            if (bufsize > 0 && str->size() >= (qore_size_t)bufsize)
+                break;
         }
 
         printd(5, "qore_socket_private::recv() received " QSD " byte(s), bufsize=" QSD ", strlen=" QSD " str='%s'\n", str->size(), bufsize, (str ? str->strlen() : 0), str ? str->getBuffer() : "n/a");
@@ -1795,13 +1907,14 @@ struct qore_socket_private {
 
         QoreStringNodeHolder str(new QoreStringNode(enc));
 
-        // perform first read with timeout
-        char* buf;
-        rc = brecv(xsink, "recv", buf, DEFAULT_SOCKET_BUFSIZE, 0, timeout, false);
+        // perform first read with timeout; data is received directly into the string's buffer
+        qore_size_t cap = getRecvCapacity(0, -1);
+        str->reserve(cap);
+        rc = brecvInto(xsink, "recv", (char*)str->c_str(), cap, 0, timeout, false);
         if (rc <= 0)
             return 0;
 
-        str->concat(buf, rc);
+        str->terminate(rc);
 
         // register event
         do_read_event(rc, rc);
@@ -1809,7 +1922,12 @@ struct qore_socket_private {
         // keep reading data until no more data is available without a timeout
         if (isDataAvailable(0, "recv", xsink)) {
             do {
-                rc = brecv(xsink, "recv", buf, DEFAULT_SOCKET_BUFSIZE, 0, 0, false);
+                qore_size_t br = str->size();
+                if (br == cap) {
+                    cap = getRecvCapacity(cap, -1);
+                    str->reserve(cap);
+                }
+                rc = brecvInto(xsink, "recv", (char*)str->c_str() + br, cap - br, 0, 0, false);
                 //printd(5, "qore_socket_private::recv(to: %d) rc=" QSD " rd=" QSD "\n", timeout, rc, str->size());
                 // if the remote end has closed the connection, return what we have
                 if (!rc)
@@ -1818,7 +1936,7 @@ struct qore_socket_private {
                     th.finalize(str->size());
                     return 0;
                 }
-                str->concat(buf, rc);
+                str->terminate(br + rc);
 
                 // register event
                 do_read_event(rc, str->size());
@@ -1858,25 +1976,30 @@ struct qore_socket_private {
 
         PrivateQoreSocketThroughputHelper th(this, false);
 
-        qore_size_t bs = bufsize > 0 && bufsize < DEFAULT_SOCKET_BUFSIZE ? bufsize : DEFAULT_SOCKET_BUFSIZE;
-
         SimpleRefHolder<BinaryNode> b(new BinaryNode);
 
-        char* buf;
+        // the binary buffer is grown as data is received, so the size given is not trusted for the allocation
+        qore_size_t br = 0, cap = 0;
         while (true) {
-            rc = brecv(xsink, "recvBinary", buf, bs, 0, timeout);
+            // read directly into the binary object's buffer
+            if (br == cap) {
+                cap = getRecvCapacity(cap, bufsize);
+                if (b->preallocate(cap)) {
+                    xsink->outOfMemory();
+                    rc = -1;
+                    break;
+                }
+            }
+            rc = brecvInto(xsink, "recvBinary", (char*)b->getPtr() + br, cap - br, 0, timeout);
             if (rc <= 0)
                 break;
 
-            b->append(buf, rc);
+            br += rc;
 
-            if (bufsize > 0) {
-                if (b->size() >= (qore_size_t)bufsize)
-                    break;
-                if ((bufsize - b->size()) < bs)
-                    bs = bufsize - b->size();
-            }
+            if (bufsize > 0 && br >= (qore_size_t)bufsize)
+                break;
         }
+        b->setSize(br);
 
         th.finalize(b->size());
 
@@ -1915,13 +2038,17 @@ struct qore_socket_private {
         SimpleRefHolder<BinaryNode> b(new BinaryNode);
 
         //printd(5, "QoreSocket::recvBinary(%d, " QSD ") this: %p\n", timeout, rc, this);
-        // perform first read with timeout
-        char* buf;
-        rc = brecv(xsink, "recvBinary", buf, DEFAULT_SOCKET_BUFSIZE, 0, timeout, false);
+        // perform first read with timeout; data is received directly into the binary object's buffer
+        qore_size_t cap = getRecvCapacity(0, -1);
+        if (b->preallocate(cap)) {
+            xsink->outOfMemory();
+            return 0;
+        }
+        rc = brecvInto(xsink, "recvBinary", (char*)b->getPtr(), cap, 0, timeout, false);
         if (rc <= 0)
             return 0;
 
-        b->append(buf, rc);
+        qore_size_t br = rc;
 
         // register event
         do_read_event(rc, rc);
@@ -1929,21 +2056,29 @@ struct qore_socket_private {
         // keep reading data until no more data is available without a timeout
         if (isDataAvailable(0, "recvBinary", xsink)) {
             do {
-                rc = brecv(xsink, "recvBinary", buf, DEFAULT_SOCKET_BUFSIZE, 0, 0, false);
+                if (br == cap) {
+                    cap = getRecvCapacity(cap, -1);
+                    if (b->preallocate(cap)) {
+                        xsink->outOfMemory();
+                        return 0;
+                    }
+                }
+                rc = brecvInto(xsink, "recvBinary", (char*)b->getPtr() + br, cap - br, 0, 0, false);
                 // if the remote end has closed the connection, return what we have
                 if (!rc)
                     break;
                 if (rc < 0) {
-                    th.finalize(b->size());
+                    th.finalize(br);
                     return 0;
                 }
 
-                b->append(buf, rc);
+                br += rc;
 
                 // register event
-                do_read_event(rc, b->size());
+                do_read_event(rc, br);
             } while (isDataAvailable(0, "recvBinary", xsink));
         }
+        b->setSize(br);
 
         th.finalize(b->size());
 
@@ -1978,7 +2113,7 @@ struct qore_socket_private {
         qore_offset_t br = 0;
         while (size < 0 || br < size) {
             // calculate bytes needed
-            int bn = size < 0 ? DEFAULT_SOCKET_BUFSIZE : QORE_MIN(size - br, DEFAULT_SOCKET_BUFSIZE);
+            int64 bn = size < 0 ? (int64)rbuf_size : QORE_MIN(size - br, (int64)rbuf_size);
 
             qore_offset_t rc = brecv(xsink, "recvToOutputStream", buf, bn, 0, timeout);
             if (rc < 0) {
@@ -2463,6 +2598,103 @@ struct qore_socket_private {
         return rc;
     }
 
+    //! sends two buffers in sequence, using a single gathering write per system call with non-SSL connections
+    /** no data events are raised
+    */
+    DLLLOCAL int sendv(ExceptionSink* xsink, const char* cname, const char* mname, const char* buf1,
+            qore_size_t size1, const char* buf2, qore_size_t size2, int timeout_ms = -1) {
+        assert(xsink);
+#ifndef _Q_WINDOWS
+        if (!ssl && size1 && size2) {
+            if (sock == QORE_INVALID_SOCKET) {
+                se_not_open(cname, mname, xsink);
+                return QSE_NOT_OPEN;
+            }
+            if (in_op >= 0) {
+                if (in_op == gettid()) {
+                    se_in_op(cname, mname, xsink);
+                    return 0;
+                }
+                se_in_op_thread(cname, mname, xsink);
+                return 0;
+            }
+
+            PrivateQoreSocketThroughputHelper th(this, true);
+
+            // set the non-blocking flag
+            bool nb = (timeout_ms >= 0);
+            // set non-blocking I/O (and restore on exit) if we have a timeout
+            OptionalNonBlockingHelper onbh(*this, nb, xsink);
+            if (*xsink)
+                return -1;
+
+            qore_size_t size = size1 + size2, bs = 0;
+            qore_offset_t rc = 0;
+            while (bs < size) {
+                struct iovec iov[2];
+                int cnt;
+                if (bs < size1) {
+                    iov[0].iov_base = (void*)(buf1 + bs);
+                    iov[0].iov_len = size1 - bs;
+                    iov[1].iov_base = (void*)buf2;
+                    iov[1].iov_len = size2;
+                    cnt = 2;
+                } else {
+                    iov[0].iov_base = (void*)(buf2 + (bs - size1));
+                    iov[0].iov_len = size - bs;
+                    cnt = 1;
+                }
+
+                rc = ::writev(sock, iov, cnt);
+                if (rc < 0) {
+                    sock_get_error();
+                    // check that the send finishes before the timeout if we are using non-blocking I/O
+                    if (nb && (errno == EAGAIN
+#ifdef EWOULDBLOCK
+                        || errno == EWOULDBLOCK
+#endif
+                        )) {
+                        if (!isWriteFinished(timeout_ms, mname, xsink)) {
+                            if (*xsink)
+                                return -1;
+                            se_timeout("Socket", mname, timeout_ms, xsink);
+                            rc = QSE_TIMEOUT;
+                            break;
+                        }
+                        continue;
+                    }
+                    // try again if we were interrupted by a signal
+                    if (errno == EINTR)
+                        continue;
+
+                    xsink->raiseErrnoException("SOCKET-SEND-ERROR", errno, "error while executing %s::%s()", cname,
+                        mname);
+#ifdef EPIPE
+                    if (errno == EPIPE)
+                        close();
+#endif
+#ifdef ECONNRESET
+                    if (errno == ECONNRESET)
+                        close();
+#endif
+                    break;
+                }
+
+                bs += rc;
+                do_send_event(rc, bs, size);
+            }
+            th.finalize(bs);
+
+            return rc < 0 || sock == QORE_INVALID_SOCKET ? (int)rc : 0;
+        }
+#endif
+        int rc = send(xsink, cname, mname, buf1, size1, timeout_ms, -1);
+        if (!rc) {
+            rc = send(xsink, cname, mname, buf2, size2, timeout_ms, -1);
+        }
+        return rc;
+    }
+
     DLLLOCAL int send(int fd, qore_offset_t size, int timeout_ms, ExceptionSink* xsink);
 
     DLLLOCAL int send(ExceptionSink* xsink, const char* cname, const char* mname, const char* buf, qore_size_t size, int timeout_ms = -1, int source = QORE_SOURCE_SOCKET) {
@@ -2750,14 +2982,10 @@ struct qore_socket_private {
 
         //printd(5, "qore_socket_private::sendHttpMessage() hdr: %s\n", hdr.c_str());
 
-        // send URI and headers
-        int rc;
-        if ((rc = send(xsink, cname, mname, hdr.c_str(), hdr.size(), timeout_ms, -1)))
-            return rc;
-
         // header message sent above with do_sent_http_message_event()
         if (size && data) {
-            int rc = send(xsink, cname, mname, (char*)data, size, timeout_ms, -1);
+            // send URI, headers, and body together
+            int rc = sendv(xsink, cname, mname, hdr.c_str(), hdr.size(), (const char*)data, size, timeout_ms);
             if (!rc) {
                 if (body) {
                     do_data_event(QORE_EVENT_SOCKET_DATA_SENT, source, *body);
@@ -2766,7 +2994,14 @@ struct qore_socket_private {
                 }
             }
             return rc;
-        } else if (send_callback) {
+        }
+
+        // send URI and headers
+        int rc;
+        if ((rc = send(xsink, cname, mname, hdr.c_str(), hdr.size(), timeout_ms, -1)))
+            return rc;
+
+        if (send_callback) {
             assert(l);
             assert(!aborted || !(*aborted));
             return sendHttpChunkedWithCallback(xsink, cname, mname, *send_callback, *l, source, timeout_ms, aborted);
@@ -2856,12 +3091,28 @@ struct qore_socket_private {
             // prepare string for chunk
             //str.allocate(size + 1);
 
-            qore_offset_t bs = size < DEFAULT_SOCKET_BUFSIZE ? size : DEFAULT_SOCKET_BUFSIZE;
             qore_offset_t br = 0; // bytes received
+            // the buffer is grown as data is received, so the chunk size is not trusted for the allocation
+            qore_size_t start = b ? b->size() : 0,
+                cap = 0;
             while (true) {
                 char* buf;
-                rc = brecv(xsink, "readHTTPChunkedBodyBinary", buf, bs, 0, timeout, false);
-                //printd(5, "qore_socket_private::readHTTPChunkedBodyBinary() str: '%s' bs: %lld rc: %lld b: %p (%lld) recv_callback: %p\n", str.c_str(), bs, rc, *b, b->size(), recv_callback);
+                if (os) {
+                    rc = brecv(xsink, "readHTTPChunkedBodyBinary", buf, QORE_MIN(size - br, (qore_offset_t)rbuf_size),
+                        0, timeout, false);
+                } else {
+                    // read the chunk directly into the binary object's buffer
+                    if ((qore_size_t)br == cap) {
+                        cap = getRecvCapacity(cap, size);
+                        if (b->preallocate(start + cap)) {
+                            xsink->outOfMemory();
+                            return nullptr;
+                        }
+                    }
+                    buf = (char*)b->getPtr() + start + br;
+                    rc = brecvInto(xsink, "readHTTPChunkedBodyBinary", buf, cap - br, 0, timeout, false);
+                }
+                //printd(5, "qore_socket_private::readHTTPChunkedBodyBinary() str: '%s' rc: %lld b: %p recv_callback: %p\n", str.c_str(), rc, *b, recv_callback);
                 if (rc <= 0) {
                     if (!*xsink) {
                         assert(!rc);
@@ -2877,15 +3128,14 @@ struct qore_socket_private {
                     os->write(buf, rc, xsink);
                     if (*xsink)
                         return nullptr;
-                } else {
-                    b->append(buf, rc);
                 }
                 br += rc;
 
                 if (br >= size)
                     break;
-                if (size - br < bs)
-                    bs = size - br;
+            }
+            if (b) {
+                b->setSize(start + br);
             }
 
             // DEBUG
@@ -3032,13 +3282,18 @@ struct qore_socket_private {
             // prepare string for chunk
             //buf->allocate((unsigned)(buf->strlen() + size + 1));
 
-            // read chunk directly into string buffer
-            qore_offset_t bs = size < DEFAULT_SOCKET_BUFSIZE ? size : DEFAULT_SOCKET_BUFSIZE;
+            // read chunk directly into string buffer; the buffer is grown as data is received, so the chunk size
+            // is not trusted for the allocation
             qore_offset_t br = 0; // bytes received
-            str.clear();
+            qore_size_t start = buf->size(),
+                cap = 0;
             while (true) {
-                char* tbuf;
-                rc = brecv(xsink, "readHTTPChunkedBody", tbuf, bs, 0, timeout, false);
+                if ((qore_size_t)br == cap) {
+                    cap = getRecvCapacity(cap, size);
+                    buf->reserve(start + cap);
+                }
+                char* tbuf = (char*)buf->c_str() + start + br;
+                rc = brecvInto(xsink, "readHTTPChunkedBody", tbuf, cap - br, 0, timeout, false);
                 if (rc <= 0) {
                     if (!*xsink) {
                         assert(!rc);
@@ -3048,14 +3303,12 @@ struct qore_socket_private {
                 }
 
                 br += rc;
-                buf->concat(tbuf, rc);
+                buf->terminate(start + br);
 
                 do_data_event(QORE_EVENT_HTTP_CHUNKED_DATA_READ, source, tbuf, (size_t)rc);
 
                 if (br >= size)
                     break;
-                if (size - br < bs)
-                    bs = size - br;
             }
 
             // DEBUG
@@ -34,6 +34,7 @@
 #ifndef QORE_QORE_STRING_PRIVATE_H
 #define QORE_QORE_STRING_PRIVATE_H
 
+#include <atomic>
 #include <vector>
 
 #define MAX_INT_STRING_LEN     48
@@ -44,29 +45,57 @@
 
 #define MIN_SPRINTF_BUFSIZE   64
 
+// the size of the inline buffer for short strings including the terminating null
+#define QORE_STRING_INLINE_SIZE 24
+
 #define QUS_PATH     0
 #define QUS_QUERY    1
 #define QUS_FRAGMENT 2
 
+// the number of characters between the byte offsets recorded in the character index of multi-byte strings
+#define QORE_STRING_CHAR_INDEX_STEP 64
+// the minimum byte length of multi-byte strings for which a character index is built
+#define QORE_STRING_CHAR_INDEX_MIN 128
+// the maximum byte length of a character in the supported multi-byte encodings
+#define QORE_STRING_MAX_CHAR_LEN 4
+
 typedef std::vector<int> intvec_t;
 
+// character offset index for multi-byte strings; only extended by operations appending data to the string
+struct qore_string_char_index {
+    // the byte length of the indexed prefix; the index remains valid for this prefix when data is only appended to
+    // the string
+    qore_size_t len = 0;
+    // the character encoding of the string when the index was built
+    const QoreEncoding* enc;
+    // the number of characters in the indexed prefix
+    qore_size_t chars = 0;
+    // offsets[i] is the byte offset of character (i * QORE_STRING_CHAR_INDEX_STEP); empty if the indexed prefix
+    // only contains single-byte characters
+    std::vector<qore_size_t> offsets;
+};
+
 struct qore_string_private {
 private:
 
 public:
     qore_size_t len = 0;
-    qore_size_t allocated = 0;
-    char* buf = nullptr;
+    // short strings are stored in the inline buffer; buf points to the inline buffer or to a heap buffer
+    qore_size_t allocated = QORE_STRING_INLINE_SIZE;
+    char* buf = ibuf;
     const QoreEncoding* charset = nullptr;
+    char ibuf[QORE_STRING_INLINE_SIZE];
+    // lazily-built character index for multi-byte strings; built by const character-oriented operations, which can
+    // be executed concurrently, and discarded by every operation that changes data other than by appending to it
+    mutable std::atomic<qore_string_char_index*> char_index = {nullptr};
 
     DLLLOCAL qore_string_private() {
+        ibuf[0] = '\0';
     }
 
     DLLLOCAL qore_string_private(const qore_string_private &p) {
-        allocated = p.len + STR_CLASS_EXTRA;
-        allocated = (allocated / 0x10 + 1) * 0x10; // use complete cache line
-        buf = (char*)malloc(sizeof(char) * allocated);
         len = p.len;
+        init_buf(len + 1, ((len + STR_CLASS_EXTRA) / 0x10 + 1) * 0x10); // use complete cache line
         if (len)
             memcpy(buf, p.buf, len);
         buf[len] = '\0';
@@ -74,16 +103,109 @@ public:
     }
 
     DLLLOCAL ~qore_string_private() {
-        if (buf)
+        free_buf();
+        delete char_index.load(std::memory_order_relaxed);
+    }
+
+    // discards the character index; must be called before any change to the string other than appending data
+    DLLLOCAL void invalidateCharIndex() {
+        qore_string_char_index* ci = char_index.load(std::memory_order_relaxed);
+        if (ci) {
+            char_index.store(nullptr, std::memory_order_relaxed);
+            delete ci;
+        }
+    }
+
+    // returns the number of characters from byte offset start to the end of the string
+    /** equivalent to getEncoding()->getLength(buf + start, buf + len, invalid); start must be at the start of a
+        character
+    */
+    DLLLOCAL qore_size_t getCharLength(qore_size_t start, bool& invalid) const;
+
+    // returns the number of characters from byte offset start to the end of the string
+    DLLLOCAL qore_size_t getCharLength(qore_size_t start, ExceptionSink* xsink) const;
+
+    // returns the byte length of the given number of characters starting at byte offset start
+    /** equivalent to getEncoding()->getByteLen(buf + start, buf + len, c, invalid); start must be at the start of a
+        character
+    */
+    DLLLOCAL qore_size_t getCharByteLen(qore_size_t start, qore_size_t c, bool& invalid) const;
+
+    // returns the byte length of the given number of characters starting at byte offset start
+    DLLLOCAL qore_size_t getCharByteLen(qore_size_t start, qore_size_t c, ExceptionSink* xsink) const;
+
+    // returns the character offset of byte offset bpos
+    /** equivalent to getEncoding()->getCharPos(buf, buf + bpos, xsink); bpos must be at the start of a character
+    */
+    DLLLOCAL qore_size_t getCharPos(qore_size_t bpos, ExceptionSink* xsink) const;
+
+    DLLLOCAL bool isInline() const {
+        return buf == ibuf;
+    }
+
+    // prepares the buffer of an empty string for size bytes including the terminating null; a heap buffer of
+    // heap_size bytes is only allocated if the inline buffer is too small
+    DLLLOCAL void init_buf(qore_size_t size, qore_size_t heap_size = 0) {
+        assert(isInline());
+        if (size > QORE_STRING_INLINE_SIZE) {
+            allocated = heap_size > size ? heap_size : size;
+            buf = (char*)malloc(sizeof(char) * allocated);
+        }
+    }
+
+    // resizes the buffer; the contents of the inline buffer are moved to the heap when it becomes too small
+    DLLLOCAL void resize_buf(qore_size_t size) {
+        if (isInline()) {
+            if (size <= QORE_STRING_INLINE_SIZE) {
+                return;
+            }
+            char* nbuf = (char*)malloc(sizeof(char) * size);
+            memcpy(nbuf, ibuf, QORE_STRING_INLINE_SIZE);
+            buf = nbuf;
+        } else {
+            buf = (char*)realloc(buf, size * sizeof(char));
+        }
+        allocated = size;
+    }
+
+    // frees any heap buffer; the buffer must be replaced or reset afterwards
+    DLLLOCAL void free_buf() {
+        if (!isInline())
             free(buf);
     }
 
+    // sets the string to an empty string in the inline buffer; any heap buffer must have been freed or taken
+    DLLLOCAL void reset_buf() {
+        invalidateCharIndex();
+        buf = ibuf;
+        allocated = QORE_STRING_INLINE_SIZE;
+        len = 0;
+        ibuf[0] = '\0';
+    }
+
+    // returns a heap buffer with the string that is owned by the caller and resets the string
+    DLLLOCAL char* take_buf() {
+        char* rv;
+        if (isInline()) {
+            rv = (char*)malloc(sizeof(char) * (len + 1));
+            memcpy(rv, ibuf, len);
+            rv[len] = '\0';
+        } else {
+            rv = buf;
+        }
+        reset_buf();
+        return rv;
+    }
+
     DLLLOCAL void check_char(qore_size_t i) {
+        // data is only appended after this call, so the index is extended over data appended before
+        if (char_index.load(std::memory_order_relaxed))
+            extendCharIndex();
         if (i >= allocated) {
             qore_size_t d = i >> 2;
-            allocated = i + (d < STR_CLASS_BLOCK ? STR_CLASS_BLOCK : d);
-            allocated = (allocated / 0x10 + 1) * 0x10; // use complete cache line
-            buf = (char*)realloc(buf, allocated * sizeof(char));
+            qore_size_t size = i + (d < STR_CLASS_BLOCK ? STR_CLASS_BLOCK : d);
+            size = (size / 0x10 + 1) * 0x10; // use complete cache line
+            resize_buf(size);
         }
     }
 
@@ -220,7 +342,7 @@ public:
 
         qore_offset_t ind = index_simple(buf + pos, len - pos, needle->c_str(), needle->size());
         if (ind != -1) {
-            ind = getEncoding()->getCharPos(buf, buf + pos + ind, xsink);
+            ind = getCharPos(pos + ind, xsink);
             if (*xsink)
                 return -1;
         }
@@ -285,13 +407,13 @@ public:
         // get positive character offset if negative
         if (pos < 0) {
             // get the length of the string in characters
-            qore_size_t clen = getEncoding()->getLength(buf + start, buf + len, xsink);
+            qore_size_t clen = getCharLength(start, xsink);
             if (*xsink)
                 return -1;
             pos = clen + pos;
         }
         // now get the byte position from this character offset
-        pos = getEncoding()->getByteLen(buf + start, buf + len, pos, xsink);
+        pos = getCharByteLen(start, pos, xsink);
         return *xsink ? -1 : 0;
     }
 
@@ -322,7 +444,7 @@ public:
 
         // calculate character position from byte position
         if (ind && ind != -1) {
-            ind = getEncoding()->getCharPos(buf, buf + ind, xsink);
+            ind = getCharPos(ind, xsink);
             if (*xsink)
                 return 0;
         }
@@ -360,11 +482,7 @@ public:
     }
 
     DLLLOCAL bool isDataAscii() const {
-        for (qore_size_t i = 0; i < len; ++i) {
-            if ((unsigned char)(buf[i]) > 127)
-                return false;
-        }
-        return true;
+        return q_ascii_prefix_len(buf, len) == len;
     }
 
     DLLLOCAL void concat_intern(const char* p, qore_size_t plen) {
@@ -465,7 +583,7 @@ public:
         assert(xsink);
         qore_size_t rc;
         if (i) {
-            rc = getEncoding()->getByteLen(buf, buf + len, i, xsink);
+            rc = getCharByteLen(0, i, xsink);
             if (*xsink)
                 return -1;
         }
@@ -475,18 +593,9 @@ public:
     }
 
     DLLLOCAL void concat(char c) {
-        if (allocated) {
-            buf[len] = c;
-            check_char(++len);
-            buf[len] = '\0';
-            return;
-        }
-        // allocate new string buffer
-        allocated = STR_CLASS_BLOCK;
-        len = 1;
-        buf = (char*)malloc(sizeof(char) * allocated);
-        buf[0] = c;
-        buf[1] = '\0';
+        buf[len] = c;
+        check_char(++len);
+        buf[len] = '\0';
     }
 
     DLLLOCAL void concat(const qore_string_private* str) {
@@ -521,17 +630,22 @@ public:
         }
     }
 
+    DLLLOCAL void concat(const char* str, qore_size_t size) {
+        check_char(len + size);
+        memcpy(buf + len, str, size);
+        len += size;
+        buf[len] = '\0';
+    }
+
     DLLLOCAL int concat(const QoreString* str, ExceptionSink* xsink);
 
     // return 0 for success
     DLLLOCAL int vsprintf(const char *fmt, va_list args) {
         size_t fmtlen = ::strlen(fmt);
-        // ensure minimum space is free
-        if ((allocated - len - fmtlen) < MIN_SPRINTF_BUFSIZE) {
-            allocated += fmtlen + MIN_SPRINTF_BUFSIZE;
-            allocated = (allocated / 0x10 + 1) * 0x10; // use complete cache line
+        // ensure minimum space is free; short strings are formatted in the inline buffer first
+        if (!isInline() && (allocated - len - fmtlen) < MIN_SPRINTF_BUFSIZE) {
             // resize buffer
-            buf = (char*)realloc(buf, allocated * sizeof(char));
+            resize_buf(((allocated + fmtlen + MIN_SPRINTF_BUFSIZE) / 0x10 + 1) * 0x10); // use complete cache line
         }
         // set free buffer size
         qore_offset_t free = allocated - len;
@@ -544,9 +658,7 @@ public:
         if (i < 0) {
             //printf("DEBUG: vsnprintf() failed: i=%d allocated=" QSD " len=" QSD " buf=%p fmtlen=" QSD " (new=i+%d = %d)\n", i, allocated, len, buf, fmtlen, STR_CLASS_EXTRA, i + STR_CLASS_EXTRA);
             // resize buffer
-            allocated += STR_CLASS_EXTRA;
-            allocated = (allocated / 0x10 + 1) * 0x10; // use complete cache line
-            buf = (char*)realloc(buf, sizeof(char) * allocated);
+            resize_buf(((allocated + STR_CLASS_EXTRA) / 0x10 + 1) * 0x10); // use complete cache line
             *(buf + len) = '\0';
             return -1;
         }
@@ -554,9 +666,7 @@ public:
         if (i >= free) {
             //printf("DEBUG: vsnprintf() failed: i=%d allocated=" QSD " len=" QSD " buf=%p fmtlen=" QSD " (new=i+%d = %d)\n", i, allocated, len, buf, fmtlen, STR_CLASS_EXTRA, i + STR_CLASS_EXTRA);
             // resize buffer
-            allocated = len + i + STR_CLASS_EXTRA;
-            allocated = (allocated / 0x10 + 1) * 0x10; // use complete cache line
-            buf = (char*)realloc(buf, sizeof(char) * allocated);
+            resize_buf(((len + i + STR_CLASS_EXTRA) / 0x10 + 1) * 0x10); // use complete cache line
             *(buf + len) = '\0';
             return -1;
         }
@@ -631,14 +741,12 @@ public:
             if ((unsigned)allocated >= requested_size)
                 return 0;
             requested_size = (requested_size / 0x10 + 1) * 0x10; // fill complete cache line
-            char* aux = (char*)realloc(buf, requested_size * sizeof(char));
-            if (!aux) {
+            resize_buf(requested_size);
+            if (!buf) {
                 assert(false);
                 // FIXME: std::bad_alloc() should be thrown here;
                 return -1;
             }
-            buf = aux;
-            allocated = requested_size;
             return 0;
         }
 
@@ -661,15 +769,42 @@ public:
     }
 
     DLLLOCAL static int getHex(const char*& p) {
-        if (*p == '%' && isxdigit(*(p + 1)) && isxdigit(*(p + 2))) {
-            char x[3] = { *(p + 1), *(p + 2), '\0' };
-            p += 3;
-            return strtol(x, 0, 16);
+        if (*p == '%') {
+            int h = q_hex_value(*(p + 1));
+            if (h >= 0) {
+                int l = q_hex_value(*(p + 2));
+                if (l >= 0) {
+                    p += 3;
+                    return (h << 4) | l;
+                }
+            }
         }
         return -1;
     }
 
     DLLLOCAL static int convert_encoding_intern(const char* src, qore_size_t src_len, const QoreEncoding* from, QoreString& targ, const QoreEncoding* nccs, ExceptionSink* xsink);
+
+private:
+    // returns the character index if it can be used for the current string, building it if necessary
+    DLLLOCAL const qore_string_char_index* getCharIndex() const;
+
+    // builds a character index for the current string; returns nullptr if the string has an invalid encoding
+    DLLLOCAL qore_string_char_index* buildCharIndex() const;
+
+    // indexes the data following the prefix covered by the index; returns -1 if the data has an invalid encoding
+    /** if partial is true, an incomplete character at the end of the data is left for a later call
+    */
+    DLLLOCAL int indexCharsIntern(qore_string_char_index& ci, bool partial) const;
+
+    // extends the character index over appended data or discards it if it cannot be used anymore; only called by
+    // operations changing the string, which have exclusive access to it
+    DLLLOCAL void extendCharIndex();
+
+    // returns the character offset of byte offset bpos using the given index
+    DLLLOCAL qore_size_t getCharPosIntern(const qore_string_char_index* ci, qore_size_t bpos, bool& invalid) const;
+
+    // returns the byte offset of character c using the given index
+    DLLLOCAL qore_size_t getByteOffsetIntern(const qore_string_char_index* ci, qore_size_t c, bool& invalid) const;
 };
 
 #endif
@@ -34,6 +34,7 @@
 #ifndef _QORE_QORE_THREAD_INTERN_H
 #define _QORE_QORE_THREAD_INTERN_H
 
+#include <atomic>
 #include <vector>
 #include <set>
 #include <map>
@@ -262,6 +263,9 @@ DLLLOCAL const AbstractStatement* get_runtime_statement();
 
 DLLLOCAL const QoreTypeInfo* parse_set_implicit_arg_type_info(const QoreTypeInfo* ti);
 DLLLOCAL const QoreTypeInfo* parse_get_implicit_arg_type_info();
+// counts implicit argument references at parse time
+DLLLOCAL void parse_ref_implicit_arg();
+DLLLOCAL unsigned parse_get_implicit_arg_refs();
 
 DLLLOCAL int64 parse_get_parse_options();
 DLLLOCAL int64 runtime_get_parse_options();
@@ -290,6 +294,8 @@ DLLLOCAL QoreException* catchSwapException(QoreException* e);
 DLLLOCAL QoreException* catchGetException();
 DLLLOCAL VLock* getVLock();
 DLLLOCAL void end_signal_thread(ExceptionSink* xsink);
+// starts a library thread that is counted in the given counter instead of the global thread counter
+DLLLOCAL int q_start_internal_thread(ExceptionSink* xsink, q_thread_t f, void* arg, QoreCounter& tcount);
 DLLLOCAL void delete_thread_local_data();
 DLLLOCAL void parse_cond_push(bool mark = false);
 DLLLOCAL bool parse_cond_else();
@@ -617,7 +623,14 @@ public:
 
 DLLLOCAL const QoreListNode* thread_get_implicit_args();
 
+// returns an empty list<auto> for evaluating call arguments, reusing a list released by a previous call if possible
+DLLLOCAL QoreListNode* thread_get_arg_list(size_t size);
+// releases a list of call arguments; the list is cached for reuse if the call did not keep a reference to it
+DLLLOCAL void thread_release_arg_list(QoreListNode* l, ExceptionSink* xsink);
+
 DLLLOCAL LocalVarValue* thread_find_lvar(const char* id);
+// finds the local variable using and updating the cached stack slot
+DLLLOCAL LocalVarValue* thread_find_lvar(const char* id, std::atomic<int>& slot);
 
 // to get the current runtime object
 DLLLOCAL QoreObject* runtime_get_stack_object();
@@ -861,6 +874,10 @@ DLLLOCAL void init_qore_threads();
 DLLLOCAL QoreNamespace* get_thread_ns(QoreNamespace& qorens);
 DLLLOCAL void delete_qore_threads();
 DLLLOCAL QoreListNode* get_thread_list();
+// returns statistics for the cache of idle threads used to start new threads
+DLLLOCAL QoreHashNode* get_thread_cache_info();
+// sets the maximum number of idle threads kept for new threads and returns the previous value
+DLLLOCAL unsigned set_thread_cache_size(unsigned size);
 DLLLOCAL QoreHashNode* getAllCallStacks();
 DLLLOCAL QoreListNode* qore_get_thread_call_stack();
 
@@ -34,6 +34,9 @@
 #ifndef _QORE_VAR_RWLOCK_PRIV_H
 #define _QORE_VAR_RWLOCK_PRIV_H
 
+#include <atomic>
+#include <sched.h>
+
 class qore_var_rwlock_priv {
 protected:
    DLLLOCAL virtual void notifyIntern() {
@@ -54,38 +57,85 @@ public:
       read_cond;
    bool has_notify;
 
+   //! write sequence counter; odd while the write lock is held
+   std::atomic<unsigned> seq;
+   //! number of lock-free atomic updates in progress
+   std::atomic<int> atomic_ops;
+
    //! creates and initializes the lock
-   DLLLOCAL qore_var_rwlock_priv() : write_tid(-1), readers(0), read_waiting(0), write_waiting(0), has_notify(false) {
+   DLLLOCAL qore_var_rwlock_priv() : write_tid(-1), readers(0), read_waiting(0), write_waiting(0), has_notify(false), seq(0), atomic_ops(0) {
    }
 
    //! destroys the lock
    DLLLOCAL virtual ~qore_var_rwlock_priv() {
    }
 
+   //! returns the private implementation of the given lock
+   DLLLOCAL static qore_var_rwlock_priv* get(QoreVarRWLock& rwl) {
+      return rwl.priv;
+   }
+
+   //! starts a lock-free read; returns an odd value if the write lock is held and the read must be made with the lock
+   DLLLOCAL unsigned readBegin() const {
+      return seq.load(std::memory_order_acquire);
+   }
+
+   //! returns true if no writer acquired the lock since readBegin() returned the given value
+   DLLLOCAL bool readValidate(unsigned s) const {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return seq.load(std::memory_order_relaxed) == s;
+   }
+
+   //! starts a lock-free atomic update; returns false if the write lock is held and the update must be made with the lock
+   /** writers wait in wrlock() for all atomic updates in progress to finish; call atomicEnd() if this function
+       returns true
+   */
+   DLLLOCAL bool atomicBegin() {
+      atomic_ops.fetch_add(1);
+      if (seq.load() & 1) {
+         atomic_ops.fetch_sub(1, std::memory_order_release);
+         return false;
+      }
+      return true;
+   }
+
+   //! ends a lock-free atomic update started with atomicBegin()
+   DLLLOCAL void atomicEnd() {
+      atomic_ops.fetch_sub(1, std::memory_order_release);
+   }
+
    //! grabs the write lock
    DLLLOCAL void wrlock() {
       int tid = gettid();
-      AutoLocker al(l);
-      assert(tid != write_tid);
-
-      while (readers || write_tid != -1) {
-         ++write_waiting;
-         write_cond.wait(l);
-         --write_waiting;
+      {
+         AutoLocker al(l);
+         assert(tid != write_tid);
+
+         while (readers || write_tid != -1) {
+            ++write_waiting;
+            write_cond.wait(l);
+            --write_waiting;
+         }
+
+         write_tid = tid;
+         seq.fetch_add(1);
       }
-
-      write_tid = tid;
+      waitAtomicIntern();
    }
 
    //! tries to grab the write lock; does not block if unsuccessful; returns 0 if successful
    DLLLOCAL int trywrlock() {
       int tid = gettid();
-      AutoLocker al(l);
-      assert(tid != write_tid);
-      if (readers || write_tid != -1)
-         return -1;
-
-      write_tid = tid;
+      {
+         AutoLocker al(l);
+         assert(tid != write_tid);
+         if (readers || write_tid != -1)
+            return -1;
+
+         write_tid = tid;
+         seq.fetch_add(1);
+      }
+      waitAtomicIntern();
       return 0;
    }
 
@@ -94,6 +144,7 @@ public:
       int tid = gettid();
       AutoLocker al(l);
       if (write_tid == tid) {
+         seq.fetch_add(1, std::memory_order_release);
          write_tid = -1;
          if (has_notify)
             notifyIntern();
@@ -131,6 +182,15 @@ public:
       return 0;
    }
 
+   //! waits for lock-free atomic updates in progress to finish after the write lock has been marked as held
+   /** must be called without \c l held; new atomic updates see the odd \c seq value and take the lock instead, and
+       those in progress run for a few instructions only
+   */
+   DLLLOCAL void waitAtomicIntern() const {
+      while (atomic_ops.load())
+         sched_yield();
+   }
+
    DLLLOCAL void unlock_signal() {
       if (write_waiting)
          write_cond.signal();
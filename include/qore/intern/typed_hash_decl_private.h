@@ -35,9 +35,11 @@
 
 #include "qore/intern/QoreClassIntern.h"
 
+#include <atomic>
 #include <string>
 
 class typed_hash_decl_private;
+class HashShape;
 
 class HashDeclMemberInfo : public QoreMemberInfoBase {
 public:
@@ -71,10 +73,7 @@ public:
 
     DLLLOCAL typed_hash_decl_private(const typed_hash_decl_private& old, TypedHashDecl* thd);
 
-    DLLLOCAL ~typed_hash_decl_private() {
-        delete typeInfo;
-        delete orNothingTypeInfo;
-    }
+    DLLLOCAL ~typed_hash_decl_private();
 
     DLLLOCAL TypedHashDecl* newTypedHashDecl(const char* n) {
         assert(name.empty());
@@ -198,6 +197,9 @@ public:
         return members.find(m);
     }
 
+    //! returns the shared key layout for hashes of this type; the shape is created on demand
+    DLLLOCAL const HashShape* getShape() const;
+
     DLLLOCAL void parseAdd(std::pair<char*, HashDeclMemberInfo*> pair) {
         members.addNoCheck(pair);
     }
@@ -283,6 +285,9 @@ protected:
     // member information
     HashDeclMemberMap members;
 
+    // shared key layout for hashes of this type
+    mutable std::atomic<HashShape*> shape{nullptr};
+
     bool pub = false;
     bool sys = false;
 
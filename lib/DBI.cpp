@@ -69,6 +69,7 @@ struct dbi_cap_hash dbi_cap_list[] =
   { DBI_CAP_HAS_DESCRIBE,           "HasDescribe" },
   { DBI_CAP_HAS_ARRAY_BIND,         "HasArrayBind" },
   { DBI_CAP_HAS_RESULTSET_OUTPUT,   "HasResultsetOutput" },
+  { DBI_CAP_HAS_STMT_BIND_ARRAY,    "HasStatementBindArray" },
 };
 
 #define NUM_DBI_CAPS (sizeof(dbi_cap_list) / sizeof(dbi_cap_hash))
@@ -168,6 +169,13 @@ void qore_dbi_method_list::add(int code, q_dbi_stmt_bind_t method) {
    priv->l[code] = (void*)method;
 }
 
+// covers stmt bind_array
+void qore_dbi_method_list::add(int code, q_dbi_stmt_bind_array_t method) {
+   assert(code == QDBI_METHOD_STMT_BIND_ARRAY);
+   assert(priv->l.find(code) == priv->l.end());
+   priv->l[code] = (void*)method;
+}
+
 // covers stmt exec, close, define, and affectedRows
 void qore_dbi_method_list::add(int code, q_dbi_stmt_exec_t method) {
    assert(code == QDBI_METHOD_STMT_EXEC || code == QDBI_METHOD_STMT_CLOSE || code == QDBI_METHOD_STMT_DEFINE || code == QDBI_METHOD_STMT_AFFECTED_ROWS || code == QDBI_METHOD_STMT_FREE || code == QDBI_METHOD_STMT_EXEC_DESCRIBE);
@@ -341,6 +349,11 @@ qore_dbi_private::qore_dbi_private(const char* nme, const qore_dbi_mlist_private
                 assert(!f.stmt.bind_values);
                 f.stmt.bind_values = (q_dbi_stmt_bind_t)(*i).second;
                 break;
+            case QDBI_METHOD_STMT_BIND_ARRAY:
+                assert(!f.stmt.bind_array);
+                f.stmt.bind_array = (q_dbi_stmt_bind_array_t)(*i).second;
+                cps |= DBI_CAP_HAS_STMT_BIND_ARRAY;
+                break;
             case QDBI_METHOD_STMT_EXEC_DESCRIBE:
                 assert(!f.stmt.exec_describe);
                 f.stmt.exec_describe = (q_dbi_stmt_exec_t)(*i).second;
@@ -329,8 +329,14 @@ QoreValue Datasource::exec_internal(bool doBind, const QoreString* query_str, co
 
     assert(priv->isopen && priv->private_data);
 
-    QoreValue rv = doBind ? qore_dbi_private::get(*priv->dsl)->execSQL(this, query_str, args, xsink)
-        : qore_dbi_private::get(*priv->dsl)->execRawSQL(this, query_str, xsink);;
+    QoreValue rv;
+    if (doBind && priv->stmt_cache && priv->stmt_cache->getMax()
+        && QoreStatementCache::cacheable(*this, *query_str, args)) {
+        rv = priv->stmt_cache->exec(*query_str, *args, xsink);
+    } else {
+        rv = doBind ? qore_dbi_private::get(*priv->dsl)->execSQL(this, query_str, args, xsink)
+            : qore_dbi_private::get(*priv->dsl)->execRawSQL(this, query_str, xsink);
+    }
     //printd(5, "Datasource::exec_internal() this=%p, autocommit=%d, in_transaction=%d, xsink=%d\n", this, priv->autocommit, priv->in_transaction, xsink->isException());
 
     if (priv->connection_aborted) {
@@ -463,6 +469,9 @@ bool Datasource::wasConnectionAborted() const {
 // forces a close and open to reset a database connection
 void Datasource::reset(ExceptionSink* xsink) {
     if (priv->isopen) {
+        // cached statements must be closed before the connection
+        priv->clearStatementCache(xsink);
+
         // close the Datasource
         qore_dbi_private::get(*priv->dsl)->close(this);
         priv->isopen = false;
@@ -619,6 +628,9 @@ QoreHashNode* Datasource::getOptionHash() const {
 }
 
 int Datasource::setOption(const char* opt, const QoreValue val, ExceptionSink* xsink) {
+    if (!strcmp(opt, DBI_OPT_STMT_CACHE))
+        return priv->setStatementCacheOption(val, xsink);
+
     // maintain a copy of the option internally
     priv->setOption(opt, val, xsink);
     // only set options in private data if private data is already set
@@ -636,6 +648,11 @@ const QoreHashNode* Datasource::getConnectOptions() const {
 }
 
 QoreValue Datasource::getOption(const char* opt, ExceptionSink* xsink) {
+    if (!strcmp(opt, DBI_OPT_STMT_CACHE))
+        return priv->getStatementCacheOption(false);
+    if (!strcmp(opt, DBI_OPT_STMT_CACHE_STATS))
+        return priv->getStatementCacheOption(true);
+
     if (!isOpen()) {
         xsink->raiseException("DATASOURCE-ERROR", "cannot retrieve the value for option '%s' when the datasource is " \
             "closed; use getOptionHash() to retrieve raw configuration option when the datasource is closed", opt);
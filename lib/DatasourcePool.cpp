@@ -29,10 +29,21 @@
 */
 
 #include <qore/Qore.h>
+#include <qore/minitest.hpp>
 #include "qore/intern/DatasourcePool.h"
 #include "qore/intern/qore_ds_private.h"
+#include "qore/intern/QoreThreadList.h"
+
 #include <memory>
 
+#ifdef DEBUG_TESTS
+#  include "tests/DatasourcePool_tests.cpp"
+#endif
+
+// upper bounds of the connection wait time histogram buckets in microseconds; the last bucket has no upper bound
+static const int64 dsp_wait_bucket_limit[DSP_WAIT_BUCKETS - 1] = { 1000, 10000, 100000, 1000000, 10000000 };
+static const char* dsp_wait_bucket_name[DSP_WAIT_BUCKETS] = { "1ms", "10ms", "100ms", "1s", "10s", "max" };
+
 DatasourcePoolActionHelper::~DatasourcePoolActionHelper() {
     if (!ds)
         return;
@@ -91,15 +102,18 @@ DatasourcePool::DatasourcePool(ExceptionSink* xsink, DBIDriver* ndsl, const char
                                Queue* q, QoreValue a) :
     pool(new Datasource*[mx]),
     tid_list(new int[mx]),
+    in_use(new std::atomic<bool>[mx]),
+    thread_map(MAX_QORE_THREADS),
     min(mn),
     max(mx),
+    tl_warning_ms(0),
     cmax(0),
     wait_count(0),
-    wait_max(0),
-    tl_warning_ms(0),
     tl_timeout_ms(120000),
     stats_reqs(0),
     stats_hits(0),
+    stats_affinity(0),
+    wait_max(0),
     warning_callback(nullptr),
     config(ndsl, user, pass, db, charset, hostname, port, opts, q, a),
     valid(false) {
@@ -120,15 +134,18 @@ DatasourcePool::DatasourcePool(ExceptionSink* xsink, DBIDriver* ndsl, const char
 DatasourcePool::DatasourcePool(const DatasourcePool& old, ExceptionSink* xsink) :
     pool(new Datasource*[old.max]),
     tid_list(new int[old.max]),
+    in_use(new std::atomic<bool>[old.max]),
+    thread_map(MAX_QORE_THREADS),
     min(old.min),
     max(old.max),
+    tl_warning_ms(old.tl_warning_ms),
     cmax(0),
     wait_count(0),
-    wait_max(0),
-    tl_warning_ms(old.tl_warning_ms),
     tl_timeout_ms(old.tl_timeout_ms),
     stats_reqs(0),
     stats_hits(0),
+    stats_affinity(0),
+    wait_max(0),
     warning_callback(old.warning_callback ? old.warning_callback->refRefSelf() : nullptr),
     callback_arg(old.callback_arg.refSelf()),
     config(old.config),
@@ -140,6 +157,7 @@ DatasourcePool::~DatasourcePool() {
     //printd(5, "DatasourcePool::~DatasourcePool() this: %p\n", this);
     for (unsigned i = 0; i < cmax; ++i)
         delete pool[i];
+    delete [] in_use;
     delete [] tid_list;
     delete [] pool;
     assert(!warning_callback);
@@ -149,6 +167,11 @@ DatasourcePool::~DatasourcePool() {
 // common constructor code
 void DatasourcePool::init(ExceptionSink* xsink) {
     assert(xsink);
+    for (unsigned i = 0; i < max; ++i)
+        in_use[i].store(false, std::memory_order_relaxed);
+    for (unsigned i = 0; i < DSP_WAIT_BUCKETS; ++i)
+        wait_hist[i] = 0;
+
     // ths initial Datasource creation could throw an exception if there is an error in a driver option, for example
     std::unique_ptr<Datasource> ds(config.get(this, xsink));
     if (*xsink)
@@ -160,8 +183,6 @@ void DatasourcePool::init(ExceptionSink* xsink) {
 
     pool[0] = ds.release();
     //printd(5, "DP::init() open %s: %p (%d)\n", ndsl->getName(), pool[0], xsink->isEvent());
-    // add to free list
-    free_list.push_back(0);
 
     while (++cmax < min) {
         ds.reset(config.get(this, xsink));
@@ -174,8 +195,6 @@ void DatasourcePool::init(ExceptionSink* xsink) {
         }
         pool[cmax] = ds.release();
         //printd(5, "DP::init() open %s: %p (%d)\n", ndsl->getName(), pool[cmax], xsink->isEvent());
-        // add to free list
-        free_list.push_back(cmax);
     }
     valid = true;
 }
@@ -184,13 +203,11 @@ void DatasourcePool::cleanup(ExceptionSink* xsink) {
    int tid = gettid();
 
    // thread must have a Datasource allocated
-   SafeLocker sl((QoreThreadLock *)this);
-   thread_use_t::iterator i = tmap.find(tid);
-   assert(i != tmap.end());
-   sl.unlock();
+   int i = thread_map.getSlot(tid);
+   assert(i >= 0);
 
 #ifndef DEBUG_1
-   xsink->raiseException("DATASOURCEPOOL-LOCK-EXCEPTION", "%s:%s@%s: TID %d terminated while in a transaction with connection %d; transaction will be automatically rolled back and the datasource returned to the pool", pool[0]->getDriverName(), pool[0]->getUsernameStr().c_str(), pool[0]->getDBNameStr().c_str(), tid, i->second);
+   xsink->raiseException("DATASOURCEPOOL-LOCK-EXCEPTION", "%s:%s@%s: TID %d terminated while in a transaction with connection %d; transaction will be automatically rolled back and the datasource returned to the pool", pool[0]->getDriverName(), pool[0]->getUsernameStr().c_str(), pool[0]->getDBNameStr().c_str(), tid, i);
 #else
    QoreString* sql = getAndResetSQL();
    xsink->raiseException("DATASOURCEPOOL-LOCK-EXCEPTION", "%s:%s@%s: TID %d terminated while in a transaction; transaction will be automatically rolled back and the datasource returned to the pool\n%s", pool[0]->getDriverName(), pool[0]->getUsernameStr().c_str(), pool[0]->getDBNameStr().c_str(), tid, sql ? sql->getBuffer() : "<no data>");
@@ -199,16 +216,10 @@ void DatasourcePool::cleanup(ExceptionSink* xsink) {
 #endif
 
    // execute rollback on Datasource before releasing to pool
-   pool[i->second]->rollback(xsink);
+   pool[i]->rollback(xsink);
 
-   // grab lock to add to free list and erase thread map entry
-   sl.lock();
-   free_list.push_back(i->second);
-   // erase thread map entry
-   tmap.erase(i);
-   // signal any waiting threads
-   if (wait_count)
-      signal();
+   thread_map.clearSlot(tid);
+   releaseSlot(i);
 }
 
 void DatasourcePool::destructor(ExceptionSink* xsink) {
@@ -218,16 +229,20 @@ void DatasourcePool::destructor(ExceptionSink* xsink) {
     // mark object as invalid in case any threads are waiting on a free Datasource
     valid = false;
 
+    // wake up any threads waiting on a connection
+    for (auto& i : waiters)
+        i->cond.signal();
+
     int tid = gettid();
-    thread_use_t::iterator i = tmap.find(tid);
-    unsigned curr = i == tmap.end() ? (unsigned)-1 : i->second;
+    int i = thread_map.getSlot(tid);
+    unsigned curr = (unsigned)i;
 
     for (unsigned j = 0; j < cmax; ++j) {
         if (j != curr && pool[j]->isInTransaction())
-            xsink->raiseException("DATASOURCEPOOL-ERROR", "%s:%s@%s: TID %d deleted DatasourcePool while TID %d using connection %d/%d was in a transaction", pool[0]->getDriverName(), pool[0]->getUsernameStr().c_str(), pool[0]->getDBNameStr().c_str(), gettid(), tid_list[j], j + 1, cmax);
+            xsink->raiseException("DATASOURCEPOOL-ERROR", "%s:%s@%s: TID %d deleted DatasourcePool while TID %d using connection %d/%d was in a transaction", pool[0]->getDriverName(), pool[0]->getUsernameStr().c_str(), pool[0]->getDBNameStr().c_str(), gettid(), tid_list[j], j + 1, cmax.load());
     }
 
-    if (i != tmap.end() && pool[curr]->isInTransaction()) {
+    if (i >= 0 && pool[curr]->isInTransaction()) {
         xsink->raiseException("DATASOURCEPOOL-LOCK-EXCEPTION", "%s:%s@%s: TID %d deleted DatasourcePool while in a transaction; transaction will be automatically rolled back", pool[0]->getDriverName(), pool[0]->getUsernameStr().c_str(), pool[0]->getDBNameStr().c_str(), tid);
         sl.unlock();
 
@@ -283,19 +298,32 @@ void DatasourcePool::freeDS(ExceptionSink* xsink) {
 
    int tid = gettid();
 
-   AutoLocker al((QoreThreadLock*)this);
-
-   thread_use_t::iterator i = tmap.find(tid);
-   assert(!pool[i->second]->isInTransaction());
-   free_list.push_back(i->second);
+   int i = thread_map.getSlot(tid);
+   assert(i >= 0);
+   assert(!pool[i]->isInTransaction());
 
    // issue 1250: close any other statements created on this datasource
-   qore_ds_private::get(*pool[i->second])->transactionDone(true, true, xsink);
+   qore_ds_private::get(*pool[i])->transactionDone(true, true, xsink);
 
-   tmap.erase(i);
+   thread_map.clearSlot(tid);
+   releaseSlot(i);
+}
+
+void DatasourcePool::releaseSlot(int i) {
+    in_use[i].store(false);
 
-   if (wait_count)
-      signal();
+    // hand the connection off to the first waiting thread, if any; the sequentially-consistent store and load
+    // ensure that either the waiter sees the free connection or we see the waiter
+    if (wait_count.load()) {
+        AutoLocker al((QoreThreadLock*)this);
+        bool f = false;
+        if (!waiters.empty() && in_use[i].compare_exchange_strong(f, true)) {
+            PoolWaiter* w = waiters.front();
+            waiters.pop_front();
+            w->slot = i;
+            w->cond.signal();
+        }
+    }
 }
 
 Datasource* DatasourcePool::getDS(bool &new_ds, ExceptionSink* xsink) {
@@ -339,11 +367,10 @@ Datasource* DatasourcePool::getDS(bool &new_ds, ExceptionSink* xsink) {
 }
 
 Datasource* DatasourcePool::getAllocatedDS() {
-   SafeLocker sl((QoreThreadLock*)this);
-   // see if thread already has a datasource allocated
-   thread_use_t::iterator i = tmap.find(gettid());
-   assert(i != tmap.end());
-   return pool[i->second];
+   // the thread must already have a datasource allocated
+   int i = thread_map.getSlot(gettid());
+   assert(i >= 0);
+   return pool[i];
 }
 
 // must be called in the lock
@@ -376,108 +403,152 @@ int DatasourcePool::checkWait(int64 wait_total, ExceptionSink* xsink) {
     return *xsink ? -1 : 0;
 }
 
+// acquires a free connection without the lock; returns the pool index or -1 if no connection is free
+int DatasourcePool::acquireFreeSlot(int hint) {
+    unsigned n = cmax.load(std::memory_order_acquire);
+
+    // try the connection last used by the thread first to benefit from any server-side state for the connection
+    if (hint >= 0 && (unsigned)hint < n) {
+        bool f = false;
+        if (in_use[hint].compare_exchange_strong(f, true)) {
+            ++stats_affinity;
+            return hint;
+        }
+    }
+
+    for (unsigned i = 0; i < n; ++i) {
+        bool f = false;
+        if (!in_use[i].load(std::memory_order_relaxed) && in_use[i].compare_exchange_strong(f, true))
+            return i;
+    }
+    return -1;
+}
+
 Datasource* DatasourcePool::getDSIntern(bool& new_ds, int64& wait_total, ExceptionSink* xsink) {
     assert(!new_ds);
 
     int tid = gettid();
 
-    Datasource* ds;
-
-    SafeLocker sl((QoreThreadLock*)this);
-
     // increase request counter
     ++stats_reqs;
 
-    // see if thread already has a datasource allocated
-    thread_use_t::iterator i = tmap.find(tid);
-    if (i != tmap.end()) {
+    // see if thread already has a datasource allocated; only the current thread can change its entry
+    int i = thread_map.getSlot(tid);
+    if (i >= 0) {
         ++stats_hits;
-        //printd(5, "DatasourcePool::getDSIntern() this: %p returning already allocated ds: %p\n", this, pool[i->second]);
-        return pool[i->second];
+        //printd(5, "DatasourcePool::getDSIntern() this: %p returning already allocated ds: %p\n", this, pool[i]);
+        return pool[i];
     }
 
     // will be a new allocation, not already in a transaction
     new_ds = true;
 
-    // iteration flag
-    bool iter = false;
+    // see if there is a datasource free; if other threads are already waiting, then queue behind them
+    i = wait_count.load() ? -1 : acquireFreeSlot(thread_map.getHint(tid));
+    if (i >= 0) {
+        // increase hit counter
+        ++stats_hits;
+    } else {
+        i = acquireSlotWait(tid, wait_total, xsink);
+        if (i < 0)
+            return nullptr;
+    }
 
-    // see if there is a datasource free
-    while (true) {
-        if (!free_list.empty()) {
-            int fi = free_list.front();
-            free_list.pop_front();
-            // DEBUG
-            //printf("DSP::getDS() assigning tid %d index %d from free list (%N)\n", $tid, $i, $.p[$i]);
+    tid_list[i] = tid;
+    thread_map.setSlot(tid, i);
 
-            tmap[tid] = fi;
-            ds = pool[fi];
-            tid_list[fi] = tid;
+    // add to thread resource list
+    //printd(5, "DatasourcePool::getDSIntern() set_thread_resource(this: %p) ds: %p\n", this, pool[i]);
 
-            // increase hit counter
-            if (!iter)
-                ++stats_hits;
-            break;
+    set_thread_resource(this);
+
+    assert(pool[i]);
+    return pool[i];
+}
+
+// acquires a connection in the lock, opening a new connection if possible or waiting for a free connection
+int DatasourcePool::acquireSlotWait(int tid, int64& wait_total, ExceptionSink* xsink) {
+    SafeLocker sl((QoreThreadLock*)this);
+
+    if (waiters.empty()) {
+        int i = acquireFreeSlot(-1);
+        if (i >= 0) {
+            ++stats_hits;
+            return i;
         }
 
         // see if we can open a new connection
-        if (cmax < max) {
-            ds = pool[cmax] = config.get(this, xsink);
+        unsigned n = cmax.load(std::memory_order_relaxed);
+        if (n < max) {
+            pool[n] = config.get(this, xsink);
             assert(!*xsink);
-
-            tmap[tid] = cmax;
-            tid_list[cmax++] = tid;
+            in_use[n].store(true, std::memory_order_relaxed);
+            // publish the new connection to threads acquiring connections without the lock
+            cmax.store(n + 1, std::memory_order_release);
 
             // increase hit counter
-            if (!iter)
-                ++stats_hits;
-
-            break;
+            ++stats_hits;
+            return n;
         }
+    }
 
-        //printd(5, "DatasourcePool::getDSIntern() this: %p tl_timeout_ms: %d max: %d\n", this, tl_timeout_ms, max);
-        // otherwise we sleep until a connection becomes available
-        ++wait_count;
-        int64 warn_start = q_clock_getmicros();
-        int rc = tl_timeout_ms ? wait((QoreThreadLock*)this, tl_timeout_ms) : wait((QoreThreadLock*)this);
-        wait_count--;
-
-        // add waiting time to total time
-        wait_total += (q_clock_getmicros() - warn_start);
-
-        if (!valid) {
-            xsink->raiseException("DATASOURCEPOOL-ERROR", "%s:%s@%s: DatasourcePool deleted while TID %d waiting " \
-                "on a connection to become free", getDriverName(), pool[0]->getUsernameStr().c_str(),
-                pool[0]->getDBNameStr().c_str(), tid);
-            return nullptr;
-        }
+    // otherwise we sleep until a connection is handed off to us by the thread releasing it
+    PoolWaiter w;
+    waiters.push_back(&w);
+    ++wait_count;
+
+    int64 warn_start = q_clock_getmicros();
+
+    // a connection may have been freed before the wait count was incremented
+    int i = waiters.front() == &w ? acquireFreeSlot(-1) : -1;
+    bool timeout = false;
+    while (i < 0 && w.slot < 0 && valid && !timeout) {
+        //printd(5, "DatasourcePool::acquireSlotWait() this: %p tl_timeout_ms: %d max: %d\n", this, tl_timeout_ms, max);
+        int rc = tl_timeout_ms ? w.cond.wait((QoreThreadLock*)this, tl_timeout_ms) : w.cond.wait((QoreThreadLock*)this);
+        if (rc && tl_timeout_ms)
+            timeout = true;
+    }
 
-        if (rc && tl_timeout_ms) {
-            xsink->raiseException("DATASOURCEPOOL-TIMEOUT", "%s:%s@%s: TID %d timed out on datasource pool after " \
-                "waiting " QLLD " millisecond%s for a free connection (max %d connections in use)",
-                                getDriverName(), pool[0]->getUsernameStr().c_str(),
-                                pool[0]->getDBNameStr().c_str(), tid,
-                                tl_timeout_ms, tl_timeout_ms == 1 ? "" : "s", max);
-            return nullptr;
+    --wait_count;
+    if (w.slot >= 0) {
+        // the connection was handed off to us, and we have already been removed from the waiter list
+        i = w.slot;
+    } else {
+        for (waiter_list_t::iterator wi = waiters.begin(), e = waiters.end(); wi != e; ++wi) {
+            if (*wi == &w) {
+                waiters.erase(wi);
+                break;
+            }
         }
-
-        if (!iter)
-            iter = true;
-        continue;
     }
 
-    if (wait_total > wait_max)
-        wait_max = wait_total;
-
-    sl.unlock();
-
-    // add to thread resource list
-    //printd(5, "DatasourcePool::getDSIntern() set_thread_resource(this: %p) ds: %p\n", this, ds);
-
-    set_thread_resource(this);
+    // add waiting time to total time
+    int64 wait_time = q_clock_getmicros() - warn_start;
+    wait_total += wait_time;
+    if (wait_time > wait_max)
+        wait_max = wait_time;
+    unsigned b = 0;
+    while (b < (DSP_WAIT_BUCKETS - 1) && wait_time >= dsp_wait_bucket_limit[b])
+        ++b;
+    ++wait_hist[b];
+
+    if (i >= 0)
+        return i;
+
+    if (!valid) {
+        xsink->raiseException("DATASOURCEPOOL-ERROR", "%s:%s@%s: DatasourcePool deleted while TID %d waiting " \
+            "on a connection to become free", getDriverName(), pool[0]->getUsernameStr().c_str(),
+            pool[0]->getDBNameStr().c_str(), tid);
+        return -1;
+    }
 
-    assert(ds);
-    return ds;
+    assert(timeout);
+    xsink->raiseException("DATASOURCEPOOL-TIMEOUT", "%s:%s@%s: TID %d timed out on datasource pool after " \
+        "waiting " QLLD " millisecond%s for a free connection (max %d connections in use)",
+                        getDriverName(), pool[0]->getUsernameStr().c_str(),
+                        pool[0]->getDBNameStr().c_str(), tid,
+                        tl_timeout_ms, tl_timeout_ms == 1 ? "" : "s", max);
+    return -1;
 }
 
 QoreValue DatasourcePool::select(const QoreString* sql, const QoreListNode* args, ExceptionSink* xsink) {
@@ -575,23 +646,24 @@ QoreStringNode* DatasourcePool::toString() {
     QoreStringNode* str = new QoreStringNode;
 
     SafeLocker sl((QoreThreadLock *)this);
-    str->sprintf("this: %p, min: %d, max: %d, cmax: %d, wait_count: %d, thread_map = (", this, min, max, cmax, wait_count);
-    thread_use_t::const_iterator ti = tmap.begin();
-    while (ti != tmap.end()) {
-        str->sprintf("tid %d: %d, ", ti->first, ti->second);
-        ++ti;
+    unsigned n = cmax.load(std::memory_order_acquire);
+    str->sprintf("this: %p, min: %d, max: %d, cmax: %d, wait_count: %d, thread_map = (", this, min, max, n, wait_count.load());
+    bool first = true;
+    for (unsigned i = 0; i < n; ++i) {
+        if (!in_use[i].load(std::memory_order_relaxed))
+            continue;
+        str->sprintf("%stid %d: %d", first ? "" : ", ", tid_list[i], i);
+        first = false;
     }
-    if (!tmap.empty())
-        str->terminate(str->strlen() - 2);
 
     str->sprintf("), free_list = (");
-    free_list_t::const_iterator fi = free_list.begin();
-    while (fi != free_list.end()) {
-        str->sprintf("%d, ", *fi);
-        ++fi;
+    first = true;
+    for (unsigned i = 0; i < n; ++i) {
+        if (in_use[i].load(std::memory_order_relaxed))
+            continue;
+        str->sprintf("%s%d", first ? "" : ", ", i);
+        first = false;
     }
-    if (!free_list.empty())
-        str->terminate(str->strlen() - 2);
     sl.unlock();
     str->concat(')');
     return str;
@@ -641,9 +713,7 @@ const QoreEncoding* DatasourcePool::getQoreEncoding() const {
 }
 
 bool DatasourcePool::inTransaction() {
-    int tid = gettid();
-    AutoLocker al((QoreThreadLock*)this);
-    return tmap.find(tid) != tmap.end();
+    return thread_map.getSlot(gettid()) >= 0;
 }
 
 QoreHashNode* DatasourcePool::getConfigHash(ExceptionSink* xsink) {
@@ -722,11 +792,53 @@ QoreHashNode* DatasourcePool::getUsageInfo() const {
         h->setKeyValue("timeout", tl_warning_ms, nullptr);
     }
     h->setKeyValue("wait_max", wait_max, nullptr);
-    h->setKeyValue("stats_reqs", stats_reqs, nullptr);
-    h->setKeyValue("stats_hits", stats_hits, nullptr);
+    int64 reqs = stats_reqs.load(std::memory_order_relaxed);
+    int64 hits = stats_hits.load(std::memory_order_relaxed);
+    h->setKeyValue("stats_reqs", reqs, nullptr);
+    h->setKeyValue("stats_hits", hits, nullptr);
+    h->setKeyValue("stats_affinity", stats_affinity.load(std::memory_order_relaxed), nullptr);
+    h->setKeyValue("hit_rate", reqs ? (double)hits / (double)reqs : 1.0, nullptr);
+
+    unsigned n = cmax.load(std::memory_order_relaxed);
+    int64 in_use_count = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        if (in_use[i].load(std::memory_order_relaxed))
+            ++in_use_count;
+    }
+    h->setKeyValue("connections", n, nullptr);
+    h->setKeyValue("in_use", in_use_count, nullptr);
+    h->setKeyValue("waiting", wait_count.load(std::memory_order_relaxed), nullptr);
+
+    QoreHashNode* wh = new QoreHashNode(bigIntTypeInfo);
+    for (unsigned i = 0; i < DSP_WAIT_BUCKETS; ++i)
+        wh->setKeyValue(dsp_wait_bucket_name[i], wait_hist[i], nullptr);
+    h->setKeyValue("wait_histogram", wh, nullptr);
     return h;
 }
 
+QoreValue DatasourcePool::getOption(const char* opt, ExceptionSink* xsink) {
+    if (strcmp(opt, DBI_OPT_STMT_CACHE_STATS))
+        return pool[0]->getOption(opt, xsink);
+
+    // sum the statement cache statistics of all connections; the size is the same for all connections
+    ReferenceHolder<QoreHashNode> rv(nullptr, xsink);
+    unsigned n = cmax.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i) {
+        ReferenceHolder<QoreHashNode> h(pool[i]->getOption(opt, xsink).get<QoreHashNode>(), xsink);
+        if (!rv) {
+            rv = h.release();
+            continue;
+        }
+        ConstHashIterator hi(*h);
+        while (hi.next()) {
+            if (!strcmp(hi.getKey(), "size"))
+                continue;
+            rv->setKeyValue(hi.getKey(), rv->getKeyValue(hi.getKey()).getAsBigInt() + hi.get().getAsBigInt(), nullptr);
+        }
+    }
+    return rv.release();
+}
+
 void DatasourcePool::setEventQueue(Queue* q, QoreValue arg, ExceptionSink* xsink) {
     AutoLocker al((QoreThreadLock*)this);
 
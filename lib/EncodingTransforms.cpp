@@ -0,0 +1,390 @@
+/* indent-tabs-mode: nil -*- */
+/*
+  EncodingTransforms.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include "qore/Qore.h"
+#include "qore/intern/EncodingTransforms.h"
+
+#include <algorithm>
+#include <string>
+
+// base class for encoding transformations; output is produced in an internal buffer and copied to the caller's
+// buffer as space is available
+class EncodingTransformBase : public Transform {
+public:
+    std::pair<int64, int64> apply(const void* src, int64 srcLen, void* dst, int64 dstLen, ExceptionSink* xsink) {
+        if (error) {
+            xsink->raiseException(err, "invalid stream state");
+            return std::make_pair(0, 0);
+        }
+
+        // deliver pending output first
+        char* d = static_cast<char*>(dst);
+        int64 written = drain(d, dstLen);
+        if (outPos < out.size()) {
+            return std::make_pair(0, written);
+        }
+
+        int64 read = 0;
+        if (src) {
+            // limit the input to the amount that will approximately fill the output buffer
+            read = std::min(srcLen, std::max((int64)4, getInputLimit(dstLen - written)));
+            if (process(static_cast<const unsigned char*>(src), read, xsink)) {
+                error = true;
+                return std::make_pair(0, 0);
+            }
+        } else if (!finished) {
+            finished = true;
+            if (finish(xsink)) {
+                error = true;
+                return std::make_pair(0, 0);
+            }
+        }
+
+        written += drain(d + written, dstLen - written);
+        return std::make_pair(read, written);
+    }
+
+protected:
+    // pending output
+    std::string out;
+    // offset of the first byte of pending output not yet delivered
+    size_t outPos = 0;
+    // the exception code for errors
+    const char* err;
+
+    DLLLOCAL EncodingTransformBase(const char* err) : err(err) {
+    }
+
+    //! processes the given input data and appends the result to the output buffer; returns -1 if an exception was raised
+    DLLLOCAL virtual int process(const unsigned char* src, int64 len, ExceptionSink* xsink) = 0;
+
+    //! processes any remaining input at the end of the stream; returns -1 if an exception was raised
+    DLLLOCAL virtual int finish(ExceptionSink* xsink) = 0;
+
+    //! returns the number of input bytes that produce approximately the given number of output bytes
+    DLLLOCAL virtual int64 getInputLimit(int64 outputSize) const = 0;
+
+    //! reserves room for size bytes at the end of the output buffer and returns a pointer to it
+    DLLLOCAL char* reserve(size_t size) {
+        size_t len = out.size();
+        out.resize(len + size);
+        return &out[len];
+    }
+
+private:
+    bool finished = false;
+    bool error = false;
+
+    DLLLOCAL int64 drain(char* dst, int64 dstLen) {
+        int64 n = std::min((int64)(out.size() - outPos), dstLen);
+        if (n) {
+            memcpy(dst, out.data() + outPos, n);
+            outPos += n;
+        }
+        if (outPos == out.size()) {
+            out.clear();
+            outPos = 0;
+        }
+        return n;
+    }
+};
+
+// see: RFC-1421: http://www.ietf.org/rfc/rfc1421.txt and RFC-2045: http://www.ietf.org/rfc/rfc2045.txt
+class Base64EncodeTransform : public EncodingTransformBase {
+public:
+    DLLLOCAL Base64EncodeTransform(int64 maxlinelen) : EncodingTransformBase("BASE64-ENCODE-ERROR"),
+            maxlinelen(maxlinelen > 0 ? maxlinelen : 0) {
+    }
+
+protected:
+    DLLLOCAL virtual int process(const unsigned char* src, int64 len, ExceptionSink* xsink) {
+        // complete a group with bytes left over from the last call
+        while (carryLen && carryLen < 3 && len) {
+            carry[carryLen++] = *src++;
+            --len;
+        }
+        if (carryLen == 3) {
+            encode(carry, 3);
+            carryLen = 0;
+        }
+
+        int64 tail = len % 3;
+        if (len - tail) {
+            encode(src, len - tail);
+        }
+        memcpy(carry + carryLen, src + (len - tail), tail);
+        carryLen += tail;
+        return 0;
+    }
+
+    DLLLOCAL virtual int finish(ExceptionSink* xsink) {
+        if (carryLen) {
+            encode(carry, carryLen);
+            carryLen = 0;
+        }
+        return 0;
+    }
+
+    DLLLOCAL virtual int64 getInputLimit(int64 outputSize) const {
+        return outputSize / 4 * 3;
+    }
+
+private:
+    // maximum line length or 0 for no line breaks
+    size_t maxlinelen;
+    // current line length
+    size_t linelen = 0;
+    // bytes not yet encoded
+    unsigned char carry[3];
+    int carryLen = 0;
+
+    DLLLOCAL void encode(const unsigned char* src, size_t len) {
+        if (!maxlinelen) {
+            q_base64_encode(reserve(q_base64_encoded_len(len)), src, len);
+            return;
+        }
+
+        char buf[1024];
+        while (len) {
+            size_t n = std::min(len, (size_t)768);
+            size_t elen = q_base64_encode(buf, src, n);
+            src += n;
+            len -= n;
+
+            // padding is only produced for the last group and is not counted in the line length
+            size_t pad = 0;
+            while (pad < 2 && buf[elen - pad - 1] == '=') {
+                ++pad;
+            }
+            concatLines(buf, elen - pad);
+            if (pad) {
+                memcpy(reserve(pad), "==", pad);
+            }
+        }
+    }
+
+    // adds the given characters to the output with a CRLF after every maxlinelen characters
+    DLLLOCAL void concatLines(const char* p, size_t len) {
+        while (len) {
+            size_t n = std::min(len, maxlinelen - linelen);
+            memcpy(reserve(n), p, n);
+            p += n;
+            len -= n;
+            linelen += n;
+            if (linelen == maxlinelen) {
+                memcpy(reserve(2), "\r\n", 2);
+                linelen = 0;
+            }
+        }
+    }
+};
+
+class Base64DecodeTransform : public EncodingTransformBase {
+public:
+    DLLLOCAL Base64DecodeTransform() : EncodingTransformBase("BASE64-PARSE-ERROR") {
+    }
+
+protected:
+    DLLLOCAL virtual int process(const unsigned char* src, int64 len, ExceptionSink* xsink) {
+        const unsigned char* end = src + len;
+        while (src < end && !padded) {
+            if (!quadLen) {
+                // decode complete groups directly
+                size_t avail = end - src;
+                size_t read;
+                size_t blen = q_base64_decode_groups(reserve(avail / 4 * 3), (const char*)src, avail, read);
+                out.resize(out.size() - (avail / 4 * 3 - blen));
+                src += read;
+                if (src == end) {
+                    break;
+                }
+            }
+
+            unsigned char c = *src++;
+            if (c == '\n' || c == '\r') {
+                continue;
+            }
+            // padding is only valid after the second or third character of a group; the rest of the input is ignored
+            if (c == '=' && quadLen >= 2) {
+                flushQuad();
+                padded = true;
+                break;
+            }
+            int v = q_base64_value(c);
+            if (v < 0) {
+                QoreStringNode* desc = new QoreStringNode;
+                desc->sprintf("ascii %03d", c);
+                if (c >= 32 && c < 127) {
+                    desc->sprintf(" ('%c')", c);
+                }
+                desc->concat(" is an invalid base64 character");
+                xsink->raiseException(err, desc);
+                return -1;
+            }
+            quad[quadLen++] = v;
+            if (quadLen == 4) {
+                flushQuad();
+            }
+        }
+        return 0;
+    }
+
+    DLLLOCAL virtual int finish(ExceptionSink* xsink) {
+        if (quadLen) {
+            xsink->raiseException(err, "premature end of base64 data");
+            return -1;
+        }
+        return 0;
+    }
+
+    DLLLOCAL virtual int64 getInputLimit(int64 outputSize) const {
+        return outputSize / 3 * 4;
+    }
+
+private:
+    // 6-bit values of the current incomplete group
+    unsigned char quad[4];
+    int quadLen = 0;
+    // set when padding has been found
+    bool padded = false;
+
+    DLLLOCAL void flushQuad() {
+        assert(quadLen >= 2);
+        char* p = reserve(quadLen - 1);
+        p[0] = (quad[0] << 2) | (quad[1] >> 4);
+        if (quadLen > 2) {
+            p[1] = (quad[1] << 4) | (quad[2] >> 2);
+            if (quadLen > 3) {
+                p[2] = (quad[2] << 6) | quad[3];
+            }
+        }
+        quadLen = 0;
+    }
+};
+
+class HexEncodeTransform : public EncodingTransformBase {
+public:
+    DLLLOCAL HexEncodeTransform() : EncodingTransformBase("HEX-ENCODE-ERROR") {
+    }
+
+protected:
+    DLLLOCAL virtual int process(const unsigned char* src, int64 len, ExceptionSink* xsink) {
+        q_hex_encode(reserve(len * 2), src, len);
+        return 0;
+    }
+
+    DLLLOCAL virtual int finish(ExceptionSink* xsink) {
+        return 0;
+    }
+
+    DLLLOCAL virtual int64 getInputLimit(int64 outputSize) const {
+        return outputSize / 2;
+    }
+};
+
+class HexDecodeTransform : public EncodingTransformBase {
+public:
+    DLLLOCAL HexDecodeTransform() : EncodingTransformBase("PARSE-HEX-ERROR") {
+    }
+
+protected:
+    DLLLOCAL virtual int process(const unsigned char* src, int64 len, ExceptionSink* xsink) {
+        if (!len) {
+            return 0;
+        }
+
+        // complete a byte with a digit left over from the last call
+        if (hasCarry) {
+            char buf[2] = { carry, (char)*src++ };
+            --len;
+            hasCarry = false;
+            if (decode(buf, 2, xsink)) {
+                return -1;
+            }
+        }
+
+        if (len % 2) {
+            carry = src[--len];
+            hasCarry = true;
+        }
+        return decode((const char*)src, len, xsink);
+    }
+
+    DLLLOCAL virtual int finish(ExceptionSink* xsink) {
+        if (hasCarry) {
+            xsink->raiseException(err, "cannot parse an odd number of hex digits");
+            return -1;
+        }
+        return 0;
+    }
+
+    DLLLOCAL virtual int64 getInputLimit(int64 outputSize) const {
+        return outputSize * 2;
+    }
+
+private:
+    // a hex digit not yet decoded
+    char carry = 0;
+    bool hasCarry = false;
+
+    DLLLOCAL int decode(const char* src, size_t len, ExceptionSink* xsink) {
+        size_t blen = q_hex_decode(reserve(len / 2), src, len);
+        if (blen != len / 2) {
+            out.resize(out.size() - (len / 2 - blen));
+            // raise the exception for the invalid digit
+            if (get_nibble(src[blen * 2], xsink) >= 0) {
+                get_nibble(src[blen * 2 + 1], xsink);
+            }
+            return -1;
+        }
+        return 0;
+    }
+};
+
+Transform* EncodingTransforms::getEncoder(const QoreStringNode* alg, int64 maxlinelen, ExceptionSink* xsink) {
+    if (*alg == ALG_BASE64) {
+        return new Base64EncodeTransform(maxlinelen);
+    } else if (*alg == ALG_HEX) {
+        return new HexEncodeTransform;
+    }
+    xsink->raiseException("ENCODING-ERROR", "Unknown encoding algorithm: %s", alg->getBuffer());
+    return nullptr;
+}
+
+Transform* EncodingTransforms::getDecoder(const QoreStringNode* alg, ExceptionSink* xsink) {
+    if (*alg == ALG_BASE64) {
+        return new Base64DecodeTransform;
+    } else if (*alg == ALG_HEX) {
+        return new HexDecodeTransform;
+    }
+    xsink->raiseException("ENCODING-ERROR", "Unknown encoding algorithm: %s", alg->getBuffer());
+    return nullptr;
+}
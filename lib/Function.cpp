@@ -31,6 +31,7 @@
 
 #include <qore/Qore.h>
 #include "qore/intern/QoreClassIntern.h"
+#include "qore/intern/QoreCallSiteCache.h"
 #include "qore/intern/qore_program_private.h"
 #include "qore/intern/qore_list_private.h"
 #include "qore/intern/QoreParseListNode.h"
@@ -149,7 +150,8 @@ static void add_args(QoreStringNode &desc, const QoreListNode* args) {
 
 CodeEvaluationHelper::CodeEvaluationHelper(ExceptionSink* n_xsink, const QoreFunction* func,
     const AbstractQoreFunctionVariant*& variant, const char* n_name, const QoreListNode* args, QoreObject* self,
-    const qore_class_private* n_qc, qore_call_t n_ct, bool is_copy, const qore_class_private* cctx)
+    const qore_class_private* n_qc, qore_call_t n_ct, bool is_copy, const qore_class_private* cctx,
+    QoreCallSiteCache* cache)
     : ct(n_ct), name(n_name), xsink(n_xsink), qc(n_qc),
         loc(get_runtime_location()),
         tmp(n_xsink), returnTypeInfo((const QoreTypeInfo*)-1) {
@@ -160,12 +162,12 @@ CodeEvaluationHelper::CodeEvaluationHelper(ExceptionSink* n_xsink, const QoreFun
     }
 
     setCallName(func);
-    tmp.assignEval(args);
+    tmp.assignEvalArgs(args);
     if (*xsink) {
         return;
     }
 
-    init(func, variant, is_copy, cctx, self);
+    init(func, variant, is_copy, cctx, self, cache);
 }
 
 CodeEvaluationHelper::CodeEvaluationHelper(ExceptionSink* n_xsink, const QoreFunction* func,
@@ -211,7 +213,7 @@ void CodeEvaluationHelper::setCallName(const QoreFunction* func) {
 }
 
 void CodeEvaluationHelper::init(const QoreFunction* func, const AbstractQoreFunctionVariant*& variant, bool is_copy,
-    const qore_class_private* cctx, QoreObject* self) {
+    const qore_class_private* cctx, QoreObject* self, QoreCallSiteCache* cache) {
     printd(5, "CodeEvaluationHelper::init() this: %p '%s()' file: %s line: %d variant: %p cctx: %p (%s)\n", this, func->getName(),
         loc->getFile(), loc->start_line, variant, cctx, cctx ? cctx->name.c_str() : "n/a");
 
@@ -221,7 +223,9 @@ void CodeEvaluationHelper::init(const QoreFunction* func, const AbstractQoreFunc
             class_ctx = nullptr;
         }
 
-        variant = func->runtimeFindVariant(xsink, getArgs(), false, class_ctx);
+        variant = cache
+            ? cache->findVariant(func, getArgs(), class_ctx, xsink)
+            : func->runtimeFindVariant(xsink, getArgs(), false, class_ctx);
         if (!variant) {
             assert(*xsink);
             return;
@@ -548,6 +552,7 @@ void UserSignature::parseInitPushLocalVars(const QoreTypeInfo* classTypeInfo) {
 
     // push argv var on stack and save id
     argvid = push_local_var("argv", loc, listOrNothingTypeInfo, true, 1);
+    parse_implicit_arg_refs = parse_get_implicit_arg_refs();
     printd(5, "UserSignature::parseInitPushLocalVars() this: %p (%s) argvid: %p selfid: %p\n", this, getSignatureText(), argvid, selfid);
 
     resolve();
@@ -569,8 +574,10 @@ void UserSignature::parseInitPopLocalVars() {
         pop_local_var(true);
     }
 
-    // pop argv param off stack
-    pop_local_var();
+    // pop argv param off stack; argv is pushed with one reference, so more references mean that it's used
+    if (pop_local_var_get_id() > 1 || parse_get_implicit_arg_refs() != parse_implicit_arg_refs) {
+        argv_ref = true;
+    }
 
     // pop $self off stack if present
     if (selfid) {
@@ -1549,7 +1556,7 @@ const AbstractQoreFunctionVariant* QoreFunction::parseFindVariant(const QoreProg
 }
 
 // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL, then it is identified at run time
-QoreValue QoreFunction::evalFunction(const AbstractQoreFunctionVariant* variant, const QoreListNode* args, QoreProgram *pgm, ExceptionSink* xsink) const {
+QoreValue QoreFunction::evalFunction(const AbstractQoreFunctionVariant* variant, const QoreListNode* args, QoreProgram *pgm, ExceptionSink* xsink, QoreCallSiteCache* cache) const {
     const char* fname = getName();
 
     // issue #3027: catch recursive references during parse initialization
@@ -1570,7 +1577,7 @@ QoreValue QoreFunction::evalFunction(const AbstractQoreFunctionVariant* variant,
         return QoreValue();
     }
 
-    CodeEvaluationHelper ceh(xsink, this, variant, fname, args);
+    CodeEvaluationHelper ceh(xsink, this, variant, fname, args, nullptr, nullptr, CT_UNUSED, false, nullptr, cache);
     if (*xsink) return QoreValue();
     // issue #3024: make the caller's call context available
     ProgramCallContextHelper pcch(pgm);
@@ -1639,6 +1646,8 @@ void QoreFunction::addBuiltinVariant(AbstractQoreFunctionVariant* variant) {
         has_pub = true;
     }
     addVariant(variant);
+    // variants resolved at runtime may change
+    qore_call_site_cache_invalidate();
 }
 
 UserVariantExecHelper::~UserVariantExecHelper() {
@@ -1702,7 +1711,8 @@ int UserVariantBase::setupCall(CodeEvaluationHelper *ceh, ReferenceHolder<QoreLi
     // if there are more arguments than parameters
     printd(5, "UserVariantBase::setupCall() params: %d args: %d\n", num_params, num_args);
 
-    if (num_params < num_args) {
+    // argv is only created if it can be accessed by the code being called
+    if (num_params < num_args && signature.argv_ref) {
         argv = new QoreListNode(autoTypeInfo);
 
         for (unsigned i = 0; i < (num_args - num_params); i++) {
@@ -2041,6 +2051,9 @@ void QoreFunction::parseCommit() {
     }
     check_parse = false;
 
+    // variants resolved at runtime may change
+    qore_call_site_cache_invalidate();
+
     parseCheckReturnType();
 
     for (vlist_t::iterator i = vlist.begin(), e = vlist.end(); i != e; ++i) {
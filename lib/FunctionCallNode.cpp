@@ -58,10 +58,10 @@ QoreValue AbstractMethodCallNode::exec(QoreObject* o, const char* c_str, const q
 
         return variant
             ? qore_method_private::evalNormalVariant(*method, xsink, o, reinterpret_cast<const QoreExternalMethodVariant*>(variant), args)
-            : qore_method_private::eval(*method, xsink, o, args, ctx);
+            : qore_method_private::eval(*method, xsink, o, args, ctx, getCallSiteCache());
     }
     //printd(5, "AbstractMethodCallNode::exec() calling QoreObject::evalMethod() for %s::%s()\n", o->getClassName(), c_str);
-    return qore_class_private::get(*o->getClass())->evalMethod(o, c_str, args, ctx, xsink);
+    return qore_class_private::get(*o->getClass())->evalMethod(o, c_str, args, ctx, xsink, getCallSiteCache());
 }
 
 const QoreTypeInfo* AbstractMethodCallNode::getTypeInfo() const {
@@ -360,7 +360,7 @@ QoreValue FunctionCallNode::evalImpl(bool& needs_deref, ExceptionSink* xsink) co
     //printd(5, "FunctionCallNode::evalImpl() this: %p '%s' tmp_args: %d args: %p '%s' (%zd)\n", this, func->getName(), tmp_args, args, args ? get_full_type_name(args) : "n/a", args ? args->size() : 0);
     return tmp_args
         ? func->evalFunctionTmpArgs(variant, args, pgm, xsink)
-        : func->evalFunction(variant, args, pgm, xsink);
+        : func->evalFunction(variant, args, pgm, xsink, variant ? nullptr : getCallSiteCache());
 }
 
 void FunctionCallNode::parseInitImpl(QoreValue& val, LocalVar* oflag, int pflag, int& lvids, const QoreTypeInfo*& returnTypeInfo) {
@@ -0,0 +1,94 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  MmapInputStream.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/MmapInputStream.h"
+
+#include <cerrno>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+MmapInputStream::MmapInputStream(const QoreStringNode* fileName, ExceptionSink* xsink) {
+    if (f.open2(xsink, fileName->c_str(), O_RDONLY))
+        return;
+
+    struct stat sbuf;
+    if (fstat(f.getFD(), &sbuf)) {
+        xsink->raiseErrnoException("FILE-MMAP-ERROR", errno, "cannot stat '%s'", fileName->c_str());
+        return;
+    }
+    if (!S_ISREG(sbuf.st_mode)) {
+        xsink->raiseException("FILE-MMAP-ERROR", "cannot map '%s'; only regular files can be mapped",
+            fileName->c_str());
+        return;
+    }
+    // empty files cannot be mapped
+    if (!sbuf.st_size)
+        return;
+
+#ifdef HAVE_SYS_MMAN_H
+    void* p = mmap(nullptr, sbuf.st_size, PROT_READ, MAP_SHARED, f.getFD(), 0);
+    if (p == MAP_FAILED) {
+        xsink->raiseErrnoException("FILE-MMAP-ERROR", errno, "cannot map '%s'", fileName->c_str());
+        return;
+    }
+    data = static_cast<char*>(p);
+    len = sbuf.st_size;
+#ifdef MADV_SEQUENTIAL
+    // the data is normally scanned from the beginning to the end
+    madvise(p, len, MADV_SEQUENTIAL);
+#endif
+#else
+    // no memory mapping available; read the file into memory instead
+    qore_offset_t size = sbuf.st_size;
+    data = static_cast<char*>(malloc(size));
+    while (len < (size_t)size) {
+        size_t rc = f.read(data + len, size - len, -1, xsink);
+        if (*xsink)
+            return;
+        if (!rc)
+            break;
+        len += rc;
+    }
+#endif
+}
+
+MmapInputStream::~MmapInputStream() {
+    if (data) {
+#ifdef HAVE_SYS_MMAN_H
+        munmap(data, len);
+#else
+        free(data);
+#endif
+    }
+}
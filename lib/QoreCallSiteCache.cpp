@@ -0,0 +1,324 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreCallSiteCache.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/QoreCallSiteCache.h"
+#include "qore/intern/Function.h"
+#include "qore/intern/QoreHashNodeIntern.h"
+#include "qore/intern/qore_list_private.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <vector>
+
+// entries are only valid in the generation in which they were created; 0 marks an empty entry
+static std::atomic<unsigned> call_site_cache_gen(1);
+
+// call sites with a cache; used to report statistics
+typedef std::set<const QoreCallSiteCache*> call_site_set_t;
+static call_site_set_t call_site_set;
+static QoreThreadLock call_site_lck;
+
+void qore_call_site_cache_invalidate() {
+    if (!++call_site_cache_gen) {
+        ++call_site_cache_gen;
+    }
+}
+
+// gets a key for the runtime type of an argument that determines variant matching; returns false if the match
+// depends on more than the type
+static bool get_arg_key(const QoreValue& n, const void*& key) {
+    qore_type_t t = n.getType();
+    switch (t) {
+        case NT_OBJECT: {
+            const QoreObject* o = n.get<const QoreObject>();
+            // deleted objects do not match any class
+            if (!o->isValid()) {
+                return false;
+            }
+            key = o->getClass();
+            return true;
+        }
+
+        case NT_LIST: {
+            const QoreTypeInfo* ti = qore_list_private::get(*n.get<const QoreListNode>())->complexTypeInfo;
+            key = ti ? static_cast<const void*>(ti) : reinterpret_cast<const void*>((uintptr_t)t);
+            return true;
+        }
+
+        case NT_HASH: {
+            const qore_hash_private* h = qore_hash_private::get(*n.get<const QoreHashNode>());
+            if (h->hashdecl) {
+                key = h->hashdecl;
+            } else if (h->complexTypeInfo) {
+                key = h->complexTypeInfo;
+            } else {
+                key = reinterpret_cast<const void*>((uintptr_t)t);
+            }
+            return true;
+        }
+
+        // matches depend on the value or object referenced
+        case NT_REFERENCE:
+        case NT_WEAKREF:
+            return false;
+
+        default:
+            key = reinterpret_cast<const void*>((uintptr_t)t);
+            return true;
+    }
+}
+
+QoreCallSiteCache::QoreCallSiteCache(const QoreProgramLocation* loc, const char* name) : pgm(getProgram()), loc(loc),
+        name(name) {
+    AutoLocker al(call_site_lck);
+    call_site_set.insert(this);
+}
+
+QoreCallSiteCache::~QoreCallSiteCache() {
+    AutoLocker al(call_site_lck);
+    call_site_set.erase(this);
+}
+
+QoreCallSiteCache* QoreCallSiteCache::get(std::atomic<QoreCallSiteCache*>& cache, const QoreProgramLocation* loc,
+        const char* name) {
+    QoreCallSiteCache* rv = cache.load(std::memory_order_acquire);
+    if (rv) {
+        return rv;
+    }
+
+    rv = new QoreCallSiteCache(loc, name);
+    QoreCallSiteCache* current = nullptr;
+    if (!cache.compare_exchange_strong(current, rv, std::memory_order_acq_rel)) {
+        // another thread created the cache first
+        delete rv;
+        return current;
+    }
+    return rv;
+}
+
+bool QoreCallSiteCache::beginUpdate(unsigned& s) {
+    s = seq.load(std::memory_order_relaxed);
+    if ((s & 1) || !seq.compare_exchange_strong(s, s + 1, std::memory_order_acquire)) {
+        return false;
+    }
+    // make sure that entry updates are not visible before the sequence change
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+const AbstractQoreFunctionVariant* QoreCallSiteCache::findVariant(const QoreFunction* func, const QoreListNode* args,
+        const qore_class_private* class_ctx, ExceptionSink* xsink) {
+    unsigned nargs = args ? args->size() : 0;
+    const void* keys[QORE_CALL_SITE_CACHE_MAX_ARGS];
+    bool cacheable = nargs <= QORE_CALL_SITE_CACHE_MAX_ARGS;
+    for (unsigned i = 0; cacheable && i < nargs; ++i) {
+        cacheable = get_arg_key(args->retrieveEntry(i), keys[i]);
+    }
+    if (!cacheable) {
+        variant_misses.fetch_add(1, std::memory_order_relaxed);
+        return func->runtimeFindVariant(xsink, args, false, class_ctx);
+    }
+
+    int64 po = runtime_get_parse_options();
+    unsigned gen = call_site_cache_gen.load(std::memory_order_acquire);
+
+    unsigned s = seq.load(std::memory_order_acquire);
+    if (!(s & 1)) {
+        for (VariantEntry& e : ventry) {
+            if (e.gen.load(std::memory_order_relaxed) != gen
+                || e.func.load(std::memory_order_relaxed) != func
+                || e.class_ctx.load(std::memory_order_relaxed) != class_ctx
+                || e.po.load(std::memory_order_relaxed) != po
+                || e.nargs.load(std::memory_order_relaxed) != nargs) {
+                continue;
+            }
+            unsigned i = 0;
+            while (i < nargs && e.args[i].load(std::memory_order_relaxed) == keys[i]) {
+                ++i;
+            }
+            if (i < nargs) {
+                continue;
+            }
+            const AbstractQoreFunctionVariant* variant = e.variant.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s) {
+                variant_hits.fetch_add(1, std::memory_order_relaxed);
+                return variant;
+            }
+            break;
+        }
+    }
+
+    variant_misses.fetch_add(1, std::memory_order_relaxed);
+    const AbstractQoreFunctionVariant* variant = func->runtimeFindVariant(xsink, args, false, class_ctx);
+    if (variant) {
+        addVariant(gen, func, class_ctx, po, nargs, keys, variant);
+    }
+    return variant;
+}
+
+void QoreCallSiteCache::addVariant(unsigned gen, const QoreFunction* func, const qore_class_private* class_ctx,
+        int64 po, unsigned nargs, const void** keys, const AbstractQoreFunctionVariant* variant) {
+    unsigned s;
+    // if another thread is updating the cache, the variant is not cached
+    if (!beginUpdate(s)) {
+        return;
+    }
+
+    // use an empty or stale entry if possible
+    VariantEntry* e = nullptr;
+    for (VariantEntry& i : ventry) {
+        if (i.gen.load(std::memory_order_relaxed) != gen) {
+            e = &i;
+            break;
+        }
+    }
+    if (!e) {
+        e = &ventry[vnext++ % QORE_CALL_SITE_CACHE_SIZE];
+    }
+
+    e->gen.store(gen, std::memory_order_relaxed);
+    e->func.store(func, std::memory_order_relaxed);
+    e->class_ctx.store(class_ctx, std::memory_order_relaxed);
+    e->po.store(po, std::memory_order_relaxed);
+    e->nargs.store(nargs, std::memory_order_relaxed);
+    for (unsigned i = 0; i < nargs; ++i) {
+        e->args[i].store(keys[i], std::memory_order_relaxed);
+    }
+    e->variant.store(variant, std::memory_order_relaxed);
+
+    endUpdate(s);
+}
+
+const QoreMethod* QoreCallSiteCache::findMethod(const QoreClass* cls, const qore_class_private* class_ctx) {
+    unsigned gen = call_site_cache_gen.load(std::memory_order_acquire);
+
+    unsigned s = seq.load(std::memory_order_acquire);
+    if (!(s & 1)) {
+        for (MethodEntry& e : mentry) {
+            if (e.gen.load(std::memory_order_relaxed) != gen
+                || e.cls.load(std::memory_order_relaxed) != cls
+                || e.class_ctx.load(std::memory_order_relaxed) != class_ctx) {
+                continue;
+            }
+            const QoreMethod* m = e.method.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s) {
+                method_hits.fetch_add(1, std::memory_order_relaxed);
+                return m;
+            }
+            break;
+        }
+    }
+
+    method_misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void QoreCallSiteCache::addMethod(const QoreClass* cls, const qore_class_private* class_ctx, const QoreMethod* m) {
+    unsigned gen = call_site_cache_gen.load(std::memory_order_acquire);
+
+    unsigned s;
+    // if another thread is updating the cache, the method is not cached
+    if (!beginUpdate(s)) {
+        return;
+    }
+
+    // use an empty or stale entry if possible
+    MethodEntry* e = nullptr;
+    for (MethodEntry& i : mentry) {
+        if (i.gen.load(std::memory_order_relaxed) != gen) {
+            e = &i;
+            break;
+        }
+    }
+    if (!e) {
+        e = &mentry[mnext++ % QORE_CALL_SITE_CACHE_SIZE];
+    }
+
+    e->gen.store(gen, std::memory_order_relaxed);
+    e->cls.store(cls, std::memory_order_relaxed);
+    e->class_ctx.store(class_ctx, std::memory_order_relaxed);
+    e->method.store(m, std::memory_order_relaxed);
+
+    endUpdate(s);
+}
+
+QoreListNode* QoreCallSiteCache::getInfo(const QoreProgram* pgm) {
+    ReferenceHolder<QoreListNode> rv(new QoreListNode(autoHashTypeInfo), nullptr);
+
+    AutoLocker al(call_site_lck);
+
+    std::vector<const QoreCallSiteCache*> sites;
+    for (const QoreCallSiteCache* i : call_site_set) {
+        if (i->pgm == pgm) {
+            sites.push_back(i);
+        }
+    }
+    // sort by location
+    std::sort(sites.begin(), sites.end(), [] (const QoreCallSiteCache* a, const QoreCallSiteCache* b) -> bool {
+        const char* af = a->loc->getFile();
+        const char* bf = b->loc->getFile();
+        int rc = strcmp(af ? af : "", bf ? bf : "");
+        if (rc) {
+            return rc < 0;
+        }
+        return a->loc->start_line < b->loc->start_line;
+    });
+
+    for (const QoreCallSiteCache* i : sites) {
+        ReferenceHolder<QoreHashNode> h(new QoreHashNode(autoTypeInfo), nullptr);
+        qore_hash_private* ph = qore_hash_private::get(**h);
+        const char* file = i->loc->getFile();
+        if (file) {
+            ph->setKeyValueIntern("file", new QoreStringNode(file));
+        }
+        ph->setKeyValueIntern("line", i->loc->start_line);
+        ph->setKeyValueIntern("name", new QoreStringNode(i->name.c_str()));
+
+        int64 vh = i->variant_hits.load(std::memory_order_relaxed);
+        int64 vm = i->variant_misses.load(std::memory_order_relaxed);
+        int64 mh = i->method_hits.load(std::memory_order_relaxed);
+        int64 mm = i->method_misses.load(std::memory_order_relaxed);
+        ph->setKeyValueIntern("variant_hits", vh);
+        ph->setKeyValueIntern("variant_misses", vm);
+        ph->setKeyValueIntern("method_hits", mh);
+        ph->setKeyValueIntern("method_misses", mm);
+        int64 total = vh + vm + mh + mm;
+        ph->setKeyValueIntern("hit_rate", total ? (double)(vh + mh) / (double)total : 0.0);
+
+        rv->push(h.release(), nullptr);
+    }
+
+    return rv.release();
+}
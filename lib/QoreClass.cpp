@@ -36,6 +36,8 @@
 #include "qore/intern/qore_program_private.h"
 #include "qore/intern/ql_crypto.h"
 #include "qore/intern/QoreObjectIntern.h"
+#include "qore/intern/QoreHashNodeIntern.h"
+#include "qore/intern/QoreCallSiteCache.h"
 
 #include <cassert>
 #include <cstdlib>
@@ -653,6 +655,11 @@ qore_class_private::~qore_class_private() {
     if (owns_ornothingtypeinfo)
         delete orNothingTypeInfo;
 
+    HashShape* s = shape.load(std::memory_order_relaxed);
+    if (s) {
+        s->deref();
+    }
+
     if (mud) {
         try {
             mud->doDeref();
@@ -1033,6 +1040,51 @@ int qore_class_private::initMembers(QoreObject& o, bool& need_scan, ExceptionSin
     return 0;
 }
 
+const HashShape* qore_class_private::getShape() const {
+    HashShape* s = shape.load(std::memory_order_acquire);
+    if (s) {
+        return s;
+    }
+    // the member initialization list is only complete once the class has been committed
+    if (!committed) {
+        return nullptr;
+    }
+
+    s = new HashShape;
+    for (auto& i : member_init_list) {
+        // only members stored in the standard object hash are part of the shape
+        if (!i.member_class_ctx && s->find(i.name) == QORE_HASH_NO_SLOT) {
+            s->addKey(i.name);
+        }
+    }
+    if (!s->size()) {
+        s->deref();
+        return nullptr;
+    }
+    s->finalize();
+
+    // another thread may have created the shape in the meantime
+    HashShape* current = nullptr;
+    if (!shape.compare_exchange_strong(current, s, std::memory_order_acq_rel)) {
+        s->deref();
+        return current;
+    }
+    return s;
+}
+
+unsigned qore_class_private::runtimeGetMemberSlot(const char* mem, const qore_class_private* class_ctx, const QoreTypeInfo*& typeInfo) const {
+    const QoreMemberInfo* info = runtimeGetMemberInfo(mem, class_ctx);
+    if (!info || info->getClassContext(class_ctx) || (info->access > Public && !class_ctx)) {
+        return QORE_HASH_NO_SLOT;
+    }
+    const HashShape* s = getShape();
+    if (!s) {
+        return QORE_HASH_NO_SLOT;
+    }
+    typeInfo = info->getTypeInfo();
+    return s->find(mem);
+}
+
 int qore_class_private::initMember(QoreObject& o, bool& need_scan, const char* member_name, const QoreMemberInfo& info, const qore_class_private* member_class_ctx, ExceptionSink* xsink) const {
     //printd(5, "qore_class_private::initMember() this: %p '%s::%s' initializing '%s::%s' member_class_ctx: %p'\n", this, name.c_str(), member_name, member_class_ctx ? member_class_ctx->name.c_str() : "<self>", member_name, member_class_ctx);
     QoreValue& v = qore_object_private::get(o)->getMemberValueRefForInitialization(member_name, member_class_ctx);
@@ -3132,6 +3184,9 @@ QoreClass* QoreClass::copy() {
 }
 
 QoreClass::~QoreClass() {
+    // call sites may have cached methods and variants resolved for this class
+    qore_call_site_cache_invalidate();
+
     // dereference the private data if still present
     if (priv) {
         {
@@ -3411,7 +3466,7 @@ QoreValue qore_class_private::evalMemberGate(QoreObject* self, const char* nme,
     return self->evalMethod(*memberGate, *args, xsink);
 }
 
-QoreValue qore_class_private::evalMethod(QoreObject* self, const char* nme, const QoreListNode* args, const qore_class_private* class_ctx, ExceptionSink* xsink) const {
+QoreValue qore_class_private::evalMethod(QoreObject* self, const char* nme, const QoreListNode* args, const qore_class_private* class_ctx, ExceptionSink* xsink, QoreCallSiteCache* cache) const {
     QORE_TRACE("qore_class_private::evalMethod()");
     assert(self);
 
@@ -3423,13 +3478,19 @@ QoreValue qore_class_private::evalMethod(QoreObject* self, const char* nme, cons
         return execCopy(self, xsink);
     }
 
-    const QoreMethod* w = getMethodForEval(nme, self->getProgram(), class_ctx, xsink);
-    if (*xsink) {
-        return QoreValue();
+    const QoreMethod* w = cache ? cache->findMethod(cls, class_ctx) : nullptr;
+    if (!w) {
+        w = getMethodForEval(nme, self->getProgram(), class_ctx, xsink);
+        if (*xsink) {
+            return QoreValue();
+        }
+        if (w && cache) {
+            cache->addMethod(cls, class_ctx, w);
+        }
     }
 
     if (w) {
-        return qore_method_private::eval(*w, xsink, self, args, class_ctx);
+        return qore_method_private::eval(*w, xsink, self, args, class_ctx, cache);
     }
 
     // first see if there is a pseudo-method for this
@@ -4783,12 +4844,12 @@ void DestructorMethodFunction::evalDestructor(const QoreClass& thisclass, QoreOb
 }
 
 // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
-QoreValue NormalMethodFunction::evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx) const {
+QoreValue NormalMethodFunction::evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, QoreObject* self, const QoreListNode* args, const qore_class_private* cctx, QoreCallSiteCache* cache) const {
     const char* cname = getClassName();
     const char* mname = getName();
     //printd(5, "NormalMethodFunction::evalMethod() %s::%s() v: %d\n", cname, mname, self->isValid());
 
-    CodeEvaluationHelper ceh(xsink, this, variant, mname, args, self, qore_class_private::get(*qc), CT_UNUSED, false, cctx);
+    CodeEvaluationHelper ceh(xsink, this, variant, mname, args, self, qore_class_private::get(*qc), CT_UNUSED, false, cctx, cache);
     if (*xsink)
         return QoreValue();
 
@@ -4834,9 +4895,9 @@ QoreValue NormalMethodFunction::evalPseudoMethod(ExceptionSink* xsink, const Abs
 }
 
 // if the variant was identified at parse time, then variant will not be NULL, otherwise if NULL then it is identified at run time
-QoreValue StaticMethodFunction::evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, const QoreListNode* args, const qore_class_private* cctx) const {
+QoreValue StaticMethodFunction::evalMethod(ExceptionSink* xsink, const AbstractQoreFunctionVariant* variant, const QoreListNode* args, const qore_class_private* cctx, QoreCallSiteCache* cache) const {
    const char* mname = getName();
-   CodeEvaluationHelper ceh(xsink, this, variant, mname, args, nullptr, qore_class_private::get(*qc), CT_UNUSED, false, cctx);
+   CodeEvaluationHelper ceh(xsink, this, variant, mname, args, nullptr, qore_class_private::get(*qc), CT_UNUSED, false, cctx, cache);
    if (*xsink)
       return QoreValue();
 
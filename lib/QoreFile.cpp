@@ -40,15 +40,18 @@ int qore_qf_private::readUnicode(int* n_len) const {
    assert(charset->getMaxCharWidth() <= 4);
    char buf[4];
 #endif
-   if (read(buf, 1) != 1)
+   int c = readChar();
+   if (c < 0)
       return -1;
+   buf[0] = (char)c;
 
    int len = (int)charset->getCharLen(buf, 1);
    if (len < 0) {
       len = -len;
       for (int i = 1; i < len; ++i) {
-         if (read(&buf[i], 1) != 1)
+         if ((c = readChar()) < 0)
             return -1;
+         buf[i] = (char)c;
       }
    }
 
@@ -316,12 +319,7 @@ int QoreFile::readUntil(const char* bytes, QoreString& str, bool incl_bytes) {
 }
 
 qore_size_t QoreFile::setPos(qore_size_t pos) {
-   AutoLocker al(priv->m);
-
-   if (!priv->is_open)
-      return -1;
-
-   return lseek(priv->fd, pos, SEEK_SET);
+   return priv->setPos(pos);
 }
 
 // FIXME: deleteme
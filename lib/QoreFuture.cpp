@@ -0,0 +1,270 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreFuture.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/QoreFuture.h"
+
+#include <cerrno>
+
+// resolves the target future with the result of calling code with the value of the source future
+class QoreFutureThenListener : public AbstractFutureListener {
+public:
+    DLLLOCAL QoreFutureThenListener(ResolvedCallReferenceNode* code, QoreFuture* target) : code(code),
+            target(target) {
+    }
+
+    DLLLOCAL virtual void done(QoreFuture& f, ExceptionSink* xsink) {
+        if (f.hasException()) {
+            target->setException(f, xsink);
+            return;
+        }
+
+        ReferenceHolder<QoreListNode> args(new QoreListNode(autoTypeInfo), xsink);
+        args->push(f.getValue().refSelf(), xsink);
+
+        ExceptionSink xs;
+        QoreValue rv = code->execValue(*args, &xs);
+        target->set(rv, xs, xsink);
+    }
+
+    DLLLOCAL virtual void del(ExceptionSink* xsink) {
+        code->deref(xsink);
+        target->deref(xsink);
+        delete this;
+    }
+
+private:
+    ResolvedCallReferenceNode* code;
+    QoreFuture* target;
+};
+
+// shared state for QoreFuture::all()
+class QoreFutureAllState : public QoreReferenceCounter {
+public:
+    QoreThreadLock m;
+    // the result list; set to nullptr when the result has been passed to the target future
+    QoreListNode* results;
+    // the number of futures not yet resolved
+    size_t remaining;
+    // set when the target future has been resolved with an exception
+    bool failed = false;
+    QoreFuture* target;
+
+    DLLLOCAL QoreFutureAllState(size_t size, QoreFuture* target) : results(new QoreListNode(autoTypeInfo)),
+            remaining(size), target(target) {
+        for (size_t i = 0; i < size; ++i) {
+            results->push(QoreValue(), nullptr);
+        }
+    }
+
+    DLLLOCAL void deref(ExceptionSink* xsink) {
+        if (ROdereference()) {
+            if (results) {
+                results->deref(xsink);
+            }
+            target->deref(xsink);
+            delete this;
+        }
+    }
+};
+
+// stores the value of one future in the result list for QoreFuture::all()
+class QoreFutureAllListener : public AbstractFutureListener {
+public:
+    DLLLOCAL QoreFutureAllListener(QoreFutureAllState* state, size_t index) : state(state), index(index) {
+        state->ROreference();
+    }
+
+    DLLLOCAL virtual void done(QoreFuture& f, ExceptionSink* xsink) {
+        SafeLocker sl(state->m);
+        if (state->failed) {
+            return;
+        }
+
+        // the first exception resolves the target future
+        if (f.hasException()) {
+            state->failed = true;
+            sl.unlock();
+            state->target->setException(f, xsink);
+            return;
+        }
+
+        state->results->getEntryReference(index) = f.getValue().refSelf();
+        if (--state->remaining) {
+            return;
+        }
+
+        QoreListNode* l = state->results;
+        state->results = nullptr;
+        sl.unlock();
+        state->target->setValue(l, xsink);
+    }
+
+    DLLLOCAL virtual void del(ExceptionSink* xsink) {
+        state->deref(xsink);
+        delete this;
+    }
+
+private:
+    QoreFutureAllState* state;
+    size_t index;
+};
+
+void QoreFuture::set(QoreValue v, ExceptionSink& xs, ExceptionSink* xsink) {
+    ValueHolder holder(v, xsink);
+
+    SafeLocker sl(m);
+    assert(!done);
+    if (xs) {
+        err.assimilate(xs);
+    } else {
+        value = holder.release();
+    }
+    resolveIntern(sl, xsink);
+}
+
+void QoreFuture::setException(const QoreFuture& src, ExceptionSink* xsink) {
+    assert(src.done && src.err);
+    ExceptionSink xs;
+    xs.rethrow(const_cast<ExceptionSink&>(src.err).getException());
+    set(QoreValue(), xs, xsink);
+}
+
+void QoreFuture::setException(const char* err, const char* desc, ExceptionSink* xsink) {
+    ExceptionSink xs;
+    xs.raiseException(err, "%s", desc);
+    set(QoreValue(), xs, xsink);
+}
+
+void QoreFuture::resolveIntern(SafeLocker& sl, ExceptionSink* xsink) {
+    done = true;
+    if (waiting) {
+        cond.broadcast();
+    }
+
+    // call listeners outside the lock
+    std::vector<AbstractFutureListener*> l;
+    l.swap(listeners);
+    sl.unlock();
+
+    for (auto& i : l) {
+        i->done(*this, xsink);
+        i->del(xsink);
+    }
+}
+
+QoreValue QoreFuture::get(int timeout_ms, bool& to, ExceptionSink* xsink) {
+    to = false;
+
+    AutoLocker al(m);
+    if (!done) {
+        if (timeout_ms < 0) {
+            to = true;
+            return QoreValue();
+        }
+
+        int64 end = timeout_ms ? q_clock_getmillis() + timeout_ms : 0;
+        ++waiting;
+        while (!done) {
+            int rc;
+            if (timeout_ms) {
+                int64 remaining = end - q_clock_getmillis();
+                rc = remaining > 0 ? cond.wait(m, remaining) : ETIMEDOUT;
+            } else {
+                rc = cond.wait(m);
+            }
+            if (rc && !done) {
+                assert(rc == ETIMEDOUT);
+                to = true;
+                break;
+            }
+        }
+        --waiting;
+        if (to) {
+            return QoreValue();
+        }
+    }
+
+    if (err) {
+        xsink->rethrow(err.getException());
+        return QoreValue();
+    }
+    return value.refSelf();
+}
+
+void QoreFuture::addListener(AbstractFutureListener* l, ExceptionSink* xsink) {
+    {
+        AutoLocker al(m);
+        if (!done) {
+            listeners.push_back(l);
+            return;
+        }
+    }
+
+    l->done(*this, xsink);
+    l->del(xsink);
+}
+
+void QoreFuture::deref(ExceptionSink* xsink) {
+    if (ROdereference()) {
+        for (auto& i : listeners) {
+            i->del(xsink);
+        }
+        listeners.clear();
+        value.discard(xsink);
+        value = QoreValue();
+        err.clear();
+        delete this;
+    }
+}
+
+QoreFuture* QoreFuture::then(const ResolvedCallReferenceNode* code, ExceptionSink* xsink) {
+    QoreFuture* rv = new QoreFuture;
+    rv->ref();
+    addListener(new QoreFutureThenListener(code->refRefSelf(), rv), xsink);
+    return rv;
+}
+
+QoreFuture* QoreFuture::all(const std::vector<QoreFuture*>& futures, ExceptionSink* xsink) {
+    QoreFuture* rv = new QoreFuture;
+    if (futures.empty()) {
+        rv->setValue(new QoreListNode(autoTypeInfo), xsink);
+        return rv;
+    }
+
+    rv->ref();
+    QoreFutureAllState* state = new QoreFutureAllState(futures.size(), rv);
+    for (size_t i = 0, e = futures.size(); i < e; ++i) {
+        futures[i]->addListener(new QoreFutureAllListener(state, i), xsink);
+    }
+    state->deref(xsink);
+    return rv;
+}
@@ -52,12 +52,382 @@
 
 static const char* qore_hash_type_name = "hash";
 
+HashShape::HashShape(const HashShape* parent) : refs(1), parent(parent) {
+    if (parent) {
+        parent->ref();
+        keys = parent->keys;
+        hash_codes = parent->hash_codes;
+    }
+}
+
+HashShape::~HashShape() {
+    if (parent) {
+        parent->deref();
+    }
+}
+
+void HashShape::deref() const {
+    if (!--refs) {
+        delete this;
+    }
+}
+
+unsigned HashShape::addKey(const char* key) {
+    assert(!finalized);
+    assert(find(key) == QORE_HASH_NO_SLOT);
+    keys.push_back(key);
+    hash_codes.push_back((unsigned)qore_hash_str()(key));
+    return (unsigned)keys.size() - 1;
+}
+
+void HashShape::finalize() {
+#ifdef DEBUG
+    assert(!finalized);
+    finalized = true;
+#endif
+    unsigned size = 4;
+    while (size < keys.size() * 2) {
+        size <<= 1;
+    }
+    index.assign(size, QORE_HASH_NO_SLOT);
+    index_mask = size - 1;
+    for (unsigned i = 0, e = (unsigned)keys.size(); i < e; ++i) {
+        unsigned pos = hash_codes[i] & index_mask;
+        while (index[pos] != QORE_HASH_NO_SLOT) {
+            pos = (pos + 1) & index_mask;
+        }
+        index[pos] = i;
+    }
+}
+
+unsigned HashShape::find(const char* key, unsigned hash_code) const {
+    if (index.empty()) {
+        // the shape is still being built
+        for (unsigned i = 0, e = (unsigned)keys.size(); i < e; ++i) {
+            if (keys[i] == key) {
+                return i;
+            }
+        }
+        return QORE_HASH_NO_SLOT;
+    }
+    for (unsigned pos = hash_code & index_mask; ; pos = (pos + 1) & index_mask) {
+        unsigned i = index[pos];
+        if (i == QORE_HASH_NO_SLOT) {
+            return QORE_HASH_NO_SLOT;
+        }
+        if (hash_codes[i] == hash_code && keys[i] == key) {
+            return i;
+        }
+    }
+}
+
+void HashMemberList::setShape(const HashShape* s) {
+    assert(!count && !shape && !slots);
+    shape = s;
+    shape->ref();
+    shape_size = s->size();
+    // make sure that storage is available for all shape slots
+    if (shape_size) {
+        first_block = new HashMember[QORE_HASH_FIRST_BLOCK];
+    }
+    while (shape_size > QORE_HASH_FIRST_BLOCK && (QORE_HASH_FIRST_BLOCK << blocks.size()) < shape_size) {
+        blocks.push_back(new HashMember[QORE_HASH_FIRST_BLOCK << blocks.size()]);
+    }
+    slots = shape_size;
+    for (unsigned i = 0; i < shape_size; ++i) {
+        getSlot(i)->hash_code = shape->getHashCode(i);
+    }
+}
+
+unsigned HashMemberList::findSlot(const char* key) const {
+    unsigned hash_code = 0;
+    if (shape) {
+        hash_code = hashKey(key);
+        unsigned s = shape->find(key, hash_code);
+        if (s != QORE_HASH_NO_SLOT) {
+            return getSlot(s)->key.isSet() ? s : QORE_HASH_NO_SLOT;
+        }
+        if (count == shape_count) {
+            return QORE_HASH_NO_SLOT;
+        }
+    }
+
+    if (!index) {
+        // small hashes are searched linearly in insertion order
+        for (unsigned i = head; i != QORE_HASH_NO_SLOT;) {
+            HashMember* m = getSlot(i);
+            if (i >= shape_size && !strcmp(m->key.c_str(), key)) {
+                return i;
+            }
+            i = m->next;
+        }
+        return QORE_HASH_NO_SLOT;
+    }
+
+    if (!shape) {
+        hash_code = hashKey(key);
+    }
+    for (unsigned pos = hash_code & index_mask; ; pos = (pos + 1) & index_mask) {
+        unsigned i = index[pos];
+        if (i == QORE_HASH_NO_SLOT) {
+            return QORE_HASH_NO_SLOT;
+        }
+        if (i != QORE_HASH_DELETED_SLOT) {
+            HashMember* m = getSlot(i);
+            if (m->hash_code == hash_code && !strcmp(m->key.c_str(), key)) {
+                return i;
+            }
+        }
+    }
+}
+
+unsigned HashMemberList::getFreeSlot() {
+    if (free_head != QORE_HASH_NO_SLOT) {
+        unsigned s = free_head;
+        free_head = getSlot(s)->next;
+        return s;
+    }
+
+    // allocate a new block if all slots are in use
+    if (!first_block) {
+        assert(!slots);
+        first_block = new HashMember[QORE_HASH_FIRST_BLOCK];
+    } else if (slots >= QORE_HASH_FIRST_BLOCK && slots == (QORE_HASH_FIRST_BLOCK << blocks.size())) {
+        blocks.push_back(new HashMember[QORE_HASH_FIRST_BLOCK << blocks.size()]);
+    }
+    return slots++;
+}
+
+void HashMemberList::link(unsigned s) {
+    HashMember* m = getSlot(s);
+    m->next = QORE_HASH_NO_SLOT;
+    m->prev = tail;
+    if (tail == QORE_HASH_NO_SLOT) {
+        head = s;
+    } else {
+        getSlot(tail)->next = s;
+    }
+    tail = s;
+    ++count;
+}
+
+HashMember* HashMemberList::findCreate(const char* key) {
+    unsigned hash_code = 0;
+    if (shape) {
+        hash_code = hashKey(key);
+        unsigned s = shape->find(key, hash_code);
+        if (s != QORE_HASH_NO_SLOT) {
+            return findCreateShapeMember(s);
+        }
+    }
+
+    if (index) {
+        if (!shape) {
+            hash_code = hashKey(key);
+        }
+        // search the index directly to avoid hashing the key twice
+        for (unsigned pos = hash_code & index_mask; ; pos = (pos + 1) & index_mask) {
+            unsigned i = index[pos];
+            if (i == QORE_HASH_NO_SLOT) {
+                break;
+            }
+            if (i != QORE_HASH_DELETED_SLOT) {
+                HashMember* m = getSlot(i);
+                if (m->hash_code == hash_code && !strcmp(m->key.c_str(), key)) {
+                    return m;
+                }
+            }
+        }
+    } else if (count > shape_count) {
+        for (unsigned i = head; i != QORE_HASH_NO_SLOT;) {
+            HashMember* m = getSlot(i);
+            if (i >= shape_size && !strcmp(m->key.c_str(), key)) {
+                return m;
+            }
+            i = m->next;
+        }
+    }
+
+    unsigned s = getFreeSlot();
+    HashMember* m = getSlot(s);
+    assert(m->val.isNothing());
+    m->key.assign(key);
+    m->hash_code = hash_code;
+    link(s);
+
+    if (index) {
+        indexAdd(s, hash_code);
+    } else if ((count - shape_count) > QORE_HASH_LINEAR_MEMBERS) {
+        // create the index when the dynamic part of the hash grows beyond the linear search limit
+        rebuildIndex(QORE_HASH_LINEAR_MEMBERS * 4);
+    }
+
+    return m;
+}
+
+HashMember* HashMemberList::findCreateShapeMember(unsigned s) {
+    assert(s < shape_size);
+    HashMember* m = getSlot(s);
+    if (!m->key.isSet()) {
+        // share the key with the shape
+        const std::string& skey = shape->getKey(s);
+        m->key.share(skey.c_str(), skey.size());
+        link(s);
+        ++shape_count;
+    }
+    return m;
+}
+
+void HashMemberList::erase(iterator li) {
+    assert(li.l == this);
+    unsigned s = li.i;
+    HashMember* m = getSlot(s);
+
+    if (s >= shape_size && index) {
+        indexRemove(s);
+    }
+
+    // unlink from the ordered list
+    if (m->prev == QORE_HASH_NO_SLOT) {
+        head = m->next;
+    } else {
+        getSlot(m->prev)->next = m->next;
+    }
+    if (m->next == QORE_HASH_NO_SLOT) {
+        tail = m->prev;
+    } else {
+        getSlot(m->next)->prev = m->prev;
+    }
+
+    m->val = QoreValue();
+    m->key.clear();
+    m->prev = QORE_HASH_NO_SLOT;
+    --count;
+
+    if (s < shape_size) {
+        // shape slots are reserved for their keys
+        m->next = QORE_HASH_NO_SLOT;
+        --shape_count;
+    } else {
+        // return the slot to the free list
+        m->next = free_head;
+        free_head = s;
+    }
+}
+
+QoreValue HashMemberList::take(const char* key, bool& exists) {
+    iterator i = getIterator(key);
+    if (i == end()) {
+        exists = false;
+        return QoreValue();
+    }
+
+    exists = true;
+    QoreValue rv = (*i)->val;
+    erase(i);
+    return rv;
+}
+
+void HashMemberList::clear() {
+    // values have already been dereferenced by the caller
+    freeStorage();
+    first_block = nullptr;
+    blocks.clear();
+    index = nullptr;
+    shape = nullptr;
+    index_mask = index_used = count = slots = shape_size = shape_count = 0;
+    head = tail = free_head = QORE_HASH_NO_SLOT;
+}
+
+void HashMemberList::freeStorage() {
+    delete [] first_block;
+    for (auto& i : blocks) {
+        delete [] i;
+    }
+    delete [] index;
+    if (shape) {
+        shape->deref();
+    }
+}
+
+void HashMemberList::indexAdd(unsigned s, unsigned hash_code) {
+    assert(index);
+    // keep the load factor (including deleted entries) under 3/4
+    if ((index_used + 1) * 4 > (index_mask + 1) * 3) {
+        // only grow if live entries would exceed half of the index; otherwise rebuild to purge deleted entries
+        unsigned size = index_mask + 1;
+        while (((count - shape_count) * 2) > size) {
+            size <<= 1;
+        }
+        rebuildIndex(size);
+        return;
+    }
+
+    unsigned pos = hash_code & index_mask;
+    while (index[pos] != QORE_HASH_NO_SLOT && index[pos] != QORE_HASH_DELETED_SLOT) {
+        pos = (pos + 1) & index_mask;
+    }
+    if (index[pos] == QORE_HASH_NO_SLOT) {
+        ++index_used;
+    }
+    index[pos] = s;
+}
+
+void HashMemberList::indexRemove(unsigned s) {
+    assert(index);
+    for (unsigned pos = getSlot(s)->hash_code & index_mask; ; pos = (pos + 1) & index_mask) {
+        assert(index[pos] != QORE_HASH_NO_SLOT);
+        if (index[pos] == s) {
+            index[pos] = QORE_HASH_DELETED_SLOT;
+            return;
+        }
+    }
+}
+
+void HashMemberList::rebuildIndex(unsigned size) {
+    assert(!(size & (size - 1)));
+    assert(size >= (count - shape_count) * 2);
+    bool new_index = !index;
+    delete [] index;
+    index = new unsigned[size];
+    index_mask = size - 1;
+    index_used = 0;
+    for (unsigned i = 0; i < size; ++i) {
+        index[i] = QORE_HASH_NO_SLOT;
+    }
+
+    for (unsigned i = head; i != QORE_HASH_NO_SLOT;) {
+        HashMember* m = getSlot(i);
+        if (i >= shape_size) {
+            // hash codes are only maintained once the index exists
+            if (new_index && !shape) {
+                m->hash_code = hashKey(m->key.c_str());
+            }
+            unsigned pos = m->hash_code & index_mask;
+            while (index[pos] != QORE_HASH_NO_SLOT) {
+                pos = (pos + 1) & index_mask;
+            }
+            index[pos] = i;
+            ++index_used;
+        }
+        i = m->next;
+    }
+}
+
+void qore_hash_private::setHashDecl(const TypedHashDecl* hd) {
+    assert(!hashdecl);
+    hashdecl = hd;
+    if (member_list.empty() && !member_list.getShape()) {
+        member_list.setShape(typed_hash_decl_private::get(*hd)->getShape());
+    }
+}
+
 QoreListNode* qore_hash_private::getKeys() const {
     QoreListNode* list = new QoreListNode(stringTypeInfo);
     qore_list_private::get(*list)->reserve(member_list.size());
 
-    for (auto& i : member_list) {
-        list->push(new QoreStringNode(i->key), nullptr);
+    for (HashMember* i : member_list) {
+        list->push(new QoreStringNode(i->key.c_str(), i->key.size()), nullptr);
     }
     return list;
 }
@@ -66,15 +436,15 @@ QoreListNode* qore_hash_private::getValues() const {
     ReferenceHolder<QoreListNode> list(new QoreListNode(getValueTypeInfo()), nullptr);
     qore_list_private::get(**list)->reserve(member_list.size());
 
-    for (auto& i : member_list) {
+    for (HashMember* i : member_list) {
         list->push(i->val.refSelf(), nullptr);
     }
     return list.release();
 }
 
 void qore_hash_private::merge(const qore_hash_private& h, ExceptionSink* xsink) {
-    for (auto& i : h.member_list) {
-        setKeyValue(i->key, i->val.refSelf(), xsink);
+    for (HashMember* i : h.member_list) {
+        setKeyValue(i->key.c_str(), i->val.refSelf(), xsink);
     }
 }
 
@@ -94,15 +464,12 @@ int qore_hash_private::getLValue(const char* key, LValueHelper& lvh, bool for_re
     else if (complexTypeInfo)
         memTypeInfo = QoreTypeInfo::getUniqueReturnComplexHash(complexTypeInfo);
 
-    hm_hm_t::const_iterator i = hm.find(key);
-    HashMember* m;
-    if (i == hm.end()) {
+    HashMember* m = member_list.find(key);
+    if (!m) {
         if (for_remove)
             return -1;
         m = findCreateMember(key);
     }
-    else
-        m = (*(i->second));
 
     //printd(5, "qore_hash_private::getLValue() this: %p hd: %p ct: %p key: '%s' type: '%s'\n", this, hashdecl, complexTypeInfo, key, QoreTypeInfo::getName(memTypeInfo));
 
@@ -268,11 +635,11 @@ QoreValue qore_hash_private::getKeyValueExistence(const char* key, bool& exists,
 }
 
 QoreValue qore_hash_private::getKeyValueExistenceIntern(const char* key, bool& exists) const {
-    hm_hm_t::const_iterator i = hm.find(key);
+    HashMember* m = member_list.find(key);
 
-    if (i != hm.end()) {
+    if (m) {
         exists = true;
-        return (*i->second)->val;
+        return m->val;
     }
 
     exists = false;
@@ -280,8 +647,8 @@ QoreValue qore_hash_private::getKeyValueExistenceIntern(const char* key, bool& e
 }
 
 QoreValue qore_hash_private::getKeyValueIntern(const char* key) const {
-    hm_hm_t::const_iterator i = hm.find(key);
-    return i != hm.end() ? (*i->second)->val : QoreValue();
+    HashMember* m = member_list.find(key);
+    return m ? m->val : QoreValue();
 }
 
 QoreHashNode::QoreHashNode(bool ne) : AbstractQoreNode(NT_HASH, !ne, ne), priv(new qore_hash_private) {
@@ -291,7 +658,7 @@ QoreHashNode::QoreHashNode() : AbstractQoreNode(NT_HASH, true, false), priv(new
 }
 
 QoreHashNode::QoreHashNode(const TypedHashDecl* hd, ExceptionSink* xsink) : QoreHashNode() {
-    priv->hashdecl = hd;
+    priv->setHashDecl(hd);
     typed_hash_decl_private::get(*hd)->initHash(this, nullptr, xsink);
 }
 
@@ -470,11 +837,11 @@ bool QoreHashNode::compareSoft(const QoreHashNode* h, ExceptionSink* xsink) cons
 
     ConstHashIterator hi(this);
     while (hi.next()) {
-        hm_hm_t::const_iterator j = h->priv->hm.find(hi.getKey());
-        if (j == h->priv->hm.end())
+        HashMember* m = h->priv->findMember(hi.getKey());
+        if (!m)
             return 1;
 
-        if (!hi.get().isEqualSoft((*j->second)->val, xsink)) {
+        if (!hi.get().isEqualSoft(m->val, xsink)) {
             return 1;
         }
     }
@@ -489,11 +856,11 @@ bool QoreHashNode::compareHard(const QoreHashNode* h, ExceptionSink* xsink) cons
 
     ConstHashIterator hi(this);
     while (hi.next()) {
-        hm_hm_t::const_iterator j = h->priv->hm.find(hi.getKey());
-        if (j == h->priv->hm.end())
+        HashMember* m = h->priv->findMember(hi.getKey());
+        if (!m)
             return 1;
 
-        if (!hi.get().isEqualHard((*j->second)->val)) {
+        if (!hi.get().isEqualHard(m->val)) {
             return 1;
         }
     }
@@ -679,7 +1046,7 @@ QoreValue HashIterator::getReferenced() const {
 }
 
 QoreString* HashIterator::getKeyString() const {
-   return !priv->valid() ? nullptr : new QoreString((*(priv->i))->key);
+   return !priv->valid() ? nullptr : new QoreString((*(priv->i))->key.c_str(), (*(priv->i))->key.size());
 }
 
 bool HashIterator::next() {
@@ -726,9 +1093,6 @@ void HashIterator::deleteKey(ExceptionSink* xsink) {
     qhlist_t::iterator ni = priv->i;
     priv->prev(h->priv->member_list);
 
-    hm_hm_t::iterator i = h->priv->hm.find((*ni)->key.c_str());
-    assert(i != h->priv->hm.end());
-    h->priv->hm.erase(i);
     h->priv->internDeleteKey(ni);
 }
 
@@ -747,9 +1111,6 @@ QoreValue HashIterator::removeKeyValue() {
     qhlist_t::iterator ni = priv->i;
     priv->prev(h->priv->member_list);
 
-    hm_hm_t::iterator i = h->priv->hm.find((*ni)->key.c_str());
-    assert(i != h->priv->hm.end());
-    h->priv->hm.erase(i);
     h->priv->internDeleteKey(ni);
 
     return rv;
@@ -826,7 +1187,7 @@ QoreValue ConstHashIterator::getReferenced() const {
 }
 
 QoreString* ConstHashIterator::getKeyString() const {
-   return !priv->valid() ? nullptr : new QoreString((*(priv->i))->key);
+   return !priv->valid() ? nullptr : new QoreString((*(priv->i))->key.c_str(), (*(priv->i))->key.size());
 }
 
 bool ConstHashIterator::next() {
@@ -32,6 +32,7 @@
 #include "qore/intern/qore_program_private.h"
 #include "qore/intern/QoreClassIntern.h"
 #include "qore/intern/typed_hash_decl_private.h"
+#include "qore/intern/QoreHashNodeIntern.h"
 
 QoreString QoreHashObjectDereferenceOperatorNode::op_str(". or {} operator expression");
 
@@ -97,6 +98,11 @@ void QoreHashObjectDereferenceOperatorNode::parseInitImpl(QoreValue& val, LocalV
                         if (!only_hashdecl && QoreTypeInfo::hasType(returnTypeInfo)) {
                             returnTypeInfo = get_or_nothing_type_check(returnTypeInfo);
                         }
+                        // members of hashes with this hashdecl can be read directly from the shape slot at runtime
+                        if (right.get<const QoreStringNode>()->getEncoding() == QCS_DEFAULT
+                            && typed_hash_decl_private::get(*hd)->findMember(member)) {
+                            member_hd = hd;
+                        }
                     } else if (rt == NT_LIST) { // check object slices as well if strings are available
                         ConstListIterator li(right.get<const QoreListNode>());
                         while (li.next()) {
@@ -157,10 +163,39 @@ void QoreHashObjectDereferenceOperatorNode::parseInitImpl(QoreValue& val, LocalV
     typeInfo = returnTypeInfo;
 }
 
+bool QoreHashObjectDereferenceOperatorNode::getShapeMemberValue(const QoreHashNode& h, QoreValue& rv) const {
+    assert(member_hd);
+    const HashShape* shape = qore_hash_private::get(h)->member_list.getShape();
+    if (!shape || shape != typed_hash_decl_private::get(*member_hd)->getShape()) {
+        return false;
+    }
+
+    unsigned slot = member_slot.load(std::memory_order_relaxed);
+    if (slot == QORE_HASH_NO_SLOT) {
+        // the slot is the same for all hashes with the shape, so concurrent resolution is harmless
+        slot = shape->find(right.get<const QoreStringNode>()->c_str());
+        assert(slot != QORE_HASH_NO_SLOT);
+        member_slot.store(slot, std::memory_order_relaxed);
+    }
+
+    HashMember* m = qore_hash_private::get(h)->member_list.getShapeMember(slot);
+    rv = m ? m->val.refSelf() : QoreValue();
+    return true;
+}
+
 QoreValue QoreHashObjectDereferenceOperatorNode::evalImpl(bool& needs_deref, ExceptionSink* xsink) const {
     ValueEvalRefHolder lh(left, xsink);
     if (*xsink)
         return QoreValue();
+
+    // read hashdecl members directly from the shape slot without a key lookup
+    if (member_hd && lh->getType() == NT_HASH) {
+        QoreValue rv;
+        if (getShapeMemberValue(*lh->get<const QoreHashNode>(), rv)) {
+            return rv;
+        }
+    }
+
     ValueEvalRefHolder rh(right, xsink);
     if (*xsink)
         return QoreValue();
@@ -42,6 +42,7 @@ QoreImplicitArgumentNode::~QoreImplicitArgumentNode() {
 
 void QoreImplicitArgumentNode::parseInitImpl(QoreValue& val, LocalVar* oflag, int pflag, int& lvids, const QoreTypeInfo*& typeInfo) {
     typeInfo = parse_get_implicit_arg_type_info();
+    parse_ref_implicit_arg();
 }
 
 const QoreTypeInfo* QoreImplicitArgumentNode::getTypeInfo() const {
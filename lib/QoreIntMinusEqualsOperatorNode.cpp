@@ -35,8 +35,14 @@ QoreValue QoreIntMinusEqualsOperatorNode::evalImpl(bool &needs_deref, ExceptionS
     if (*xsink)
         return QoreValue();
 
+    // typed global variables are updated with an atomic operation if possible
+    int64 i = rh->getAsBigInt();
+    int64 old_val;
+    if (!LValueHelper::atomicAddBigInt(left, -i, old_val))
+        return old_val - i;
+
     LValueHelper v(left, xsink);
     if (*xsink)
         return QoreValue();
-    return v.minusEqualsBigInt(rh->getAsBigInt(), "<-= operator>");
+    return v.minusEqualsBigInt(i, "<-= operator>");
 }
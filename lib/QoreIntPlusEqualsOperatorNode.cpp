@@ -34,8 +34,14 @@ QoreValue QoreIntPlusEqualsOperatorNode::evalImpl(bool& needs_deref, ExceptionSi
     ValueEvalRefHolder rh(right, xsink);
     if (*xsink)
         return QoreValue();
+    // typed global variables are updated with an atomic operation if possible
+    int64 i = rh->getAsBigInt();
+    int64 old_val;
+    if (!LValueHelper::atomicAddBigInt(left, i, old_val))
+        return old_val + i;
+
     LValueHelper v(left, xsink);
     if (*xsink)
         return QoreValue();
-    return v.plusEqualsBigInt(rh->getAsBigInt(), "<+= operator>");
+    return v.plusEqualsBigInt(i, "<+= operator>");
 }
@@ -33,6 +33,11 @@
 QoreString QoreIntPostIncrementOperatorNode::op_str("++ (post-increment) operator expression");
 
 QoreValue QoreIntPostIncrementOperatorNode::evalImpl(bool& needs_deref, ExceptionSink* xsink) const {
+    // typed global variables are updated with an atomic operation if possible
+    int64 old_val;
+    if (!LValueHelper::atomicAddBigInt(exp, 1, old_val))
+        return QoreValue(old_val);
+
     LValueHelper n(exp, xsink);
     if (!n)
         return QoreValue();
@@ -33,6 +33,11 @@
 QoreString QoreIntPreIncrementOperatorNode::op_str("++ (pre-increment) operator expression");
 
 QoreValue QoreIntPreIncrementOperatorNode::evalImpl(bool& needs_deref, ExceptionSink* xsink) const {
+    // typed global variables are updated with an atomic operation if possible
+    int64 old_val;
+    if (!LValueHelper::atomicAddBigInt(exp, 1, old_val))
+        return QoreValue(old_val + 1);
+
     LValueHelper n(exp, xsink);
     if (!n)
         return QoreValue();
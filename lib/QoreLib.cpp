@@ -64,6 +64,12 @@
 #include <pwd.h>
 #endif
 
+// SSSE3 codec kernels are compiled for the target with function attributes and selected at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QORE_CODEC_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
 FeatureList qoreFeatureList;
 
 #define cpp_str(s) #s
@@ -151,6 +157,240 @@ char table64[64] = {
    '4', '5', '6', '7', '8', '9', '+', '/',
 };
 
+// lookup tables for the base64 and hex encoding and decoding kernels
+struct qore_codec_tables {
+    // maps base64 characters to their 6-bit values; all other bytes map to 0xff
+    unsigned char base64_value[256];
+    // maps hex digits to their 4-bit values; all other bytes map to 0xff
+    unsigned char hex_value[256];
+    // lower-case hex digit pairs for all byte values
+    char hex_pair[512];
+    // true if the SSSE3 kernels can be used on this CPU
+    bool ssse3 = false;
+
+    DLLLOCAL qore_codec_tables() {
+#ifdef QORE_CODEC_SSSE3
+        __builtin_cpu_init();
+        ssse3 = __builtin_cpu_supports("ssse3");
+#endif
+
+        static const char hex_digits[] = "0123456789abcdef";
+
+        memset(base64_value, 0xff, sizeof(base64_value));
+        for (unsigned i = 0; i < 64; ++i) {
+            base64_value[(unsigned char)table64[i]] = i;
+        }
+
+        memset(hex_value, 0xff, sizeof(hex_value));
+        for (unsigned i = 0; i < 16; ++i) {
+            hex_value[(unsigned char)hex_digits[i]] = i;
+            if (i > 9) {
+                hex_value[(unsigned char)(hex_digits[i] - 32)] = i;
+            }
+        }
+
+        for (unsigned i = 0; i < 256; ++i) {
+            hex_pair[i * 2] = hex_digits[i >> 4];
+            hex_pair[i * 2 + 1] = hex_digits[i & 15];
+        }
+    }
+};
+
+static qore_codec_tables codec_tables;
+
+#ifdef QORE_CODEC_SSSE3
+// encodes groups of 12 bytes to 16 characters while 16 bytes can be loaded; returns the number of bytes encoded
+__attribute__((target("ssse3")))
+static qore_size_t q_base64_encode_ssse3(char* dst, const unsigned char* src, qore_size_t len) {
+    // maps the 6-bit value ranges A-Z, a-z, 0-9, '+' and '/' to the offset added to get the character
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    qore_size_t i = 0;
+    for (; i + 16 <= len; i += 12) {
+        // put the three bytes of each group in the order needed to extract the 6-bit values in 32-bit lanes
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i)),
+            _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        __m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i idx = _mm_or_si128(hi, lo);
+
+        // get the index of the offset for each value's range
+        __m128i r = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+        _mm_storeu_si128((__m128i*)dst, _mm_add_epi8(_mm_shuffle_epi8(shift, r), idx));
+        dst += 16;
+    }
+    return i;
+}
+
+// hex-encodes blocks of 16 bytes; returns the number of bytes encoded
+__attribute__((target("ssse3")))
+static qore_size_t q_hex_encode_ssse3(char* dst, const unsigned char* src, qore_size_t len) {
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e',
+        'f');
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    qore_size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+        _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(dst + i * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+// decodes blocks of 16 hex digits; stops before the first block with any other character and returns the number of
+// characters decoded
+__attribute__((target("ssse3")))
+static qore_size_t q_hex_decode_ssse3(char* dst, const char* src, qore_size_t len) {
+    qore_size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+        // signed comparisons also reject all bytes >= 0x80
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+            _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i l = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)),
+            _mm_cmplt_epi8(l, _mm_set1_epi8('f' + 1)));
+        if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff) {
+            break;
+        }
+        __m128i v = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+            _mm_and_si128(alpha, _mm_sub_epi8(l, _mm_set1_epi8('a' - 10))));
+        // combine each pair of nibbles to a byte: high * 16 + low
+        v = _mm_maddubs_epi16(v, _mm_set1_epi16(0x0110));
+        _mm_storel_epi64((__m128i*)(dst + i / 2), _mm_packus_epi16(v, v));
+    }
+    return i;
+}
+#endif
+
+bool q_codec_simd() {
+    return codec_tables.ssse3;
+}
+
+qore_size_t q_base64_encode(char* dst, const unsigned char* src, qore_size_t len) {
+    char* p = dst;
+#ifdef QORE_CODEC_SSSE3
+    if (codec_tables.ssse3) {
+        qore_size_t done = q_base64_encode_ssse3(p, src, len);
+        p += (done / 3) * 4;
+        src += done;
+        len -= done;
+    }
+#endif
+    const unsigned char* end = src + (len - (len % 3));
+
+    // encode complete groups of three bytes to four characters
+    while (src < end) {
+        unsigned v = ((unsigned)src[0] << 16) | ((unsigned)src[1] << 8) | src[2];
+        p[0] = table64[v >> 18];
+        p[1] = table64[(v >> 12) & 63];
+        p[2] = table64[(v >> 6) & 63];
+        p[3] = table64[v & 63];
+        p += 4;
+        src += 3;
+    }
+
+    // encode the tail with padding
+    switch (len % 3) {
+        case 1:
+            p[0] = table64[src[0] >> 2];
+            p[1] = table64[(src[0] & 3) << 4];
+            p[2] = '=';
+            p[3] = '=';
+            p += 4;
+            break;
+        case 2:
+            p[0] = table64[src[0] >> 2];
+            p[1] = table64[((src[0] & 3) << 4) | (src[1] >> 4)];
+            p[2] = table64[(src[1] & 15) << 2];
+            p[3] = '=';
+            p += 4;
+            break;
+    }
+
+    return p - dst;
+}
+
+qore_size_t q_base64_decode_groups(char* dst, const char* src, qore_size_t len, qore_size_t& read) {
+    const unsigned char* p = (const unsigned char*)src;
+    const unsigned char* end = p + (len & ~(qore_size_t)3);
+    const unsigned char* t = codec_tables.base64_value;
+    char* d = dst;
+
+    while (p < end) {
+        unsigned a = t[p[0]], b = t[p[1]], c = t[p[2]], e = t[p[3]];
+        // any character outside the alphabet sets the high bit
+        if ((a | b | c | e) & 0x80) {
+            break;
+        }
+        unsigned v = (a << 18) | (b << 12) | (c << 6) | e;
+        d[0] = (char)(v >> 16);
+        d[1] = (char)(v >> 8);
+        d[2] = (char)v;
+        d += 3;
+        p += 4;
+    }
+
+    read = (const char*)p - src;
+    return d - dst;
+}
+
+int q_base64_value(char c) {
+    unsigned char v = codec_tables.base64_value[(unsigned char)c];
+    return v == 0xff ? -1 : v;
+}
+
+void q_hex_encode(char* dst, const unsigned char* src, qore_size_t len) {
+#ifdef QORE_CODEC_SSSE3
+    if (codec_tables.ssse3) {
+        qore_size_t done = q_hex_encode_ssse3(dst, src, len);
+        dst += done * 2;
+        src += done;
+        len -= done;
+    }
+#endif
+    const unsigned char* end = src + len;
+    while (src < end) {
+        memcpy(dst, codec_tables.hex_pair + (*src++ * 2), 2);
+        dst += 2;
+    }
+}
+
+qore_size_t q_hex_decode(char* dst, const char* src, qore_size_t len) {
+    assert(!(len % 2));
+    const unsigned char* p = (const unsigned char*)src;
+    const unsigned char* end = p + len;
+    const unsigned char* t = codec_tables.hex_value;
+    char* d = dst;
+
+#ifdef QORE_CODEC_SSSE3
+    if (codec_tables.ssse3) {
+        qore_size_t done = q_hex_decode_ssse3(d, src, len);
+        p += done;
+        d += done / 2;
+    }
+#endif
+
+    while (p < end) {
+        unsigned h = t[p[0]], l = t[p[1]];
+        if ((h | l) & 0x80) {
+            break;
+        }
+        *d++ = (char)((h << 4) | l);
+        p += 2;
+    }
+
+    return d - dst;
+}
+
+int q_hex_value(char c) {
+    unsigned char v = codec_tables.hex_value[(unsigned char)c];
+    return v == 0xff ? -1 : v;
+}
+
 template<>
 DLLLOCAL vector_set_t<const char*>::iterator vector_set_t<const char*>::find(const char* const& v) {
     return std::find_if(vector.begin(), vector.end(), string_compare(v));
@@ -1005,9 +1245,11 @@ BinaryNode* parseBase64(const char* buf, int len, ExceptionSink* xsink) {
     }
 
     char* binbuf = (char*)malloc(sizeof(char) * (len + 3));
-    int blen = 0;
 
-    qore_size_t pos = 0;
+    // decode all clean groups with the fast kernel; line breaks, padding and errors are handled below
+    qore_size_t pos;
+    int blen = q_base64_decode_groups(binbuf, buf, len, pos);
+
     while (pos < (qore_size_t)len) {
         // add first 6 bits
         char b = getBase64Value(buf, pos, true, xsink);
@@ -1095,9 +1337,11 @@ BinaryNode* parseHex(const char* buf, int len, ExceptionSink* xsink) {
     }
 
     char* binbuf = (char* )malloc(sizeof(char) * (len / 2));
-    int blen = 0;
+    int blen = q_hex_decode(binbuf, buf, len);
+    buf += blen * 2;
 
-    const char* end = buf + len;
+    // the kernel stops at the first invalid digit; raise the error here
+    const char* end = buf + (len - blen * 2);
     while (buf < end) {
         int b = get_nibble(*buf, xsink);
         if (b < 0) {
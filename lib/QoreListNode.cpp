@@ -45,9 +45,6 @@
 #  include "tests/List_tests.cpp"
 #endif
 
-#define LIST_BLOCK 20
-#define LIST_PAD   15
-
 static QoreListNode* do_args(const QoreValue& e1, const QoreValue& e2) {
     QoreListNode* l = new QoreListNode(autoTypeInfo);
     qore_list_private* ll = qore_list_private::get(*l);
@@ -90,6 +87,33 @@ void QoreListNodeEvalOptionalRefHolder::evalIntern(QoreListNode* exp) {
     assert(exp->size() == val->size());
 }
 
+void QoreListNodeEvalOptionalRefHolder::releaseArgs() {
+    thread_release_arg_list(val, xsink);
+}
+
+void QoreListNodeEvalOptionalRefHolder::assignEvalArgs(const QoreListNode* exp) {
+    discardIntern();
+
+    // lists that need no evaluation are used directly; only argument lists of type list<auto> are evaluated into
+    // recycled lists, as no type conversions are performed when values are added to them
+    if (!exp || exp->is_value() || qore_list_private::get(*exp)->complexTypeInfo != autoListTypeInfo) {
+        evalIntern(exp);
+        return;
+    }
+
+    const qore_list_private* el = qore_list_private::get(*exp);
+    val = thread_get_arg_list(el->length);
+    needs_deref = true;
+    recycle = true;
+    for (size_t i = 0; i < el->length; ++i) {
+        ValueEvalRefHolder v(el->entry[i], xsink);
+        if (*xsink) {
+            return;
+        }
+        qore_list_private::get(*val)->pushIntern(v.takeReferencedValue());
+    }
+}
+
 int qore_list_private::getLValue(size_t ind, LValueHelper& lvh, bool for_remove, ExceptionSink* xsink) {
     if (ind >= length) {
         resize(ind + 1);
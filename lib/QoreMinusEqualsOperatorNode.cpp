@@ -69,6 +69,14 @@ QoreValue QoreMinusEqualsOperatorNode::evalImpl(bool &needs_deref, ExceptionSink
     if (*xsink)
         return QoreValue();
 
+    // typed float global variables are updated with an atomic operation if possible
+    if (QoreTypeInfo::isType(ti, NT_FLOAT)) {
+        double f = new_right->getAsFloat();
+        double old_val;
+        if (!LValueHelper::atomicAddFloat(left, -f, old_val))
+            return ref_rv ? QoreValue(old_val - f) : QoreValue();
+    }
+
     // get ptr to current value (lvalue is locked for the scope of the LValueHelper object)
     LValueHelper v(left, xsink);
     if (!v)
@@ -45,6 +45,7 @@
 
 // include files for default object classes
 #include "qore/intern/QC_Socket.h"
+#include "qore/intern/QC_SocketPoller.h"
 #include "qore/intern/QC_SSLCertificate.h"
 #include "qore/intern/QC_SSLPrivateKey.h"
 #include "qore/intern/QC_ProgramControl.h"
@@ -65,6 +66,7 @@
 #include "qore/intern/QC_Datasource.h"
 #include "qore/intern/QC_DatasourcePool.h"
 #include "qore/intern/QC_SQLStatement.h"
+#include "qore/intern/QC_SQLResultBlock.h"
 
 // functions
 #include "qore/intern/ql_time.h"
@@ -133,6 +135,7 @@ DLLLOCAL QoreClass* initInputStreamClass(QoreNamespace& ns);
 DLLLOCAL QoreClass* initBinaryInputStreamClass(QoreNamespace& ns);
 DLLLOCAL QoreClass* initStringInputStreamClass(QoreNamespace& ns);
 DLLLOCAL QoreClass* initFileInputStreamClass(QoreNamespace& ns);
+DLLLOCAL QoreClass* initMmapInputStreamClass(QoreNamespace& ns);
 DLLLOCAL QoreClass* initEncodingConversionInputStreamClass(QoreNamespace& ns);
 DLLLOCAL QoreClass* initEncodingConversionOutputStreamClass(QoreNamespace& ns);
 DLLLOCAL QoreClass* initOutputStreamClass(QoreNamespace& ns);
@@ -190,7 +193,8 @@ const TypedHashDecl* hashdeclStatInfo,
     * hashdeclHashSerializationInfo,
     * hashdeclListSerializationInfo,
     * hashdeclUrlInfo,
-    * hashdeclFtpResponseInfo;
+    * hashdeclFtpResponseInfo,
+    * hashdeclSocketPollerEvent;
 
 DLLLOCAL void init_context_functions(QoreNamespace& ns);
 DLLLOCAL void init_RangeIterator_functions(QoreNamespace& ns);
@@ -1047,6 +1051,7 @@ StaticSystemNamespace::StaticSystemNamespace() : RootQoreNamespace(new qore_root
     qns.addSystemClass(initBinaryInputStreamClass(qns));
     qns.addSystemClass(initStringInputStreamClass(qns));
     qns.addSystemClass(initFileInputStreamClass(qns));
+    qns.addSystemClass(initMmapInputStreamClass(qns));
     qns.addSystemClass(initEncodingConversionInputStreamClass(qns));
     qns.addSystemClass(initEncodingConversionOutputStreamClass(qns));
     qns.addSystemClass(initBinaryOutputStreamClass(qns));
@@ -1066,6 +1071,8 @@ StaticSystemNamespace::StaticSystemNamespace() : RootQoreNamespace(new qore_root
     qns.addSystemClass(initSSLCertificateClass(qns));
     qns.addSystemClass(initSSLPrivateKeyClass(qns));
     qns.addSystemClass(initSocketClass(qns));
+    hashdeclSocketPollerEvent = init_hashdecl_SocketPollerEvent(qns);
+    qns.addSystemClass(initSocketPollerClass(qns));
     preinitProgramClass();  // to resolve circular dependency Program/Expression class
     qns.addSystemClass(initExpressionClass(qns));
     preinitBreakpointClass();  // to resolve circular dependency Program/Breakpoint class
@@ -1152,6 +1159,7 @@ StaticSystemNamespace::StaticSystemNamespace() : RootQoreNamespace(new qore_root
     sqlns->addSystemClass(initAbstractDatasourceClass(*sqlns));
     sqlns->addSystemClass(initDatasourceClass(*sqlns));
     sqlns->addSystemClass(initDatasourcePoolClass(*sqlns));
+    sqlns->addSystemClass(initSQLResultBlockClass(*sqlns));
     sqlns->addSystemClass(initSQLStatementClass(*sqlns));
 
     init_dbi_functions(*sqlns);
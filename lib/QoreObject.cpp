@@ -705,6 +705,52 @@ QoreValue qore_object_private::getReferencedMemberNoMethod(const char* mem, Exce
     return rv;
 }
 
+QoreValue qore_object_private::getReferencedMemberSlot(const HashShape* shape, unsigned slot, const char* mem, ExceptionSink* xsink) const {
+    QoreSafeVarRWReadLocker sl(rml);
+
+    if (status == OS_DELETED) {
+        makeAccessDeletedObjectException(xsink, mem, theclass->getName());
+        return QoreValue();
+    }
+
+    const qore_hash_private* h = qore_hash_private::get(*data);
+    // the data hash only lacks the class shape if it was created before the class was committed
+    if (h->member_list.getShape() != shape) {
+        return h->getReferencedKeyValueIntern(mem);
+    }
+    HashMember* m = h->member_list.getShapeMember(slot);
+    return m ? m->val.refSelf() : QoreValue();
+}
+
+int qore_object_private::getLValueSlot(const HashShape* shape, unsigned slot, const char* key, const QoreTypeInfo* mti, LValueHelper& lvh, bool for_remove, ExceptionSink* xsink) {
+    // do lock handoff
+    qore_object_lock_handoff_helper qolhh(const_cast<qore_object_private*>(this), lvh.vl);
+
+    if (status == OS_DELETED) {
+        xsink->raiseException("OBJECT-ALREADY-DELETED", "write attempted to member \"%s\" in an already-deleted object", key);
+        return -1;
+    }
+
+    qolhh.stayLocked();
+
+    qore_hash_private* h = qore_hash_private::get(*data);
+    HashMember* m;
+    if (h->member_list.getShape() != shape) {
+        m = for_remove ? h->findMember(key) : h->findCreateMember(key);
+    } else {
+        m = for_remove ? h->member_list.getShapeMember(slot) : h->member_list.findCreateShapeMember(slot);
+    }
+    if (!m) {
+        assert(for_remove);
+        return -1;
+    }
+
+    lvh.setValue(m->val, mti);
+    lvh.setObjectContext(this);
+
+    return 0;
+}
+
 void qore_object_private::setValue(const char* key, QoreValue val, ExceptionSink* xsink) {
     // get the current class context
     const qore_class_private* class_ctx = runtime_get_class();
@@ -972,11 +1018,20 @@ void QoreObject::externalDelete(qore_classid_t key, ExceptionSink* xsink) {
 }
 
 // issue #2791: make sure that the internal data hash has type hash<auto> so that types can be stripped if necessary
-QoreObject::QoreObject(const QoreClass* oc, QoreProgram* p) : AbstractQoreNode(NT_OBJECT, false, false, false, true), priv(new qore_object_private(this, oc, p, new QoreHashNode(autoTypeInfo))) {
+// declared members share the key layout of the class
+static QoreHashNode* new_object_data(const QoreClass* oc) {
+    QoreHashNode* h = new QoreHashNode(autoTypeInfo);
+    const HashShape* shape = qore_class_private::get(*oc)->getShape();
+    if (shape) {
+        qore_hash_private::get(*h)->member_list.setShape(shape);
+    }
+    return h;
 }
 
-// issue #2791: make sure that the internal data hash has type hash<auto> so that types can be stripped if necessary
-QoreObject::QoreObject(const QoreClass* oc, QoreProgram* p, AbstractPrivateData* data) : AbstractQoreNode(NT_OBJECT, false, false, false, true), priv(new qore_object_private(this, oc, p, new QoreHashNode(autoTypeInfo))) {
+QoreObject::QoreObject(const QoreClass* oc, QoreProgram* p) : AbstractQoreNode(NT_OBJECT, false, false, false, true), priv(new qore_object_private(this, oc, p, new_object_data(oc))) {
+}
+
+QoreObject::QoreObject(const QoreClass* oc, QoreProgram* p, AbstractPrivateData* data) : AbstractQoreNode(NT_OBJECT, false, false, false, true), priv(new qore_object_private(this, oc, p, new_object_data(oc))) {
     assert(data);
     priv->setPrivate(oc->getID(), data);
 }
@@ -0,0 +1,215 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreParallelPool.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/QoreParallelPool.h"
+#include "qore/intern/qore_program_private.h"
+
+#include <algorithm>
+#include <thread>
+
+// the maximum number of pool threads
+#define QPP_MAX_THREADS 256
+
+QoreParallelPool qore_parallel_pool;
+
+struct QoreParallelPool::ParallelJobState {
+    AbstractParallelJob& job;
+    // the Program where the job was submitted
+    QoreProgram* pgm;
+    size_t chunks;
+    // the next chunk to execute
+    std::atomic<size_t> next;
+    // set when an exception is raised; no further chunks are started
+    std::atomic<bool> error;
+    // the number of pool threads executing chunks of this job; protected by the pool lock
+    int workers = 0;
+    // the first exception raised
+    QoreThreadLock err_lck;
+    ExceptionSink err;
+
+    DLLLOCAL ParallelJobState(AbstractParallelJob& job, QoreProgram* pgm, size_t chunks) : job(job), pgm(pgm),
+            chunks(chunks), next(0), error(false) {
+    }
+
+    DLLLOCAL void setError(ExceptionSink& xs) {
+        AutoLocker al(err_lck);
+        if (error.load(std::memory_order_relaxed)) {
+            xs.clear();
+            return;
+        }
+        err.assimilate(xs);
+        error.store(true, std::memory_order_release);
+    }
+};
+
+void QoreParallelPool::startWorker(ExceptionSink* xsink, void* arg) {
+    static_cast<QoreParallelPool*>(arg)->worker(xsink);
+}
+
+void QoreParallelPool::initUnlocked() {
+    if (max_threads >= 0) {
+        return;
+    }
+    // the thread submitting a job also executes chunks
+    int n = (int)std::thread::hardware_concurrency();
+    max_threads = n > 1 ? n - 1 : 0;
+    if (max_threads > QPP_MAX_THREADS) {
+        max_threads = QPP_MAX_THREADS;
+    }
+}
+
+unsigned QoreParallelPool::getConcurrency() {
+    AutoLocker al(m);
+    initUnlocked();
+    return max_threads + 1;
+}
+
+void QoreParallelPool::runChunks(ParallelJobState& js) {
+    while (!js.error.load(std::memory_order_acquire)) {
+        size_t i = js.next.fetch_add(1, std::memory_order_relaxed);
+        if (i >= js.chunks) {
+            break;
+        }
+        ExceptionSink xs;
+        js.job.runChunk(i, &xs);
+        if (xs) {
+            js.setError(xs);
+        }
+    }
+}
+
+int QoreParallelPool::run(AbstractParallelJob& job, size_t chunks, ExceptionSink* xsink) {
+    ParallelJobState js(job, getProgram(), chunks);
+
+    bool queued = false;
+    if (chunks > 1) {
+        AutoLocker al(m);
+        initUnlocked();
+        if (max_threads && !stopflag) {
+            jobs.push_back(&js);
+            queued = true;
+
+            // start new threads if there are not enough idle threads for the job
+            int want = chunks - 1 < (size_t)max_threads ? (int)chunks - 1 : max_threads;
+            while (idle < want && threads < max_threads) {
+                ExceptionSink xs;
+                if (q_start_internal_thread(&xs, startWorker, this, tcount) < 0) {
+                    // the job will be executed by the threads that are already running
+                    xs.clear();
+                    break;
+                }
+                ++threads;
+                --want;
+            }
+            if (idle) {
+                cond.broadcast();
+            }
+        }
+    }
+
+    runChunks(js);
+
+    if (queued) {
+        AutoLocker al(m);
+        std::deque<ParallelJobState*>::iterator i = std::find(jobs.begin(), jobs.end(), &js);
+        if (i != jobs.end()) {
+            jobs.erase(i);
+        }
+        // wait for pool threads to finish any chunks in progress
+        while (js.workers) {
+            done_cond.wait(m);
+        }
+    }
+
+    if (js.error.load(std::memory_order_acquire)) {
+        xsink->assimilate(js.err);
+        return -1;
+    }
+    return 0;
+}
+
+void QoreParallelPool::worker(ExceptionSink* xsink) {
+    SafeLocker sl(m);
+
+    while (!stopflag) {
+        if (jobs.empty()) {
+            ++idle;
+            cond.wait(m);
+            --idle;
+            continue;
+        }
+
+        ParallelJobState* js = jobs.front();
+        if (js->error.load(std::memory_order_acquire) || js->next.load(std::memory_order_relaxed) >= js->chunks) {
+            // all chunks have been started
+            jobs.pop_front();
+            continue;
+        }
+
+        ++js->workers;
+        sl.unlock();
+
+        {
+            ExceptionSink xs;
+            // execute the chunks in the context of the Program where the job was submitted
+            qore_program_private::startThread(*js->pgm, xs);
+            {
+                ProgramThreadCountContextHelper tch(&xs, js->pgm, true);
+                if (!xs) {
+                    runChunks(*js);
+                }
+            }
+
+            // delete thread-local storage and release any thread resources acquired while executing the chunks
+            end_signal_thread(&xs);
+            purge_thread_resources(&xs);
+
+            if (xs) {
+                js->setError(xs);
+            }
+        }
+
+        sl.lock();
+        if (!--js->workers) {
+            done_cond.broadcast();
+        }
+    }
+}
+
+void QoreParallelPool::del() {
+    {
+        AutoLocker al(m);
+        stopflag = true;
+        cond.broadcast();
+    }
+    tcount.waitForZero();
+}
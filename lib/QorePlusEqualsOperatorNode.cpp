@@ -85,6 +85,14 @@ QoreValue QorePlusEqualsOperatorNode::evalImpl(bool& needs_deref, ExceptionSink*
     // is the same value, so it can be copied in the LValueHelper constructor
     new_right.ensureReferencedValue();
 
+    // typed float global variables are updated with an atomic operation if possible
+    if (QoreTypeInfo::isType(ti, NT_FLOAT)) {
+        double f = new_right->getAsFloat();
+        double old_val;
+        if (!LValueHelper::atomicAddFloat(left, f, old_val))
+            return ref_rv ? QoreValue(old_val + f) : QoreValue();
+    }
+
     // get ptr to current value (lvalue is locked for the scope of the LValueHelper object)
     LValueHelper v(left, xsink);
     if (!v)
@@ -36,6 +36,17 @@
 #include <cerrno>
 #include <sys/time.h>
 
+// number of attempts made by lock-free queue operations before blocking
+#define QUEUE_LOCKFREE_SPIN 100
+
+static inline void qore_cpu_relax() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
 void Queue::deref(ExceptionSink* xsink) {
     if (ROdereference()) {
         priv->destructor(xsink);
@@ -46,15 +57,19 @@ void Queue::deref(ExceptionSink* xsink) {
 void qore_queue_private::destructor(ExceptionSink* xsink) {
     AutoLocker al(&l);
     if (read_waiting) {
-        xsink->raiseException("QUEUE-ERROR", "Queue deleted while there %s %d waiting thread%s for reading", read_waiting == 1 ? "is" : "are", read_waiting, read_waiting == 1 ? "" : "s");
+        xsink->raiseException("QUEUE-ERROR", "Queue deleted while there %s %d waiting thread%s for reading", read_waiting == 1 ? "is" : "are", read_waiting.load(), read_waiting == 1 ? "" : "s");
         read_cond.broadcast();
     }
     if (write_waiting) {
-        xsink->raiseException("QUEUE-ERROR", "Queue deleted while there %s %d waiting thread%s for writing", write_waiting == 1 ? "is" : "are", write_waiting, write_waiting == 1 ? "" : "s");
+        xsink->raiseException("QUEUE-ERROR", "Queue deleted while there %s %d waiting thread%s for writing", write_waiting == 1 ? "is" : "are", write_waiting.load(), write_waiting == 1 ? "" : "s");
         write_cond.broadcast();
     }
 
     clearIntern(xsink);
+    if (ring) {
+        clearRingIntern(xsink);
+        ring_closed.store(true, std::memory_order_release);
+    }
     len = Queue_Deleted;
     if (desc) {
         desc->deref();
@@ -74,6 +89,200 @@ void qore_queue_private::clearIntern(ExceptionSink* xsink) {
     scan_count = 0;
 }
 
+void qore_queue_private::clearRingIntern(ExceptionSink* xsink) {
+    QoreValue v;
+    while (ring->shift(v)) {
+        v.discard(xsink);
+    }
+}
+
+void qore_queue_private::quiesceRingIntern() const {
+    ring_scan.store(true, std::memory_order_seq_cst);
+    while (ring_ops.load(std::memory_order_seq_cst)) {
+        qore_cpu_relax();
+    }
+}
+
+void qore_queue_private::initScan(QoreObject* self) {
+    if (ring) {
+        qore_object_private::get(*self)->incScanPrivateData();
+    }
+}
+
+void qore_queue_private::pushLockFree(ExceptionSink* xsink, QoreValue n, int timeout_ms, bool& to) {
+    ValueHolder holder(n, xsink);
+    if (checkLockFree(xsink)) {
+        return;
+    }
+
+    for (int i = 0; i < QUEUE_LOCKFREE_SPIN; ++i) {
+        if (ringPush(*holder)) {
+            holder.release();
+            signalLockFree(read_waiting, read_cond);
+            return;
+        }
+        if (timeout_ms < 0) {
+            break;
+        }
+        qore_cpu_relax();
+    }
+
+    // the queue is full: block until a slot is free
+    int64 end = timeout_ms > 0 ? q_clock_getmillis() + timeout_ms : 0;
+    AutoLocker al(&l);
+    ++write_waiting;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool pushed = false;
+    while (true) {
+        if (ring->push(*holder)) {
+            holder.release();
+            pushed = true;
+            break;
+        }
+        if (checkWriteIntern(xsink, true)) {
+            break;
+        }
+        int rc;
+        if (timeout_ms < 0) {
+            rc = ETIMEDOUT;
+        } else if (timeout_ms) {
+            int64 remaining = end - q_clock_getmillis();
+            rc = remaining > 0 ? write_cond.wait(l, remaining) : ETIMEDOUT;
+        } else {
+            rc = write_cond.wait(l);
+        }
+        if (rc) {
+            assert(rc == ETIMEDOUT);
+            to = true;
+            break;
+        }
+    }
+    --write_waiting;
+    if (pushed && read_waiting) {
+        read_cond.signal();
+    }
+}
+
+QoreValue qore_queue_private::shiftLockFree(ExceptionSink* xsink, int timeout_ms, bool& to) {
+    if (checkLockFree(xsink)) {
+        return QoreValue();
+    }
+
+    QoreValue rv;
+    for (int i = 0; i < QUEUE_LOCKFREE_SPIN; ++i) {
+        if (ringShift(rv)) {
+            signalLockFree(write_waiting, write_cond);
+            return rv;
+        }
+        if (timeout_ms < 0) {
+            break;
+        }
+        qore_cpu_relax();
+    }
+
+    // the queue is empty: block until data is available
+    int64 end = timeout_ms > 0 ? q_clock_getmillis() + timeout_ms : 0;
+    AutoLocker al(&l);
+    ++read_waiting;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool got = false;
+    while (true) {
+        if (ring->shift(rv)) {
+            got = true;
+            break;
+        }
+        if (checkWriteIntern(xsink, true)) {
+            break;
+        }
+        int rc;
+        if (timeout_ms < 0) {
+            rc = ETIMEDOUT;
+        } else if (timeout_ms) {
+            int64 remaining = end - q_clock_getmillis();
+            rc = remaining > 0 ? read_cond.wait(l, remaining) : ETIMEDOUT;
+        } else {
+            rc = read_cond.wait(l);
+        }
+        if (rc) {
+            assert(rc == ETIMEDOUT);
+            to = true;
+            break;
+        }
+    }
+    --read_waiting;
+    if (got && write_waiting) {
+        write_cond.signal();
+    }
+    return rv;
+}
+
+void qore_queue_private::pushAllLockFree(ExceptionSink* xsink, const QoreListNode* vl, int timeout_ms, bool& to) {
+    if (checkLockFree(xsink)) {
+        return;
+    }
+
+    // number of values pushed since readers were last woken up
+    size_t pushed = 0;
+    for (size_t i = 0, size = vl->size(); i < size; ++i) {
+        // the value must be referenced before it's visible to readers
+        QoreValue v = vl->retrieveEntry(i).refSelf();
+        if (ringPush(v)) {
+            ++pushed;
+            continue;
+        }
+
+        // the ring is full: wake up readers for the values pushed so far and block until a slot is free
+        if (pushed) {
+            signalLockFree(read_waiting, read_cond, pushed > 1);
+            pushed = 0;
+        }
+        pushLockFree(xsink, v, timeout_ms, to);
+        if (to || *xsink) {
+            return;
+        }
+    }
+
+    if (pushed) {
+        signalLockFree(read_waiting, read_cond, pushed > 1);
+    }
+}
+
+size_t qore_queue_private::takeRingBatch(QoreListNode& rv, int max_elements) {
+    size_t n = 0;
+    QoreValue v;
+    while ((max_elements <= 0 || n < (size_t)max_elements) && ringShift(v)) {
+        rv.push(v, nullptr);
+        ++n;
+    }
+    return n;
+}
+
+QoreListNode* qore_queue_private::getBatchLockFree(ExceptionSink* xsink, int max_elements, int timeout_ms, bool& to) {
+    if (checkLockFree(xsink)) {
+        return nullptr;
+    }
+
+    ReferenceHolder<QoreListNode> rv(new QoreListNode(autoTypeInfo), xsink);
+    size_t n = takeRingBatch(**rv, max_elements);
+    if (!n) {
+        // the queue is empty; block for the first value
+        QoreValue v = shiftLockFree(xsink, timeout_ms, to);
+        if (to || *xsink) {
+            return nullptr;
+        }
+        rv->push(v, nullptr);
+        if (max_elements == 1) {
+            return rv.release();
+        }
+        n = takeRingBatch(**rv, max_elements > 0 ? max_elements - 1 : max_elements);
+    }
+
+    if (n) {
+        signalLockFree(write_waiting, write_cond, n > 1);
+    }
+    return rv.release();
+}
+
 int qore_queue_private::waitReadIntern(ExceptionSink *xsink, int timeout_ms) {
     // if there is no data, then wait for condition variable
     while (!head) {
@@ -220,6 +429,10 @@ void qore_queue_private::pushAndTakeRef(QoreValue n) {
 
 void qore_queue_private::push(ExceptionSink* xsink, QoreObject* self, QoreValue n, int timeout_ms, bool& to) {
     to = false;
+    if (ring) {
+        pushLockFree(xsink, n, timeout_ms, to);
+        return;
+    }
     ValueHolder holder(n, xsink);
 
     bool inc_obj = false;
@@ -257,6 +470,10 @@ void qore_queue_private::push(ExceptionSink* xsink, QoreObject* self, QoreValue
 void qore_queue_private::insert(ExceptionSink* xsink, QoreObject* self, QoreValue n, int timeout_ms, bool& to) {
     to = false;
     ValueHolder holder(n, xsink);
+    if (ring) {
+        xsink->raiseException("QUEUE-ERROR", "cannot insert values at the beginning of a lock-free Queue");
+        return;
+    }
 
     bool inc_obj = false;
     {
@@ -292,6 +509,9 @@ void qore_queue_private::insert(ExceptionSink* xsink, QoreObject* self, QoreValu
 
 QoreValue qore_queue_private::shift(ExceptionSink* xsink, QoreObject* self, int timeout_ms, bool& to) {
     to = false;
+    if (ring) {
+        return shiftLockFree(xsink, timeout_ms, to);
+    }
     bool dec_obj = false;
     QoreValue rv;
     {
@@ -351,6 +571,10 @@ QoreValue qore_queue_private::shift(ExceptionSink* xsink, QoreObject* self, int
 
 QoreValue qore_queue_private::pop(ExceptionSink* xsink, QoreObject* self, int timeout_ms, bool& to) {
     to = false;
+    if (ring) {
+        xsink->raiseException("QUEUE-ERROR", "cannot remove values from the end of a lock-free Queue");
+        return QoreValue();
+    }
     bool dec_obj = false;
     QoreValue rv;
     {
@@ -402,6 +626,175 @@ QoreValue qore_queue_private::pop(ExceptionSink* xsink, QoreObject* self, int ti
     return rv;
 }
 
+void qore_queue_private::pushAll(ExceptionSink* xsink, QoreObject* self, const QoreListNode* vl, int timeout_ms,
+        bool& to) {
+    to = false;
+    if (!vl || vl->empty()) {
+        return;
+    }
+    if (ring) {
+        pushAllLockFree(xsink, vl, timeout_ms, to);
+        return;
+    }
+
+    bool inc_obj = false;
+    {
+        AutoLocker al(&l);
+        if (checkWriteIntern(xsink)) {
+            return;
+        }
+
+        int scan = 0;
+        size_t i = 0, size = vl->size();
+        while (i < size) {
+            {
+                int rc = waitWriteIntern(xsink, timeout_ms);
+                if (rc == QW_TIMEOUT) {
+                    to = true;
+                }
+                if (rc) {
+                    break;
+                }
+            }
+
+            // push as many values as the queue can hold
+            size_t start = i;
+            while (i < size && (max < 0 || len < max)) {
+                QoreValue v = vl->retrieveEntry(i++);
+                pushNode(v.refSelf());
+                if (self && needs_scan(v)) {
+                    ++scan;
+                }
+            }
+
+            // wake up waiting readers once for each set of values pushed
+            if (read_waiting) {
+                if ((i - start) > 1) {
+                    read_cond.broadcast();
+                } else {
+                    read_cond.signal();
+                }
+            }
+        }
+
+        if (scan) {
+            if (!scan_count) {
+                inc_obj = true;
+            }
+            scan_count += scan;
+        }
+    }
+
+    if (inc_obj) {
+        qore_object_private::get(*self)->incScanPrivateData();
+    }
+}
+
+QoreListNode* qore_queue_private::takeBatchIntern(SafeLocker& sl, QoreObject* self, int max_elements) {
+    assert(head);
+
+    // detach the nodes from the list in the lock
+    QoreQueueNode* first = head;
+    int n;
+    if (max_elements <= 0 || max_elements >= len) {
+        n = len;
+        head = tail = nullptr;
+    } else {
+        n = max_elements;
+        QoreQueueNode* last = head;
+        for (int i = 1; i < n; ++i) {
+            last = last->next;
+        }
+        head = last->next;
+        head->prev = nullptr;
+        last->next = nullptr;
+    }
+    len -= n;
+
+    bool dec_obj = false;
+    if (self && scan_count) {
+        for (QoreQueueNode* w = first; w; w = w->next) {
+            if (needs_scan(w->node)) {
+                --scan_count;
+            }
+        }
+        if (!scan_count) {
+            dec_obj = true;
+        }
+    }
+
+    if (write_waiting) {
+        if (n > 1) {
+            write_cond.broadcast();
+        } else {
+            write_cond.signal();
+        }
+    }
+
+    sl.unlock();
+
+    QoreListNode* rv = new QoreListNode(autoTypeInfo);
+    while (first) {
+        QoreQueueNode* next = first->next;
+        rv->push(first->takeAndDel(), nullptr);
+        first = next;
+    }
+
+    if (dec_obj) {
+        qore_object_private::get(*self)->decScanPrivateData();
+    }
+
+    return rv;
+}
+
+QoreListNode* qore_queue_private::getBatch(ExceptionSink* xsink, QoreObject* self, int max_elements, int timeout_ms,
+        bool& to) {
+    to = false;
+    if (ring) {
+        return getBatchLockFree(xsink, max_elements, timeout_ms, to);
+    }
+
+    SafeLocker sl(&l);
+    if (checkWriteIntern(xsink, true)) {
+        return nullptr;
+    }
+
+    {
+        int rc = waitReadIntern(xsink, timeout_ms);
+        if (rc == QW_TIMEOUT) {
+            to = true;
+        }
+        if (rc) {
+            return nullptr;
+        }
+    }
+
+    return takeBatchIntern(sl, self, max_elements);
+}
+
+QoreListNode* qore_queue_private::drain(ExceptionSink* xsink, QoreObject* self) {
+    if (ring) {
+        if (checkLockFree(xsink)) {
+            return nullptr;
+        }
+        ReferenceHolder<QoreListNode> rv(new QoreListNode(autoTypeInfo), xsink);
+        if (takeRingBatch(**rv, -1)) {
+            signalLockFree(write_waiting, write_cond, true);
+        }
+        return rv.release();
+    }
+
+    SafeLocker sl(&l);
+    if (checkWriteIntern(xsink, true)) {
+        return nullptr;
+    }
+    if (!head) {
+        return new QoreListNode(autoTypeInfo);
+    }
+
+    return takeBatchIntern(sl, self, -1);
+}
+
 void qore_queue_private::clear(ExceptionSink* xsink, QoreObject* self) {
     bool dec_obj = false;
     {
@@ -417,6 +810,14 @@ void qore_queue_private::clear(ExceptionSink* xsink, QoreObject* self) {
             return;
         }
 
+        if (ring) {
+            clearRingIntern(xsink);
+            if (write_waiting) {
+                write_cond.broadcast();
+            }
+            return;
+        }
+
         if (scan_count) {
             dec_obj = true;
         }
@@ -454,6 +855,10 @@ void qore_queue_private::setError(const char* n_err, const QoreStringNode* n_des
 
         // clear the queue
         clearIntern(xsink);
+        if (ring) {
+            ring_closed.store(true, std::memory_order_release);
+            clearRingIntern(xsink);
+        }
         len = 0;
 
         if (read_waiting) {
@@ -480,6 +885,9 @@ void qore_queue_private::clearError() {
         desc->deref();
         desc = nullptr;
     }
+    if (ring) {
+        ring_closed.store(false, std::memory_order_release);
+    }
 }
 
 bool qore_queue_private::scanMembers(RObject& obj, RSetHelper& rsh) {
@@ -490,6 +898,20 @@ bool qore_queue_private::scanMembers(RObject& obj, RSetHelper& rsh) {
     }
     AutoLocker al(l, true);
 
+    if (ring) {
+        // values in lock-free queues can only be accessed while no other thread can remove them
+        bool rc = false;
+        quiesceRingIntern();
+        ring->forEach([&] (QoreValue v) -> bool {
+            if (v.hasNode() && obj.scanCheck(rsh, v.getInternalNode())) {
+                rc = true;
+            }
+            return rc;
+        });
+        resumeRingIntern();
+        return rc;
+    }
+
     QoreQueueNode* w = head;
     while (w) {
         //printd(5, "qore_object_private::checkIntern() scanning Queue value: '%s'\n", w->node.getFullTypeName());
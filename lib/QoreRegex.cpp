@@ -50,9 +50,6 @@ QoreRegex::QoreRegex(const QoreString& s, int64 opts, ExceptionSink* xsink) {
 }
 
 QoreRegex::~QoreRegex() {
-    if (p) {
-        pcre_free(p);
-    }
     delete str;
 }
 
@@ -61,9 +58,6 @@ void QoreRegex::concat(char c) {
 }
 
 void QoreRegex::parseRT(const QoreString* pattern, ExceptionSink* xsink) {
-    const char* err;
-    int eo;
-
     // convert to UTF-8 if necessary
     TempEncodingHelper t(pattern, QCS_UTF8, xsink);
     if (*xsink)
@@ -71,11 +65,7 @@ void QoreRegex::parseRT(const QoreString* pattern, ExceptionSink* xsink) {
 
     //printd(5, "QoreRegex::parseRT(%s) this=%p\n", t->getBuffer(), this);
 
-    p = pcre_compile(t->getBuffer(), options, &err, &eo, 0);
-    if (err) {
-        //printd(5, "QoreRegex::parse() error parsing '%s': %s", t->getBuffer(), (char* )err);
-        xsink->raiseException("REGEX-COMPILATION-ERROR", (char* )err);
-    }
+    compile(t->getBuffer(), xsink);
 }
 
 void QoreRegex::parse(q_get_loc_t get_loc) {
@@ -117,7 +107,7 @@ bool QoreRegex::exec(const char* str, size_t len) const {
       std::vector<int> ovc(vsize, 0);
       int* ovector = &ovc[0];
 #endif
-      rc = pcre_exec(p, 0, str, len, 0, 0, ovector, vsize);
+      rc = execIntern(str, len, 0, ovector, vsize);
       if (!rc) {
          // rc == 0 means not enough space was available in ovector
          printd(5, "QoreRegex::exec() ovector too small: vsize: %d -> %d (max: %d)\n", vsize, vsize << 1, OVECMAX);
@@ -156,7 +146,7 @@ QoreListNode* QoreRegex::extractSubstrings(const QoreString* target, ExceptionSi
         std::vector<int> ovc(vsize, 0);
         int* ovector = &ovc[0];
 #endif
-        int rc = pcre_exec(p, 0, t->c_str(), t->size(), offset, 0, ovector, vsize);
+        int rc = execIntern(t->c_str(), t->size(), offset, ovector, vsize);
         //printd(5, "QoreRegex::exec(%s) =~ /xxx/ = %d (global: %d)\n", t->c_str() + offset, rc, global);
 
         if (!rc) {
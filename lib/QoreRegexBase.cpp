@@ -33,6 +33,54 @@
 #include <qore/Qore.h>
 #include "qore/intern/QoreRegexBase.h"
 
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define QORE_PCRE_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#else
+#define QORE_PCRE_STUDY_OPTIONS 0
+#endif
+
+QoreRegexBase::~QoreRegexBase() {
+    if (extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+        pcre_free_study(extra);
+#else
+        pcre_free(extra);
+#endif
+    }
+    if (p) {
+        pcre_free(p);
+    }
+}
+
+int QoreRegexBase::compile(const char* pattern, ExceptionSink* xsink) {
+    assert(!p);
+    const char* err;
+    int eo;
+    p = pcre_compile(pattern, options, &err, &eo, 0);
+    if (!p) {
+        xsink->raiseException("REGEX-COMPILATION-ERROR", (char*)err);
+        return -1;
+    }
+
+    // study errors are not fatal; the pattern is then executed without extra data
+    extra = pcre_study(p, QORE_PCRE_STUDY_OPTIONS, &err);
+    //printd(5, "QoreRegexBase::compile() '%s' extra: %p err: %s\n", pattern, extra, extra ? "n/a" : err);
+    return 0;
+}
+
+int QoreRegexBase::execIntern(const char* subject, int len, int offset, int* ovector, int ovecsize) const {
+    int rc = pcre_exec(p, extra, subject, len, offset, 0, ovector, ovecsize);
+#ifdef PCRE_ERROR_JIT_STACKLIMIT
+    // JIT code runs on a small fixed-size stack; rerun deeply-recursive matches with the interpreter
+    if (rc == PCRE_ERROR_JIT_STACKLIMIT) {
+        pcre_extra tmp = *extra;
+        tmp.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+        rc = pcre_exec(p, &tmp, subject, len, offset, 0, ovector, ovecsize);
+    }
+#endif
+    return rc;
+}
+
 void QoreRegexBase::setCaseInsensitive() {
     options |= PCRE_CASELESS;
 }
@@ -0,0 +1,119 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreRegexCache.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/QoreRegexCache.h"
+
+QoreRegexCache qore_regex_cache;
+
+template <class T, class F>
+T* QoreRegexCache::get(LruCache<T>& cache, const QoreString& pattern, int64 options, ExceptionSink* xsink,
+        F create) {
+    // patterns are compiled in UTF-8, so the key is the UTF-8 pattern
+    TempEncodingHelper t(&pattern, QCS_UTF8, xsink);
+    if (*xsink)
+        return nullptr;
+
+    Key key = {std::string(t->c_str(), t->size()), options};
+
+    {
+        AutoLocker al(m);
+        typename LruCache<T>::map_t::iterator i = cache.map.find(key);
+        if (i != cache.map.end()) {
+            ++hits;
+            // move the entry to the front of the LRU list
+            cache.lru.splice(cache.lru.begin(), cache.lru, i->second);
+            return i->second->second->refSelf();
+        }
+        ++misses;
+    }
+
+    // compile the pattern without holding the lock
+    SimpleRefHolder<T> rv(create(**t));
+    if (*xsink)
+        return nullptr;
+
+    if (!max)
+        return rv.release();
+
+    T* evicted = nullptr;
+    {
+        AutoLocker al(m);
+        // do not replace an entry added by another thread in the meantime
+        if (cache.map.find(key) == cache.map.end()) {
+            if (cache.lru.size() >= max) {
+                evicted = cache.lru.back().second;
+                cache.map.erase(cache.lru.back().first);
+                cache.lru.pop_back();
+                ++evictions;
+            }
+            cache.lru.emplace_front(key, rv->refSelf());
+            cache.map[key] = cache.lru.begin();
+        }
+    }
+    if (evicted)
+        evicted->deref();
+
+    return rv.release();
+}
+
+QoreRegex* QoreRegexCache::getRegex(const QoreString& pattern, int64 options, ExceptionSink* xsink) {
+    return get(regex_cache, pattern, options, xsink, [options, xsink] (const QoreString& str) -> QoreRegex* {
+        return new QoreRegex(str, options, xsink);
+    });
+}
+
+QoreRegexSubst* QoreRegexCache::getRegexSubst(const QoreString& pattern, int64 options, ExceptionSink* xsink) {
+    return get(subst_cache, pattern, options, xsink, [options, xsink] (const QoreString& str) -> QoreRegexSubst* {
+        QoreRegexSubst* rv = new QoreRegexSubst(&str, (int)(options & 0xffffffff), xsink);
+        if (options & QRE_GLOBAL)
+            rv->setGlobal();
+        return rv;
+    });
+}
+
+QoreHashNode* QoreRegexCache::getStats() const {
+    QoreHashNode* h = new QoreHashNode(autoTypeInfo);
+
+    AutoLocker al(m);
+    h->setKeyValue("hits", hits, nullptr);
+    h->setKeyValue("misses", misses, nullptr);
+    h->setKeyValue("evictions", evictions, nullptr);
+    h->setKeyValue("size", (int64)(regex_cache.lru.size() + subst_cache.lru.size()), nullptr);
+    h->setKeyValue("max", (int64)max, nullptr);
+    return h;
+}
+
+void QoreRegexCache::clear() {
+    AutoLocker al(m);
+    regex_cache.clear();
+    subst_cache.clear();
+}
@@ -68,8 +68,6 @@ QoreRegexSubst::QoreRegexSubst(const QoreString *pstr, int opts, ExceptionSink *
 QoreRegexSubst::~QoreRegexSubst() {
    //printd(5, "QoreRegexSubst::~QoreRegexSubst() this=%p\n", this);
    delete newstr;
-   if (p)
-      pcre_free(p);
    delete str;
 }
 
@@ -88,11 +86,7 @@ void QoreRegexSubst::parseRT(const QoreString *pstr, ExceptionSink *xsink) {
    if (*xsink)
       return;
 
-   const char *err;
-   int eo;
-   p = pcre_compile(t->getBuffer(), options, &err, &eo, 0);
-   if (err)
-      xsink->raiseException("REGEX-COMPILATION-ERROR", (char *)err);
+   compile(t->getBuffer(), xsink);
 }
 
 void QoreRegexSubst::parse() {
@@ -157,7 +151,7 @@ QoreStringNode *QoreRegexSubst::exec(const QoreString *target, const QoreString
       int offset = ptr - t->getBuffer();
       if ((unsigned)offset >= t->size())
          break;
-      int rc = pcre_exec(p, 0, t->getBuffer(), t->strlen(), offset, 0, ovector, SUBST_OVECSIZE);
+      int rc = execIntern(t->getBuffer(), t->strlen(), offset, ovector, SUBST_OVECSIZE);
 
       //printd(5, "QoreRegexSubst::exec() prec_exec() rc: %d ovector[0]: %d\n", rc, ovector[0]);
       // FIXME: rc = 0 means that not enough space was available in ovector!
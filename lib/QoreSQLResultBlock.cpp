@@ -0,0 +1,224 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreSQLResultBlock.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/QoreSQLResultBlock.h"
+#include "qore/intern/qore_list_private.h"
+
+// returns the value type for a column where all values have the given type
+static const QoreTypeInfo* get_column_value_type(qore_type_t t) {
+    switch (t) {
+        case NT_INT: return bigIntTypeInfo;
+        case NT_FLOAT: return floatTypeInfo;
+        case NT_STRING: return stringTypeInfo;
+        case NT_DATE: return dateTypeInfo;
+        case NT_NUMBER: return numberTypeInfo;
+        case NT_BINARY: return binaryTypeInfo;
+        case NT_BOOLEAN: return boolTypeInfo;
+    }
+    return nullptr;
+}
+
+// returns the common type of all values in the list or NT_ALL if the types are mixed or NULL is present
+static qore_type_t get_column_type(const QoreListNode& l) {
+    qore_type_t rv = NT_ALL;
+    ConstListIterator li(l);
+    while (li.next()) {
+        qore_type_t t = li.getValue().getType();
+        if (t == NT_NULL || t == NT_NOTHING || (rv != NT_ALL && t != rv))
+            return NT_ALL;
+        rv = t;
+    }
+    return rv;
+}
+
+SQLResultColumns::SQLResultColumns(const QoreHashNode& h) {
+    names.reserve(h.size());
+    ConstHashIterator hi(h);
+    while (hi.next()) {
+        index[hi.getKey()] = names.size();
+        names.push_back(hi.getKey());
+    }
+}
+
+bool SQLResultColumns::matches(const QoreHashNode& h) const {
+    if (h.size() != names.size())
+        return false;
+    name_vec_t::const_iterator i = names.begin();
+    ConstHashIterator hi(h);
+    while (hi.next()) {
+        if (*i != hi.getKey())
+            return false;
+        ++i;
+    }
+    return true;
+}
+
+QoreSQLResultBlock* QoreSQLResultBlock::create(QoreHashNode* h, SQLResultColumns*& cols, ExceptionSink* xsink) {
+    ReferenceHolder<QoreHashNode> holder(h, xsink);
+    if (!h || *xsink || h->empty())
+        return nullptr;
+
+    // get the number of rows and check the driver's output
+    size_t rows = 0;
+    {
+        ConstHashIterator hi(h);
+        bool first = true;
+        while (hi.next()) {
+            const QoreValue v = hi.get();
+            if (v.getType() != NT_LIST) {
+                xsink->raiseException("SQLRESULTBLOCK-ERROR", "DBI driver returned type '%s' for column '%s'; expecting 'list'",
+                    v.getTypeName(), hi.getKey());
+                return nullptr;
+            }
+            size_t size = v.get<const QoreListNode>()->size();
+            if (first) {
+                rows = size;
+                first = false;
+            } else if (size != rows) {
+                xsink->raiseException("SQLRESULTBLOCK-ERROR", "DBI driver returned " QLLD " value%s for column '%s'; expecting " QLLD,
+                    (int64)size, size == 1 ? "" : "s", hi.getKey(), (int64)rows);
+                return nullptr;
+            }
+        }
+    }
+    if (!rows)
+        return nullptr;
+
+    // reuse the column names of the previous block if possible
+    if (cols && cols->matches(*h)) {
+        cols->ref();
+    } else {
+        if (cols)
+            cols->deref();
+        cols = new SQLResultColumns(*h);
+        cols->ref();
+    }
+
+    QoreSQLResultBlock* rv = new QoreSQLResultBlock(cols, rows);
+    rv->data.reserve(h->size());
+    rv->types.reserve(h->size());
+
+    HashIterator hi(h);
+    while (hi.next()) {
+        QoreListNode* l = hi.get().get<QoreListNode>()->listRefSelf();
+        qore_type_t t = get_column_type(*l);
+        const QoreTypeInfo* vti = get_column_value_type(t);
+        if (!vti)
+            t = NT_ALL;
+        // the lists returned by the driver are not referenced anywhere else, so they can be typed in place
+        else if (h->reference_count() == 1 && l->reference_count() == 2)
+            qore_list_private::get(*l)->complexTypeInfo = qore_get_complex_list_type(vti);
+        rv->data.push_back(l);
+        rv->types.push_back(t);
+    }
+
+    return rv;
+}
+
+QoreSQLResultBlock::QoreSQLResultBlock(const QoreSQLResultBlock& old) : cols(old.cols), types(old.types), rows(old.rows) {
+    cols->ref();
+    data.reserve(old.data.size());
+    for (auto& i : old.data)
+        data.push_back(i->listRefSelf());
+}
+
+void QoreSQLResultBlock::deref(ExceptionSink* xsink) {
+    if (ROdereference()) {
+        for (auto& i : data)
+            i->deref(xsink);
+        data.clear();
+        delete this;
+    }
+}
+
+int QoreSQLResultBlock::findColumn(const char* name, ExceptionSink* xsink) const {
+    int i = cols->find(name);
+    if (i < 0)
+        xsink->raiseException("SQLRESULTBLOCK-ERROR", "the result block does not have column '%s'", name);
+    return i;
+}
+
+int QoreSQLResultBlock::checkRow(int64 row, ExceptionSink* xsink) const {
+    if (row < 0 || row >= (int64)rows) {
+        xsink->raiseException("SQLRESULTBLOCK-ERROR", "row " QLLD " is out of range; the result block has " QLLD " row%s",
+            row, (int64)rows, rows == 1 ? "" : "s");
+        return -1;
+    }
+    return 0;
+}
+
+QoreListNode* QoreSQLResultBlock::getColumnNames() const {
+    QoreListNode* rv = new QoreListNode(stringTypeInfo);
+    for (auto& i : cols->names)
+        rv->push(new QoreStringNode(i), nullptr);
+    return rv;
+}
+
+QoreHashNode* QoreSQLResultBlock::getColumnTypes() const {
+    QoreHashNode* rv = new QoreHashNode(stringTypeInfo);
+    for (size_t i = 0, e = data.size(); i < e; ++i) {
+        const QoreTypeInfo* vti = get_column_value_type(types[i]);
+        rv->setKeyValue(cols->names[i].c_str(), new QoreStringNode(vti ? QoreTypeInfo::getName(vti) : "auto"), nullptr);
+    }
+    return rv;
+}
+
+QoreListNode* QoreSQLResultBlock::getColumn(const char* name, ExceptionSink* xsink) const {
+    int i = findColumn(name, xsink);
+    return i < 0 ? nullptr : data[i]->listRefSelf();
+}
+
+QoreHashNode* QoreSQLResultBlock::getColumns(ExceptionSink* xsink) const {
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), xsink);
+    for (size_t i = 0, e = data.size(); i < e; ++i) {
+        rv->setKeyValue(cols->names[i].c_str(), data[i]->listRefSelf(), xsink);
+    }
+    return rv.release();
+}
+
+QoreHashNode* QoreSQLResultBlock::getRow(int64 row, ExceptionSink* xsink) const {
+    if (checkRow(row, xsink))
+        return nullptr;
+
+    ReferenceHolder<QoreHashNode> rv(new QoreHashNode(autoTypeInfo), xsink);
+    for (size_t i = 0, e = data.size(); i < e; ++i) {
+        rv->setKeyValue(cols->names[i].c_str(), data[i]->getReferencedEntry(row), xsink);
+    }
+    return rv.release();
+}
+
+QoreValue QoreSQLResultBlock::getValue(int64 row, const char* name, ExceptionSink* xsink) const {
+    if (checkRow(row, xsink))
+        return QoreValue();
+    int i = findColumn(name, xsink);
+    return i < 0 ? QoreValue() : data[i]->getReferencedEntry(row);
+}
@@ -30,6 +30,7 @@
 */
 
 #include <qore/Qore.h>
+#include <qore/minitest.hpp>
 #include "qore/intern/QC_SQLStatement.h"
 #include "qore/intern/DatasourceStatementHelper.h"
 #include "qore/intern/sql_statement_private.h"
@@ -37,6 +38,10 @@
 #include "qore/intern/qore_dbi_private.h"
 #include "qore/intern/DatasourcePool.h"
 
+#ifdef DEBUG_TESTS
+#  include "tests/SQLStatement_tests.cpp"
+#endif
+
 const char* QoreSQLStatement::stmt_statuses[] = { "idle", "prepared", "executed", "defined" };
 
 class DBActionHelper {
@@ -209,6 +214,9 @@ void QoreSQLStatement::deref(ExceptionSink* xsink) {
         if (prepare_args)
             prepare_args->deref(xsink);
 
+        if (block_cols)
+            block_cols->deref();
+
         delete this;
     }
 }
@@ -351,6 +359,77 @@ int QoreSQLStatement::exec(const QoreListNode* args, ExceptionSink* xsink) {
    return execIntern(dba, xsink);
 }
 
+int64 QoreSQLStatement::execArray(const QoreHashNode& data, ExceptionSink* xsink) {
+    DBActionHelper dba(*this, xsink, DAH_ACQUIRE);
+    if (!dba)
+        return -1;
+
+    // statements from output buffers have no SQL
+    if (str.empty()) {
+        xsink->raiseException("SQLSTATEMENT-ERROR", "the current statement has no SQL to execute");
+        return -1;
+    }
+
+    if (checkStatus(xsink, dba, STMT_PREPARED, "execArray"))
+        return -1;
+
+    // get the bind arguments in placeholder order and the number of rows
+    ReferenceHolder<QoreListNode> args(new QoreListNode(autoTypeInfo), xsink);
+    int64 rows = -1;
+    const char* first_key = nullptr;
+    ConstHashIterator hi(data);
+    while (hi.next()) {
+        const QoreValue v = hi.get();
+        if (v.getType() == NT_LIST) {
+            int64 size = v.get<const QoreListNode>()->size();
+            if (rows == -1) {
+                rows = size;
+                first_key = hi.getKey();
+            } else if (size != rows) {
+                xsink->raiseException("SQLSTATEMENT-ERROR", "SQLStatement::execArray(): column '%s' has " QLLD " value%s, but column '%s' has " QLLD " value%s; all list arguments must have the same number of elements",
+                    hi.getKey(), size, size == 1 ? "" : "s", first_key, rows, rows == 1 ? "" : "s");
+                return -1;
+            }
+        }
+        args->push(v.refSelf(), xsink);
+    }
+    // no column arrays means a single row
+    if (rows == -1)
+        rows = 1;
+    if (!rows)
+        return 0;
+
+    const qore_dbi_private* driver = qore_dbi_private::get(*priv->ds->getDriver());
+
+    // bind all rows in one call if possible
+    if (driver->hasStmtBindArray() || (driver->getCaps() & DBI_CAP_HAS_ARRAY_BIND)) {
+        int rc = driver->hasStmtBindArray()
+            ? driver->stmt_bind_array(this, **args, rows, xsink)
+            : driver->stmt_bind(this, **args, xsink);
+        if (rc || execIntern(dba, xsink))
+            return -1;
+        return driver->stmt_affected_rows(this, xsink);
+    }
+
+    // otherwise execute the statement once for each row
+    int64 affected = 0;
+    for (int64 i = 0; i < rows; ++i) {
+        ReferenceHolder<QoreListNode> row(new QoreListNode(autoTypeInfo), xsink);
+        ConstListIterator li(*args);
+        while (li.next()) {
+            const QoreValue v = li.getValue();
+            row->push(v.getType() == NT_LIST ? v.get<const QoreListNode>()->getReferencedEntry(i) : v.refSelf(), xsink);
+        }
+        if (driver->stmt_bind(this, **row, xsink) || execIntern(dba, xsink))
+            return -1;
+        int64 rc = driver->stmt_affected_rows(this, xsink);
+        if (*xsink)
+            return -1;
+        affected += rc;
+    }
+    return affected;
+}
+
 int QoreSQLStatement::execIntern(DBActionHelper& dba, ExceptionSink* xsink) {
     int rc = qore_dbi_private::get(*priv->ds->getDriver())->stmt_exec(this, xsink);
     if (!rc)
@@ -472,6 +551,17 @@ QoreHashNode* QoreSQLStatement::fetchColumns(int rows, ExceptionSink* xsink) {
    return qore_dbi_private::get(*priv->ds->getDriver())->stmt_fetch_columns(this, rows, xsink);
 }
 
+QoreSQLResultBlock* QoreSQLStatement::fetchBlock(int rows, ExceptionSink* xsink) {
+   DBActionHelper dba(*this, xsink, DAH_ACQUIRE);
+   if (!dba)
+      return nullptr;
+
+   if (checkStatus(xsink, dba, STMT_DEFINED, "fetchBlock"))
+      return nullptr;
+
+   return QoreSQLResultBlock::create(qore_dbi_private::get(*priv->ds->getDriver())->stmt_fetch_columns(this, rows, xsink), block_cols, xsink);
+}
+
 QoreHashNode* QoreSQLStatement::describe(ExceptionSink* xsink) {
     DBActionHelper dba(*this, xsink, DAH_ACQUIRE);
     if (!dba)
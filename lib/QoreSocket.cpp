@@ -701,13 +701,13 @@ int qore_socket_private::recv(int fd, qore_offset_t size, int timeout_ms, Except
     qore_offset_t rc;
     while (true) {
         // calculate bytes needed
-        int bn;
+        qore_offset_t bn;
         if (size == -1)
-            bn = DEFAULT_SOCKET_BUFSIZE;
+            bn = rbuf_size;
         else {
             bn = size - br;
-            if (bn > DEFAULT_SOCKET_BUFSIZE)
-                bn = DEFAULT_SOCKET_BUFSIZE;
+            if (bn > (qore_offset_t)rbuf_size)
+                bn = rbuf_size;
         }
 
         rc = brecv(xsink, "recv", buf, bn, 0, timeout_ms);
@@ -1720,13 +1720,13 @@ int QoreSocket::recv(int fd, qore_offset_t size, int timeout) {
     qore_offset_t rc;
     while (true) {
         // calculate bytes needed
-        int bn;
+        qore_offset_t bn;
         if (size == -1)
-            bn = DEFAULT_SOCKET_BUFSIZE;
+            bn = priv->rbuf_size;
         else {
             bn = size - br;
-            if (bn > DEFAULT_SOCKET_BUFSIZE)
-                bn = DEFAULT_SOCKET_BUFSIZE;
+            if (bn > (qore_offset_t)priv->rbuf_size)
+                bn = priv->rbuf_size;
         }
 
         rc = priv->brecv(&xsink, "recv", buf, bn, 0, timeout);
@@ -2371,6 +2371,14 @@ int64 QoreSocket::getConnectionId() const {
     return priv->connection_id;
 }
 
+int QoreSocket::setReadBufferSize(int64 size, ExceptionSink* xsink) {
+    return priv->setReadBufferSize(xsink, size);
+}
+
+int64 QoreSocket::getReadBufferSize() const {
+    return priv->getReadBufferSize();
+}
+
 QoreSocketTimeoutHelper::QoreSocketTimeoutHelper(QoreSocket& s, const char* op) : priv(new PrivateQoreSocketTimeoutHelper(qore_socket_private::get(s), op)) {
 }
 
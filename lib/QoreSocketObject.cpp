@@ -481,6 +481,13 @@ bool QoreSocketObject::isDataAvailable(ExceptionSink* xsink, int timeout_ms) {
    return priv->socket->isDataAvailable(xsink, timeout_ms);
 }
 
+int my_socket_priv::getPollInfo(QoreSocketObject& sock, bool& buffered) {
+   AutoLocker al(sock.priv->m);
+   qore_socket_private* sp = qore_socket_private::get(*sock.priv->socket);
+   buffered = sp->hasBufferedData();
+   return sp->sock;
+}
+
 bool QoreSocketObject::isWriteFinished(ExceptionSink* xsink, int timeout_ms) {
    AutoLocker al(priv->m);
    return priv->socket->isWriteFinished(xsink, timeout_ms);
@@ -688,4 +695,14 @@ int64 QoreSocketObject::getConnectionId() const {
     return priv->socket->getConnectionId();
 }
 
+int QoreSocketObject::setReadBufferSize(int64 size, ExceptionSink* xsink) {
+    AutoLocker al(priv->m);
+    return priv->socket->setReadBufferSize(size, xsink);
+}
+
+int64 QoreSocketObject::getReadBufferSize() const {
+    AutoLocker al(priv->m);
+    return priv->socket->getReadBufferSize();
+}
+
 
@@ -0,0 +1,400 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreSocketPoller.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/QoreSocketPoller.h"
+#include "qore/intern/QC_Socket.h"
+#include "qore/intern/QoreHashNodeIntern.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef QORE_SOCKETPOLLER_EPOLL
+#include <sys/epoll.h>
+#endif
+
+void QoreSocketPoller::SocketPollerEntry::del(ExceptionSink* xsink) {
+    arg.discard(xsink);
+    sock->deref(xsink);
+    obj->deref(xsink);
+}
+
+QoreSocketPoller::QoreSocketPoller(ExceptionSink* xsink) {
+#if defined QORE_SOCKETPOLLER_EPOLL || defined QORE_SOCKETPOLLER_POLL
+    if (pipe(wfd)) {
+        xsink->raiseErrnoException("SOCKETPOLLER-ERROR", errno, "failed to create wakeup pipe");
+        return;
+    }
+    for (int i = 0; i < 2; ++i) {
+        fcntl(wfd[i], F_SETFL, fcntl(wfd[i], F_GETFL) | O_NONBLOCK);
+        fcntl(wfd[i], F_SETFD, FD_CLOEXEC);
+    }
+#ifdef QORE_SOCKETPOLLER_EPOLL
+    efd = epoll_create1(EPOLL_CLOEXEC);
+    if (efd == -1) {
+        xsink->raiseErrnoException("SOCKETPOLLER-ERROR", errno, "epoll_create1() failed");
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;
+    if (epoll_ctl(efd, EPOLL_CTL_ADD, wfd[0], &ev)) {
+        xsink->raiseErrnoException("SOCKETPOLLER-ERROR", errno, "failed to register wakeup pipe with epoll");
+        return;
+    }
+#endif
+#else
+    xsink->raiseException("SOCKETPOLLER-ERROR", "the SocketPoller class is not supported on this platform");
+#endif
+}
+
+QoreSocketPoller::~QoreSocketPoller() {
+    assert(emap.empty());
+#ifdef QORE_SOCKETPOLLER_EPOLL
+    if (efd != -1)
+        close(efd);
+#endif
+    for (int i = 0; i < 2; ++i) {
+        if (wfd[i] != -1)
+            close(wfd[i]);
+    }
+}
+
+const char* QoreSocketPoller::getBackend() {
+#if defined QORE_SOCKETPOLLER_EPOLL
+    return "epoll";
+#elif defined QORE_SOCKETPOLLER_POLL
+    return "poll";
+#else
+    return "none";
+#endif
+}
+
+void QoreSocketPoller::signalIntern() {
+    char c = 0;
+    // if the pipe is full, waiting threads will be woken up anyway
+    if (write(wfd[1], &c, 1)) {
+    }
+}
+
+void QoreSocketPoller::drainIntern() {
+    char buf[64];
+    while (read(wfd[0], buf, sizeof buf) > 0) {
+    }
+}
+
+int QoreSocketPoller::add(QoreObject* obj, QoreSocketObject* sock, int events, const QoreValue arg,
+        ExceptionSink* xsink) {
+    if (!(events & (SOCK_POLLIN | SOCK_POLLOUT)) || (events & ~(SOCK_POLLIN | SOCK_POLLOUT))) {
+        xsink->raiseException("SOCKETPOLLER-ERROR", "invalid event mask %d; expecting a combination of SOCK_POLLIN "
+            "and SOCK_POLLOUT", events);
+        return -1;
+    }
+
+    // get the descriptor and buffer status before acquiring the poller lock to avoid blocking other threads
+    bool buffered;
+    int fd = my_socket_priv::getPollInfo(*sock, buffered);
+    if (fd < 0) {
+        xsink->raiseException("SOCKETPOLLER-ERROR", "cannot add a Socket that is not open to a SocketPoller");
+        return -1;
+    }
+
+    AutoLocker al(m);
+    if (omap.find(obj) != omap.end()) {
+        xsink->raiseException("SOCKETPOLLER-ERROR", "the Socket (fd %d) is already registered with this "
+            "SocketPoller", fd);
+        return -1;
+    }
+
+    uint64_t token = next_token++;
+
+    // data already read from the kernel (or decrypted) will not trigger a kernel event
+    if ((events & SOCK_POLLIN) && buffered) {
+        ready.push_back(std::make_pair(token, SOCK_POLLIN));
+        signalIntern();
+        fd = -1;
+    }
+#ifdef QORE_SOCKETPOLLER_EPOLL
+    else {
+        struct epoll_event ev;
+        ev.events = EPOLLONESHOT;
+        if (events & SOCK_POLLIN)
+            ev.events |= EPOLLIN;
+        if (events & SOCK_POLLOUT)
+            ev.events |= EPOLLOUT;
+        ev.data.u64 = token;
+        if (epoll_ctl(efd, EPOLL_CTL_ADD, fd, &ev)) {
+            // a descriptor that was returned by wait() after a concurrent close and reopen may still be registered
+            if (errno != EEXIST || epoll_ctl(efd, EPOLL_CTL_MOD, fd, &ev)) {
+                xsink->raiseErrnoException("SOCKETPOLLER-ERROR", errno, "failed to register Socket (fd %d) with "
+                    "epoll", fd);
+                return -1;
+            }
+        }
+    }
+#else
+    else {
+        // threads blocked in poll() must rebuild their descriptor list
+        signalIntern();
+    }
+#endif
+
+    obj->ref();
+    sock->ref();
+    emap.insert(entry_map_t::value_type(token, {obj, sock, fd, events, arg.refSelf()}));
+    omap.insert(obj_map_t::value_type(obj, token));
+    return 0;
+}
+
+QoreSocketPoller::SocketPollerEntry QoreSocketPoller::takeIntern(entry_map_t::iterator i) {
+    SocketPollerEntry e = i->second;
+    omap.erase(e.obj);
+    emap.erase(i);
+    return e;
+}
+
+void QoreSocketPoller::unregister(const SocketPollerEntry& e) {
+#ifdef QORE_SOCKETPOLLER_EPOLL
+    if (e.fd < 0)
+        return;
+    // if the socket has been closed, the kernel has already removed the registration, and the descriptor
+    // could now belong to another socket
+    bool buffered;
+    if (my_socket_priv::getPollInfo(*e.sock, buffered) != e.fd)
+        return;
+    epoll_ctl(efd, EPOLL_CTL_DEL, e.fd, nullptr);
+#endif
+}
+
+bool QoreSocketPoller::remove(const QoreObject* obj, ExceptionSink* xsink) {
+    SocketPollerEntry e;
+    {
+        AutoLocker al(m);
+        obj_map_t::iterator i = omap.find(obj);
+        if (i == omap.end())
+            return false;
+        e = takeIntern(emap.find(i->second));
+    }
+    unregister(e);
+    e.del(xsink);
+    return true;
+}
+
+void QoreSocketPoller::wakeup() {
+    AutoLocker al(m);
+    woken = true;
+    signalIntern();
+}
+
+QoreListNode* QoreSocketPoller::clear(ExceptionSink* xsink) {
+    entry_map_t tmp;
+    {
+        AutoLocker al(m);
+        tmp.swap(emap);
+        omap.clear();
+        ready.clear();
+    }
+
+    ReferenceHolder<QoreListNode> rv(new QoreListNode(QC_SOCKET->getTypeInfo()), xsink);
+    for (auto& i : tmp) {
+        unregister(i.second);
+        // the object reference is transferred to the list
+        rv->push(i.second.obj, xsink);
+        i.second.arg.discard(xsink);
+        i.second.sock->deref(xsink);
+    }
+    return rv.release();
+}
+
+QoreListNode* QoreSocketPoller::getEvents(result_list_t& rl, ExceptionSink* xsink) {
+    ReferenceHolder<QoreListNode> rv(new QoreListNode(hashdeclSocketPollerEvent->getTypeInfo()), xsink);
+    for (auto& i : rl) {
+        SocketPollerEntry& e = i.first;
+        unregister(e);
+        e.sock->deref(xsink);
+
+        QoreHashNode* h = new QoreHashNode(hashdeclSocketPollerEvent, xsink);
+        qore_hash_private* hh = qore_hash_private::get(*h);
+        // the object and arg references are transferred to the hash
+        hh->setKeyValueIntern("socket", e.obj);
+        hh->setKeyValueIntern("events", i.second);
+        hh->setKeyValueIntern("arg", e.arg);
+        rv->push(h, xsink);
+    }
+    return rv.release();
+}
+
+QoreListNode* QoreSocketPoller::wait(int timeout_ms, int max, ExceptionSink* xsink) {
+#if defined QORE_SOCKETPOLLER_EPOLL || defined QORE_SOCKETPOLLER_POLL
+    if (max <= 0) {
+        xsink->raiseException("SOCKETPOLLER-ERROR", "the maximum number of events must be greater than zero; "
+            "got %d", max);
+        return nullptr;
+    }
+
+    int64 end = timeout_ms > 0 ? q_clock_getmillis() + timeout_ms : 0;
+    result_list_t rl;
+
+#ifdef QORE_SOCKETPOLLER_EPOLL
+    std::vector<struct epoll_event> evs(max + 1);
+#else
+    std::vector<pollfd> pfds;
+    std::vector<uint64_t> tokens;
+#endif
+
+    while (true) {
+        {
+            AutoLocker al(m);
+            // return sockets with buffered data first
+            while (!ready.empty() && (int)rl.size() < max) {
+                entry_map_t::iterator i = emap.find(ready.front().first);
+                if (i != emap.end())
+                    rl.push_back(std::make_pair(takeIntern(i), ready.front().second));
+                ready.pop_front();
+            }
+            if (!rl.empty())
+                break;
+            if (woken) {
+                woken = false;
+                drainIntern();
+                break;
+            }
+#ifdef QORE_SOCKETPOLLER_POLL
+            pfds.clear();
+            tokens.clear();
+            pfds.push_back({wfd[0], POLLIN, 0});
+            tokens.push_back(0);
+            for (auto& i : emap) {
+                if (i.second.fd < 0)
+                    continue;
+                short pev = 0;
+                if (i.second.events & SOCK_POLLIN)
+                    pev |= POLLIN;
+                if (i.second.events & SOCK_POLLOUT)
+                    pev |= POLLOUT;
+                pfds.push_back({i.second.fd, pev, 0});
+                tokens.push_back(i.first);
+            }
+#endif
+        }
+
+        int to = -1;
+        if (timeout_ms >= 0) {
+            if (end) {
+                to = (int)(end - q_clock_getmillis());
+                if (to < 0)
+                    to = 0;
+            } else {
+                to = 0;
+            }
+        }
+
+#ifdef QORE_SOCKETPOLLER_EPOLL
+        int rc = epoll_wait(efd, &evs[0], max + 1, to);
+#else
+        int rc = poll(&pfds[0], pfds.size(), to);
+#endif
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            xsink->raiseErrnoException("SOCKETPOLLER-ERROR", errno, "%s() failed", getBackend());
+            return nullptr;
+        }
+
+        if (rc) {
+            AutoLocker al(m);
+#ifdef QORE_SOCKETPOLLER_EPOLL
+            for (int n = 0; n < rc; ++n) {
+                uint64_t token = evs[n].data.u64;
+                uint32_t revents = evs[n].events;
+                bool in = revents & EPOLLIN, out = revents & EPOLLOUT, hup = revents & EPOLLHUP,
+                    err = revents & EPOLLERR;
+#else
+            for (size_t n = 0; n < pfds.size(); ++n) {
+                if (!pfds[n].revents)
+                    continue;
+                uint64_t token = tokens[n];
+                short revents = pfds[n].revents;
+                bool in = revents & POLLIN, out = revents & POLLOUT, hup = revents & POLLHUP,
+                    err = revents & (POLLERR | POLLNVAL);
+#endif
+                if (!token) {
+                    drainIntern();
+                    continue;
+                }
+                entry_map_t::iterator i = emap.find(token);
+                // the socket was removed by another thread or returned to another waiting thread
+                if (i == emap.end())
+                    continue;
+                int events = 0;
+                if (in)
+                    events |= SOCK_POLLIN;
+                if (out)
+                    events |= SOCK_POLLOUT;
+                // return all requested events on errors or hangups so that the next I/O call reports the status
+                if (hup || err)
+                    events |= i->second.events;
+                events &= i->second.events;
+                if (err)
+                    events |= SOCK_POLLERR;
+                if (!events)
+                    continue;
+                if ((int)rl.size() == max) {
+                    // the socket has already been disarmed in the kernel; return it in the next call
+                    ready.push_back(std::make_pair(token, events));
+                    continue;
+                }
+                rl.push_back(std::make_pair(takeIntern(i), events));
+            }
+            if (woken) {
+                woken = false;
+                drainIntern();
+                break;
+            }
+            if (!rl.empty())
+                break;
+        }
+
+        // check for a timeout
+        if (!to)
+            break;
+        if (end && q_clock_getmillis() >= end)
+            break;
+    }
+
+    return getEvents(rl, xsink);
+#else
+    xsink->raiseException("SOCKETPOLLER-ERROR", "the SocketPoller class is not supported on this platform");
+    return nullptr;
+#endif
+}
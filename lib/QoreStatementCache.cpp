@@ -0,0 +1,195 @@
+/* -*- mode: c++; indent-tabs-mode: nil -*- */
+/*
+  QoreStatementCache.cpp
+
+  Qore Programming Language
+
+  Copyright (C) 2003 - 2020 Qore Technologies, s.r.o.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+  DEALINGS IN THE SOFTWARE.
+
+  Note that the Qore library is released under a choice of three open-source
+  licenses: MIT (as above), LGPL 2+, or GPL 2+; see README-LICENSE for more
+  information.
+*/
+
+#include <qore/Qore.h>
+#include "qore/intern/QoreStatementCache.h"
+#include "qore/intern/qore_dbi_private.h"
+
+#include <cctype>
+#include <memory>
+
+// DML statements that return the number of affected rows when executed
+static const char* cacheable_stmts[] = { "insert", "update", "delete", "merge", "upsert" };
+
+// returns true if the SQL has output placeholders (ex: ":code"), in which case exec() returns a hash of output values
+static bool has_placeholder(const char* p) {
+    char quote = '\0';
+    for (; *p; ++p) {
+        if (quote) {
+            if (*p == quote)
+                quote = '\0';
+        } else if (*p == '\'' || *p == '"') {
+            quote = *p;
+        } else if (*p == ':') {
+            // "::" is a type cast in some databases
+            if (p[1] == ':') {
+                ++p;
+                continue;
+            }
+            if (isalpha(p[1]) || p[1] == '_')
+                return true;
+        }
+    }
+    return false;
+}
+
+bool QoreStatementCache::cacheable(const Datasource& ds, const QoreString& sql, const QoreListNode* args) {
+    // only statements with bind values and in the connection's character encoding are cached
+    if (!args || !args->size() || sql.getEncoding() != ds.getQoreEncoding())
+        return false;
+
+    const char* p = sql.c_str();
+    while (isspace(*p))
+        ++p;
+
+    bool dml = false;
+    for (const char* kw : cacheable_stmts) {
+        size_t len = strlen(kw);
+        if (!strncasecmp(p, kw, len) && !isalnum(p[len]) && p[len] != '_') {
+            dml = true;
+            break;
+        }
+    }
+    if (!dml)
+        return false;
+
+    // statements with output placeholders return their output values instead of the number of affected rows
+    if (has_placeholder(p))
+        return false;
+
+    // placeholder buffer specifications may also be given as hashes in the arguments
+    ConstListIterator li(args);
+    while (li.next()) {
+        if (li.getValue().getType() == NT_HASH)
+            return false;
+    }
+
+    // the SQL text must not depend on the arguments; any formatting code other than %v is substituted in the text
+    while ((p = strchr(p, '%'))) {
+        if (p[1] != 'v')
+            return false;
+        p += 2;
+    }
+    return true;
+}
+
+QoreValue QoreStatementCache::exec(const QoreString& sql, const QoreListNode& args, ExceptionSink* xsink) {
+    assert(max);
+    qore_dbi_private* dbi = qore_dbi_private::get(*ds->getDriver());
+
+    std::string key(sql.c_str(), sql.size());
+    stmt_list_t::iterator i;
+    stmt_map_t::iterator mi = smap.find(key);
+    if (mi != smap.end()) {
+        ++hits;
+        i = mi->second;
+        // move to the front of the LRU list
+        if (i != lru.begin())
+            lru.splice(lru.begin(), lru, i);
+    } else {
+        ++misses;
+        std::unique_ptr<SQLStatement> stmt(new SQLStatement(ds, nullptr));
+        if (dbi->stmt_prepare(stmt.get(), sql, nullptr, xsink)) {
+            if (stmt->getPrivateData())
+                dbi->stmt_close(stmt.get(), xsink);
+            return QoreValue();
+        }
+
+        // make room for the new statement
+        while (lru.size() >= max) {
+            ++evictions;
+            remove(--lru.end(), xsink);
+        }
+
+        lru.emplace_front(key, stmt.release());
+        i = lru.begin();
+        smap[key] = i;
+        ++count;
+    }
+
+    SQLStatement* stmt = i->stmt;
+    if (dbi->stmt_bind(stmt, args, xsink) || dbi->stmt_exec(stmt, xsink)) {
+        // the state of the statement is unknown after an error, so it's not reused
+        remove(i, xsink);
+        return QoreValue();
+    }
+
+    return dbi->stmt_affected_rows(stmt, xsink);
+}
+
+void QoreStatementCache::setMax(size_t n, ExceptionSink* xsink) {
+    max = n;
+    while (lru.size() > max) {
+        ++evictions;
+        remove(--lru.end(), xsink);
+    }
+}
+
+void QoreStatementCache::clear(ExceptionSink* xsink) {
+    if (lru.empty())
+        return;
+
+    ++invalidations;
+    while (!lru.empty())
+        remove(lru.begin(), xsink);
+}
+
+void QoreStatementCache::remove(stmt_list_t::iterator i, ExceptionSink* xsink) {
+    std::unique_ptr<SQLStatement> stmt(i->stmt);
+    smap.erase(i->sql);
+    lru.erase(i);
+    --count;
+
+    if (stmt->getPrivateData())
+        qore_dbi_private::get(*ds->getDriver())->stmt_close(stmt.get(), xsink);
+}
+
+static QoreHashNode* get_stats_hash(int64 size, int64 count, int64 hits, int64 misses, int64 evictions,
+        int64 invalidations) {
+    QoreHashNode* h = new QoreHashNode(bigIntTypeInfo);
+    h->setKeyValue("size", size, nullptr);
+    h->setKeyValue("count", count, nullptr);
+    h->setKeyValue("hits", hits, nullptr);
+    h->setKeyValue("misses", misses, nullptr);
+    h->setKeyValue("evictions", evictions, nullptr);
+    h->setKeyValue("invalidations", invalidations, nullptr);
+    return h;
+}
+
+QoreHashNode* QoreStatementCache::getStats() const {
+    return get_stats_hash(max, count.load(std::memory_order_relaxed), hits.load(std::memory_order_relaxed),
+        misses.load(std::memory_order_relaxed), evictions.load(std::memory_order_relaxed),
+        invalidations.load(std::memory_order_relaxed));
+}
+
+QoreHashNode* QoreStatementCache::getEmptyStats() {
+    return get_stats_hash(0, 0, 0, 0, 0, 0);
+}
@@ -36,6 +36,7 @@
 #include "qore/intern/StringReaderHelper.h"
 #include "qore/minitest.hpp"
 
+#include <algorithm>
 #include <cctype>
 #include <cerrno>
 #include <cstdio>
@@ -61,8 +62,10 @@ struct code_table {
     unsigned len;
 };
 
-// complete set of characters to percent-encode (RFC 3986 http://tools.ietf.org/html/rfc3986)
-static int_set_t url_reserved;
+// percent-encoding classes for all byte values (RFC 3986 http://tools.ietf.org/html/rfc3986)
+#define URL_ENC_ALWAYS   (1 << 0)   // always encoded: '%', ' ' and non-ASCII bytes; also set for the terminating null
+#define URL_ENC_RESERVED (1 << 1)   // reserved characters; encoded when all characters are encoded
+static unsigned char url_enc_class[256];
 
 // maps from entity strings to unicode code points
 typedef std::map<std::string, uint32_t> emap_t;
@@ -400,7 +403,10 @@ void qore_string_init() {
 #define URLIST_SIZE (sizeof(url_reserved_list) / sizeof(int))
 
     for (unsigned i = 0; i < URLIST_SIZE; ++i)
-        url_reserved.insert(url_reserved_list[i]);
+        url_enc_class[url_reserved_list[i]] = URL_ENC_RESERVED;
+    url_enc_class[0] = url_enc_class[(unsigned char)'%'] = url_enc_class[(unsigned char)' '] = URL_ENC_ALWAYS;
+    for (unsigned i = 128; i < 256; ++i)
+        url_enc_class[i] = URL_ENC_ALWAYS;
 
     for (unsigned i = 0; i < NUM_ENTITIES; ++i) {
         assert(emap.find(xhtml_entity_list[i].entity) == emap.end());
@@ -483,9 +489,19 @@ int qore_string_private::concatDecodeUriIntern(ExceptionSink* xsink, const qore_
    }
 
    bool in_query = false;
+   // characters that need processing; all others are copied in runs
+   const char* special = detect_query ? "%?+#" : "%";
 
    const char* url = str.buf;
    while (*url) {
+      qore_size_t run = strcspn(url, special);
+      if (run) {
+         concat(url, run);
+         url += run;
+         if (!*url)
+            break;
+      }
+
       int x1 = getHex(url);
       if (x1 >= 0) {
          // see if a multi-byte char is starting
@@ -957,6 +973,7 @@ int qore_string_private::concatUnicode(unsigned code) {
 }
 
 int qore_string_private::trimLeading(ExceptionSink* xsink, const intvec_t& cvec) {
+    invalidateCharIndex();
     qore_size_t i = 0;
 
     // trim default whitespace
@@ -1035,12 +1052,213 @@ int qore_string_private::trimTrailing(ExceptionSink* xsink, const qore_string_pr
 }
 
 void qore_string_private::terminate(size_t size) {
+   invalidateCharIndex();
    if (size > len)
       check_char(size);
    len = size;
    buf[size] = '\0';
 }
 
+qore_string_char_index* qore_string_private::buildCharIndex() const {
+    std::unique_ptr<qore_string_char_index> ci(new qore_string_char_index);
+    ci->enc = getEncoding();
+    return indexCharsIntern(*ci, false) ? nullptr : ci.release();
+}
+
+int qore_string_private::indexCharsIntern(qore_string_char_index& ci, bool partial) const {
+    const QoreEncoding* enc = ci.enc;
+    const char* p = buf + ci.len;
+    const char* end = buf + len;
+    qore_size_t c = ci.chars;
+    std::vector<qore_size_t>& offsets = ci.offsets;
+    // offsets are only recorded once a multi-byte character is found
+    bool single_byte = offsets.empty();
+    while (p < end) {
+        // skip runs of ASCII characters in UTF-8 strings a word at a time
+        if (enc == QCS_UTF8) {
+            qore_size_t run = q_ascii_prefix_len(p, end - p);
+            if (run) {
+                if (!single_byte) {
+                    // record the offsets of all indexed characters in the run
+                    qore_size_t next = (c + QORE_STRING_CHAR_INDEX_STEP - 1) / QORE_STRING_CHAR_INDEX_STEP
+                        * QORE_STRING_CHAR_INDEX_STEP;
+                    for (; next < c + run; next += QORE_STRING_CHAR_INDEX_STEP) {
+                        offsets.push_back(p - buf + (next - c));
+                    }
+                }
+                p += run;
+                c += run;
+                continue;
+            }
+        }
+
+        bool invalid;
+        qore_size_t bl = enc->getByteLen(p, end, 1, invalid);
+        if (invalid || !bl) {
+            if (partial && (end - p) < QORE_STRING_MAX_CHAR_LEN) {
+                break;
+            }
+            return -1;
+        }
+        if (bl > 1 && single_byte) {
+            // all characters so far are single-byte characters, so their byte offsets are their character offsets
+            offsets.reserve(len / QORE_STRING_CHAR_INDEX_STEP + 1);
+            for (qore_size_t i = 0; i < c; i += QORE_STRING_CHAR_INDEX_STEP) {
+                offsets.push_back(i);
+            }
+            single_byte = false;
+        }
+        if (!single_byte && !(c % QORE_STRING_CHAR_INDEX_STEP)) {
+            offsets.push_back(p - buf);
+        }
+        p += bl;
+        ++c;
+    }
+
+    ci.len = p - buf;
+    ci.chars = c;
+    return 0;
+}
+
+void qore_string_private::extendCharIndex() {
+    qore_string_char_index* ci = char_index.load(std::memory_order_relaxed);
+    assert(ci);
+    if (ci->len == len) {
+        return;
+    }
+    if (ci->len > len || ci->enc != getEncoding() || indexCharsIntern(*ci, true)) {
+        invalidateCharIndex();
+    }
+}
+
+const qore_string_char_index* qore_string_private::getCharIndex() const {
+    if (len < QORE_STRING_CHAR_INDEX_MIN || !getEncoding()->isMultiByte()) {
+        return nullptr;
+    }
+
+    qore_string_char_index* ci = char_index.load(std::memory_order_acquire);
+    if (!ci) {
+        ci = buildCharIndex();
+        if (!ci) {
+            return nullptr;
+        }
+        // another thread may have published an index for the same data in the meantime
+        qore_string_char_index* current = nullptr;
+        if (!char_index.compare_exchange_strong(current, ci, std::memory_order_acq_rel)) {
+            delete ci;
+            ci = current;
+        }
+    }
+
+    // an index is only usable if the data has not been changed other than by appending to it since it was built
+    return ci->enc == getEncoding() && ci->len <= len ? ci : nullptr;
+}
+
+qore_size_t qore_string_private::getCharPosIntern(const qore_string_char_index* ci, qore_size_t bpos,
+        bool& invalid) const {
+    if (bpos >= ci->len) {
+        return ci->chars + getEncoding()->getCharPos(buf + ci->len, buf + bpos, invalid);
+    }
+    invalid = false;
+    if (ci->offsets.empty()) {
+        return bpos;
+    }
+    // find the last indexed character at or before the byte offset
+    std::vector<qore_size_t>::const_iterator i = std::upper_bound(ci->offsets.begin(), ci->offsets.end(), bpos);
+    assert(i != ci->offsets.begin());
+    --i;
+    qore_size_t c = (i - ci->offsets.begin()) * QORE_STRING_CHAR_INDEX_STEP;
+    return *i == bpos ? c : c + getEncoding()->getCharPos(buf + *i, buf + bpos, invalid);
+}
+
+qore_size_t qore_string_private::getByteOffsetIntern(const qore_string_char_index* ci, qore_size_t c,
+        bool& invalid) const {
+    if (c >= ci->chars) {
+        return ci->len + getEncoding()->getByteLen(buf + ci->len, buf + len, c - ci->chars, invalid);
+    }
+    invalid = false;
+    if (ci->offsets.empty()) {
+        return c;
+    }
+    qore_size_t start = ci->offsets[c / QORE_STRING_CHAR_INDEX_STEP];
+    qore_size_t rem = c % QORE_STRING_CHAR_INDEX_STEP;
+    return rem ? start + getEncoding()->getByteLen(buf + start, buf + len, rem, invalid) : start;
+}
+
+qore_size_t qore_string_private::getCharLength(qore_size_t start, bool& invalid) const {
+    const qore_string_char_index* ci = getCharIndex();
+    if (!ci) {
+        return getEncoding()->getLength(buf + start, buf + len, invalid);
+    }
+    qore_size_t c = ci->chars;
+    if (ci->len < len) {
+        c += getEncoding()->getLength(buf + ci->len, buf + len, invalid);
+        if (invalid) {
+            return getEncoding()->getLength(buf + start, buf + len, invalid);
+        }
+    }
+    else {
+        invalid = false;
+    }
+    if (!start) {
+        return c;
+    }
+    qore_size_t sc = getCharPosIntern(ci, start, invalid);
+    if (invalid) {
+        return getEncoding()->getLength(buf + start, buf + len, invalid);
+    }
+    return c - sc;
+}
+
+qore_size_t qore_string_private::getCharLength(qore_size_t start, ExceptionSink* xsink) const {
+    bool invalid;
+    qore_size_t rc = getCharLength(start, invalid);
+    if (invalid) {
+        xsink->raiseException("INVALID-ENCODING", "invalid %s encoding encountered in string",
+            getEncoding()->getCode());
+        return 0;
+    }
+    return rc;
+}
+
+qore_size_t qore_string_private::getCharByteLen(qore_size_t start, qore_size_t c, bool& invalid) const {
+    const qore_string_char_index* ci = getCharIndex();
+    if (ci) {
+        qore_size_t sc = start ? getCharPosIntern(ci, start, invalid) : 0;
+        if (!start || !invalid) {
+            qore_size_t end = getByteOffsetIntern(ci, sc + c, invalid);
+            if (!invalid) {
+                return end - start;
+            }
+        }
+    }
+    // fall back to a scan of the data to find the offset of any invalid character
+    return getEncoding()->getByteLen(buf + start, buf + len, c, invalid);
+}
+
+qore_size_t qore_string_private::getCharByteLen(qore_size_t start, qore_size_t c, ExceptionSink* xsink) const {
+    bool invalid;
+    qore_size_t rc = getCharByteLen(start, c, invalid);
+    if (invalid) {
+        xsink->raiseException("INVALID-ENCODING", "invalid %s encoding encountered in string",
+            getEncoding()->getCode());
+        return 0;
+    }
+    return rc;
+}
+
+qore_size_t qore_string_private::getCharPos(qore_size_t bpos, ExceptionSink* xsink) const {
+    const qore_string_char_index* ci = getCharIndex();
+    if (ci) {
+        bool invalid;
+        qore_size_t rc = getCharPosIntern(ci, bpos, invalid);
+        if (!invalid) {
+            return rc;
+        }
+    }
+    return getEncoding()->getCharPos(buf, buf + bpos, xsink);
+}
+
 QoreStringMaker::QoreStringMaker(const char* fmt, ...) {
    va_list args;
 
@@ -1066,18 +1284,11 @@ QoreStringMaker::QoreStringMaker(const QoreEncoding* enc, const char* fmt, ...)
 }
 
 QoreString::QoreString() : priv(new qore_string_private) {
-   priv->len = 0;
-   priv->allocated = STR_CLASS_BLOCK;
-   priv->buf = (char*)malloc(priv->allocated * sizeof(char));
-   priv->buf[0] = '\0';
    priv->charset = QCS_DEFAULT;
 }
 
 // FIXME: this is not very efficient with the array offsets...
 QoreString::QoreString(const char* str) : priv(new qore_string_private) {
-   priv->len = 0;
-   priv->allocated = STR_CLASS_BLOCK;
-   priv->buf = (char*)malloc(priv->allocated * sizeof(char));
    if (str) {
       while (str[priv->len]) {
          priv->check_char(priv->len);
@@ -1094,9 +1305,6 @@ QoreString::QoreString(const char* str) : priv(new qore_string_private) {
 
 // FIXME: this is not very efficient with the array offsets...
 QoreString::QoreString(const char* str, const QoreEncoding* new_qorecharset) : priv(new qore_string_private) {
-   priv->len = 0;
-   priv->allocated = STR_CLASS_BLOCK;
-   priv->buf = (char*)malloc(priv->allocated * sizeof(char));
    if (str) {
       while (str[priv->len]) {
          priv->check_char(priv->len);
@@ -1112,25 +1320,19 @@ QoreString::QoreString(const char* str, const QoreEncoding* new_qorecharset) : p
 }
 
 QoreString::QoreString(const std::string& str, const QoreEncoding* new_encoding) : priv(new qore_string_private) {
-   priv->allocated = str.size() + 1 + STR_CLASS_BLOCK;
-   priv->buf = (char*)malloc(priv->allocated * sizeof(char));
+   priv->init_buf(str.size() + 1, str.size() + 1 + STR_CLASS_BLOCK);
    memcpy(priv->buf, str.c_str(), str.size() + 1);
    priv->len = str.size();
    priv->charset = new_encoding;
 }
 
 QoreString::QoreString(const QoreEncoding* new_qorecharset) : priv(new qore_string_private) {
-   priv->len = 0;
-   priv->allocated = STR_CLASS_BLOCK;
-   priv->buf = (char*)malloc(priv->allocated * sizeof(char));
-   priv->buf[0] = '\0';
    priv->charset = new_qorecharset;
 }
 
 QoreString::QoreString(const char* str, qore_size_t size, const QoreEncoding* new_qorecharset) : priv(new qore_string_private) {
    priv->len = size;
-   priv->allocated = size + STR_CLASS_EXTRA;
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
+   priv->init_buf(size + 1, size + STR_CLASS_EXTRA);
    memcpy(priv->buf, str, size);
    priv->buf[size] = '\0';
    priv->charset = new_qorecharset;
@@ -1146,8 +1348,7 @@ QoreString::QoreString(const QoreString* str, qore_size_t size) : priv(new qore_
    if (size >= str->priv->len)
       size = str->priv->len;
    priv->len = size;
-   priv->allocated = size + STR_CLASS_EXTRA;
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
+   priv->init_buf(size + 1, size + STR_CLASS_EXTRA);
    if (size)
       memcpy(priv->buf, str->priv->buf, size);
    priv->buf[size] = '\0';
@@ -1156,25 +1357,19 @@ QoreString::QoreString(const QoreString* str, qore_size_t size) : priv(new qore_
 
 QoreString::QoreString(char c) : priv(new qore_string_private) {
    priv->len = 1;
-   priv->allocated = STR_CLASS_BLOCK;
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
    priv->buf[0] = c;
    priv->buf[1] = '\0';
    priv->charset = QCS_DEFAULT;
 }
 
 QoreString::QoreString(int64 i) : priv(new qore_string_private) {
-   priv->allocated = MAX_BIGINT_STRING_LEN + 1;
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
-   priv->len = ::snprintf(priv->buf, MAX_BIGINT_STRING_LEN, QLLD, i);
-   // terminate string just in case
-   priv->buf[MAX_BIGINT_STRING_LEN] = '\0';
+   // integers always fit in the inline buffer
+   priv->len = ::snprintf(priv->buf, QORE_STRING_INLINE_SIZE, QLLD, i);
+   assert(priv->len < QORE_STRING_INLINE_SIZE);
    priv->charset = QCS_DEFAULT;
 }
 
 QoreString::QoreString(bool b) : priv(new qore_string_private) {
-   priv->allocated = 2;
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
    priv->buf[0] = b ? '1' : '0';
    priv->buf[1] = 0;
    priv->len = 1;
@@ -1182,9 +1377,9 @@ QoreString::QoreString(bool b) : priv(new qore_string_private) {
 }
 
 QoreString::QoreString(double f) : priv(new qore_string_private) {
-   priv->allocated = MAX_FLOAT_STRING_LEN + 1;
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
-   priv->len = ::snprintf(priv->buf, MAX_FLOAT_STRING_LEN, "%.9g", f);
+   // floating-point values with 9 significant digits always fit in the inline buffer
+   priv->len = ::snprintf(priv->buf, QORE_STRING_INLINE_SIZE, "%.9g", f);
+   assert(priv->len < QORE_STRING_INLINE_SIZE);
    // snprintf() always terminates the string
    priv->charset = QCS_DEFAULT;
    // issue 1556: external modules that call setlocale() can change
@@ -1193,8 +1388,7 @@ QoreString::QoreString(double f) : priv(new qore_string_private) {
 }
 
 QoreString::QoreString(const DateTime *d) : priv(new qore_string_private) {
-   priv->allocated = 15;
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
+   priv->init_buf(15);
 
    qore_tm info;
    d->getInfo(info);
@@ -1204,17 +1398,13 @@ QoreString::QoreString(const DateTime *d) : priv(new qore_string_private) {
 }
 
 QoreString::QoreString(const BinaryNode *b) : priv(new qore_string_private) {
-   priv->allocated = b->size() + (b->size() * 4) / 10 + 10; // estimate for base64 encoding
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
-   priv->len = 0;
+   priv->init_buf(b->size() + (b->size() * 4) / 10 + 10); // estimate for base64 encoding
    priv->charset = QCS_DEFAULT;
    concatBase64(b, -1);
 }
 
 QoreString::QoreString(const BinaryNode *b, qore_size_t maxlinelen) : priv(new qore_string_private) {
-   priv->allocated = b->size() + (b->size() * 4) / 10 + 10; // estimate for base64 encoding
-   priv->buf = (char*)malloc(sizeof(char) * priv->allocated);
-   priv->len = 0;
+   priv->init_buf(b->size() + (b->size() * 4) / 10 + 10); // estimate for base64 encoding
    priv->charset = QCS_DEFAULT;
    concatBase64(b, maxlinelen);
 }
@@ -1458,17 +1648,15 @@ void QoreString::reserve(qore_size_t size) {
 }
 
 void QoreString::take(char* str) {
-   if (priv->buf)
-      free(priv->buf);
-   priv->buf = str;
+   priv->invalidateCharIndex();
+   priv->free_buf();
    if (str) {
+      priv->buf = str;
       priv->len = ::strlen(str);
       priv->allocated = priv->len + 1;
    }
-   else {
-      priv->allocated = 0;
-      priv->len = 0;
-   }
+   else
+      priv->reset_buf();
 }
 
 void QoreString::take(char* str, const QoreEncoding* new_qorecharset) {
@@ -1477,16 +1665,16 @@ void QoreString::take(char* str, const QoreEncoding* new_qorecharset) {
 }
 
 void QoreString::take(char* str, qore_size_t size) {
-   if (priv->buf)
-      free(priv->buf);
+   priv->invalidateCharIndex();
+   priv->free_buf();
    priv->buf = str;
    priv->len = size;
    priv->allocated = size + 1;
 }
 
 void QoreString::take(char* str, qore_size_t size, const QoreEncoding* enc) {
-   if (priv->buf)
-      free(priv->buf);
+   priv->invalidateCharIndex();
+   priv->free_buf();
    priv->buf = str;
    priv->len = size;
    priv->allocated = size + 1;
@@ -1495,8 +1683,8 @@ void QoreString::take(char* str, qore_size_t size, const QoreEncoding* enc) {
 }
 
 void QoreString::takeAndTerminate(char* str, qore_size_t size) {
-   if (priv->buf)
-      free(priv->buf);
+   priv->invalidateCharIndex();
+   priv->free_buf();
    priv->buf = str;
    priv->len = size;
    priv->allocated = size + 1;
@@ -1509,13 +1697,9 @@ void QoreString::takeAndTerminate(char* str, qore_size_t size, const QoreEncodin
    priv->charset = enc;
 }
 
-// NOTE: could be dangerous if we refer to the priv->buffer after this
-// call and it's NULL (the only way the priv->buffer can become NULL)
+// the string is left empty in the inline buffer after this call
 char* QoreString::giveBuffer() {
-   char* rv = priv->buf;
-   priv->buf = 0;
-   priv->len = 0;
-   priv->allocated = 0;
+   char* rv = priv->take_buf();
    // reset character set, just in case the string will be reused
    // (normally not after this call)
    priv->charset = QCS_DEFAULT;
@@ -1523,32 +1707,29 @@ char* QoreString::giveBuffer() {
 }
 
 void QoreString::clear() {
-   if (priv->allocated) {
-      priv->len = 0;
-      priv->buf[0] = '\0';
-   }
+   priv->invalidateCharIndex();
+   priv->len = 0;
+   priv->buf[0] = '\0';
 }
 
 void QoreString::reset() {
-   char* b = giveBuffer();
-   if (b)
-      free(b);
-   priv->check_char(0);
-   priv->buf[0] = '\0';
+   priv->free_buf();
+   priv->reset_buf();
+   priv->charset = QCS_DEFAULT;
 }
 
 void QoreString::set(const char* str, const QoreEncoding* new_qorecharset) {
+   priv->invalidateCharIndex();
    priv->len = 0;
    priv->charset = new_qorecharset;
-   if (!str) {
-      if (priv->buf)
-         priv->buf[0] = '\0';
-   }
+   if (!str)
+      priv->buf[0] = '\0';
    else
       concat(str);
 }
 
 void QoreString::set(const QoreString* str) {
+   priv->invalidateCharIndex();
    priv->len = str->priv->len;
    priv->charset = str->priv->getEncoding();
    allocate(str->priv->len + 1);
@@ -1561,6 +1742,7 @@ void QoreString::set(const QoreString& str) {
 }
 
 void QoreString::set(const std::string& str, const QoreEncoding* ne) {
+   priv->invalidateCharIndex();
    priv->len = str.size();
    priv->charset = ne;
    allocate(priv->len + 1);
@@ -1569,8 +1751,8 @@ void QoreString::set(const std::string& str, const QoreEncoding* ne) {
 }
 
 void QoreString::set(char* nbuf, size_t nlen, size_t nallocated, const QoreEncoding* enc) {
-   if (priv->buf)
-      free(priv->buf);
+   priv->invalidateCharIndex();
+   priv->free_buf();
 
    assert(nallocated >= nlen);
    priv->buf = nbuf;
@@ -1584,6 +1766,7 @@ void QoreString::set(char* nbuf, size_t nlen, size_t nallocated, const QoreEncod
 }
 
 void QoreString::setEncoding(const QoreEncoding* new_encoding) {
+   priv->invalidateCharIndex();
    priv->charset = new_encoding;
 }
 
@@ -1635,6 +1818,7 @@ void QoreString::replace(qore_size_t offset, qore_size_t dlen, const QoreString*
 }
 
 void QoreString::replaceChar(qore_size_t offset, char c) {
+   priv->invalidateCharIndex();
    if (priv->len <= offset)
       return;
 
@@ -1782,71 +1966,39 @@ QoreString* QoreString::convertEncoding(const QoreEncoding* nccs, ExceptionSink*
    return targ.release();
 }
 
-static void base64_concat(QoreString& str, unsigned char c, qore_size_t& linelen, qore_size_t maxlinelen) {
-   str.concat(table64[c]);
-
-   ++linelen;
-   if (maxlinelen > 0 && linelen == maxlinelen) {
-      str.concat("\r\n");
-      linelen = 0;
-   }
-}
-
 // endian-agnostic binary object -> base64 string function
-// NOTE: not very high-performance - high-performance versions
-//       would likely be endian-aware and operate directly on 32-bit words
 // FIXME: does not work with non-ASCII-compatible encodings such as UTF-16*
 void QoreString::concatBase64(const char* bbuf, qore_size_t size, qore_size_t maxlinelen) {
    //printf("bbuf=%p, size=" QSD "\n", bbuf, size);
    if (!size)
       return;
 
-   qore_size_t linelen = 0;
-
-   unsigned char* p = (unsigned char*)bbuf;
-   unsigned char* endbuf = p + size;
-   while (p < endbuf) {
-      // get 6 bits of data
-      unsigned char c = p[0] >> 2;
-
-      // byte 1: concat 1st 6-bit value
-      base64_concat(*this, c, linelen, maxlinelen);
-
-      // byte 1: use remaining 2 bits in low order position
-      c = (p[0] & 3) << 4;
+   qore_size_t elen = q_base64_encoded_len(size);
+   // line breaks are inserted after every maxlinelen characters before the padding
+   qore_size_t dlen = elen - ((3 - size % 3) % 3);
+   qore_size_t breaks = maxlinelen ? dlen / maxlinelen : 0;
 
-      // check end
-      if ((endbuf - p) == 1) {
-         base64_concat(*this, c, linelen, maxlinelen);
-         concat("==");
-         break;
-      }
-
-      // byte 2: get 4 bits to make next 6-bit unit
-      c |= p[1] >> 4;
-
-      // concat 2nd 6-bit value
-      base64_concat(*this, c, linelen, maxlinelen);
-
-      // byte 2: get 4 low bits
-      c = (p[1] & 15) << 2;
-
-      if ((endbuf - p) == 2) {
-         base64_concat(*this, c, linelen, maxlinelen);
-         concat('=');
-         break;
+   priv->check_char(priv->len + elen + breaks * 2);
+   char* p = priv->buf + priv->len;
+   if (!breaks)
+      q_base64_encode(p, (const unsigned char*)bbuf, size);
+   else {
+      // encode to the end of the reserved space and move each line into place; the output never overtakes the
+      // unmoved input, and the characters after the last line break are already in their final position
+      char* src = p + breaks * 2;
+      q_base64_encode(src, (const unsigned char*)bbuf, size);
+      for (qore_size_t i = 0; i < breaks; ++i) {
+         memmove(p, src, maxlinelen);
+         p += maxlinelen;
+         src += maxlinelen;
+         p[0] = '\r';
+         p[1] = '\n';
+         p += 2;
       }
-
-      // byte 3: get high 2 bits to make next 6-bit unit
-      c |= p[2] >> 6;
-
-      // concat 3rd 6-bit value
-      base64_concat(*this, c, linelen, maxlinelen);
-
-      // byte 3: concat final 6 bits
-      base64_concat(*this, p[2] & 63, linelen, maxlinelen);
-      p += 3;
+      assert(p == src);
    }
+   priv->len += elen + breaks * 2;
+   priv->buf[priv->len] = '\0';
 }
 
 void QoreString::concatBase64(const BinaryNode *b, qore_size_t maxlinelen) {
@@ -1869,23 +2021,16 @@ void QoreString::concatBase64(const char* bbuf, qore_size_t size) {
    concatBase64(bbuf, size, -1);
 }
 
-#define DO_HEX_CHAR(b) ((b) + (((b) > 9) ? 87 : 48))
-
 // FIXME: does not work with non-ASCII-compatible encodings such as UTF-16*
 void QoreString::concatHex(const char* binbuf, qore_size_t size) {
    //printf("priv->buf=%p, size=" QSD "\n", binbuf, size);
    if (!size)
       return;
 
-   unsigned char* p = (unsigned char*)binbuf;
-   unsigned char* endbuf = p + size;
-   while (p < endbuf) {
-      char c = (*p & 0xf0) >> 4;
-      concat(DO_HEX_CHAR(c));
-      c = *p & 0x0f;
-      concat(DO_HEX_CHAR(c));
-      p++;
-   }
+   priv->check_char(priv->len + size * 2);
+   q_hex_encode(priv->buf + priv->len, (const unsigned char*)binbuf, size);
+   priv->len += size * 2;
+   priv->buf[priv->len] = '\0';
 }
 
 int QoreString::concatEncode(ExceptionSink* xsink, const QoreString& str, unsigned code) {
@@ -2004,11 +2149,15 @@ void QoreString::concatDecodeUrl(const char* url) {
       return;
 
    while (*url) {
-      if (*url == '%' && isxdigit(*(url + 1)) && isxdigit(*(url + 2))) {
-         char x[3] = { *(url + 1), *(url + 2), '\0' };
-         char code = strtol(x, 0, 16);
-         concat(code);
-         url += 3;
+      qore_size_t run = strcspn(url, "%");
+      if (run) {
+         concat(url, run);
+         url += run;
+         continue;
+      }
+      int code = qore_string_private::getHex(url);
+      if (code >= 0) {
+         concat((char)code);
          continue;
       }
       concat(*url);
@@ -2027,6 +2176,12 @@ int QoreString::concatDecodeUrl(const QoreString& url_str, ExceptionSink* xsink)
    return priv->concatDecodeUriIntern(xsink, *str->priv);
 }
 
+static void concat_url_percent(QoreString& str, unsigned char c) {
+   static const char hex_digits[] = "0123456789ABCDEF";
+   char buf[3] = { '%', hex_digits[c >> 4], hex_digits[c & 15] };
+   str.concat(buf, 3);
+}
+
 // assume encoding according to http://tools.ietf.org/html/rfc3986#section-2.1
 int QoreString::concatEncodeUrl(ExceptionSink* xsink, const QoreString& url, bool encode_all) {
    assert(xsink);
@@ -2042,30 +2197,33 @@ int QoreString::concatEncodeUrl(ExceptionSink* xsink, const QoreString& url, boo
    if (*xsink)
       return -1;
 
+   unsigned char mask = URL_ENC_ALWAYS | (encode_all ? URL_ENC_RESERVED : 0);
    const unsigned char* p = (const unsigned char*)str->getBuffer();
-   while (*p) {
-      if ((*p) == '%')
-         concat("%25");
-      else if ((*p) == ' ')
-         concat("%20");
-      else if (*p > 127) {
-         qore_size_t len = q_UTF8_get_char_len((const char*)p, str->size() - ((const char*)p - str->getBuffer()));
+   while (true) {
+      // copy runs of characters that need no encoding in one step
+      const unsigned char* start = p;
+      while (!(url_enc_class[*p] & mask))
+         ++p;
+      if (p != start)
+         concat((const char*)start, p - start);
+      if (!*p)
+         break;
+
+      if (*p > 127) {
+         qore_offset_t len = q_UTF8_get_char_len((const char*)p, str->size() - ((const char*)p - str->getBuffer()));
          if (len <= 0) {
             xsink->raiseException("INVALID-ENCODING", "invalid UTF-8 encoding found in string");
             return -1;
          }
          // add UTF-8 percent-encoded characters
-         for (qore_size_t i = 0; i < len; ++i)
-            sprintf("%%%X", (unsigned)p[i]);
+         for (qore_offset_t i = 0; i < len; ++i)
+            concat_url_percent(*this, p[i]);
          p += len;
          continue;
       }
-      else if (encode_all && url_reserved.find(*p) != url_reserved.end()) {
-         sprintf("%%%X", (unsigned)*p);
-      }
-      else
-         concat(*p);
 
+      // '%', ' ' or a reserved character
+      concat_url_percent(*this, *p);
       ++p;
    }
 
@@ -2194,9 +2352,8 @@ void QoreString::concat(char c) {
 int QoreString::vsnprintf(size_t size, const char* fmt, va_list args) {
    // ensure minimum space is free
    if ((priv->allocated - priv->len) < (unsigned)size) {
-      priv->allocated += (size + STR_CLASS_EXTRA);
       // resize priv->buffer
-      priv->buf = (char*)realloc(priv->buf, priv->allocated * sizeof(char));
+      priv->resize_buf(priv->allocated + size + STR_CLASS_EXTRA);
    }
    // copy formatted string to priv->buffer
    int i = ::vsnprintf(priv->buf + priv->len, size, fmt, args);
@@ -2276,9 +2433,8 @@ int QoreString::substr_complex(QoreString* ns, qore_offset_t offset, qore_offset
     printd(5, "QoreString::substr_complex(offset=" QSD ", length=" QSD ") string=\"%s\" (this=%p priv->len=" QSD ")\n",
             offset, length, priv->buf, this, priv->len);
 
-    char* pend = priv->buf + priv->len;
     if (offset < 0) {
-        int clength = priv->getEncoding()->getLength(priv->buf, pend, xsink);
+        int clength = priv->getCharLength(0, xsink);
         if (*xsink)
             return -1;
 
@@ -2288,7 +2444,7 @@ int QoreString::substr_complex(QoreString* ns, qore_offset_t offset, qore_offset
             return -1;
     }
 
-    qore_size_t start = priv->getEncoding()->getByteLen(priv->buf, pend, offset, xsink);
+    qore_size_t start = priv->getCharByteLen(0, offset, xsink);
     if (*xsink)
         return -1;
 
@@ -2296,14 +2452,14 @@ int QoreString::substr_complex(QoreString* ns, qore_offset_t offset, qore_offset
         return -1;
 
     if (length < 0) {
-        length = priv->getEncoding()->getLength(priv->buf + start, pend, xsink) + length;
+        length = priv->getCharLength(start, xsink) + length;
         if (*xsink)
             return -1;
 
         if (length < 0)
             length = 0;
     }
-    qore_size_t end = priv->getEncoding()->getByteLen(priv->buf + start, pend, length, xsink);
+    qore_size_t end = priv->getCharByteLen(start, length, xsink);
     if (*xsink)
         return -1;
 
@@ -2314,9 +2470,8 @@ int QoreString::substr_complex(QoreString* ns, qore_offset_t offset, qore_offset
 int QoreString::substr_complex(QoreString* ns, qore_offset_t offset, ExceptionSink* xsink) const {
     assert(xsink);
     //printd(5, "QoreString::substr_complex(offset=" QSD ") string=\"%s\" (this=%p priv->len=" QSD ")\n", offset, priv->buf, this, priv->len);
-    char* pend = priv->buf + priv->len;
     if (offset < 0) {
-        qore_size_t clength = priv->getEncoding()->getLength(priv->buf, pend, xsink);
+        qore_size_t clength = priv->getCharLength(0, xsink);
         if (*xsink)
             return -1;
 
@@ -2328,7 +2483,7 @@ int QoreString::substr_complex(QoreString* ns, qore_offset_t offset, ExceptionSi
         }
     }
 
-    qore_size_t start = priv->getEncoding()->getByteLen(priv->buf, pend, offset, xsink);
+    qore_size_t start = priv->getCharByteLen(0, offset, xsink);
     if (*xsink)
         return -1;
 
@@ -2344,6 +2499,7 @@ int QoreString::substr_complex(QoreString* ns, qore_offset_t offset, ExceptionSi
 }
 
 void QoreString::splice_simple(qore_size_t offset, qore_size_t num, QoreString* extract) {
+   priv->invalidateCharIndex();
    //printd(5, "splice_intern(offset=" QSD ", num=" QSD ", priv->len=" QSD ")\n", offset, num, priv->len);
    qore_size_t end;
    if (num > (priv->len - offset)) {
@@ -2368,6 +2524,7 @@ void QoreString::splice_simple(qore_size_t offset, qore_size_t num, QoreString*
 }
 
 void QoreString::splice_simple(qore_size_t offset, qore_size_t num, const char* str, qore_size_t str_len, QoreString* extract) {
+   priv->invalidateCharIndex();
    //printd(5, "splice_intern(offset=" QSD ", num=" QSD ", priv->len=" QSD ")\n", offset, num, priv->len);
 
    qore_size_t end;
@@ -2402,6 +2559,7 @@ void QoreString::splice_simple(qore_size_t offset, qore_size_t num, const char*
 }
 
 void QoreString::splice_complex(qore_offset_t offset, ExceptionSink* xsink, QoreString* extract) {
+   priv->invalidateCharIndex();
    assert(xsink);
    // get length in chars
    qore_size_t clen = priv->getEncoding()->getLength(priv->buf, priv->buf + priv->len, xsink);
@@ -2432,6 +2590,7 @@ void QoreString::splice_complex(qore_offset_t offset, ExceptionSink* xsink, Qore
 }
 
 void QoreString::splice_complex(qore_offset_t offset, qore_offset_t num, ExceptionSink* xsink, QoreString* extract) {
+   priv->invalidateCharIndex();
    assert(xsink);
    //printd(5, "splice_complex(offset=" QSD ", num=" QSD ", priv->len=" QSD ")\n", offset, num, priv->len);
 
@@ -2491,6 +2650,7 @@ void QoreString::splice_complex(qore_offset_t offset, qore_offset_t num, Excepti
 }
 
 void QoreString::splice_complex(qore_offset_t offset, qore_offset_t num, const QoreString* str, ExceptionSink* xsink, QoreString* extract) {
+    priv->invalidateCharIndex();
     assert(xsink);
     // get length in chars
     qore_size_t clen = priv->getEncoding()->getLength(priv->buf, priv->buf + priv->len, xsink);
@@ -2652,7 +2812,7 @@ QoreString* QoreString::substr(qore_offset_t offset, qore_offset_t length, Excep
 qore_size_t QoreString::length() const {
    if (priv->getEncoding()->isMultiByte() && priv->buf) {
       bool invalid;
-      return priv->getEncoding()->getLength(priv->buf, priv->buf + priv->len, invalid);
+      return priv->getCharLength(0, invalid);
    }
    return priv->len;
 }
@@ -2733,6 +2893,7 @@ QoreString* QoreString::copy() const {
 
 // FIXME: does not work with non-ASCII-compatible encodings such as UTF-16*
 void QoreString::tolwr() {
+   priv->invalidateCharIndex();
    char* c = priv->buf;
    while (*c) {
       *c = ::tolower(*c);
@@ -2742,6 +2903,7 @@ void QoreString::tolwr() {
 
 // FIXME: does not work with non-ASCII-compatible encodings such as UTF-16*
 void QoreString::toupr() {
+   priv->invalidateCharIndex();
    char* c = priv->buf;
    while (*c) {
       *c = ::toupper(*c);
@@ -2780,6 +2942,7 @@ void QoreString::addch(char c, unsigned times) {
 
 // FIXME: does not work with non-ASCII-compatible encodings such as UTF-16*
 int QoreString::insertch(char c, qore_size_t pos, unsigned times) {
+    priv->invalidateCharIndex();
     //printd(5, "QoreString::insertch(c: %c pos: " QLLD " times: %d) this: %p\n", c, pos, times, this);
     if (pos > priv->len || !times)
         return -1;
@@ -2795,6 +2958,7 @@ int QoreString::insertch(char c, qore_size_t pos, unsigned times) {
 
 // FIXME: does not work with non-ASCII-compatible encodings such as UTF-16*
 int QoreString::insert(const char* str, qore_size_t pos) {
+    priv->invalidateCharIndex();
     if (pos > priv->len)
         return -1;
 
@@ -2825,7 +2989,7 @@ unsigned int QoreString::getUnicodePointFromUTF8(qore_offset_t offset) const {
     // get length in chars
     bool invalid;
     char* endp = priv->buf + priv->len;
-    qore_size_t clen = priv->getEncoding()->getLength(priv->buf, endp, invalid);
+    qore_size_t clen = priv->getCharLength(0, invalid);
     if (invalid)
         return -1;
 
@@ -2839,7 +3003,7 @@ unsigned int QoreString::getUnicodePointFromUTF8(qore_offset_t offset) const {
 
     // calculate byte offset
     if (offset) {
-        offset = priv->getEncoding()->getByteLen(priv->buf, endp, offset, invalid);
+        offset = priv->getCharByteLen(0, offset, invalid);
         if (invalid)
             return -1;
     }
@@ -2854,14 +3018,14 @@ unsigned int QoreString::getUnicodePointFromUTF8(qore_offset_t offset) const {
 unsigned int QoreString::getUnicodePoint(qore_offset_t offset, ExceptionSink* xsink) const {
     if (offset < 0) {
         // get string length in characters
-        qore_offset_t clen = (qore_offset_t)priv->getEncoding()->getLength(priv->buf, priv->buf + priv->len, xsink);
+        qore_offset_t clen = (qore_offset_t)priv->getCharLength(0, xsink);
         if (*xsink)
             return -1;
         offset = clen + offset;
         if (offset < 0)
             offset = 0;
     }
-    qore_size_t bl = priv->getEncoding()->getByteLen(priv->buf, priv->buf + priv->len, offset, xsink);
+    qore_size_t bl = priv->getCharByteLen(0, offset, xsink);
     if (*xsink)
         return -1;
 
@@ -2899,6 +3063,7 @@ void QoreString::trim_single_trailing(char c) {
 
 // remove leading char
 void QoreString::trim_leading(char c) {
+    priv->invalidateCharIndex();
     if (!priv->len)
         return;
 
@@ -2914,6 +3079,7 @@ void QoreString::trim_leading(char c) {
 
 // remove single leading char
 void QoreString::trim_single_leading(char c) {
+    priv->invalidateCharIndex();
     if (priv->len && priv->buf[0] == c) {
         memmove(priv->buf, priv->buf + 1, priv->len);
         priv->len -= 1;
@@ -2957,6 +3123,7 @@ void QoreString::trim_trailing(const char* chars) {
 
 // remove leading char
 void QoreString::trim_leading(const char* chars) {
+    priv->invalidateCharIndex();
     if (!priv->len)
         return;
 
@@ -3077,6 +3244,7 @@ void QoreString::prepend(const char* str) {
 }
 
 void QoreString::prepend(const char* str, qore_size_t size) {
+   priv->invalidateCharIndex();
    priv->check_char(priv->len + size + 1);
    // move memory forward
    memmove((char*)priv->buf + size, priv->buf, priv->len + 1);
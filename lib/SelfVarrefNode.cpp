@@ -29,6 +29,9 @@
 */
 
 #include <qore/Qore.h>
+#include "qore/intern/QoreClassIntern.h"
+#include "qore/intern/QoreObjectIntern.h"
+#include "qore/intern/QoreHashNodeIntern.h"
 
 // get string representation (for %n and %N), foff is for multi-line formatting offset, -1 = no line breaks
 // the ExceptionSink is only needed for QoreObject where a method may be executed
@@ -52,11 +55,38 @@ const char* SelfVarrefNode::getTypeName() const {
     return "in-object variable reference";
 }
 
+const SelfVarrefNode::MemberSlot* SelfVarrefNode::getMemberSlot(const QoreObject& obj, const qore_class_private* class_ctx) const {
+    if (!declared) {
+        return nullptr;
+    }
+
+    const qore_class_private* cls = qore_class_private::get(*obj.getClass());
+    MemberSlot* ms = member_slot.load(std::memory_order_acquire);
+    if (!ms) {
+        // resolve the member with the normal access rules for the first object class seen
+        const QoreTypeInfo* typeInfo = nullptr;
+        unsigned slot = cls->runtimeGetMemberSlot(str, class_ctx, typeInfo);
+        ms = new MemberSlot{cls, class_ctx, cls->getShape(), typeInfo, slot};
+        MemberSlot* current = nullptr;
+        if (!member_slot.compare_exchange_strong(current, ms, std::memory_order_acq_rel)) {
+            delete ms;
+            ms = current;
+        }
+    }
+
+    return (ms->cls == cls && ms->class_ctx == class_ctx && ms->slot != QORE_HASH_NO_SLOT) ? ms : nullptr;
+}
+
 QoreValue SelfVarrefNode::evalImpl(bool& needs_deref, ExceptionSink* xsink) const {
-    assert(runtime_get_stack_object());
+    QoreObject* obj = runtime_get_stack_object();
+    assert(obj);
     assert(needs_deref);
+    // declared members are read from their slot without a key lookup
+    const MemberSlot* ms = getMemberSlot(*obj, runtime_get_class());
     // issue 3523: evaluate in case the value is a reference
-    ValueHolder val(runtime_get_stack_object()->getReferencedMemberNoMethod(str, xsink), xsink);
+    ValueHolder val(ms
+        ? qore_object_private::get(*obj)->getReferencedMemberSlot(ms->shape, ms->slot, str, xsink)
+        : obj->getReferencedMemberNoMethod(str, xsink), xsink);
     // the value here must always require a dereference
     return val->needsEval() ? val->eval(xsink) : val.release();
 }
@@ -76,7 +106,11 @@ void SelfVarrefNode::parseInitImpl(QoreValue& val, LocalVar* oflag, int pflag, i
     if (!oflag)
         parse_error(*loc, "cannot reference member \"%s\" when not in an object context", str);
     else {
-        qore_class_private::parseCheckInternalMemberAccess(parse_get_class(), str, typeInfo, loc);
+        if (!qore_class_private::parseCheckInternalMemberAccess(parse_get_class(), str, typeInfo, loc)) {
+            const qore_class_private* qc;
+            ClassAccess access;
+            declared = (bool)qore_class_private::get(*parse_get_class())->parseFindMember(str, qc, access);
+        }
         returnTypeInfo = typeInfo;
     }
 }
@@ -35,6 +35,7 @@
 #include "qore/intern/qore_program_private.h"
 #include "qore/intern/QoreParseHashNode.h"
 #include "qore/intern/QoreHashNodeIntern.h"
+#include "qore/intern/QoreCallSiteCache.h"
 
 bool HashDeclMemberInfo::equal(const HashDeclMemberInfo& other) const {
     return QoreTypeInfo::equal(typeInfo, other.typeInfo);
@@ -70,6 +71,38 @@ void HashDeclMemberInfo::parseInit(const char* name, bool priv) {
     }
 }
 
+typed_hash_decl_private::~typed_hash_decl_private() {
+    // call sites may have cached variants resolved for hashes of this type
+    qore_call_site_cache_invalidate();
+    delete typeInfo;
+    delete orNothingTypeInfo;
+    HashShape* s = shape.load();
+    if (s) {
+        s->deref();
+    }
+}
+
+const HashShape* typed_hash_decl_private::getShape() const {
+    HashShape* s = shape.load(std::memory_order_acquire);
+    if (s) {
+        return s;
+    }
+
+    s = new HashShape;
+    for (auto& i : members.member_list) {
+        s->addKey(i.first);
+    }
+    s->finalize();
+
+    // another thread may have created the shape in the meantime
+    HashShape* current = nullptr;
+    if (!shape.compare_exchange_strong(current, s, std::memory_order_acq_rel)) {
+        s->deref();
+        return current;
+    }
+    return s;
+}
+
 // NOTE: the new namespace will be set manually after this call
 typed_hash_decl_private::typed_hash_decl_private(const typed_hash_decl_private& old, TypedHashDecl* thd) :
     loc(old.loc),
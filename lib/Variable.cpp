@@ -118,9 +118,44 @@ const char* Var::getName() const {
     return name.c_str();
 }
 
+bool Var::evalAtomic(QoreValue& rv) const {
+    qore_var_rwlock_priv* l = qore_var_rwlock_priv::get(rwl);
+    unsigned s = l->readBegin();
+    if (s & 1)
+        return false;
+
+    // the value type is fixed; the value itself can only be changed by a writer or with an atomic operation
+    if (val.assigned) {
+        switch (val.type) {
+            case QV_Int:
+                rv = __atomic_load_n(&val.v.i, __ATOMIC_RELAXED);
+                break;
+            case QV_Float: {
+                double f;
+                __atomic_load(&val.v.f, &f, __ATOMIC_RELAXED);
+                rv = f;
+                break;
+            }
+            case QV_Bool:
+                rv = __atomic_load_n(&val.v.b, __ATOMIC_RELAXED);
+                break;
+            default:
+                assert(false);
+        }
+    }
+
+    return l->readValidate(s);
+}
+
 QoreValue Var::eval() const {
     if (val.type == QV_Ref)
         return val.v.getPtr()->eval();
+    // typed int, float, and bool values are read without the lock unless a writer holds it
+    if (val.fixed_type) {
+        QoreValue rv;
+        if (evalAtomic(rv))
+            return rv;
+    }
     QoreAutoVarRWReadLocker al(rwl);
     if (val.getType() == NT_WEAKREF) {
         return static_cast<WeakReferenceNode*>(val.v.n)->get()->refSelf();
@@ -128,6 +163,48 @@ QoreValue Var::eval() const {
     return val.getReferencedValue();
 }
 
+int Var::atomicAddBigInt(int64 i, int64& old_val) {
+    if (val.type == QV_Ref)
+        return val.v.isReadOnly() ? -1 : val.v.getPtr()->atomicAddBigInt(i, old_val);
+    if (val.type != QV_Int)
+        return -1;
+
+    qore_var_rwlock_priv* l = qore_var_rwlock_priv::get(rwl);
+    if (!l->atomicBegin())
+        return -1;
+    // the assigned and finalized flags can only change with the write lock held
+    int rc = -1;
+    if (val.assigned && !finalized) {
+        old_val = __atomic_fetch_add(&val.v.i, i, __ATOMIC_RELAXED);
+        rc = 0;
+    }
+    l->atomicEnd();
+    return rc;
+}
+
+int Var::atomicAddFloat(double f, double& old_val) {
+    if (val.type == QV_Ref)
+        return val.v.isReadOnly() ? -1 : val.v.getPtr()->atomicAddFloat(f, old_val);
+    if (val.type != QV_Float)
+        return -1;
+
+    qore_var_rwlock_priv* l = qore_var_rwlock_priv::get(rwl);
+    if (!l->atomicBegin())
+        return -1;
+    // the assigned and finalized flags can only change with the write lock held
+    int rc = -1;
+    if (val.assigned && !finalized) {
+        double nv;
+        __atomic_load(&val.v.f, &old_val, __ATOMIC_RELAXED);
+        do {
+            nv = old_val + f;
+        } while (!__atomic_compare_exchange(&val.v.f, &old_val, &nv, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        rc = 0;
+    }
+    l->atomicEnd();
+    return rc;
+}
+
 void Var::deref(ExceptionSink* xsink) {
     //printd(5, "Var::deref() this: %p '%s' %d -> %d\n", this, getName(), reference_count(), reference_count() - 1);
     if (ROdereference()) {
@@ -483,7 +560,12 @@ int LValueHelper::doLValue(const QoreValue n, bool for_remove) {
         ocvec.clear();
         clearPtr();
 
-        if (qore_object_private::getLValue(*obj, v->str, *this, runtime_get_class(), for_remove, vl.xsink)) {
+        // declared members are accessed by their slot without a key lookup
+        const qore_class_private* class_ctx = runtime_get_class();
+        const SelfVarrefNode::MemberSlot* ms = v->getMemberSlot(*obj, class_ctx);
+        if (ms
+            ? qore_object_private::getLValueSlot(*obj, ms->shape, ms->slot, v->str, ms->typeInfo, *this, for_remove, vl.xsink)
+            : qore_object_private::getLValue(*obj, v->str, *this, class_ctx, for_remove, vl.xsink)) {
             // here the object has already been cleared above
             return -1;
         }
@@ -552,6 +634,20 @@ void LValueHelper::set(QoreVarRWLock& rwl) {
     vl.set(&rwl);
 }
 
+int LValueHelper::atomicAddBigInt(const QoreValue exp, int64 i, int64& old_val) {
+    if (exp.getType() != NT_VARREF)
+        return -1;
+    Var* var = exp.get<const VarRefNode>()->getGlobalVar();
+    return var ? var->atomicAddBigInt(i, old_val) : -1;
+}
+
+int LValueHelper::atomicAddFloat(const QoreValue exp, double f, double& old_val) {
+    if (exp.getType() != NT_VARREF)
+        return -1;
+    Var* var = exp.get<const VarRefNode>()->getGlobalVar();
+    return var ? var->atomicAddFloat(f, old_val) : -1;
+}
+
 QoreValue LValueHelper::getReferencedValue() const {
     if (val)
         return val->getReferencedValue();
@@ -485,6 +485,24 @@ const QoreEncoding* QoreEncodingManager::findCreate(const QoreString* str) {
    return findCreate(str->getBuffer());
 }
 
+qore_size_t q_ascii_prefix_len(const char* p, qore_size_t len) {
+    const char* s = p;
+    const char* end = p + len;
+    // check 8 bytes at a time for any byte with the high bit set
+    while (end - s >= 8) {
+        uint64_t w;
+        memcpy(&w, s, sizeof w);
+        if (w & 0x8080808080808080ULL) {
+            break;
+        }
+        s += 8;
+    }
+    while (s < end && !(*s & 0x80)) {
+        ++s;
+    }
+    return s - p;
+}
+
 qore_offset_t q_UTF8_get_char_len(const char* p, qore_size_t len) {
     // see if a multi-byte char is starting
     if ((*p & 0xc0) == 0xc0) {
@@ -525,6 +543,13 @@ qore_offset_t q_UTF8_get_char_len(const char* p, qore_size_t len) {
 static qore_size_t UTF8_getLength(const char* p, const char* end, bool& invalid) {
     qore_size_t i = 0;
     while (p < end) {
+        // skip ASCII characters a word at a time
+        qore_size_t run = q_ascii_prefix_len(p, end - p);
+        if (run) {
+            p += run;
+            i += run;
+            continue;
+        }
         qore_offset_t l = q_UTF8_get_char_len(p, end - p);
         if (l <= 0) {
             invalid = true;
@@ -541,6 +566,14 @@ static qore_size_t UTF8_getLength(const char* p, const char* end, bool& invalid)
 static qore_size_t UTF8_getByteLen(const char* p, const char* end, qore_size_t l, bool& invalid) {
     qore_size_t b = 0;
     while ((p < end) && l) {
+        // skip ASCII characters a word at a time
+        qore_size_t run = q_ascii_prefix_len(p, QORE_MIN((qore_size_t)(end - p), l));
+        if (run) {
+            b += run;
+            p += run;
+            l -= run;
+            continue;
+        }
         qore_offset_t bl = q_UTF8_get_char_len(p, end - p);
         if (bl <= 0) {
             invalid = true;
@@ -557,6 +590,13 @@ static qore_size_t UTF8_getByteLen(const char* p, const char* end, qore_size_t l
 static qore_size_t UTF8_getCharPos(const char* p, const char* end, bool& invalid) {
     qore_size_t i = 0;
     while (p < end) {
+        // skip ASCII characters a word at a time
+        qore_size_t run = q_ascii_prefix_len(p, end - p);
+        if (run) {
+            p += run;
+            i += run;
+            continue;
+        }
         qore_offset_t l = q_UTF8_get_char_len(p, end - p);
         if (l <= 0) {
             invalid = true;
@@ -35,6 +35,8 @@
 
 #include "qore/intern/QoreSignal.h"
 #include "qore/intern/ModuleInfo.h"
+#include "qore/intern/QoreParallelPool.h"
+#include "qore/intern/QoreRegexCache.h"
 
 #include <cerrno>
 #include <csignal>
@@ -198,6 +200,9 @@ void qore_cleanup() {
     // set shutdown flag for external modules
     qore_shutdown.store(true, std::memory_order_relaxed);
 
+    // stop the parallel list function thread pool
+    qore_parallel_pool.del();
+
     // purge thread resources before deleting modules
     {
         ExceptionSink xsink;
@@ -220,6 +225,9 @@ void qore_cleanup() {
     // delete all loadable modules
     QMM.cleanup();
 
+    // free cached regular expressions
+    qore_regex_cache.clear();
+
     // issue #3045: clear module options
     qore_delete_module_options();
 
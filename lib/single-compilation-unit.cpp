@@ -133,6 +133,9 @@
 #include "ManagedDatasource.cpp"
 #include "SQLStatement.cpp"
 #include "QoreSQLStatement.cpp"
+#include "QoreSQLResultBlock.cpp"
+#include "QoreStatementCache.cpp"
+#include "QoreCallSiteCache.cpp"
 #include "ExecArgList.cpp"
 #include "CallReferenceNode.cpp"
 #include "NamedScope.cpp"
@@ -141,11 +144,16 @@
 #include "QoreSSLCertificate.cpp"
 #include "QoreSSLPrivateKey.cpp"
 #include "QoreSocketObject.cpp"
+#include "QoreSocketPoller.cpp"
+#include "QoreFuture.cpp"
+#include "QoreParallelPool.cpp"
 #include "QoreCondition.cpp"
 #include "QoreQueue.cpp"
 #include "QoreQueueHelper.cpp"
 #include "QoreRegex.cpp"
 #include "QoreRegexBase.cpp"
+#include "QoreRegexCache.cpp"
+#include "MmapInputStream.cpp"
 #include "QoreRegexSubst.cpp"
 #include "QoreTransliteration.cpp"
 #include "Sequence.cpp"
@@ -243,6 +251,7 @@
 #include "FunctionalOperator.cpp"
 #include "StreamPipe.cpp"
 #include "CompressionTransforms.cpp"
+#include "EncodingTransforms.cpp"
 #include "EncryptionTransforms.cpp"
 #include "Transform.cpp"
 #include "QoreSerializable.cpp"
@@ -267,6 +276,7 @@
 #include "qc_errno.cpp"
 #include "qc_qore.cpp"
 #include "QC_Socket.cpp"
+#include "QC_SocketPoller.cpp"
 #include "QC_ProgramControl.cpp"
 #include "QC_Program.cpp"
 #include "QC_DebugProgram.cpp"
@@ -305,12 +315,14 @@
 #include "QC_InputStreamLineIterator.cpp"
 #include "QC_SingleValueIterator.cpp"
 #include "QC_RangeIterator.cpp"
+#include "QC_Future.cpp"
 #include "QC_ThreadPool.cpp"
 #include "QC_AbstractDatasource.cpp"
 #include "QC_AbstractSQLStatement.cpp"
 #include "QC_Datasource.cpp"
 #include "QC_DatasourcePool.cpp"
 #include "QC_SQLStatement.cpp"
+#include "QC_SQLResultBlock.cpp"
 #include "QC_Queue.cpp"
 #include "QC_Mutex.cpp"
 #include "QC_Condition.cpp"
@@ -335,6 +347,7 @@
 #include "QC_BinaryInputStream.cpp"
 #include "QC_StringInputStream.cpp"
 #include "QC_FileInputStream.cpp"
+#include "QC_MmapInputStream.cpp"
 #include "QC_EncodingConversionInputStream.cpp"
 #include "QC_EncodingConversionOutputStream.cpp"
 #include "QC_OutputStream.cpp"
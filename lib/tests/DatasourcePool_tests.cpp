@@ -0,0 +1,94 @@
+// Unit tests for DatasourcePool.cpp
+
+#ifdef DEBUG
+namespace DatasourcePool_tests {
+
+static int ds_data;
+
+static int test_open(Datasource* ds, ExceptionSink* xsink) {
+  ds->setQoreEncoding(QCS_UTF8);
+  ds->setPrivateData(&ds_data);
+  return 0;
+}
+
+static int test_close(Datasource* ds) {
+  ds->setPrivateData(nullptr);
+  return 0;
+}
+
+static QoreValue test_select(Datasource* ds, const QoreString* str, const QoreListNode* args, ExceptionSink* xsink) {
+  return QoreValue();
+}
+
+static int test_commit(Datasource* ds, ExceptionSink* xsink) {
+  return 0;
+}
+
+static int64 get_info(const QoreHashNode* h, const char* key) {
+  bool found;
+  QoreValue v = h->getKeyValueExistence(key, found);
+  assert(found);
+  return v.getAsBigInt();
+}
+
+TEST()
+{
+  printf("testing DatasourcePool connection allocation\n");
+  qore_dbi_method_list methods;
+  methods.add(QDBI_METHOD_OPEN, test_open);
+  methods.add(QDBI_METHOD_CLOSE, test_close);
+  methods.add(QDBI_METHOD_SELECT, test_select);
+  methods.add(QDBI_METHOD_SELECT_ROWS, test_select);
+  methods.add(QDBI_METHOD_EXEC, test_select);
+  methods.add(QDBI_METHOD_COMMIT, test_commit);
+  methods.add(QDBI_METHOD_ROLLBACK, test_commit);
+  DBIDriver* drv = DBI.registerDriver("dspool-test", methods, 0);
+
+  ExceptionSink xsink;
+  DatasourcePool* pool = new DatasourcePool(&xsink, drv, "user", "pass", "db", nullptr, nullptr, 1, 2);
+  assert(!xsink);
+
+  // the first allocation finds the connection opened by the constructor free
+  pool->beginTransaction(&xsink);
+  assert(!xsink);
+  assert(pool->inTransaction());
+  {
+    ReferenceHolder<QoreHashNode> h(pool->getUsageInfo(), &xsink);
+    assert(get_info(*h, "in_use") == 1);
+    assert(get_info(*h, "connections") == 1);
+    assert(!get_info(*h, "stats_affinity"));
+  }
+
+  // committing the transaction releases the connection to the pool
+  pool->commit(&xsink);
+  assert(!xsink);
+  assert(!pool->inTransaction());
+
+  // the thread gets its previous connection back
+  pool->beginTransaction(&xsink);
+  assert(!xsink);
+  pool->rollback(&xsink);
+  assert(!xsink);
+
+  {
+    ReferenceHolder<QoreHashNode> h(pool->getUsageInfo(), &xsink);
+    assert(!get_info(*h, "in_use"));
+    assert(!get_info(*h, "waiting"));
+    assert(get_info(*h, "stats_affinity") == 1);
+    assert(get_info(*h, "stats_reqs") == get_info(*h, "stats_hits"));
+    assert(h->getKeyValue("hit_rate").getAsFloat() == 1.0);
+    const QoreHashNode* wh = h->getKeyValue("wait_histogram").get<const QoreHashNode>();
+    assert(wh->size() == DSP_WAIT_BUCKETS);
+    assert(!get_info(wh, "1ms"));
+  }
+
+  pool->destructor(&xsink);
+  assert(!xsink);
+  pool->deref(&xsink);
+  assert(!xsink);
+}
+
+} // namespace
+#endif // DEBUG
+
+// EOF
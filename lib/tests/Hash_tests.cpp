@@ -1,6 +1,9 @@
-// Unit tests for Hash.cc. 
+// Unit tests for Hash.cc.
 
 #ifdef DEBUG
+#include <list>
+#include <unordered_map>
+
 namespace  Hash_tests {
 
 TEST()
@@ -8,17 +11,221 @@ TEST()
   printf("testing QoreHashNode::derefAndDelete()\n");
   ExceptionSink xsink;
   QoreHashNode* h = new QoreHashNode;
-  h->derefAndDelete(&xsink);
+  h->deref(&xsink);
   assert(!xsink);
 
   h = new QoreHashNode;
-  h->setKeyValue("aaa", new AbstractQoreNode(true), &xsink);
+  h->setKeyValue("aaa", true, &xsink);
+  assert(!xsink);
+  h->setKeyValue("bbbb", 1.1, &xsink);
+  assert(!xsink);
+  h->setKeyValue("bbb", 0.0, &xsink); // the same key
+  h->deref(&xsink);
   assert(!xsink);
-  h->setKeyValue("bbbb", new AbstractQoreNode(1.1), &xsink);
+}
+
+TEST()
+{
+  printf("testing QoreHashNode member order with linear and indexed storage\n");
+  ExceptionSink xsink;
+  QoreHashNode* h = new QoreHashNode;
+  // empty hashes allocate no member storage
+  assert(!qore_hash_private::get(*h)->member_list.getBlockCount());
+  char key[20];
+  for (int i = 0; i < 100; ++i) {
+    sprintf(key, "key-%d", i);
+    h->setKeyValue(key, i, &xsink);
+    // small hashes are searched linearly without an index
+    assert(h->size() > QORE_HASH_LINEAR_MEMBERS || !qore_hash_private::get(*h)->member_list.hasIndex());
+    assert(h->size() > QORE_HASH_FIRST_BLOCK || qore_hash_private::get(*h)->member_list.getBlockCount() == 1);
+  }
+  assert(qore_hash_private::get(*h)->member_list.hasIndex());
+
+  // remove every other key and add them again; they must be appended in the new order
+  for (int i = 0; i < 100; i += 2) {
+    sprintf(key, "key-%d", i);
+    h->removeKey(key, &xsink);
+  }
+  assert(h->size() == 50);
+  for (int i = 0; i < 100; i += 2) {
+    sprintf(key, "key-%d", i);
+    h->setKeyValue(key, i, &xsink);
+  }
+  assert(h->size() == 100);
+
+  int n = 0;
+  ConstHashIterator hi(h);
+  while (hi.next()) {
+    int i = n < 50 ? n * 2 + 1 : (n - 50) * 2;
+    sprintf(key, "key-%d", i);
+    assert(!strcmp(hi.getKey(), key));
+    assert(hi.get().getAsBigInt() == i);
+    ++n;
+  }
+  assert(n == 100);
+
+  ReverseConstHashIterator rhi(h);
+  assert(rhi.next());
+  assert(!strcmp(rhi.getKey(), "key-98"));
+
+  // delete all keys while iterating
+  HashIterator dhi(h);
+  while (dhi.next()) {
+    dhi.deleteKey(&xsink);
+  }
+  assert(h->empty());
+  assert(!h->getFirstKey());
+  h->deref(&xsink);
+  assert(!xsink);
+}
+
+TEST()
+{
+  printf("testing QoreHashNode member storage with a shared key shape\n");
+  HashShape* shape = new HashShape;
+  char key[20];
+  for (int i = 0; i < 12; ++i) {
+    sprintf(key, "member-%d", i);
+    assert(shape->addKey(key) == (unsigned)i);
+  }
+  shape->finalize();
+
+  ExceptionSink xsink;
+  QoreHashNode* h = new QoreHashNode;
+  qore_hash_private* hp = qore_hash_private::get(*h);
+  hp->member_list.setShape(shape);
+  shape->deref();
+
+  // keys are added in a different order than the shape order and mixed with dynamic keys
+  h->setKeyValue("dynamic-1", 100, &xsink);
+  for (int i = 11; i >= 0; --i) {
+    sprintf(key, "member-%d", i);
+    h->setKeyValue(key, i, &xsink);
+  }
+  h->setKeyValue("dynamic-2", 200, &xsink);
+  assert(h->size() == 14);
+  assert(!strcmp(h->getFirstKey(), "dynamic-1"));
+  assert(!strcmp(h->getLastKey(), "dynamic-2"));
+
+  // shape members share the key with the shape and can be accessed by slot
+  for (unsigned i = 0; i < shape->size(); ++i) {
+    HashMember* m = hp->member_list.getShapeMember(i);
+    assert(m);
+    assert(m->key.c_str() == shape->getKey(i).c_str());
+    assert(m->val.getAsBigInt() == (int64)i);
+  }
+  assert(h->getKeyValue("dynamic-2").getAsBigInt() == 200);
+
+  h->removeKey("member-3", &xsink);
+  assert(!hp->member_list.getShapeMember(3));
+  assert(!h->existsKey("member-3"));
+  h->setKeyValue("member-3", 3, &xsink);
+  assert(!strcmp(h->getLastKey(), "member-3"));
+  assert(hp->member_list.getShapeMember(3)->val.getAsBigInt() == 3);
+
+  // copies without a hashdecl use generic storage
+  QoreHashNode* c = h->copy();
+  assert(!qore_hash_private::get(*c)->member_list.getShape());
+  assert(!c->compareHard(h, &xsink));
+  c->deref(&xsink);
+  h->deref(&xsink);
   assert(!xsink);
-  h->setKeyValue("bbb", new AbstractQoreNode(0.0), &xsink); // the same key
-  h->derefAndDelete(&xsink);
+}
+
+// emulation of the former member storage: a list of heap-allocated members plus a separate map index
+class LegacyMember {
+public:
+  QoreValue val;
+  std::string key;
+
+  LegacyMember(const char* key) : key(key) {
+  }
+};
+
+static size_t legacy_allocs = 0;
+
+template <typename T>
+class CountingAllocator : public std::allocator<T> {
+public:
+  template <typename U>
+  struct rebind {
+    typedef CountingAllocator<U> other;
+  };
+
+  CountingAllocator() {
+  }
+
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {
+  }
+
+  T* allocate(size_t n) {
+    ++legacy_allocs;
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+typedef std::list<LegacyMember*, CountingAllocator<LegacyMember*>> legacy_list_t;
+typedef std::unordered_map<const char*, legacy_list_t::iterator, qore_hash_str, eqstr,
+  CountingAllocator<std::pair<const char* const, legacy_list_t::iterator>>> legacy_map_t;
+
+TEST()
+{
+  printf("benchmarking small hash creation and lookups\n");
+  static const char* keys[] = {"id", "name", "status", "created", "amount"};
+  static const int num_keys = sizeof(keys) / sizeof(const char*);
+  static const int iters = 100000;
+
+  ExceptionSink xsink;
+  int64 sum = 0;
+
+  // legacy layout
+  int64 start = q_clock_getmicros();
+  for (int i = 0; i < iters; ++i) {
+    legacy_list_t l;
+    legacy_map_t m;
+    for (int k = 0; k < num_keys; ++k) {
+      LegacyMember* om = new LegacyMember(keys[k]);
+      ++legacy_allocs;
+      om->val = i + k;
+      l.push_back(om);
+      legacy_list_t::iterator li = l.end();
+      --li;
+      m[om->key.c_str()] = li;
+    }
+    for (int k = 0; k < num_keys; ++k) {
+      sum += (*m.find(keys[k])->second)->val.getAsBigInt();
+    }
+    for (auto& om : l) {
+      delete om;
+    }
+  }
+  int64 legacy_us = q_clock_getmicros() - start;
+
+  // current layout; each member block needs one allocation, and the block vector one more if there are any
+  // blocks after the first
+  int64 new_blocks = 0;
+  start = q_clock_getmicros();
+  for (int i = 0; i < iters; ++i) {
+    QoreHashNode* h = new QoreHashNode;
+    for (int k = 0; k < num_keys; ++k) {
+      h->setKeyValue(keys[k], i + k, &xsink);
+    }
+    assert(!qore_hash_private::get(*h)->member_list.hasIndex());
+    new_blocks += qore_hash_private::get(*h)->member_list.getBlockCount();
+    for (int k = 0; k < num_keys; ++k) {
+      sum -= h->getKeyValue(keys[k]).getAsBigInt();
+    }
+    h->deref(&xsink);
+  }
+  int64 new_us = q_clock_getmicros() - start;
+  assert(!sum);
   assert(!xsink);
+
+  printf("  %d-key hashes x %d: legacy storage %lld us (%.1f allocations per hash excluding the hash itself), "
+    "current storage %lld us (%.1f member blocks per hash; sizeof(qore_hash_private): %d)\n", num_keys, iters,
+    (long long)legacy_us, (double)legacy_allocs / iters, (long long)new_us, (double)new_blocks / iters,
+    (int)sizeof(qore_hash_private));
 }
 
 } // namespace
@@ -17,6 +17,34 @@ TEST()
   assert(!xsink);
 }
 
+TEST()
+{
+  printf("testing QoreListNode slot allocation\n");
+  ExceptionSink xsink;
+  QoreListNode* l = new QoreListNode(autoTypeInfo);
+  for (int i = 0; i < 10; ++i) {
+    l->push(i, &xsink);
+  }
+  const qore_list_private* lp = qore_list_private::get(*l);
+  assert(lp->allocated >= 10 && lp->allocated <= 10 + LIST_PAD);
+
+  // reserving the allocated size does not reallocate
+  QoreListNode* c = l->copy();
+  qore_list_private* cp = qore_list_private::get(*c);
+  size_t allocated = cp->allocated;
+  const QoreValue* entry = cp->entry;
+  cp->reserve(allocated);
+  assert(cp->allocated == allocated);
+  assert(cp->entry == entry);
+  c->push(10, &xsink);
+  assert(c->size() == 11);
+  assert(c->retrieveEntry(10).getAsBigInt() == 10);
+
+  c->deref(&xsink);
+  l->deref(&xsink);
+  assert(!xsink);
+}
+
 } // namespace
 #endif // DEBUG
 
@@ -1,6 +1,8 @@
 // Unit tests for QoreString.cc
 
 #ifdef DEBUG
+#include <memory>
+
 namespace QoreString_tests {
 
 TEST()
@@ -92,6 +94,433 @@ TEST()
   assert(s2.length() == 0);
 }
 
+TEST()
+{
+  printf("testing QoreString inline storage for short strings\n");
+  QoreString s;
+  qore_string_private* p = qore_string_private::get(s);
+  assert(p->isInline());
+  for (int i = 0; i < QORE_STRING_INLINE_SIZE - 1; ++i) {
+    s.concat('a');
+  }
+  assert(p->isInline());
+  assert(s.size() == QORE_STRING_INLINE_SIZE - 1);
+
+  // the string is moved to the heap when it grows
+  s.concat("bcd");
+  assert(!p->isInline());
+  assert(!strcmp(s.c_str() + QORE_STRING_INLINE_SIZE - 1, "bcd"));
+
+  QoreString c(s);
+  assert(!qore_string_private::get(c)->isInline());
+  assert(c == s);
+
+  // short copies and substrings use the inline buffer
+  ExceptionSink xsink;
+  std::unique_ptr<QoreString> sub(s.substr(-3, &xsink));
+  assert(!xsink);
+  assert(qore_string_private::get(*sub)->isInline());
+  assert(*sub == "bcd");
+
+  // giveBuffer() returns an allocated buffer for inline strings and leaves the string empty
+  QoreString g("xyz");
+  assert(qore_string_private::get(g)->isInline());
+  char* b = g.giveBuffer();
+  assert(!strcmp(b, "xyz"));
+  free(b);
+  assert(g.empty());
+  assert(!strcmp(g.c_str(), ""));
+  g.sprintf("%d-%s", 10, "abc");
+  assert(g == "10-abc");
+  assert(qore_string_private::get(g)->isInline());
+
+  s.reset();
+  assert(p->isInline());
+  assert(s.empty());
+  s.take(strdup("taken"));
+  assert(!p->isInline());
+  assert(s == "taken");
+  s.take(nullptr);
+  assert(p->isInline());
+  assert(s.empty());
+}
+
+// emulates the former string layout where the string buffer was always allocated on the heap
+static void force_heap(QoreString& str) {
+  str.reserve(QORE_STRING_INLINE_SIZE + 1);
+}
+
+static int64 bench_short_strings(bool heap, int iters) {
+  static const char* vals[] = {"id", "status", "OK", "2020-01-01", "customer_name", "a1b2c3d4"};
+  static const int num_vals = sizeof(vals) / sizeof(const char*);
+
+  ExceptionSink xsink;
+  size_t total = 0;
+  int64 start = q_clock_getmicros();
+  for (int i = 0; i < iters; ++i) {
+    for (int v = 0; v < num_vals; ++v) {
+      QoreString str(vals[v]);
+      if (heap) {
+        force_heap(str);
+      }
+      // concat
+      str.concat('-');
+      str.concat(vals[(v + 1) % num_vals]);
+      // substr
+      QoreString* sub = str.substr(1, 4, &xsink);
+      if (heap) {
+        force_heap(*sub);
+      }
+      // toupper
+      sub->toupr();
+      total += str.size() + sub->size();
+      delete sub;
+    }
+  }
+  assert(!xsink);
+  assert(total);
+  return q_clock_getmicros() - start;
+}
+
+TEST()
+{
+  printf("benchmarking short string concat, substr and toupper\n");
+  static const int iters = 100000;
+  int64 heap_us = bench_short_strings(true, iters);
+  int64 inline_us = bench_short_strings(false, iters);
+  printf("  6 strings x %d: heap buffers %lld us, inline buffers %lld us\n", iters, (long long)heap_us,
+    (long long)inline_us);
+}
+
+// returns the substring at the given character offset by scanning the string from the start
+static std::string char_at(const QoreString& str, qore_size_t c) {
+  const char* p = str.c_str();
+  const char* end = p + str.size();
+  for (qore_size_t i = 0; i < c && p < end; ++i) {
+    p += q_UTF8_get_char_len(p, end - p);
+  }
+  if (p == end)
+    return std::string();
+  return std::string(p, q_UTF8_get_char_len(p, end - p));
+}
+
+static void check_chars(const QoreString& str, qore_size_t clen) {
+  ExceptionSink xsink;
+  assert(str.length() == clen);
+  for (qore_size_t i = 0; i <= clen; ++i) {
+    std::unique_ptr<QoreString> c(str.substr(i, 1, &xsink));
+    assert(!xsink);
+    if (i == clen) {
+      assert(!c.get());
+    } else {
+      assert(*c == char_at(str, i));
+      // negative offsets count from the end of the string
+      std::unique_ptr<QoreString> nc(str.substr((qore_offset_t)i - (qore_offset_t)clen, 1, &xsink));
+      assert(*nc == *c);
+    }
+  }
+}
+
+TEST()
+{
+  printf("testing the QoreString character index\n");
+  // a string with single-byte, 2-byte, 3-byte and 4-byte UTF-8 characters
+  QoreString str(QCS_UTF8);
+  qore_size_t clen = 0;
+  for (int i = 0; i < 100; ++i) {
+    str.concat("ab\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80");
+    clen += 5;
+    if (!(i % 7)) {
+      // long ASCII runs are indexed a word at a time
+      str.concat("0123456789abcdefghijklmnopqrstuvwxyz");
+      clen += 36;
+    }
+  }
+  check_chars(str, clen);
+  assert(qore_string_private::get(str)->char_index.load());
+
+  ExceptionSink xsink;
+  QoreString needle("\xf0\x9f\x98\x80ab", QCS_UTF8);
+  assert(str.index(needle, 0, &xsink) == 45);
+  assert(str.index(needle, 46, &xsink) == 50);
+  assert(str.rindex(needle, -1, &xsink) == (qore_offset_t)clen - 47);
+  assert(!xsink);
+
+  // appending data keeps the index for the existing data
+  str.concat("\xc3\xa4z");
+  clen += 2;
+  assert(qore_string_private::get(str)->char_index.load());
+  check_chars(str, clen);
+
+  // the index is extended over data appended after it was built
+  const qore_string_char_index* ci = qore_string_private::get(str)->char_index.load();
+  qore_size_t indexed = ci->len;
+  for (int i = 0; i < 50; ++i) {
+    str.concat("x\xe2\x82\xac");
+    clen += 2;
+    // multi-byte characters appended a byte at a time are only indexed when complete
+    str.concat('\xc3');
+    str.concat('\xa4');
+    ++clen;
+  }
+  str.concat('y');
+  ++clen;
+  assert(qore_string_private::get(str)->char_index.load() == ci);
+  assert(ci->len == str.size());
+  assert(ci->len > indexed);
+  assert(ci->chars == clen);
+  check_chars(str, clen);
+
+  // other changes discard the index
+  str.splice(0, 2, &xsink);
+  assert(!xsink);
+  assert(!qore_string_private::get(str)->char_index.load());
+  clen -= 2;
+  check_chars(str, clen);
+  str.terminate(str.size() - 1);
+  --clen;
+  check_chars(str, clen);
+  str.replaceChar(9, 'x');
+  check_chars(str, clen);
+
+  // replacing the data with data of the same byte length but different characters
+  std::string ascii(str.size(), 'a');
+  QoreString same_size(ascii, QCS_UTF8);
+  check_chars(str, clen);
+  str.set(same_size);
+  check_chars(str, str.size());
+
+  // copies do not share the index
+  QoreString copy(str);
+  assert(!qore_string_private::get(copy)->char_index.load());
+  check_chars(copy, clen);
+}
+
+TEST()
+{
+  printf("benchmarking character iteration over a multi-byte string\n");
+  QoreString str(QCS_UTF8);
+  for (int i = 0; i < 20000; ++i) {
+    str.concat(i % 10 ? "abcd" : "\xc3\xa4\xc3\xb6");
+  }
+  ExceptionSink xsink;
+  int64 start = q_clock_getmicros();
+  qore_size_t len = str.length();
+  for (qore_size_t i = 0; i < len; ++i) {
+    std::unique_ptr<QoreString> c(str.substr(i, 1, &xsink));
+    assert(c.get());
+  }
+  assert(!xsink);
+  printf("  %lld characters: %lld us\n", (long long)len, (long long)(q_clock_getmicros() - start));
+}
+
+TEST()
+{
+  printf("testing base64 and hex encoding\n");
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    data += (char)(i * 7);
+  }
+  ExceptionSink xsink;
+  for (size_t len = 0; len < 10; ++len) {
+    QoreString b64;
+    b64.concatBase64(data.c_str(), len);
+    assert(b64.size() == q_base64_encoded_len(len));
+    SimpleRefHolder<BinaryNode> b(b64.parseBase64(&xsink));
+    assert(b->size() == len);
+    assert(!memcmp(b->getPtr(), data.c_str(), len));
+  }
+
+  // line breaks go after every maxlinelen characters, before the padding
+  QoreString lines;
+  lines.concatBase64("ABCD", 4, 2);
+  assert(lines == "QU\r\nJD\r\nRA\r\n==");
+
+  QoreString b64;
+  b64.concatBase64(data.c_str(), data.size(), 76);
+  SimpleRefHolder<BinaryNode> b(b64.parseBase64(&xsink));
+  assert(!xsink);
+  assert(b->size() == data.size() && !memcmp(b->getPtr(), data.c_str(), data.size()));
+
+  QoreString hex;
+  hex.concatHex(data.c_str(), data.size());
+  assert(hex.size() == data.size() * 2);
+  assert(!strncmp(hex.c_str(), "00070e151c", 10));
+  b = hex.parseHex(&xsink);
+  assert(!xsink);
+  assert(b->size() == data.size() && !memcmp(b->getPtr(), data.c_str(), data.size()));
+}
+
+// the implementations replaced by the codec kernels, kept here as the benchmark baseline
+static void old_base64_concat(QoreString& str, unsigned char c, qore_size_t& linelen, qore_size_t maxlinelen) {
+  str.concat(table64[c]);
+  ++linelen;
+  if (maxlinelen > 0 && linelen == maxlinelen) {
+    str.concat("\r\n");
+    linelen = 0;
+  }
+}
+
+static void old_concat_base64(QoreString& str, const char* bbuf, qore_size_t size, qore_size_t maxlinelen) {
+  qore_size_t linelen = 0;
+  const unsigned char* p = (const unsigned char*)bbuf;
+  const unsigned char* endbuf = p + size;
+  while (p < endbuf) {
+    old_base64_concat(str, p[0] >> 2, linelen, maxlinelen);
+    unsigned char c = (p[0] & 3) << 4;
+    if ((endbuf - p) == 1) {
+      old_base64_concat(str, c, linelen, maxlinelen);
+      str.concat("==");
+      break;
+    }
+    c |= p[1] >> 4;
+    old_base64_concat(str, c, linelen, maxlinelen);
+    c = (p[1] & 15) << 2;
+    if ((endbuf - p) == 2) {
+      old_base64_concat(str, c, linelen, maxlinelen);
+      str.concat('=');
+      break;
+    }
+    c |= p[2] >> 6;
+    old_base64_concat(str, c, linelen, maxlinelen);
+    old_base64_concat(str, p[2] & 63, linelen, maxlinelen);
+    p += 3;
+  }
+}
+
+static int old_base64_value(const char* buf, qore_size_t& offset) {
+  while (buf[offset] == '\n' || buf[offset] == '\r') {
+    ++offset;
+  }
+  char c = buf[offset];
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+  if (c >= 'a' && c <= 'z') {
+    return c - 'a' + 26;
+  }
+  if (c >= '0' && c <= '9') {
+    return c - '0' + 52;
+  }
+  if (c == '+') {
+    return 62;
+  }
+  return c == '/' ? 63 : -1;
+}
+
+// decodes valid base64 input only
+static std::string old_parse_base64(const char* buf, qore_size_t len) {
+  std::string rv;
+  qore_size_t pos = 0;
+  while (pos < len) {
+    int b = old_base64_value(buf, pos);
+    if (!buf[pos]) {
+      break;
+    }
+    ++pos;
+    int c = old_base64_value(buf, pos);
+    rv += (char)((b << 2) | (c >> 4));
+    ++pos;
+    if (buf[pos] == '=') {
+      break;
+    }
+    b = (c & 15) << 4;
+    c = old_base64_value(buf, pos);
+    rv += (char)(b | (c >> 2));
+    ++pos;
+    if (buf[pos] == '=') {
+      break;
+    }
+    b = (c & 3) << 6;
+    c = old_base64_value(buf, pos);
+    rv += (char)(b | c);
+    ++pos;
+  }
+  return rv;
+}
+
+static void old_concat_hex(QoreString& str, const char* binbuf, qore_size_t size) {
+  const unsigned char* p = (const unsigned char*)binbuf;
+  const unsigned char* endbuf = p + size;
+  while (p < endbuf) {
+    char c = (*p & 0xf0) >> 4;
+    str.concat((char)(c + (c > 9 ? 87 : 48)));
+    c = *p & 0x0f;
+    str.concat((char)(c + (c > 9 ? 87 : 48)));
+    p++;
+  }
+}
+
+static std::string old_parse_hex(const char* buf, qore_size_t len, ExceptionSink* xsink) {
+  std::string rv;
+  const char* end = buf + len;
+  while (buf < end) {
+    int b = get_nibble(*buf++, xsink);
+    int l = get_nibble(*buf++, xsink);
+    rv += (char)(b << 4 | l);
+  }
+  return rv;
+}
+
+static void print_bench(const char* name, int64 old_us, int64 new_us) {
+  printf("  %s: old %lld us, new %lld us (%.1fx)\n", name, (long long)old_us, (long long)new_us,
+    new_us ? (double)old_us / new_us : 0.0);
+}
+
+TEST()
+{
+  printf("benchmarking base64 and hex encoding and decoding against the previous implementation (SIMD: %s)\n",
+    q_codec_simd() ? "yes" : "no");
+  std::string data;
+  for (int i = 0; i < 1024 * 1024; ++i) {
+    data += (char)(i * 31);
+  }
+  ExceptionSink xsink;
+
+  int64 start = q_clock_getmicros();
+  QoreString old_b64;
+  old_concat_base64(old_b64, data.c_str(), data.size(), 76);
+  int64 old_us = q_clock_getmicros() - start;
+  start = q_clock_getmicros();
+  QoreString b64;
+  b64.concatBase64(data.c_str(), data.size(), 76);
+  int64 new_us = q_clock_getmicros() - start;
+  assert(b64 == old_b64);
+  print_bench("base64 encode 1MB", old_us, new_us);
+
+  start = q_clock_getmicros();
+  std::string old_dec = old_parse_base64(b64.c_str(), b64.size());
+  old_us = q_clock_getmicros() - start;
+  start = q_clock_getmicros();
+  SimpleRefHolder<BinaryNode> b(b64.parseBase64(&xsink));
+  new_us = q_clock_getmicros() - start;
+  assert(b->size() == data.size() && old_dec == data);
+  assert(!memcmp(b->getPtr(), data.c_str(), data.size()));
+  print_bench("base64 decode 1MB", old_us, new_us);
+
+  start = q_clock_getmicros();
+  QoreString old_hex;
+  old_concat_hex(old_hex, data.c_str(), data.size());
+  old_us = q_clock_getmicros() - start;
+  start = q_clock_getmicros();
+  QoreString hex;
+  hex.concatHex(data.c_str(), data.size());
+  new_us = q_clock_getmicros() - start;
+  assert(hex == old_hex);
+  print_bench("hex encode 1MB", old_us, new_us);
+
+  start = q_clock_getmicros();
+  old_dec = old_parse_hex(hex.c_str(), hex.size(), &xsink);
+  old_us = q_clock_getmicros() - start;
+  start = q_clock_getmicros();
+  b = hex.parseHex(&xsink);
+  new_us = q_clock_getmicros() - start;
+  assert(!xsink);
+  assert(b->size() == data.size() && old_dec == data);
+  assert(!memcmp(b->getPtr(), data.c_str(), data.size()));
+  print_bench("hex decode 1MB", old_us, new_us);
+}
+
 } // namespace
 
 #endif // DEBUG
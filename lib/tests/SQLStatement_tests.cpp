@@ -0,0 +1,369 @@
+// Unit tests for QoreSQLStatement.cpp
+
+#ifdef DEBUG
+#include "qore/intern/ManagedDatasource.h"
+
+namespace SQLStatement_tests {
+
+// state of the in-memory test driver
+static int ds_data;
+static int stmt_data;
+static int prepare_calls;
+static int select_calls;
+static int bind_calls;
+static int bind_array_calls;
+static int exec_calls;
+static int64 last_rows;
+static int64 last_cols;
+static int fetch_remaining;
+
+static int test_open(Datasource* ds, ExceptionSink* xsink) {
+  ds->setQoreEncoding(QCS_UTF8);
+  ds->setPrivateData(&ds_data);
+  return 0;
+}
+
+static int test_close(Datasource* ds) {
+  ds->setPrivateData(nullptr);
+  return 0;
+}
+
+static QoreValue test_select(Datasource* ds, const QoreString* str, const QoreListNode* args, ExceptionSink* xsink) {
+  ++select_calls;
+  return QoreValue();
+}
+
+static int test_commit(Datasource* ds, ExceptionSink* xsink) {
+  return 0;
+}
+
+static int test_stmt_prepare(SQLStatement* stmt, const QoreString& str, const QoreListNode* args, ExceptionSink* xsink) {
+  ++prepare_calls;
+  stmt->setPrivateData(&stmt_data);
+  return 0;
+}
+
+static int test_stmt_prepare_raw(SQLStatement* stmt, const QoreString& str, ExceptionSink* xsink) {
+  stmt->setPrivateData(&stmt_data);
+  return 0;
+}
+
+static int test_stmt_bind(SQLStatement* stmt, const QoreListNode& l, ExceptionSink* xsink) {
+  ++bind_calls;
+  last_rows = 1;
+  last_cols = l.size();
+  return 0;
+}
+
+static int test_stmt_bind_array(SQLStatement* stmt, const QoreListNode& l, int64 rows, ExceptionSink* xsink) {
+  ++bind_array_calls;
+  last_rows = rows;
+  last_cols = l.size();
+  return 0;
+}
+
+static int test_stmt_exec(SQLStatement* stmt, ExceptionSink* xsink) {
+  ++exec_calls;
+  return 0;
+}
+
+static int test_stmt_affected_rows(SQLStatement* stmt, ExceptionSink* xsink) {
+  return (int)last_rows;
+}
+
+static int test_stmt_define(SQLStatement* stmt, ExceptionSink* xsink) {
+  return 0;
+}
+
+static QoreHashNode* test_stmt_get_output(SQLStatement* stmt, ExceptionSink* xsink) {
+  return new QoreHashNode(autoTypeInfo);
+}
+
+static QoreHashNode* test_stmt_fetch_row(SQLStatement* stmt, ExceptionSink* xsink) {
+  return new QoreHashNode(autoTypeInfo);
+}
+
+static QoreListNode* test_stmt_fetch_rows(SQLStatement* stmt, int rows, ExceptionSink* xsink) {
+  return new QoreListNode(autoTypeInfo);
+}
+
+// returns the next "rows" rows of the "fetch_remaining" rows left in the result set
+static QoreHashNode* test_stmt_fetch_columns(SQLStatement* stmt, int rows, ExceptionSink* xsink) {
+  if (rows <= 0 || rows > fetch_remaining)
+    rows = fetch_remaining;
+  QoreHashNode* h = new QoreHashNode(autoTypeInfo);
+  QoreListNode* id = new QoreListNode(autoTypeInfo);
+  QoreListNode* name = new QoreListNode(autoTypeInfo);
+  QoreListNode* opt = new QoreListNode(autoTypeInfo);
+  for (int i = 0; i < rows; ++i) {
+    id->push(fetch_remaining - i, xsink);
+    name->push(new QoreStringNode("name"), xsink);
+    opt->push(i % 2 ? QoreValue(&Null) : QoreValue(1.5), xsink);
+  }
+  fetch_remaining -= rows;
+  h->setKeyValue("id", id, xsink);
+  h->setKeyValue("name", name, xsink);
+  h->setKeyValue("opt", opt, xsink);
+  return h;
+}
+
+static bool test_stmt_next(SQLStatement* stmt, ExceptionSink* xsink) {
+  return false;
+}
+
+static int test_stmt_close(SQLStatement* stmt, ExceptionSink* xsink) {
+  stmt->setPrivateData(nullptr);
+  return 0;
+}
+
+static DBIDriver* get_test_driver(const char* name, bool bind_array) {
+  qore_dbi_method_list methods;
+  methods.add(QDBI_METHOD_OPEN, test_open);
+  methods.add(QDBI_METHOD_CLOSE, test_close);
+  methods.add(QDBI_METHOD_SELECT, test_select);
+  methods.add(QDBI_METHOD_SELECT_ROWS, test_select);
+  methods.add(QDBI_METHOD_EXEC, test_select);
+  methods.add(QDBI_METHOD_COMMIT, test_commit);
+  methods.add(QDBI_METHOD_ROLLBACK, test_commit);
+  methods.add(QDBI_METHOD_STMT_PREPARE, test_stmt_prepare);
+  methods.add(QDBI_METHOD_STMT_PREPARE_RAW, test_stmt_prepare_raw);
+  methods.add(QDBI_METHOD_STMT_BIND, test_stmt_bind);
+  methods.add(QDBI_METHOD_STMT_BIND_VALUES, test_stmt_bind);
+  if (bind_array)
+    methods.add(QDBI_METHOD_STMT_BIND_ARRAY, test_stmt_bind_array);
+  methods.add(QDBI_METHOD_STMT_EXEC, test_stmt_exec);
+  methods.add(QDBI_METHOD_STMT_DEFINE, test_stmt_define);
+  methods.add(QDBI_METHOD_STMT_FETCH_ROW, test_stmt_fetch_row);
+  methods.add(QDBI_METHOD_STMT_FETCH_ROWS, test_stmt_fetch_rows);
+  methods.add(QDBI_METHOD_STMT_FETCH_COLUMNS, test_stmt_fetch_columns);
+  methods.add(QDBI_METHOD_STMT_NEXT, test_stmt_next);
+  methods.add(QDBI_METHOD_STMT_CLOSE, test_stmt_close);
+  methods.add(QDBI_METHOD_STMT_AFFECTED_ROWS, test_stmt_affected_rows);
+  methods.add(QDBI_METHOD_STMT_GET_OUTPUT, test_stmt_get_output);
+  methods.add(QDBI_METHOD_STMT_GET_OUTPUT_ROWS, test_stmt_get_output);
+
+  return DBI.registerDriver(name, methods, DBI_CAP_HAS_STATEMENT);
+}
+
+// returns the number of affected rows for a bulk insert of 3 rows with a constant column
+static int64 exec_array_test(DBIDriver* drv) {
+  ExceptionSink xsink;
+  ManagedDatasource* ds = new ManagedDatasource(drv);
+  QoreSQLStatement* stmt = new QoreSQLStatement(ds);
+
+  QoreString sql("insert into test (id, name, type) values (%v, %v, %v)");
+  stmt->prepare(sql, nullptr, &xsink);
+  assert(!xsink);
+
+  ReferenceHolder<QoreHashNode> data(new QoreHashNode(autoTypeInfo), &xsink);
+  QoreListNode* l = new QoreListNode(autoTypeInfo);
+  for (int i = 0; i < 3; ++i)
+    l->push(i, &xsink);
+  data->setKeyValue("id", l, &xsink);
+  l = new QoreListNode(autoTypeInfo);
+  l->push(new QoreStringNode("one"), &xsink);
+  l->push(new QoreStringNode("two"), &xsink);
+  l->push(new QoreStringNode("three"), &xsink);
+  data->setKeyValue("name", l, &xsink);
+  data->setKeyValue("type", new QoreStringNode("const"), &xsink);
+
+  int64 rc = stmt->execArray(**data, &xsink);
+  assert(!xsink);
+
+  // column arrays of differing lengths are rejected before anything is bound
+  l = new QoreListNode(autoTypeInfo);
+  l->push(1, &xsink);
+  data->setKeyValue("name", l, &xsink);
+  int calls = bind_calls + bind_array_calls;
+  assert(stmt->execArray(**data, &xsink) == -1);
+  assert(xsink);
+  assert(calls == bind_calls + bind_array_calls);
+  xsink.clear();
+
+  stmt->commit(&xsink);
+  assert(!xsink);
+  stmt->deref(&xsink);
+  ds->deref(&xsink);
+  assert(!xsink);
+  return rc;
+}
+
+TEST()
+{
+  printf("testing SQLStatement::execArray() with array binding\n");
+  DBIDriver* drv = get_test_driver("execarray-test", true);
+  assert(qore_dbi_private::get(*drv)->getCaps() & DBI_CAP_HAS_STMT_BIND_ARRAY);
+
+  bind_calls = bind_array_calls = exec_calls = 0;
+  assert(exec_array_test(drv) == 3);
+  // all rows are bound and executed in a single round trip
+  assert(bind_array_calls == 1);
+  assert(!bind_calls);
+  assert(exec_calls == 1);
+  assert(last_rows == 3);
+  assert(last_cols == 3);
+}
+
+TEST()
+{
+  printf("testing SQLStatement::execArray() without array binding\n");
+  DBIDriver* drv = get_test_driver("execarray-test-rows", false);
+  assert(!(qore_dbi_private::get(*drv)->getCaps() & DBI_CAP_HAS_STMT_BIND_ARRAY));
+
+  bind_calls = bind_array_calls = exec_calls = 0;
+  assert(exec_array_test(drv) == 3);
+  // the statement is executed once for each row
+  assert(!bind_array_calls);
+  assert(bind_calls == 3);
+  assert(exec_calls == 3);
+  assert(last_cols == 3);
+}
+
+TEST()
+{
+  printf("testing SQLStatement::fetchBlock()\n");
+  ExceptionSink xsink;
+  ManagedDatasource* ds = new ManagedDatasource(get_test_driver("fetchblock-test", false));
+  QoreSQLStatement* stmt = new QoreSQLStatement(ds);
+
+  QoreString sql("select id, name, opt from test");
+  stmt->prepare(sql, nullptr, &xsink);
+  assert(!xsink);
+
+  fetch_remaining = 5;
+  int64 next_id = 5;
+  int blocks = 0;
+  while (true) {
+    QoreSQLResultBlock* b = stmt->fetchBlock(2, &xsink);
+    assert(!xsink);
+    if (!b)
+      break;
+    ++blocks;
+    assert(b->size() == (blocks < 3 ? 2 : 1));
+    assert(b->columnCount() == 3);
+
+    ReferenceHolder<QoreHashNode> types(b->getColumnTypes(), &xsink);
+    assert(!strcmp(types->getKeyValue("id").get<const QoreStringNode>()->c_str(), "int"));
+    assert(!strcmp(types->getKeyValue("name").get<const QoreStringNode>()->c_str(), "string"));
+    // columns with NULL values are not typed
+    assert(!strcmp(types->getKeyValue("opt").get<const QoreStringNode>()->c_str(), b->size() > 1 ? "auto" : "float"));
+
+    ReferenceHolder<QoreListNode> id(b->getColumn("id", &xsink), &xsink);
+    assert(id->size() == b->size());
+    assert(QoreTypeInfo::getComplexListValueType(id->getTypeInfo()) == bigIntTypeInfo);
+
+    for (size_t i = 0; i < b->size(); ++i, --next_id) {
+      assert(b->getValue(i, "id", &xsink).getAsBigInt() == next_id);
+      ReferenceHolder<QoreHashNode> row(b->getRow(i, &xsink), &xsink);
+      assert(row->size() == 3);
+      assert(row->getKeyValue("id").getAsBigInt() == next_id);
+    }
+
+    // invalid rows and columns raise exceptions
+    assert(!b->getRow(b->size(), &xsink));
+    assert(xsink);
+    xsink.clear();
+    b->getValue(0, "none", &xsink);
+    assert(xsink);
+    xsink.clear();
+
+    b->deref(&xsink);
+  }
+  assert(blocks == 3);
+  assert(!next_id);
+
+  stmt->commit(&xsink);
+  assert(!xsink);
+  stmt->deref(&xsink);
+  ds->deref(&xsink);
+  assert(!xsink);
+}
+
+static int64 get_cache_stat(ManagedDatasource* ds, const char* key) {
+  ExceptionSink xsink;
+  ValueHolder h(ds->getOption(DBI_OPT_STMT_CACHE_STATS, &xsink), &xsink);
+  assert(!xsink);
+  return h->get<const QoreHashNode>()->getKeyValue(key).getAsBigInt();
+}
+
+TEST()
+{
+  printf("testing the Datasource prepared statement cache\n");
+  ExceptionSink xsink;
+  ManagedDatasource* ds = new ManagedDatasource(get_test_driver("stmtcache-test", false));
+  ds->setOption(DBI_OPT_STMT_CACHE, 2, &xsink);
+  assert(!xsink);
+  assert(ds->getOption(DBI_OPT_STMT_CACHE, &xsink).getAsBigInt() == 2);
+
+  ReferenceHolder<QoreListNode> args(new QoreListNode(autoTypeInfo), &xsink);
+  args->push(1, &xsink);
+
+  prepare_calls = select_calls = exec_calls = 0;
+  QoreString sql("insert into test (id) values (%v)");
+  for (int i = 0; i < 3; ++i)
+    assert(ds->exec(&sql, *args, &xsink).getAsBigInt() == 1);
+  assert(!xsink);
+  // the statement is only prepared once
+  assert(prepare_calls == 1);
+  assert(exec_calls == 3);
+  assert(!select_calls);
+  assert(get_cache_stat(ds, "hits") == 2);
+  assert(get_cache_stat(ds, "misses") == 1);
+
+  // queries, statements without bind values, and SQL with inline arguments are not cached
+  QoreString query("select * from test where id = %v");
+  ds->exec(&query, *args, &xsink);
+  ds->exec(&sql, nullptr, &xsink);
+  QoreString inline_sql("delete from test where id = %d");
+  ds->exec(&inline_sql, *args, &xsink);
+  assert(!xsink);
+  assert(select_calls == 3);
+  assert(prepare_calls == 1);
+
+  // statements with output placeholders return a hash of output values and are not cached either
+  QoreString returning_sql("insert into test (id) values (%v) returning id into :id");
+  ds->exec(&returning_sql, *args, &xsink);
+  ReferenceHolder<QoreListNode> spec_args(args->copy(), &xsink);
+  spec_args->push(new QoreHashNode(autoTypeInfo), &xsink);
+  ds->exec(&sql, *spec_args, &xsink);
+  assert(!xsink);
+  assert(select_calls == 5);
+  assert(prepare_calls == 1);
+
+  // the least-recently used statement is closed when the cache is full
+  QoreString sql2("update test set id = %v");
+  QoreString sql3("delete from test where id = %v");
+  ds->exec(&sql2, *args, &xsink);
+  ds->exec(&sql, *args, &xsink);
+  ds->exec(&sql3, *args, &xsink);
+  assert(!xsink);
+  assert(prepare_calls == 3);
+  assert(get_cache_stat(ds, "count") == 2);
+  assert(get_cache_stat(ds, "evictions") == 1);
+  ds->exec(&sql, *args, &xsink);
+  assert(prepare_calls == 3);
+
+  // type casts and colons in string literals are not placeholders
+  QoreString cast_sql("update test set id = %v::int, name = 'a:b'");
+  ds->exec(&cast_sql, *args, &xsink);
+  assert(!xsink);
+  assert(prepare_calls == 4);
+  assert(select_calls == 5);
+
+  ds->commit(&xsink);
+  assert(!xsink);
+  // the cache survives transactions but not the connection
+  assert(get_cache_stat(ds, "count") == 2);
+  ds->close(&xsink);
+  assert(!xsink);
+  assert(!get_cache_stat(ds, "count"));
+  assert(get_cache_stat(ds, "invalidations") == 1);
+
+  ds->deref(&xsink);
+  assert(!xsink);
+}
+
+} // namespace
+#endif // DEBUG
+
+// EOF
@@ -40,6 +40,7 @@
 #include "qore/intern/qore_program_private.h"
 #include "qore/intern/ModuleInfo.h"
 #include "qore/intern/QoreHashNodeIntern.h"
+#include "qore/intern/qore_list_private.h"
 #include "qore/intern/StatementBlock.h"
 #include "qore/intern/Sequence.h"
 
@@ -66,6 +67,14 @@
 #include <sys/time.h>
 #include <vector>
 
+// the maximum number of argument lists cached per thread for function and method calls
+#define QORE_ARG_LIST_CACHE_SIZE 16
+
+// the default maximum number of idle OS threads kept for new Qore threads
+#define QORE_THREAD_CACHE_SIZE 32
+// the time in milliseconds an idle OS thread waits for a new Qore thread before terminating
+#define QORE_THREAD_CACHE_IDLE_MS 30000
+
 #if defined(__ia64) && defined(__LP64__)
 #define IA64_64
 #endif
@@ -101,6 +110,7 @@ QorePThreadAttr ta_default;
 
 DLLLOCAL QoreThreadList thread_list;
 
+DLLLOCAL QoreClass* initFutureClass(QoreNamespace& ns);
 DLLLOCAL QoreClass* initThreadPoolClass(QoreNamespace& ns);
 
 class ArgvRefStack {
@@ -308,6 +318,10 @@ public:
     // current implicit argument
     QoreListNode* current_implicit_arg = nullptr;
 
+    // argument lists released by completed calls for reuse by the next calls
+    QoreListNode* arg_list_cache[QORE_ARG_LIST_CACHE_SIZE];
+    unsigned arg_list_cache_count = 0;
+
     // this data structure is stored in the current Program object on a per-thread basis
     ThreadLocalProgramData* tlpd = nullptr;
 
@@ -343,6 +357,8 @@ public:
 
     // parse-time implicit argument type
     const QoreTypeInfo* implicit_arg_type_info = nullptr;
+    // number of implicit argument references parsed in this thread
+    unsigned implicit_arg_refs = 0;
 
     // current implicit element offset
     int element = 0;
@@ -418,6 +434,11 @@ public:
         assert(!trlist->prev);
         delete pcs;
         delete trlist;
+
+        // cached argument lists are always empty
+        for (unsigned i = 0; i < arg_list_cache_count; ++i) {
+            arg_list_cache[i]->deref(nullptr);
+        }
     }
 
     DLLLOCAL void endFileParsing() {
@@ -926,6 +947,11 @@ LocalVarValue* thread_find_lvar(const char* id) {
    return td->tlpd->lvstack.find(id);
 }
 
+LocalVarValue* thread_find_lvar(const char* id, std::atomic<int>& slot) {
+   ThreadData* td = thread_data.get();
+   return td->tlpd->lvstack.find(id, slot);
+}
+
 ClosureVarValue* thread_instantiate_closure_var(const char* n_id, const QoreTypeInfo* typeInfo, QoreValue& nval, bool assign) {
    return thread_data.get()->tlpd->cvstack.instantiate(n_id, typeInfo, nval, assign);
 }
@@ -964,6 +990,14 @@ const QoreTypeInfo* parse_get_implicit_arg_type_info() {
    return thread_data.get()->implicit_arg_type_info;
 }
 
+void parse_ref_implicit_arg() {
+   ++thread_data.get()->implicit_arg_refs;
+}
+
+unsigned parse_get_implicit_arg_refs() {
+   return thread_data.get()->implicit_arg_refs;
+}
+
 void parse_set_try_reexport(bool tr) {
    thread_data.get()->try_reexport = tr;
 }
@@ -1731,6 +1765,33 @@ SingleArgvContextHelper::~SingleArgvContextHelper() {
     td->current_implicit_arg = old_argv;
 }
 
+QoreListNode* thread_get_arg_list(size_t size) {
+    ThreadData* td = thread_data.get();
+    QoreListNode* l = td->arg_list_cache_count
+        ? td->arg_list_cache[--td->arg_list_cache_count]
+        : new QoreListNode(autoTypeInfo);
+    qore_list_private::get(*l)->reserve(size);
+    return l;
+}
+
+void thread_release_arg_list(QoreListNode* l, ExceptionSink* xsink) {
+    // the list can only be reused if the call did not keep a reference to it
+    if (!l->is_unique()) {
+        l->deref(xsink);
+        return;
+    }
+
+    // clearing the list can run destructors that make calls, so the list is cached afterwards
+    qore_list_private::get(*l)->clearArgs(xsink);
+
+    ThreadData* td = thread_data.get();
+    if (td->arg_list_cache_count == QORE_ARG_LIST_CACHE_SIZE) {
+        l->deref(xsink);
+        return;
+    }
+    td->arg_list_cache[td->arg_list_cache_count++] = l;
+}
+
 const QoreListNode* thread_get_implicit_args() {
    //printd(5, "thread_get_implicit_args() returning %p\n", thread_data.get()->current_implicit_arg);
    return thread_data.get()->current_implicit_arg;
@@ -2315,8 +2376,11 @@ struct ThreadArg {
    q_thread_t f;
    void* arg;
    int tid;
+   // the counter decremented when the thread terminates
+   QoreCounter* tcount;
 
-   DLLLOCAL ThreadArg(q_thread_t n_f, void* a, int n_tid) : f(n_f), arg(a), tid(n_tid) {
+   DLLLOCAL ThreadArg(q_thread_t n_f, void* a, int n_tid, QoreCounter* n_tcount) : f(n_f), arg(a), tid(n_tid),
+         tcount(n_tcount) {
    }
 
    DLLLOCAL void run(ExceptionSink* xsink) {
@@ -2331,19 +2395,241 @@ static void set_tid_thread_name(int tid) {
 #endif
 }
 
+// runs a Qore thread in a thread from the thread cache; must release the TID and decrement the thread counter
+typedef void (*q_cached_thread_t)(void* arg);
+
+// a Qore thread to be run by a thread from the thread cache
+struct ThreadCacheJob {
+    q_cached_thread_t f = nullptr;
+    void* arg = nullptr;
+    // the time the thread was started in microseconds
+    int64 start_us = 0;
+
+    DLLLOCAL ThreadCacheJob() {
+    }
+
+    DLLLOCAL ThreadCacheJob(q_cached_thread_t f, void* arg, int64 start_us) : f(f), arg(arg), start_us(start_us) {
+    }
+};
+
+namespace {
+    extern "C" void* q_cached_thread(void* x);
+}
+
+// keeps idle OS threads for new Qore threads
+/** every Qore thread gets a new TID and new thread data, only the OS thread and its stack are reused
+*/
+class QoreThreadCache {
+public:
+    // runs the Qore thread in an idle OS thread or creates a new one; returns 0 or the error from pthread_create()
+    DLLLOCAL int start(q_cached_thread_t f, void* arg) {
+        int64 now = q_clock_getmicros();
+        {
+            AutoLocker al(lck);
+            if (idle_head) {
+                IdleThread* t = idle_head;
+                idle_head = t->next;
+                --idle;
+                t->job = ThreadCacheJob(f, arg, now);
+                t->cond.signal();
+                return 0;
+            }
+        }
+
+        ThreadCacheJob* job = new ThreadCacheJob(f, arg, now);
+        pthread_t ptid;
+        int rc = pthread_create(&ptid, ta_default.get_ptr(), q_cached_thread, job);
+        if (rc) {
+            delete job;
+        }
+        return rc;
+    }
+
+    // called in the OS thread when it has terminated a Qore thread; returns false if the OS thread should terminate
+    DLLLOCAL bool park(ThreadCacheJob& job) {
+        IdleThread t;
+        AutoLocker al(lck);
+        if (shutting_down || idle >= max_idle) {
+            return false;
+        }
+
+        t.next = idle_head;
+        idle_head = &t;
+        if (++idle > peak_idle) {
+            peak_idle = idle;
+        }
+
+        while (!t.job.f && !t.exit) {
+            if (t.cond.wait2(&lck, QORE_THREAD_CACHE_IDLE_MS) && !t.job.f && !t.exit) {
+                // timeout: remove the thread from the cache
+                IdleThread** i = &idle_head;
+                while (*i != &t) {
+                    i = &(*i)->next;
+                }
+                *i = t.next;
+                --idle;
+                return false;
+            }
+        }
+
+        if (t.exit) {
+            if (!--exiting) {
+                exit_cond.broadcast();
+            }
+            return false;
+        }
+
+        job = t.job;
+        return true;
+    }
+
+    // called in the OS thread before a Qore thread is run
+    DLLLOCAL void startJob(const ThreadCacheJob& job, bool reused) {
+        int64 us = q_clock_getmicros() - job.start_us;
+        if (reused) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            hit_us.fetch_add(us, std::memory_order_relaxed);
+        } else {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            miss_us.fetch_add(us, std::memory_order_relaxed);
+        }
+        int64 max = max_us.load(std::memory_order_relaxed);
+        while (us > max && !max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    // terminates all idle threads
+    DLLLOCAL void flush() {
+        AutoLocker al(lck);
+        flushIntern();
+    }
+
+    // terminates all idle threads and disables the cache
+    DLLLOCAL void shutdown() {
+        AutoLocker al(lck);
+        shutting_down = true;
+        flushIntern();
+        while (exiting) {
+            exit_cond.wait(&lck);
+        }
+    }
+
+    // sets the maximum number of idle threads and returns the previous value
+    DLLLOCAL unsigned setSize(unsigned size) {
+        AutoLocker al(lck);
+        unsigned rc = max_idle;
+        max_idle = size;
+        while (idle > max_idle) {
+            exitIntern();
+        }
+        return rc;
+    }
+
+    DLLLOCAL QoreHashNode* getInfo() {
+        ReferenceHolder<QoreHashNode> h(new QoreHashNode(autoTypeInfo), nullptr);
+        qore_hash_private* ph = qore_hash_private::get(**h);
+        {
+            AutoLocker al(lck);
+            ph->setKeyValueIntern("size", (int64)max_idle);
+            ph->setKeyValueIntern("idle", (int64)idle);
+            ph->setKeyValueIntern("peak_idle", (int64)peak_idle);
+        }
+        int64 h_cnt = hits.load(std::memory_order_relaxed);
+        int64 m_cnt = misses.load(std::memory_order_relaxed);
+        ph->setKeyValueIntern("hits", h_cnt);
+        ph->setKeyValueIntern("misses", m_cnt);
+        ph->setKeyValueIntern("hit_rate", (h_cnt + m_cnt) ? (double)h_cnt / (double)(h_cnt + m_cnt) : 0.0);
+        ph->setKeyValueIntern("avg_hit_start_us", h_cnt ? hit_us.load(std::memory_order_relaxed) / h_cnt : 0);
+        ph->setKeyValueIntern("avg_miss_start_us", m_cnt ? miss_us.load(std::memory_order_relaxed) / m_cnt : 0);
+        ph->setKeyValueIntern("max_start_us", max_us.load(std::memory_order_relaxed));
+        ph->setKeyValueIntern("threads", (int64)thread_list.getNumThreads());
+        ph->setKeyValueIntern("peak_threads", (int64)thread_list.getPeakThreads());
+        return h.release();
+    }
+
+private:
+    // an idle thread waiting for a new Qore thread; lives on the stack of the idle thread
+    struct IdleThread {
+        QoreCondition cond;
+        ThreadCacheJob job;
+        IdleThread* next = nullptr;
+        // set if the thread should terminate
+        bool exit = false;
+    };
+
+    QoreThreadLock lck;
+    // signaled when all threads told to terminate have left the cache
+    QoreCondition exit_cond;
+    // the most recently parked thread is reused first
+    IdleThread* idle_head = nullptr;
+    unsigned idle = 0,
+        peak_idle = 0,
+        max_idle = QORE_THREAD_CACHE_SIZE,
+        // the number of threads told to terminate that have not yet left the cache
+        exiting = 0;
+    bool shutting_down = false;
+
+    // statistics
+    std::atomic<int64> hits = {0},
+        misses = {0},
+        hit_us = {0},
+        miss_us = {0},
+        max_us = {0};
+
+    // tells the most recently parked thread to terminate; must be called with the lock held
+    DLLLOCAL void exitIntern() {
+        IdleThread* t = idle_head;
+        idle_head = t->next;
+        --idle;
+        t->exit = true;
+        ++exiting;
+        t->cond.signal();
+    }
+
+    // must be called with the lock held
+    DLLLOCAL void flushIntern() {
+        while (idle_head) {
+            exitIntern();
+        }
+    }
+};
+
+static QoreThreadCache thread_cache;
+
 
 // put functions in an unnamed namespace to make them 'static extern "C"'
 namespace {
-    extern "C" void* q_run_thread(void* arg) {
+    extern "C" void* q_cached_thread(void* x) {
+        ThreadCacheJob job = *reinterpret_cast<ThreadCacheJob*>(x);
+        delete reinterpret_cast<ThreadCacheJob*>(x);
+
+        // the OS thread can run more than one Qore thread and is never joined
+        pthread_detach(pthread_self());
+
+        pthread_cleanup_push(qore_thread_cleanup, nullptr);
+
+        bool reused = false;
+        do {
+            thread_cache.startJob(job, reused);
+            job.f(job.arg);
+            reused = true;
+        } while (thread_cache.park(job));
+
+        pthread_cleanup_pop(0);
+        pthread_exit(0);
+        return 0;
+    }
+
+    void q_run_thread(void* arg) {
         ThreadArg* ta = (ThreadArg*)arg;
+        QoreCounter* tcount = ta->tcount;
 
         register_thread(ta->tid, pthread_self(), 0);
+        thread_list.setDetached(ta->tid);
         printd(5, "q_run_thread() ta: %p TID %d started\n", ta, ta->tid);
 
         set_tid_thread_name(ta->tid);
 
-        pthread_cleanup_push(qore_thread_cleanup, nullptr);
-
         {
             ExceptionSink xsink;
 
@@ -2381,23 +2667,20 @@ namespace {
             }
         }
 
-        pthread_cleanup_pop((int)1);
-        thread_counter.dec();
-        pthread_exit(0);
-        return 0;
+        qore_thread_cleanup();
+        tcount->dec();
     }
 
-    extern "C" void* op_background_thread(void* x) {
+    void op_background_thread(void* x) {
         BGThreadParams* btp = (BGThreadParams*) x;
         // register thread
         register_thread(btp->tid, pthread_self(), btp->pgm);
+        thread_list.setDetached(btp->tid);
         printd(5, "op_background_thread() btp: %p TID %d started\n", btp, btp->tid);
         //printf("op_background_thread() btp: %p TID %d started\n", btp, btp->tid);
 
         set_tid_thread_name(btp->tid);
 
-        pthread_cleanup_push(qore_thread_cleanup, nullptr);
-
         {
             ExceptionSink xsink;
 
@@ -2458,10 +2741,8 @@ namespace {
             }
         }
 
-        pthread_cleanup_pop(1);
+        qore_thread_cleanup();
         thread_counter.dec();
-        pthread_exit(0);
-        return 0;
     }
 }
 
@@ -2495,11 +2776,10 @@ QoreValue do_op_background(const QoreValue left, ExceptionSink* xsink) {
         return QoreValue();
     }
     //printd(5, "tp = %p\n", tp);
-    // create thread
+    // create thread or reuse an idle thread
     int rc;
-    pthread_t ptid;
 
-    //printd(5, "calling pthread_create(%p, %p, %p, %p)\n", &ptid, &ta_default, op_background_thread, tp);
+    //printd(5, "starting thread (%p, %p)\n", op_background_thread, tp);
     thread_counter.inc();
 
 #ifdef QORE_MANAGE_STACK
@@ -2507,7 +2787,7 @@ QoreValue do_op_background(const QoreValue left, ExceptionSink* xsink) {
     AutoLocker al(stack_lck);
 #endif
 
-    if ((rc = pthread_create(&ptid, ta_default.get_ptr(), op_background_thread, tp))) {
+    if ((rc = thread_cache.start(op_background_thread, tp))) {
         tp->cleanup(xsink);
         tp->del();
 
@@ -2516,11 +2796,11 @@ QoreValue do_op_background(const QoreValue left, ExceptionSink* xsink) {
         xsink->raiseErrnoException("THREAD-CREATION-FAILURE", rc, "could not create thread");
         return QoreValue();
     }
-    //printd(5, "pthread_create() new thread TID %d, pthread_create() returned %d\n", tid, rc);
+    //printd(5, "started new thread TID %d, returned %d\n", tid, rc);
     return tid;
 }
 
-int q_start_thread(ExceptionSink* xsink, q_thread_t f, void* arg) {
+static int q_start_thread_intern(ExceptionSink* xsink, q_thread_t f, void* arg, QoreCounter& tcount) {
     int tid = get_thread_entry();
     //printd(2, "got %d()\n", tid);
 
@@ -2530,23 +2810,22 @@ int q_start_thread(ExceptionSink* xsink, q_thread_t f, void* arg) {
         return -1;
     }
 
-    ThreadArg* ta = new ThreadArg(f, arg, tid);
+    ThreadArg* ta = new ThreadArg(f, arg, tid, &tcount);
 
     //printd(5, "tp = %p\n", tp);
-    // create thread
+    // create thread or reuse an idle thread
     int rc;
-    pthread_t ptid;
 
 #ifdef QORE_MANAGE_STACK
     // make sure accesses to ta_default are made locked
     AutoLocker al(stack_lck);
 #endif
 
-    //printd(5, "calling pthread_create(%p, %p, %p, %p)\n", &ptid, &ta_default, op_background_thread, tp);
-    thread_counter.inc();
-    if ((rc = pthread_create(&ptid, ta_default.get_ptr(), q_run_thread, ta))) {
+    //printd(5, "starting thread (%p, %p)\n", q_run_thread, ta);
+    tcount.inc();
+    if ((rc = thread_cache.start(q_run_thread, ta))) {
         delete ta;
-        thread_counter.dec();
+        tcount.dec();
         deregister_thread(tid);
         xsink->raiseErrnoException("THREAD-CREATION-FAILURE", rc, "could not create thread");
         return -1;
@@ -2555,6 +2834,14 @@ int q_start_thread(ExceptionSink* xsink, q_thread_t f, void* arg) {
     return tid;
 }
 
+int q_start_thread(ExceptionSink* xsink, q_thread_t f, void* arg) {
+    return q_start_thread_intern(xsink, f, arg, thread_counter);
+}
+
+int q_start_internal_thread(ExceptionSink* xsink, q_thread_t f, void* arg, QoreCounter& tcount) {
+    return q_start_thread_intern(xsink, f, arg, tcount);
+}
+
 // returns the default thread stack size for new threads
 size_t q_thread_get_stack_size() {
 #ifdef QORE_MANAGE_STACK
@@ -2579,6 +2866,8 @@ size_t q_thread_set_stack_size(size_t size, ExceptionSink* xsink) {
     }
     // make sure we check what was actually set
     qore_thread_stack_size = ta_default.getstacksize();
+    // idle threads have the old stack size
+    thread_cache.flush();
 
     return qore_thread_stack_size;
 #else
@@ -2727,6 +3016,7 @@ QoreNamespace* get_thread_ns(QoreNamespace &qorens) {
    Thread->addSystemClass(initAutoReadLockClass(*Thread));
    Thread->addSystemClass(initAutoWriteLockClass(*Thread));
 
+   Thread->addSystemClass(initFutureClass(*Thread));
    Thread->addSystemClass(initThreadPoolClass(*Thread));
 
    Thread->addSystemClass(initAbstractThreadResourceClass(*Thread));
@@ -2754,6 +3044,9 @@ void delete_qore_threads() {
     // mark threading as inactive
     threads_initialized = false;
 
+    // terminate idle threads
+    thread_cache.shutdown();
+
     pthread_mutexattr_destroy(&ma_recursive);
 
     assert(initial_thread);
@@ -2766,6 +3059,14 @@ void delete_qore_threads() {
 #endif
 }
 
+QoreHashNode* get_thread_cache_info() {
+    return thread_cache.getInfo();
+}
+
+unsigned set_thread_cache_size(unsigned size) {
+    return thread_cache.setSize(size);
+}
+
 QoreListNode* get_thread_list() {
     QoreListNode* l = new QoreListNode(bigIntTypeInfo);
 